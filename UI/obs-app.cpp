@@ -26,6 +26,7 @@
 #include <util/bmem.h>
 #include <util/dstr.h>
 #include <util/platform.h>
+#include <util/log-sink.h>
 #include <util/profiler.hpp>
 #include <obs-config.h>
 #include <obs.hpp>
@@ -59,6 +60,7 @@ using namespace std;
 static log_handler_t def_log_handler;
 
 static string currentLogFile;
+static log_sink_t *logSink = nullptr;
 static string lastLogFile;
 static string lastCrashLogFile;
 
@@ -66,6 +68,7 @@ bool portable_mode = false;
 static bool multi = false;
 static bool log_verbose = false;
 static bool unfiltered_log = false;
+static bool trace_lagged_frames = false;
 bool opt_start_streaming = false;
 bool opt_start_recording = false;
 bool opt_studio_mode = false;
@@ -232,10 +235,30 @@ string CurrentDateTimeString()
 	return buf;
 }
 
+/* lines go through the log sink when there is one, so the calling thread
+ * never waits for the disk */
+static void WriteLogLine(fstream &logFile, const string &line)
+{
+	if (logSink)
+		log_sink_write(logSink, line.c_str(), line.size());
+	else
+		logFile << line << flush;
+}
+
+static void WriteLogSinkData(void *param, const char *data, size_t size)
+{
+	fstream &logFile = *static_cast<fstream*>(param);
+	logFile.write(data, size);
+	logFile.flush();
+}
+
 static inline void LogString(fstream &logFile, const char *timeString,
 		char *str)
 {
-	logFile << timeString << str << endl;
+	string line = timeString;
+	line += str;
+	line += '\n';
+	WriteLogLine(logFile, line);
 }
 
 static inline void LogStringChunk(fstream &logFile, char *str)
@@ -300,10 +323,10 @@ static inline bool too_many_repeated_entries(fstream &logFile, const char *msg,
 	}
 
 	if (rep_count > MAX_REPEATED_LINES) {
-		logFile << CurrentTimeString() <<
-			": Last log entry repeated for " <<
-			to_string(rep_count - MAX_REPEATED_LINES) <<
-			" more lines" << endl;
+		WriteLogLine(logFile, CurrentTimeString() +
+			": Last log entry repeated for " +
+			to_string(rep_count - MAX_REPEATED_LINES) +
+			" more lines\n");
 	}
 
 	last_msg_ptr = msg;
@@ -986,14 +1009,21 @@ const char *OBSApp::GetRenderModule() const
 	const char *renderer = config_get_string(globalConfig, "Video",
 			"Renderer");
 
-	return (astrcmpi(renderer, "Direct3D 11") == 0) ?
-		DL_D3D11 : DL_OPENGL;
+	if (astrcmpi(renderer, "Direct3D 11") == 0)
+		return DL_D3D11;
+	if (astrcmpi(renderer, "Software") == 0)
+		return DL_SOFTWARE;
+
+	return DL_OPENGL;
 }
 
 static bool StartupOBS(const char *locale, profiler_name_store_t *store)
 {
 	char path[512];
 
+	if (GetConfigPath(path, sizeof(path), "obs-studio/effect_cache") > 0)
+		gs_effect_cache_set_dir(path);
+
 	if (GetConfigPath(path, sizeof(path), "obs-studio/plugin_config") <= 0)
 		return false;
 
@@ -1345,6 +1375,7 @@ static void create_log_file(fstream &logFile)
 
 	if (logFile.is_open()) {
 		delete_oldest_file(false, "obs-studio/logs");
+		logSink = log_sink_create(0, WriteLogSinkData, &logFile);
 		base_set_log_handler(do_log, &logFile);
 	} else {
 		blog(LOG_ERROR, "Failed to open log file");
@@ -1440,6 +1471,13 @@ static int run_program(fstream &logFile, int argc, char *argv[])
 		program.AppInit();
 		delete_oldest_file(false, "obs-studio/profiler_data");
 
+		if (trace_lagged_frames) {
+			BPtr<char> dir = GetConfigPathPtr(
+					"obs-studio/profiler_data");
+			profiler_trace_set_dump_dir(dir);
+			profiler_trace_enable(true);
+		}
+
 		OBSTranslator translator;
 		program.installTranslator(&translator);
 
@@ -1537,6 +1575,8 @@ static void main_crash_handler(const char *format, va_list args, void *param)
 {
 	char *text = new char[MAX_CRASH_REPORT_SIZE];
 
+	log_sink_flush(logSink);
+
 	vsnprintf(text, MAX_CRASH_REPORT_SIZE, format, args);
 	text[MAX_CRASH_REPORT_SIZE - 1] = 0;
 
@@ -1997,6 +2037,9 @@ int main(int argc, char *argv[])
 		} else if (arg_is(argv[i], "--unfiltered_log", nullptr)) {
 			unfiltered_log = true;
 
+		} else if (arg_is(argv[i], "--trace-lagged-frames", nullptr)) {
+			trace_lagged_frames = true;
+
 		} else if (arg_is(argv[i], "--startstreaming", nullptr)) {
 			opt_start_streaming = true;
 
@@ -2040,7 +2083,9 @@ int main(int argc, char *argv[])
 			"--multi, -m: Don't warn when launching multiple instances.\n\n" <<
 			"--verbose: Make log more verbose.\n" <<
 			"--always-on-top: Start in 'always on top' mode.\n\n" <<
-			"--unfiltered_log: Make log unfiltered.\n\n" <<
+			"--unfiltered_log: Make log unfiltered.\n" <<
+			"--trace-lagged-frames: Write a profiler trace to the "
+				"profiler_data directory when frames lag.\n\n" <<
 			"--allow-opengl: Allow OpenGL on Windows.\n\n" <<
 			"--version, -V: Get current version.\n";
 
@@ -2070,6 +2115,13 @@ int main(int argc, char *argv[])
 	curl_global_init(CURL_GLOBAL_ALL);
 	int ret = run_program(logFile, argc, argv);
 
+	/* everything still buffered is written out here, the log file is
+	 * written synchronously from now on and the sink's memory isn't
+	 * counted as leaked */
+	log_sink_t *sink = logSink;
+	logSink = nullptr;
+	log_sink_destroy(sink);
+
 	blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());
 	base_set_log_handler(nullptr, nullptr);
 	return ret;
@@ -0,0 +1,148 @@
+/******************************************************************************
+    Copyright (C) 2017 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/base.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "scene-collection-writer.hpp"
+
+using namespace std;
+
+/* matches the output of obs_data_get_json, which indents by 4 spaces */
+static const char sourcesKey[]   = "\n    \"sources\": [";
+static const char sourceIndent[] = "\n        ";
+
+static void AppendIndented(string &out, const string &json)
+{
+	size_t start = 0;
+	size_t end;
+
+	while ((end = json.find('\n', start)) != string::npos) {
+		out.append(json, start, end - start);
+		out += sourceIndent;
+		start = end + 1;
+	}
+
+	out.append(json, start, string::npos);
+}
+
+static bool BuildJson(const SceneCollectionSnapshot &snapshot, string &out)
+{
+	const string &json = snapshot.json;
+	size_t keyLen = sizeof(sourcesKey) - 1;
+	size_t pos = json.find(string(sourcesKey) + "]");
+	size_t size = json.size();
+
+	if (pos == string::npos)
+		return false;
+
+	for (auto &source : snapshot.sources)
+		size += source->size() * 5 / 4 + sizeof(sourceIndent);
+
+	out.reserve(size);
+	out.append(json, 0, pos + keyLen);
+
+	for (size_t i = 0; i < snapshot.sources.size(); i++) {
+		if (i)
+			out += ',';
+		out += sourceIndent;
+		AppendIndented(out, *snapshot.sources[i]);
+	}
+
+	if (!snapshot.sources.empty())
+		out += "\n    ";
+
+	out.append(json, pos + keyLen, string::npos);
+	return true;
+}
+
+static void WriteSnapshot(const SceneCollectionSnapshot &snapshot)
+{
+	const char *file = snapshot.path.c_str();
+	string json;
+
+	if (!BuildJson(snapshot, json) ||
+	    !os_quick_write_utf8_file_safe(file, json.c_str(), json.size(),
+			    false, "tmp", "bak"))
+		blog(LOG_ERROR, "Could not save scene data to %s", file);
+}
+
+void SceneCollectionWriter::Thread()
+{
+	os_set_thread_name("scene collection writer");
+
+	unique_lock<mutex> lock(writeMutex);
+
+	for (;;) {
+		cv.wait(lock, [this] () {return stopping || !pending.empty();});
+
+		if (pending.empty())
+			break;
+
+		SceneCollectionSnapshot snapshot = move(pending.front());
+		pending.pop_front();
+		writing = true;
+
+		lock.unlock();
+		WriteSnapshot(snapshot);
+		lock.lock();
+
+		writing = false;
+		idle.notify_all();
+	}
+}
+
+SceneCollectionWriter::SceneCollectionWriter()
+{
+	writeThread = thread([this] () {Thread();});
+}
+
+SceneCollectionWriter::~SceneCollectionWriter()
+{
+	{
+		lock_guard<mutex> lock(writeMutex);
+		stopping = true;
+	}
+
+	cv.notify_one();
+	writeThread.join();
+}
+
+void SceneCollectionWriter::Write(SceneCollectionSnapshot &&snapshot)
+{
+	{
+		lock_guard<mutex> lock(writeMutex);
+
+		for (auto &queued : pending) {
+			if (queued.path == snapshot.path) {
+				queued = move(snapshot);
+				return;
+			}
+		}
+
+		pending.push_back(move(snapshot));
+	}
+
+	cv.notify_one();
+}
+
+void SceneCollectionWriter::Flush()
+{
+	unique_lock<mutex> lock(writeMutex);
+	idle.wait(lock, [this] () {return !writing && pending.empty();});
+}
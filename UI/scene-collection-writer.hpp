@@ -0,0 +1,59 @@
+/******************************************************************************
+    Copyright (C) 2017 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* The JSON of everything but the sources, which must contain an empty
+ * top-level "sources" array.  The JSON of each source is kept separately so
+ * that unchanged sources can share it between saves. */
+struct SceneCollectionSnapshot {
+	std::string path;
+	std::string json;
+	std::vector<std::shared_ptr<const std::string>> sources;
+};
+
+/* Writes scene collection snapshots to disk on a background thread.  If a
+ * snapshot of a file is still waiting to be written when a new one arrives,
+ * only the newer snapshot is written. */
+class SceneCollectionWriter {
+	std::thread writeThread;
+	std::mutex writeMutex;
+	std::condition_variable cv;
+	std::condition_variable idle;
+	std::deque<SceneCollectionSnapshot> pending;
+	bool writing = false;
+	bool stopping = false;
+
+	void Thread();
+
+public:
+	SceneCollectionWriter();
+	~SceneCollectionWriter();
+
+	void Write(SceneCollectionSnapshot &&snapshot);
+
+	/* waits until everything written so far is on disk */
+	void Flush();
+};
@@ -342,6 +342,9 @@ void OBSBasic::on_actionRemoveSceneCollection_triggered()
 	if (button == QMessageBox::No)
 		return;
 
+	/* a save that is still pending would recreate the file */
+	collectionWriter.Flush();
+
 	char path[512];
 	int ret = GetConfigPath(path, 512, "obs-studio/basic/scenes/");
 	if (ret <= 0) {
@@ -464,6 +467,10 @@ void OBSBasic::on_actionExportSceneCollection_triggered()
 		if (QFile::exists(exportFile))
 			QFile::remove(exportFile);
 
+		/* saves are written in the background, make sure the latest
+		 * one is complete before copying the file */
+		collectionWriter.Flush();
+
 		QFile::copy(path + currentFile + ".json", exportFile);
 	}
 }
@@ -298,11 +298,82 @@ static void SaveAudioDevice(const char *name, int channel, obs_data_t *parent,
 	obs_source_release(source);
 }
 
+struct DirtySource {
+	size_t idx;
+	obs_source_t *source;
+	bool tracked;
+	long stamp;
+};
+
+/* Sources whose save stamp hasn't changed reuse their previously saved JSON,
+ * only the others are saved and serialized again.  The stamp is read before
+ * the source is saved, so a change made while saving is picked up next time.
+ * The source pointers are only used as keys, the stamps of new sources never
+ * match the stamps of old sources at the same address. */
+static void SaveSources(vector<OBSSource> &audioSources,
+		SavedSourceMap &savedSources,
+		vector<shared_ptr<const string>> &sources)
+{
+	SavedSourceMap newSavedSources;
+	vector<DirtySource> dirty;
+
+	newSavedSources.reserve(savedSources.size());
+
+	auto FilterSources = [&](obs_source_t *source)
+	{
+		if (find(begin(audioSources), end(audioSources), source) !=
+				end(audioSources))
+			return false;
+
+		long stamp = 0;
+		bool tracked = obs_source_get_save_stamp(source, &stamp);
+
+		if (tracked) {
+			auto it = savedSources.find(source);
+			if (it != savedSources.end() &&
+			    it->second.stamp == stamp) {
+				sources.push_back(it->second.json);
+				newSavedSources.insert(*it);
+				return false;
+			}
+		}
+
+		dirty.push_back({sources.size(), source, tracked, stamp});
+		sources.push_back(nullptr);
+		return true;
+	};
+	using FilterSources_t = decltype(FilterSources);
+
+	obs_data_array_t *sourcesArray = obs_save_sources_filtered(
+			[](void *data, obs_source_t *source)
+	{
+		return (*static_cast<FilterSources_t*>(data))(source);
+	}, static_cast<void*>(&FilterSources));
+
+	for (size_t i = 0; i < dirty.size(); i++) {
+		DirtySource &info = dirty[i];
+		obs_data_t *sourceData = obs_data_array_item(sourcesArray, i);
+		const char *json = obs_data_get_json(sourceData);
+		auto saved = make_shared<const string>(json ? json : "{}");
+
+		sources[info.idx] = saved;
+		if (info.tracked)
+			newSavedSources[info.source] = {info.stamp, saved};
+
+		obs_data_release(sourceData);
+	}
+
+	obs_data_array_release(sourcesArray);
+	savedSources = move(newSavedSources);
+}
+
 static obs_data_t *GenerateSaveData(obs_data_array_t *sceneOrder,
 		obs_data_array_t *quickTransitionData, int transitionDuration,
 		obs_data_array_t *transitions,
 		OBSScene &scene, OBSSource &curProgramScene,
-		obs_data_array_t *savedProjectorList)
+		obs_data_array_t *savedProjectorList,
+		SavedSourceMap &savedSources,
+		vector<shared_ptr<const string>> &sources)
 {
 	obs_data_t *saveData = obs_data_create();
 
@@ -315,18 +386,11 @@ static obs_data_t *GenerateSaveData(obs_data_array_t *sceneOrder,
 	SaveAudioDevice(AUX_AUDIO_2,     4, saveData, audioSources);
 	SaveAudioDevice(AUX_AUDIO_3,     5, saveData, audioSources);
 
-	auto FilterAudioSources = [&](obs_source_t *source)
-	{
-		return find(begin(audioSources), end(audioSources), source) ==
-				end(audioSources);
-	};
-	using FilterAudioSources_t = decltype(FilterAudioSources);
+	SaveSources(audioSources, savedSources, sources);
 
-	obs_data_array_t *sourcesArray = obs_save_sources_filtered(
-			[](void *data, obs_source_t *source)
-	{
-		return (*static_cast<FilterAudioSources_t*>(data))(source);
-	}, static_cast<void*>(&FilterAudioSources));
+	/* the saved sources are inserted in place of this empty array by the
+	 * scene collection writer */
+	obs_data_array_t *sourcesArray = obs_data_array_create();
 
 	obs_source_t *transition = obs_get_output_source(0);
 	obs_source_t *currentScene = obs_scene_get_source(scene);
@@ -480,9 +544,11 @@ void OBSBasic::Save(const char *file)
 	obs_data_array_t *transitions = SaveTransitions();
 	obs_data_array_t *quickTrData = SaveQuickTransitions();
 	obs_data_array_t *savedProjectorList = SaveProjectors();
+	SceneCollectionSnapshot snapshot;
 	obs_data_t *saveData = GenerateSaveData(sceneOrder, quickTrData,
 			ui->transitionDuration->value(), transitions,
-			scene, curProgramScene, savedProjectorList);
+			scene, curProgramScene, savedProjectorList,
+			savedSources, snapshot.sources);
 
 	obs_data_set_bool(saveData, "preview_locked", ui->preview->Locked());
 	obs_data_set_bool(saveData, "scaling_enabled",
@@ -501,8 +567,16 @@ void OBSBasic::Save(const char *file)
 		obs_data_release(moduleObj);
 	}
 
-	if (!obs_data_save_json_safe(saveData, file, "tmp", "bak"))
+	/* serializing the whole collection and writing it to disk happens on
+	 * the writer thread, only sources that changed are serialized here */
+	const char *json = obs_data_get_json(saveData);
+	if (json) {
+		snapshot.path = file;
+		snapshot.json = json;
+		collectionWriter.Write(move(snapshot));
+	} else {
 		blog(LOG_ERROR, "Could not save scene data to %s", file);
+	}
 
 	obs_data_release(saveData);
 	obs_data_array_release(sceneOrder);
@@ -1158,6 +1232,7 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_string(basicConfig, "Video", "ColorSpace", "601");
 	config_set_default_string(basicConfig, "Video", "ColorRange",
 			"Partial");
+	config_set_default_uint  (basicConfig, "Video", "StagingDepth", 2);
 
 	config_set_default_string(basicConfig, "Audio", "MonitoringDeviceId",
 			"default");
@@ -1961,6 +2036,7 @@ void OBSBasic::SaveProjectNow()
 
 	projectChanged = true;
 	SaveProjectDeferred();
+	collectionWriter.Flush();
 }
 
 void OBSBasic::SaveProject()
@@ -3123,6 +3199,8 @@ int OBSBasic::ResetVideo()
 			"Video", "AdapterIdx");
 	ovi.gpu_conversion = true;
 	ovi.scale_type     = GetScaleType(basicConfig);
+	ovi.staging_depth  = (uint32_t)config_get_uint(basicConfig,
+			"Video", "StagingDepth");
 
 	if (ovi.base_width == 0 || ovi.base_height == 0) {
 		ovi.base_width = 1920;
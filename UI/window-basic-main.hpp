@@ -23,6 +23,7 @@
 #include <obs.hpp>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include "window-main.hpp"
 #include "window-basic-interaction.hpp"
 #include "window-basic-properties.hpp"
@@ -30,6 +31,7 @@
 #include "window-basic-adv-audio.hpp"
 #include "window-basic-filters.hpp"
 #include "window-projector.hpp"
+#include "scene-collection-writer.hpp"
 
 #include <obs-frontend-internal.hpp>
 
@@ -75,6 +77,14 @@ struct SavedProjectorInfo {
 	std::string name;
 };
 
+/* the saved data of a source, reused while its save stamp stays the same */
+struct SavedSourceData {
+	long stamp;
+	std::shared_ptr<const std::string> json;
+};
+
+using SavedSourceMap = std::unordered_map<obs_source_t*, SavedSourceData>;
+
 struct QuickTransition {
 	QPushButton *button = nullptr;
 	OBSSource source;
@@ -131,6 +141,8 @@ private:
 	bool loaded = false;
 	long disableSaving = 1;
 	bool projectChanged = false;
+	SavedSourceMap savedSources;
+	SceneCollectionWriter collectionWriter;
 	bool previewEnabled = true;
 	bool fullscreenInterface = false;
 
@@ -13,6 +13,7 @@
 #include <QGridLayout>
 
 #include <string>
+#include <cmath>
 
 #define TIMER_INTERVAL 2000
 
@@ -36,6 +37,7 @@ OBSBasicStats::OBSBasicStats(QWidget *parent)
 	QVBoxLayout *mainLayout = new QVBoxLayout();
 	QGridLayout *topLayout = new QGridLayout();
 	outputLayout = new QGridLayout();
+	loudnessLayout = new QGridLayout();
 
 	int row = 0;
 
@@ -106,8 +108,33 @@ OBSBasicStats::OBSBasicStats(QWidget *parent)
 
 	/* --------------------------------------------- */
 
+	col = 0;
+	auto addLoudnessCol = [&] (const char *loc)
+	{
+		QLabel *label = new QLabel(QTStr(loc), this);
+		label->setStyleSheet("font-weight: bold");
+		loudnessLayout->addWidget(label, 0, col++);
+	};
+
+	addLoudnessCol("Basic.Settings.Output.Adv.AudioTrack");
+	addLoudnessCol("Basic.Stats.Loudness.Momentary");
+	addLoudnessCol("Basic.Stats.Loudness.ShortTerm");
+	addLoudnessCol("Basic.Stats.Loudness.Integrated");
+	addLoudnessCol("Basic.Stats.Loudness.NormalizerGain");
+
+	/* --------------------------------------------- */
+
+	for (int i = 0; i < MAX_AUDIO_MIXES; i++) {
+		std::string str = "Basic.Settings.Output.Adv.Audio.Track";
+		str += std::to_string(i + 1);
+		AddLoudnessLabels(QTStr(str.c_str()));
+	}
+
+	/* --------------------------------------------- */
+
 	QVBoxLayout *outputContainerLayout = new QVBoxLayout();
 	outputContainerLayout->addLayout(outputLayout);
+	outputContainerLayout->addLayout(loudnessLayout);
 	outputContainerLayout->addStretch();
 
 	QWidget *widget = new QWidget(this);
@@ -209,6 +236,25 @@ void OBSBasicStats::AddOutputLabels(QString name)
 	outputLabels.push_back(ol);
 }
 
+void OBSBasicStats::AddLoudnessLabels(QString name)
+{
+	LoudnessLabels ll;
+	ll.name = new QLabel(name, this);
+	ll.momentary = new QLabel(this);
+	ll.shortTerm = new QLabel(this);
+	ll.integrated = new QLabel(this);
+	ll.normalizerGain = new QLabel(this);
+
+	int col = 0;
+	int row = loudnessLabels.size() + 1;
+	loudnessLayout->addWidget(ll.name, row, col++);
+	loudnessLayout->addWidget(ll.momentary, row, col++);
+	loudnessLayout->addWidget(ll.shortTerm, row, col++);
+	loudnessLayout->addWidget(ll.integrated, row, col++);
+	loudnessLayout->addWidget(ll.normalizerGain, row, col++);
+	loudnessLabels.push_back(ll);
+}
+
 static uint32_t first_encoded = 0xFFFFFFFF;
 static uint32_t first_skipped = 0xFFFFFFFF;
 static uint32_t first_rendered = 0xFFFFFFFF;
@@ -385,6 +431,12 @@ void OBSBasicStats::Update()
 
 	outputLabels[0].Update(strOutput, false);
 	outputLabels[1].Update(recOutput, true);
+
+	/* ------------------------------------------- */
+	/* audio track loudness                        */
+
+	for (int i = 0; i < loudnessLabels.size(); i++)
+		loudnessLabels[i].Update((size_t)i);
 }
 
 void OBSBasicStats::Reset()
@@ -403,6 +455,11 @@ void OBSBasicStats::Reset()
 
 	outputLabels[0].Reset(strOutput);
 	outputLabels[1].Reset(recOutput);
+
+	audio_t *audio = obs_get_audio();
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
+		audio_output_reset_loudness(audio, i);
+
 	Update();
 }
 
@@ -500,3 +557,33 @@ void OBSBasicStats::OutputLabels::Reset(obs_output_t *output)
 	first_total   = obs_output_get_total_frames(output);
 	first_dropped = obs_output_get_frames_dropped(output);
 }
+
+static QString LoudnessString(float lufs)
+{
+	if (!std::isfinite(lufs))
+		return QStringLiteral("-");
+
+	return QString("%1 LUFS").arg(QString::number(lufs, 'f', 1));
+}
+
+void OBSBasicStats::LoudnessLabels::Update(size_t mixIdx)
+{
+	struct audio_loudness_info info = {};
+	bool active = audio_output_get_loudness(obs_get_audio(), mixIdx,
+			&info);
+
+	if (!active) {
+		QString str = QTStr("Basic.Stats.Status.Inactive");
+		momentary->setText(str);
+		shortTerm->setText(QString());
+		integrated->setText(QString());
+		normalizerGain->setText(QString());
+		return;
+	}
+
+	momentary->setText(LoudnessString(info.momentary));
+	shortTerm->setText(LoudnessString(info.short_term));
+	integrated->setText(LoudnessString(info.integrated));
+	normalizerGain->setText(QString("%1 dB").arg(
+			QString::number(info.normalizer_gain, 'f', 1)));
+}
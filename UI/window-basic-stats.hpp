@@ -48,7 +48,22 @@ class OBSBasicStats : public QWidget {
 
 	QList<OutputLabels> outputLabels;
 
+	QGridLayout *loudnessLayout = nullptr;
+
+	struct LoudnessLabels {
+		QPointer<QLabel> name;
+		QPointer<QLabel> momentary;
+		QPointer<QLabel> shortTerm;
+		QPointer<QLabel> integrated;
+		QPointer<QLabel> normalizerGain;
+
+		void Update(size_t mixIdx);
+	};
+
+	QList<LoudnessLabels> loudnessLabels;
+
 	void AddOutputLabels(QString name);
+	void AddLoudnessLabels(QString name);
 	void Update();
 	void Reset();
 
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2017 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <util/threading.h>
+
+#include "cache.h"
+
+/* total memory all media caches may use together */
+#define CACHE_BUDGET (size_t)(1024ULL * 1024ULL * 1024ULL)
+
+static pthread_mutex_t budget_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t budget_used = 0;
+
+static bool reserve_budget(size_t size)
+{
+	bool success;
+
+	pthread_mutex_lock(&budget_mutex);
+	success = budget_used + size <= CACHE_BUDGET;
+	if (success)
+		budget_used += size;
+	pthread_mutex_unlock(&budget_mutex);
+
+	return success;
+}
+
+static void release_budget(size_t size)
+{
+	pthread_mutex_lock(&budget_mutex);
+	budget_used -= size;
+	pthread_mutex_unlock(&budget_mutex);
+}
+
+void mp_cache_entry_free(struct mp_cache_entry *entry)
+{
+	if (entry->is_video)
+		obs_source_frame_free(&entry->video);
+	else
+		bfree((void*)entry->audio.data[0]);
+
+	memset(entry, 0, sizeof(*entry));
+}
+
+static void mp_cache_clear(struct mp_cache *cache)
+{
+	for (size_t i = 0; i < cache->entries.num; i++)
+		mp_cache_entry_free(cache->entries.array + i);
+
+	release_budget(cache->size);
+	da_free(cache->entries);
+	cache->size = 0;
+	cache->pos = 0;
+	cache->complete = false;
+}
+
+void mp_cache_init(struct mp_cache *cache, size_t max_size)
+{
+	memset(cache, 0, sizeof(*cache));
+	cache->max_size = max_size;
+}
+
+void mp_cache_free(struct mp_cache *cache)
+{
+	mp_cache_clear(cache);
+	cache->recording = false;
+}
+
+void mp_cache_start(struct mp_cache *cache)
+{
+	if (!mp_cache_enabled(cache) || cache->complete)
+		return;
+
+	mp_cache_clear(cache);
+	cache->recording = true;
+}
+
+void mp_cache_finish(struct mp_cache *cache, int64_t end_pts)
+{
+	if (!cache->recording)
+		return;
+
+	cache->recording = false;
+	cache->complete = cache->entries.num > 0;
+	cache->end_pts = end_pts;
+
+	if (cache->complete)
+		blog(LOG_DEBUG, "MP: Cached %llu frames (%llu bytes)",
+				(unsigned long long)cache->entries.num,
+				(unsigned long long)cache->size);
+}
+
+/* the clip is too large to keep in memory, so stop trying */
+static void mp_cache_fail(struct mp_cache *cache)
+{
+	mp_cache_clear(cache);
+	cache->recording = false;
+	cache->failed = true;
+
+	blog(LOG_DEBUG, "MP: Media too large to cache, decoding normally");
+}
+
+/* other media are using the shared budget right now, so decode this pass
+ * normally and try recording again on the next loop */
+static void mp_cache_abandon(struct mp_cache *cache)
+{
+	mp_cache_clear(cache);
+	cache->recording = false;
+
+	blog(LOG_DEBUG, "MP: Cache budget exhausted, retrying next loop");
+}
+
+static bool mp_cache_reserve(struct mp_cache *cache, size_t size)
+{
+	if (cache->size + size > cache->max_size) {
+		mp_cache_fail(cache);
+		return false;
+	}
+	if (!reserve_budget(size)) {
+		mp_cache_abandon(cache);
+		return false;
+	}
+
+	cache->size += size;
+	return true;
+}
+
+static size_t get_frame_size(const struct obs_source_frame *frame)
+{
+	bool half_height = frame->format == VIDEO_FORMAT_I420 ||
+	                   frame->format == VIDEO_FORMAT_NV12;
+	size_t size = 0;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		size_t height = (half_height && i > 0) ?
+			(frame->height + 1) / 2 : frame->height;
+		size += (size_t)frame->linesize[i] * height;
+	}
+
+	return size;
+}
+
+static inline bool video_entry_matches(const struct mp_cache_entry *entry,
+		const struct obs_source_frame *frame)
+{
+	return entry->is_video &&
+	       entry->video.data[0] != NULL &&
+	       entry->video.format == frame->format &&
+	       entry->video.width  == frame->width &&
+	       entry->video.height == frame->height;
+}
+
+void mp_cache_entry_copy_video(struct mp_cache_entry *entry,
+		const struct obs_source_frame *frame, int64_t pts)
+{
+	if (!video_entry_matches(entry, frame)) {
+		mp_cache_entry_free(entry);
+		obs_source_frame_init(&entry->video, frame->format,
+				frame->width, frame->height);
+		entry->is_video = true;
+		entry->size = get_frame_size(frame);
+	}
+
+	entry->pts = pts;
+	obs_source_frame_copy(&entry->video, frame);
+
+	entry->video.timestamp  = frame->timestamp;
+	entry->video.full_range = frame->full_range;
+	entry->video.flip       = frame->flip;
+	memcpy(entry->video.color_matrix, frame->color_matrix,
+			sizeof(frame->color_matrix));
+	memcpy(entry->video.color_range_min, frame->color_range_min,
+			sizeof(frame->color_range_min));
+	memcpy(entry->video.color_range_max, frame->color_range_max,
+			sizeof(frame->color_range_max));
+}
+
+void mp_cache_entry_copy_audio(struct mp_cache_entry *entry,
+		const struct obs_source_audio *audio, int64_t pts)
+{
+	size_t planes = get_audio_planes(audio->format, audio->speakers);
+	size_t plane_size = get_audio_size(audio->format, audio->speakers,
+			audio->frames);
+	uint8_t *data;
+
+	if (entry->is_video || entry->size != planes * plane_size) {
+		mp_cache_entry_free(entry);
+		entry->size = planes * plane_size;
+		entry->audio.data[0] = bmalloc(entry->size);
+	}
+
+	data = (uint8_t*)entry->audio.data[0];
+
+	entry->pts = pts;
+	entry->audio = *audio;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (i < planes) {
+			memcpy(data + plane_size * i, audio->data[i],
+					plane_size);
+			entry->audio.data[i] = data + plane_size * i;
+		} else {
+			entry->audio.data[i] = NULL;
+		}
+	}
+
+	/* keep the allocation even if there are no planes */
+	entry->audio.data[0] = data;
+}
+
+void mp_cache_add_video(struct mp_cache *cache,
+		const struct obs_source_frame *frame, int64_t pts)
+{
+	if (!cache->recording)
+		return;
+
+	if (!mp_cache_reserve(cache, get_frame_size(frame)))
+		return;
+
+	mp_cache_entry_copy_video(da_push_back_new(cache->entries), frame,
+			pts);
+}
+
+void mp_cache_add_audio(struct mp_cache *cache,
+		const struct obs_source_audio *audio, int64_t pts)
+{
+	size_t size;
+
+	if (!cache->recording)
+		return;
+
+	size = get_audio_planes(audio->format, audio->speakers) *
+		get_audio_size(audio->format, audio->speakers, audio->frames);
+
+	if (!mp_cache_reserve(cache, size))
+		return;
+
+	mp_cache_entry_copy_audio(da_push_back_new(cache->entries), audio,
+			pts);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2017 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <obs.h>
+#include <util/darray.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frames and audio exactly as they were given to the source, so a short
+ * clip only has to be decoded and converted once and can then be replayed
+ * from memory. */
+
+struct mp_cache_entry {
+	int64_t                 pts;
+	bool                    is_video;
+	struct obs_source_frame video;
+	struct obs_source_audio audio;
+	size_t                  size;
+};
+
+/* copies into the entry, reusing its previous allocation if possible.  the
+ * entry must be zeroed before first use */
+extern void mp_cache_entry_copy_video(struct mp_cache_entry *entry,
+		const struct obs_source_frame *frame, int64_t pts);
+extern void mp_cache_entry_copy_audio(struct mp_cache_entry *entry,
+		const struct obs_source_audio *audio, int64_t pts);
+extern void mp_cache_entry_free(struct mp_cache_entry *entry);
+
+struct mp_cache {
+	DARRAY(struct mp_cache_entry) entries;
+	size_t                        size;
+	size_t                        max_size;
+	int64_t                       end_pts;
+	size_t                        pos;
+
+	bool                          recording;
+	bool                          complete;
+	bool                          failed;
+};
+
+extern void mp_cache_init(struct mp_cache *cache, size_t max_size);
+extern void mp_cache_free(struct mp_cache *cache);
+
+/* discards anything recorded so far and starts recording from scratch,
+ * unless the cache is disabled, complete or previously failed */
+extern void mp_cache_start(struct mp_cache *cache);
+extern void mp_cache_finish(struct mp_cache *cache, int64_t end_pts);
+
+extern void mp_cache_add_video(struct mp_cache *cache,
+		const struct obs_source_frame *frame, int64_t pts);
+extern void mp_cache_add_audio(struct mp_cache *cache,
+		const struct obs_source_audio *audio, int64_t pts);
+
+static inline bool mp_cache_enabled(const struct mp_cache *cache)
+{
+	return cache->max_size != 0 && !cache->failed;
+}
+
+static inline struct mp_cache_entry *mp_cache_cur(struct mp_cache *cache)
+{
+	return cache->pos < cache->entries.num ?
+		cache->entries.array + cache->pos : NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -225,6 +225,11 @@ static inline int64_t mp_media_get_next_min_pts(mp_media_t *m)
 {
 	int64_t min_next_ns = 0x7FFFFFFFFFFFFFFFLL;
 
+	if (m->cache.complete) {
+		struct mp_cache_entry *entry = mp_cache_cur(&m->cache);
+		return entry ? entry->pts : min_next_ns;
+	}
+
 	if (m->has_video && m->v.frame_ready) {
 		if (m->v.frame_pts < min_next_ns)
 			min_next_ns = m->v.frame_pts;
@@ -241,6 +246,9 @@ static inline int64_t mp_media_get_base_pts(mp_media_t *m)
 {
 	int64_t base_ts = 0;
 
+	if (m->cache.complete)
+		return m->cache.end_pts;
+
 	if (m->has_video && m->v.next_pts > base_ts)
 		base_ts = m->v.next_pts;
 	if (m->has_audio && m->a.next_pts > base_ts)
@@ -255,6 +263,231 @@ static inline bool mp_media_can_play_frame(mp_media_t *m,
 	return d->frame_ready && d->frame_pts <= m->next_pts_ns;
 }
 
+/* ------------------------------------------------------------------------- */
+/* decode-ahead queue */
+
+/* frames output later than this are counted as late */
+#define MP_LATE_THRESHOLD_NS 20000000ULL
+
+static inline size_t mp_media_queue_depth(mp_media_t *m)
+{
+	return m->queue.size / sizeof(struct mp_queue_item);
+}
+
+static inline bool mp_media_interrupted(mp_media_t *m)
+{
+	bool interrupted;
+
+	pthread_mutex_lock(&m->mutex);
+	interrupted = m->reset || m->kill;
+	pthread_mutex_unlock(&m->mutex);
+
+	return interrupted;
+}
+
+static struct mp_cache_entry *mp_media_get_free_entry(mp_media_t *m)
+{
+	struct mp_cache_entry *entry = NULL;
+
+	pthread_mutex_lock(&m->queue_mutex);
+	if (m->free_entries.num) {
+		entry = m->free_entries.array[m->free_entries.num - 1];
+		da_pop_back(m->free_entries);
+	}
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	return entry ? entry : bzalloc(sizeof(struct mp_cache_entry));
+}
+
+/* queue_mutex must be held */
+static inline void mp_media_recycle_item(mp_media_t *m,
+		struct mp_queue_item *item)
+{
+	if (item->owned)
+		da_push_back(m->free_entries, &item->entry);
+}
+
+static bool mp_media_wait_queue_space(mp_media_t *m)
+{
+	for (;;) {
+		bool has_space;
+
+		pthread_mutex_lock(&m->queue_mutex);
+		has_space = mp_media_queue_depth(m) < MP_QUEUE_SIZE;
+		pthread_mutex_unlock(&m->queue_mutex);
+
+		if (has_space)
+			return true;
+		if (mp_media_interrupted(m))
+			return false;
+
+		os_event_timedwait(m->queue_space, 100);
+	}
+}
+
+/* lets everything already decoded play out, used before stopping at the
+ * end of the media */
+static void mp_media_wait_queue_empty(mp_media_t *m)
+{
+	for (;;) {
+		bool empty;
+
+		pthread_mutex_lock(&m->queue_mutex);
+		empty = !m->queue.size && !m->presenting;
+		pthread_mutex_unlock(&m->queue_mutex);
+
+		if (empty || mp_media_interrupted(m))
+			return;
+
+		os_event_timedwait(m->queue_space, 100);
+	}
+}
+
+static void mp_media_queue_entry(mp_media_t *m, struct mp_cache_entry *entry,
+		bool owned, uint64_t timestamp)
+{
+	struct mp_queue_item item = {
+		.entry      = entry,
+		.owned      = owned,
+		.generation = os_atomic_load_long(&m->queue_generation),
+		.timestamp  = timestamp,
+		.due_ns     = m->next_ns
+	};
+
+	bool has_space = mp_media_wait_queue_space(m);
+
+	pthread_mutex_lock(&m->queue_mutex);
+	if (has_space)
+		circlebuf_push_back(&m->queue, &item, sizeof(item));
+	else
+		mp_media_recycle_item(m, &item);
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	if (has_space) {
+		m->queued_total++;
+		os_event_signal(m->queue_filled);
+	}
+}
+
+/* drops everything queued and waits for any frame being output to finish,
+ * so nothing from before a reset is output afterward */
+static void mp_media_clear_queue(mp_media_t *m)
+{
+	struct mp_queue_item item;
+
+	pthread_mutex_lock(&m->queue_mutex);
+	while (m->queue.size) {
+		circlebuf_pop_front(&m->queue, &item, sizeof(item));
+		mp_media_recycle_item(m, &item);
+	}
+	os_atomic_inc_long(&m->queue_generation);
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	pthread_mutex_lock(&m->present_mutex);
+	pthread_mutex_unlock(&m->present_mutex);
+
+	os_event_signal(m->queue_space);
+}
+
+static void mp_media_present(mp_media_t *m, struct mp_queue_item *item)
+{
+	struct mp_cache_entry *entry = item->entry;
+
+	/* sleep in short steps so resets are noticed */
+	for (;;) {
+		uint64_t t = os_gettime_ns();
+
+		if (item->generation != os_atomic_load_long(&m->queue_generation))
+			return;
+		if (os_atomic_load_bool(&m->kill_presenter))
+			return;
+
+		if (t >= item->due_ns) {
+			if (entry->is_video &&
+			    t - item->due_ns > MP_LATE_THRESHOLD_NS)
+				os_atomic_inc_long(&m->late_frames);
+			break;
+		}
+
+		os_sleepto_ns(item->due_ns - t > 50000000ULL
+				? t + 50000000ULL
+				: item->due_ns);
+	}
+
+	pthread_mutex_lock(&m->present_mutex);
+
+	if (item->generation == os_atomic_load_long(&m->queue_generation)) {
+		if (entry->is_video) {
+			struct obs_source_frame frame = entry->video;
+			frame.timestamp = item->timestamp;
+			if (m->v_cb)
+				m->v_cb(m->opaque, &frame);
+		} else {
+			struct obs_source_audio audio = entry->audio;
+			audio.timestamp = item->timestamp;
+			if (m->a_cb)
+				m->a_cb(m->opaque, &audio);
+		}
+	}
+
+	pthread_mutex_unlock(&m->present_mutex);
+}
+
+static void *mp_present_thread(void *opaque)
+{
+	mp_media_t *m = opaque;
+
+	os_set_thread_name("mp_present_thread");
+
+	while (!os_atomic_load_bool(&m->kill_presenter)) {
+		struct mp_queue_item item;
+		bool got_item;
+
+		pthread_mutex_lock(&m->queue_mutex);
+		got_item = m->queue.size != 0;
+		if (got_item) {
+			circlebuf_pop_front(&m->queue, &item, sizeof(item));
+			m->presenting = true;
+		}
+		pthread_mutex_unlock(&m->queue_mutex);
+
+		if (!got_item) {
+			os_event_wait(m->queue_filled);
+			continue;
+		}
+
+		os_event_signal(m->queue_space);
+		mp_media_present(m, &item);
+
+		pthread_mutex_lock(&m->queue_mutex);
+		mp_media_recycle_item(m, &item);
+		m->presenting = false;
+		pthread_mutex_unlock(&m->queue_mutex);
+
+		os_event_signal(m->queue_space);
+	}
+
+	return NULL;
+}
+
+static void mp_media_queue_video(mp_media_t *m,
+		const struct obs_source_frame *frame, int64_t pts)
+{
+	struct mp_cache_entry *entry = mp_media_get_free_entry(m);
+	mp_cache_entry_copy_video(entry, frame, pts);
+	mp_media_queue_entry(m, entry, true, frame->timestamp);
+}
+
+static void mp_media_queue_audio(mp_media_t *m,
+		const struct obs_source_audio *audio, int64_t pts)
+{
+	struct mp_cache_entry *entry = mp_media_get_free_entry(m);
+	mp_cache_entry_copy_audio(entry, audio, pts);
+	mp_media_queue_entry(m, entry, true, audio->timestamp);
+}
+
+/* ------------------------------------------------------------------------- */
+
 static void mp_media_next_audio(mp_media_t *m)
 {
 	struct mp_decode *d = &m->a;
@@ -281,7 +514,8 @@ static void mp_media_next_audio(mp_media_t *m)
 	if (audio.format == AUDIO_FORMAT_UNKNOWN)
 		return;
 
-	m->a_cb(m->opaque, &audio);
+	mp_cache_add_audio(&m->cache, &audio, d->frame_pts);
+	mp_media_queue_audio(m, &audio, d->frame_pts);
 }
 
 static void mp_media_next_video(mp_media_t *m, bool preload)
@@ -379,10 +613,46 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 		d->got_first_keyframe = true;
 	}
 
-	if (preload)
+	if (preload) {
 		m->v_preload_cb(m->opaque, frame);
-	else
-		m->v_cb(m->opaque, frame);
+	} else {
+		mp_cache_add_video(&m->cache, frame, d->frame_pts);
+		mp_media_queue_video(m, frame, d->frame_pts);
+	}
+}
+
+static inline int64_t mp_media_cached_ts(mp_media_t *m, int64_t pts)
+{
+	return m->base_ts + pts - m->start_ts + m->play_sys_ts - base_sys_ts;
+}
+
+static void mp_media_preload_cached(mp_media_t *m)
+{
+	for (size_t i = 0; i < m->cache.entries.num; i++) {
+		struct mp_cache_entry *entry = m->cache.entries.array + i;
+		if (entry->is_video) {
+			struct obs_source_frame frame = entry->video;
+			frame.timestamp = mp_media_cached_ts(m, entry->pts);
+			m->v_preload_cb(m->opaque, &frame);
+			break;
+		}
+	}
+}
+
+/* outputs every cached entry that is due, in the order they were
+ * originally output */
+static void mp_media_next_cached(mp_media_t *m)
+{
+	struct mp_cache_entry *entry;
+
+	while ((entry = mp_cache_cur(&m->cache)) != NULL &&
+	       entry->pts <= m->next_pts_ns) {
+		if (entry->is_video ? !!m->v_cb : !!m->a_cb)
+			mp_media_queue_entry(m, entry, false,
+					mp_media_cached_ts(m, entry->pts));
+
+		m->cache.pos++;
+	}
 }
 
 static void mp_media_calc_next_ns(mp_media_t *m)
@@ -405,6 +675,7 @@ static void mp_media_calc_next_ns(mp_media_t *m)
 static bool mp_media_reset(mp_media_t *m)
 {
 	AVStream *stream = m->fmt->streams[0];
+	bool cached = m->cache.complete;
 	int64_t seek_pos;
 	int seek_flags;
 	bool stopping;
@@ -422,7 +693,7 @@ static bool mp_media_reset(mp_media_t *m)
 		? av_rescale_q(seek_pos, AV_TIME_BASE_Q, stream->time_base)
 		: seek_pos;
 
-	if (m->is_local_file) {
+	if (m->is_local_file && !cached) {
 		int ret = av_seek_frame(m->fmt, 0, seek_target, seek_flags);
 		if (ret < 0) {
 			blog(LOG_WARNING, "MP: Failed to seek: %s",
@@ -430,9 +701,9 @@ static bool mp_media_reset(mp_media_t *m)
 		}
 	}
 
-	if (m->has_video && m->is_local_file)
+	if (m->has_video && m->is_local_file && !cached)
 		mp_decode_flush(&m->v);
-	if (m->has_audio && m->is_local_file)
+	if (m->has_audio && m->is_local_file && !cached)
 		mp_decode_flush(&m->a);
 
 	int64_t next_ts = mp_media_get_base_pts(m);
@@ -447,8 +718,14 @@ static bool mp_media_reset(mp_media_t *m)
 	m->stopping = false;
 	pthread_mutex_unlock(&m->mutex);
 
-	if (!mp_media_prepare_frames(m))
-		return false;
+	if (cached) {
+		m->cache.pos = 0;
+	} else {
+		if (!mp_media_prepare_frames(m))
+			return false;
+		if (m->is_local_file)
+			mp_cache_start(&m->cache);
+	}
 
 	if (active) {
 		if (!m->play_sys_ts)
@@ -462,8 +739,12 @@ static bool mp_media_reset(mp_media_t *m)
 		m->next_ns = 0;
 	}
 
-	if (!active && m->is_local_file && m->v_preload_cb)
-		mp_media_next_video(m, true);
+	if (!active && m->is_local_file && m->v_preload_cb) {
+		if (cached)
+			mp_media_preload_cached(m);
+		else
+			mp_media_next_video(m, true);
+	}
 	if (stopping && m->stop_cb)
 		m->stop_cb(m->opaque);
 	return true;
@@ -494,11 +775,16 @@ static inline bool mp_media_eof(mp_media_t *m)
 {
 	bool v_ended = !m->has_video || !m->v.frame_ready;
 	bool a_ended = !m->has_audio || !m->a.frame_ready;
-	bool eof = v_ended && a_ended;
+	bool eof = m->cache.complete
+		? !mp_cache_cur(&m->cache)
+		: v_ended && a_ended;
 
 	if (eof) {
 		bool looping;
 
+		/* a full pass was recorded, play from memory from now on */
+		mp_cache_finish(&m->cache, mp_media_get_base_pts(m));
+
 		pthread_mutex_lock(&m->mutex);
 		looping = m->looping;
 		if (!looping) {
@@ -507,6 +793,9 @@ static inline bool mp_media_eof(mp_media_t *m)
 		}
 		pthread_mutex_unlock(&m->mutex);
 
+		if (!looping)
+			mp_media_wait_queue_empty(m);
+
 		mp_media_reset(m);
 	}
 
@@ -587,6 +876,8 @@ static inline bool mp_media_thread(mp_media_t *m)
 		return false;
 	}
 
+	uint64_t last_queued_total = 0;
+
 	for (;;) {
 		bool reset, kill, is_active;
 		bool timeout = false;
@@ -598,10 +889,16 @@ static inline bool mp_media_thread(mp_media_t *m)
 		if (!is_active) {
 			if (os_sem_wait(m->sem) < 0)
 				return false;
-		} else {
+		} else if (m->queued_total == last_queued_total) {
+			/* nothing went through the queue last time, so it
+			 * can't pace decoding */
 			timeout = mp_media_sleepto(m);
+		} else if (!m->next_ns) {
+			m->next_ns = os_gettime_ns();
 		}
 
+		last_queued_total = m->queued_total;
+
 		pthread_mutex_lock(&m->mutex);
 
 		reset = m->reset;
@@ -612,22 +909,29 @@ static inline bool mp_media_thread(mp_media_t *m)
 		pthread_mutex_unlock(&m->mutex);
 
 		if (kill) {
+			mp_media_clear_queue(m);
 			break;
 		}
 		if (reset) {
+			mp_media_clear_queue(m);
 			mp_media_reset(m);
 			continue;
 		}
 
 		/* frames are ready */
 		if (is_active && !timeout) {
-			if (m->has_video)
-				mp_media_next_video(m, false);
-			if (m->has_audio)
-				mp_media_next_audio(m);
+			if (m->cache.complete) {
+				mp_media_next_cached(m);
+			} else {
+				if (m->has_video)
+					mp_media_next_video(m, false);
+				if (m->has_audio)
+					mp_media_next_audio(m);
+
+				if (!mp_media_prepare_frames(m))
+					return false;
+			}
 
-			if (!mp_media_prepare_frames(m))
-				return false;
 			if (mp_media_eof(m))
 				continue;
 
@@ -658,15 +962,33 @@ static inline bool mp_media_init_internal(mp_media_t *m,
 		blog(LOG_WARNING, "MP: Failed to init mutex");
 		return false;
 	}
+	if (pthread_mutex_init(&m->queue_mutex, NULL) != 0 ||
+	    pthread_mutex_init(&m->present_mutex, NULL) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init queue mutexes");
+		return false;
+	}
 	if (os_sem_init(&m->sem, 0) != 0) {
 		blog(LOG_WARNING, "MP: Failed to init semaphore");
 		return false;
 	}
+	if (os_event_init(&m->queue_filled, OS_EVENT_TYPE_AUTO) != 0 ||
+	    os_event_init(&m->queue_space, OS_EVENT_TYPE_AUTO) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init queue events");
+		return false;
+	}
 
 	m->path = info->path ? bstrdup(info->path) : NULL;
 	m->format_name = info->format ? bstrdup(info->format) : NULL;
 	m->hw = info->hardware_decoding;
 
+	if (pthread_create(&m->present_thread, NULL, mp_present_thread,
+				m) != 0) {
+		blog(LOG_WARNING, "MP: Could not create presentation thread");
+		return false;
+	}
+
+	m->present_thread_valid = true;
+
 	if (pthread_create(&m->thread, NULL, mp_media_thread_start, m) != 0) {
 		blog(LOG_WARNING, "MP: Could not create media thread");
 		return false;
@@ -680,6 +1002,8 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 {
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
+	pthread_mutex_init_value(&media->queue_mutex);
+	pthread_mutex_init_value(&media->present_mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
 	media->a_cb = info->a_cb;
@@ -689,6 +1013,8 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	media->buffering = info->buffering;
 	media->speed = info->speed;
 	media->is_local_file = info->is_local_file;
+	mp_cache_init(&media->cache, info->is_local_file ?
+			info->cache_max_size : 0);
 
 	if (!info->is_local_file || media->speed < 1 || media->speed > 200)
 		media->speed = 100;
@@ -720,9 +1046,34 @@ static void mp_kill_thread(mp_media_t *m)
 		m->kill = true;
 		pthread_mutex_unlock(&m->mutex);
 		os_sem_post(m->sem);
+		os_event_signal(m->queue_space);
 
 		pthread_join(m->thread, NULL);
 	}
+	if (m->present_thread_valid) {
+		os_atomic_set_bool(&m->kill_presenter, true);
+		os_event_signal(m->queue_filled);
+
+		pthread_join(m->present_thread, NULL);
+	}
+}
+
+static void mp_media_free_queue(mp_media_t *m)
+{
+	struct mp_queue_item item;
+
+	while (m->queue.size) {
+		circlebuf_pop_front(&m->queue, &item, sizeof(item));
+		mp_media_recycle_item(m, &item);
+	}
+
+	for (size_t i = 0; i < m->free_entries.num; i++) {
+		mp_cache_entry_free(m->free_entries.array[i]);
+		bfree(m->free_entries.array[i]);
+	}
+
+	circlebuf_free(&m->queue);
+	da_free(m->free_entries);
 }
 
 void mp_media_free(mp_media_t *media)
@@ -734,15 +1085,23 @@ void mp_media_free(mp_media_t *media)
 	mp_kill_thread(media);
 	mp_decode_free(&media->v);
 	mp_decode_free(&media->a);
+	mp_media_free_queue(media);
+	mp_cache_free(&media->cache);
 	avformat_close_input(&media->fmt);
 	pthread_mutex_destroy(&media->mutex);
+	pthread_mutex_destroy(&media->queue_mutex);
+	pthread_mutex_destroy(&media->present_mutex);
 	os_sem_destroy(media->sem);
+	os_event_destroy(media->queue_filled);
+	os_event_destroy(media->queue_space);
 	sws_freeContext(media->swscale);
 	av_freep(&media->scale_pic[0]);
 	bfree(media->path);
 	bfree(media->format_name);
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
+	pthread_mutex_init_value(&media->queue_mutex);
+	pthread_mutex_init_value(&media->present_mutex);
 }
 
 void mp_media_play(mp_media_t *m, bool loop)
@@ -758,6 +1117,7 @@ void mp_media_play(mp_media_t *m, bool loop)
 	pthread_mutex_unlock(&m->mutex);
 
 	os_sem_post(m->sem);
+	os_event_signal(m->queue_space);
 }
 
 void mp_media_stop(mp_media_t *m)
@@ -768,6 +1128,17 @@ void mp_media_stop(mp_media_t *m)
 		m->active = false;
 		m->stopping = true;
 		os_sem_post(m->sem);
+		os_event_signal(m->queue_space);
 	}
 	pthread_mutex_unlock(&m->mutex);
 }
+
+void mp_media_get_queue_stats(mp_media_t *m, int *queue_depth,
+		int64_t *late_frames)
+{
+	pthread_mutex_lock(&m->queue_mutex);
+	*queue_depth = (int)mp_media_queue_depth(m);
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	*late_frames = (int64_t)os_atomic_load_long(&m->late_frames);
+}
@@ -18,6 +18,7 @@
 
 #include <obs.h>
 #include "decode.h"
+#include "cache.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +43,17 @@ typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
 
+/* decoded frames waiting to be output by the presentation thread */
+struct mp_queue_item {
+	struct mp_cache_entry *entry;
+	bool owned;
+	long generation;
+	uint64_t timestamp;
+	uint64_t due_ns;
+};
+
+#define MP_QUEUE_SIZE 16
+
 struct mp_media {
 	AVFormatContext *fmt;
 
@@ -63,6 +75,7 @@ struct mp_media {
 
 	struct mp_decode v;
 	struct mp_decode a;
+	struct mp_cache cache;
 	bool is_local_file;
 	bool has_video;
 	bool has_audio;
@@ -93,6 +106,23 @@ struct mp_media {
 
 	bool thread_valid;
 	pthread_t thread;
+
+	/* the media thread decodes ahead into the queue, the presentation
+	 * thread outputs each item when it is due */
+	pthread_mutex_t queue_mutex;
+	pthread_mutex_t present_mutex;
+	struct circlebuf queue;
+	DARRAY(struct mp_cache_entry *) free_entries;
+	os_event_t *queue_filled;
+	os_event_t *queue_space;
+	volatile long queue_generation;
+	volatile long late_frames;
+	uint64_t queued_total;
+	volatile bool kill_presenter;
+	bool presenting;
+
+	bool present_thread_valid;
+	pthread_t present_thread;
 };
 
 typedef struct mp_media mp_media_t;
@@ -112,6 +142,10 @@ struct mp_media_info {
 	enum video_range_type force_range;
 	bool hardware_decoding;
 	bool is_local_file;
+
+	/* local files that decode to less than this are played back from
+	 * memory after the first pass, 0 to disable */
+	size_t cache_max_size;
 };
 
 extern bool mp_media_init(mp_media_t *media, const struct mp_media_info *info);
@@ -120,6 +154,9 @@ extern void mp_media_free(mp_media_t *media);
 extern void mp_media_play(mp_media_t *media, bool loop);
 extern void mp_media_stop(mp_media_t *media);
 
+extern void mp_media_get_queue_stats(mp_media_t *media, int *queue_depth,
+		int64_t *late_frames);
+
 /* #define DETAILED_DEBUG_INFO */
 
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
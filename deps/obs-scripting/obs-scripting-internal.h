@@ -30,6 +30,11 @@ struct obs_script {
 	struct dstr path;
 	struct dstr file;
 	struct dstr desc;
+
+	/* per call time budget of script_tick/timer/tick callbacks, 0 means
+	 * the default budget */
+	volatile long budget_ms;
+	volatile long overruns;
 };
 
 struct script_callback;
@@ -37,6 +42,16 @@ typedef void (*defer_call_cb)(void *param);
 
 extern void defer_call_post(defer_call_cb call, void *cb);
 
+/* queues a call to be made on the graphics thread before the next frame's
+ * script tick is posted.  ticks, timers and tick callbacks of scripts run on
+ * the script thread, so anything that has to happen on the graphics thread
+ * must go through this */
+extern void defer_graphics_call_post(defer_call_cb call, void *cb);
+
+/* logs and counts the call if it took longer than the script's budget */
+extern void script_check_budget(obs_script_t *script, uint64_t start_ns,
+		const char *what);
+
 extern void script_log(obs_script_t *script, int level, const char *format, ...);
 extern void script_log_va(obs_script_t *script, int level, const char *format,
 		va_list args);
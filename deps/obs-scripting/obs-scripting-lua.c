@@ -236,6 +236,9 @@ struct lua_obs_timer {
 
 	uint64_t last_ts;
 	uint64_t interval;
+
+	/* obs_add_tick_callback: called every tick with the elapsed seconds */
+	bool tick;
 };
 
 static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -364,15 +367,13 @@ static int obs_lua_add_main_render_callback(lua_State *script)
 
 /* -------------------------------------------- */
 
-static void obs_lua_tick_callback(void *priv, float seconds)
+static void tick_call(struct script_callback *p_cb, float seconds)
 {
-	struct lua_obs_callback *cb = priv;
+	struct lua_obs_callback *cb = (struct lua_obs_callback *)p_cb;
 	lua_State *script = cb->script;
 
-	if (cb->base.removed) {
-		obs_remove_tick_callback(obs_lua_tick_callback, cb);
+	if (p_cb->removed)
 		return;
-	}
 
 	lock_callback();
 
@@ -392,18 +393,59 @@ static int obs_lua_remove_tick_callback(lua_State *script)
 	return 0;
 }
 
-static void defer_add_tick(void *cb)
+/* tick callbacks are driven by the script thread just like timers, they are
+ * never called from the graphics thread */
+static int obs_lua_add_tick_callback(lua_State *script)
 {
-	obs_add_tick_callback(obs_lua_tick_callback, cb);
+	if (!verify_args1(script, is_function))
+		return 0;
+
+	struct lua_obs_callback *cb = add_lua_obs_callback_extra(script, 1,
+			sizeof(struct lua_obs_timer));
+	struct lua_obs_timer *timer = lua_obs_callback_extra_data(cb);
+
+	timer->tick = true;
+	timer->last_ts = obs_get_video_frame_time();
+
+	defer_call_post(defer_timer_init, cb);
+	return 0;
 }
 
-static int obs_lua_add_tick_callback(lua_State *script)
+/* -------------------------------------------- */
+
+static void graphics_call(void *p_cb)
+{
+	struct lua_obs_callback *cb = p_cb;
+	struct obs_lua_script *data = lua_obs_callback_script(cb);
+
+	if (cb->base.removed)
+		return;
+
+	/* never stall the graphics thread on a script that is busy on the
+	 * script thread, try again on the next frame instead */
+	if (pthread_mutex_trylock(&data->mutex) != 0) {
+		defer_graphics_call_post(graphics_call, cb);
+		return;
+	}
+
+	if (!cb->base.removed) {
+		lock_callback();
+		call_func_(cb->script, cb->reg_idx, 0, 0, "graphics_call",
+				__FUNCTION__);
+		remove_lua_obs_callback(cb);
+		unlock_callback();
+	}
+
+	pthread_mutex_unlock(&data->mutex);
+}
+
+static int defer_graphics_call(lua_State *script)
 {
 	if (!verify_args1(script, is_function))
 		return 0;
 
 	struct lua_obs_callback *cb = add_lua_obs_callback(script, 1);
-	defer_call_post(defer_add_tick, cb);
+	defer_graphics_call_post(graphics_call, cb);
 	return 0;
 }
 
@@ -1030,6 +1072,8 @@ static void add_hook_functions(lua_State *script)
 			property_set_modified_callback);
 	add_func("remove_current_callback",
 			remove_current_callback);
+	add_func("defer_graphics_call",
+			defer_graphics_call);
 
 	lua_pop(script, 1);
 #undef add_func
@@ -1037,11 +1081,11 @@ static void add_hook_functions(lua_State *script)
 
 /* -------------------------------------------- */
 
-static void lua_tick(void *param, float seconds)
+/* called on the script thread */
+void obs_lua_tick(float seconds, uint64_t ts)
 {
 	struct obs_lua_script *data;
 	struct lua_obs_timer *timer;
-	uint64_t ts = obs_get_video_frame_time();
 
 	/* --------------------------------- */
 	/* process script_tick calls         */
@@ -1050,6 +1094,7 @@ static void lua_tick(void *param, float seconds)
 	data = first_tick_script;
 	while (data) {
 		lua_State *script = data->script;
+		uint64_t start = os_gettime_ns();
 		current_lua_script = data;
 
 		pthread_mutex_lock(&data->mutex);
@@ -1059,6 +1104,8 @@ static void lua_tick(void *param, float seconds)
 
 		pthread_mutex_unlock(&data->mutex);
 
+		script_check_budget(&data->base, start, "script_tick");
+
 		data = data->next_tick;
 	}
 	current_lua_script = NULL;
@@ -1075,11 +1122,22 @@ static void lua_tick(void *param, float seconds)
 
 		if (cb->base.removed) {
 			lua_obs_timer_remove(timer);
+
+		} else if (timer->tick) {
+			uint64_t start = os_gettime_ns();
+			tick_call(&cb->base, seconds);
+			script_check_budget(cb->base.script, start,
+					"tick callback");
+
 		} else {
 			uint64_t elapsed = ts - timer->last_ts;
 
 			if (elapsed >= timer->interval) {
+				uint64_t start = os_gettime_ns();
 				timer_call(&cb->base);
+				script_check_budget(cb->base.script, start,
+						"timer");
+
 				timer->last_ts += timer->interval;
 			}
 		}
@@ -1087,8 +1145,6 @@ static void lua_tick(void *param, float seconds)
 		timer = next;
 	}
 	pthread_mutex_unlock(&timer_mutex);
-
-	UNUSED_PARAMETER(param);
 }
 
 /* -------------------------------------------- */
@@ -1309,14 +1365,10 @@ void obs_lua_load(void)
 	startup_script = tmp.array;
 
 	dstr_free(&dep_paths);
-
-	obs_add_tick_callback(lua_tick, NULL);
 }
 
 void obs_lua_unload(void)
 {
-	obs_remove_tick_callback(lua_tick, NULL);
-
 	bfree(startup_script);
 	pthread_mutex_destroy(&tick_mutex);
 	pthread_mutex_destroy(&timer_mutex);
@@ -399,6 +399,9 @@ struct python_obs_timer {
 
 	uint64_t last_ts;
 	uint64_t interval;
+
+	/* obs_add_tick_callback: called every tick with the elapsed seconds */
+	bool tick;
 };
 
 static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -490,14 +493,12 @@ static PyObject *timer_add(PyObject *self, PyObject *args)
 
 /* -------------------------------------------- */
 
-static void obs_python_tick_callback(void *priv, float seconds)
+static void tick_call(struct script_callback *p_cb, float seconds)
 {
-	struct python_obs_callback *cb = priv;
+	struct python_obs_callback *cb = (struct python_obs_callback *)p_cb;
 
-	if (cb->base.removed) {
-		obs_remove_tick_callback(obs_python_tick_callback, cb);
+	if (p_cb->removed)
 		return;
-	}
 
 	lock_callback(cb);
 
@@ -546,13 +547,65 @@ static PyObject *obs_python_add_tick_callback(PyObject *self, PyObject *args)
 
 	UNUSED_PARAMETER(self);
 
+	if (!parse_args(args, "O", &py_cb))
+		return python_none();
+	if (!py_cb || !PyFunction_Check(py_cb))
+		return python_none();
+
+	/* tick callbacks are driven by the script thread just like timers,
+	 * they are never called from the graphics thread */
+	struct python_obs_callback *cb = add_python_obs_callback_extra(
+			script, py_cb, sizeof(struct python_obs_timer));
+	struct python_obs_timer *timer = python_obs_callback_extra_data(cb);
+
+	timer->tick = true;
+	timer->last_ts = obs_get_video_frame_time();
+
+	defer_call_post(defer_timer_init, cb);
+	return python_none();
+}
+
+/* -------------------------------------------- */
+
+static void graphics_call(void *p_cb)
+{
+	struct python_obs_callback *cb = p_cb;
+
+	if (cb->base.removed)
+		return;
+
+	/* the interpreter hands the GIL over to waiting threads at its
+	 * switch interval, so a busy script thread only delays this briefly */
+	lock_callback(cb);
+	if (!cb->base.removed) {
+		PyObject *py_ret = PyObject_CallObject(cb->func, NULL);
+		py_error();
+		Py_XDECREF(py_ret);
+		remove_python_obs_callback(cb);
+	}
+	unlock_callback();
+}
+
+static PyObject *defer_graphics_call(PyObject *self, PyObject *args)
+{
+	struct obs_python_script *script = cur_python_script;
+	PyObject *py_cb = NULL;
+
+	if (!script) {
+		PyErr_SetString(PyExc_RuntimeError,
+				"No active script, report this to Jim");
+		return NULL;
+	}
+
+	UNUSED_PARAMETER(self);
+
 	if (!parse_args(args, "O", &py_cb))
 		return python_none();
 	if (!py_cb || !PyFunction_Check(py_cb))
 		return python_none();
 
 	struct python_obs_callback *cb = add_python_obs_callback(script, py_cb);
-	obs_add_tick_callback(obs_python_tick_callback, cb);
+	defer_graphics_call_post(graphics_call, cb);
 	return python_none();
 }
 
@@ -1248,6 +1301,8 @@ static void add_hook_functions(PyObject *module)
 		         obs_python_remove_tick_callback),
 		DEF_FUNC("obs_add_tick_callback",
 		         obs_python_add_tick_callback),
+		DEF_FUNC("defer_graphics_call",
+		         defer_graphics_call),
 		DEF_FUNC("signal_handler_disconnect",
 		         obs_python_signal_handler_disconnect),
 		DEF_FUNC("signal_handler_connect",
@@ -1497,11 +1552,14 @@ void obs_python_script_save(obs_script_t *s)
 
 /* -------------------------------------------- */
 
-static void python_tick(void *param, float seconds)
+/* called on the script thread */
+void obs_python_tick(float seconds, uint64_t ts)
 {
 	struct obs_python_script *data;
 	bool valid;
-	uint64_t ts = obs_get_video_frame_time();
+
+	if (!python_loaded)
+		return;
 
 	pthread_mutex_lock(&tick_mutex);
 	valid = !!first_tick_script;
@@ -1518,12 +1576,15 @@ static void python_tick(void *param, float seconds)
 		pthread_mutex_lock(&tick_mutex);
 		data = first_tick_script;
 		while (data) {
+			uint64_t start = os_gettime_ns();
 			cur_python_script = data;
 
 			PyObject *py_ret = PyObject_CallObject(data->tick, args);
 			Py_XDECREF(py_ret);
 			py_error();
 
+			script_check_budget(&data->base, start, "script_tick");
+
 			data = data->next_tick;
 		}
 
@@ -1547,14 +1608,30 @@ static void python_tick(void *param, float seconds)
 
 		if (cb->base.removed) {
 			python_obs_timer_remove(timer);
+
+		} else if (timer->tick) {
+			uint64_t start = os_gettime_ns();
+
+			lock_python();
+			tick_call(&cb->base, seconds);
+			unlock_python();
+
+			script_check_budget(cb->base.script, start,
+					"tick callback");
+
 		} else {
 			uint64_t elapsed = ts - timer->last_ts;
 
 			if (elapsed >= timer->interval) {
+				uint64_t start = os_gettime_ns();
+
 				lock_python();
 				timer_call(&cb->base);
 				unlock_python();
 
+				script_check_budget(cb->base.script, start,
+						"timer");
+
 				timer->last_ts += timer->interval;
 			}
 		}
@@ -1562,8 +1639,6 @@ static void python_tick(void *param, float seconds)
 		timer = next;
 	}
 	pthread_mutex_unlock(&timer_mutex);
-
-	UNUSED_PARAMETER(param);
 }
 
 /* -------------------------------------------- */
@@ -1699,10 +1774,6 @@ out:
 	}
 
 	python_loaded_at_all = success;
-
-	if (python_loaded)
-		obs_add_tick_callback(python_tick, NULL);
-
 	return python_loaded;
 }
 
@@ -1720,8 +1791,6 @@ void obs_python_unload(void)
 
 	/* ---------------------- */
 
-	obs_remove_tick_callback(python_tick, NULL);
-
 	for (size_t i = 0; i < python_paths.num; i++)
 		bfree(python_paths.array[i]);
 	da_free(python_paths);
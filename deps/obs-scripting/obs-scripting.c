@@ -33,6 +33,7 @@ extern void obs_lua_script_unload(obs_script_t *s);
 extern void obs_lua_script_destroy(obs_script_t *s);
 extern void obs_lua_load(void);
 extern void obs_lua_unload(void);
+extern void obs_lua_tick(float seconds, uint64_t ts);
 
 extern obs_properties_t *obs_lua_script_get_properties(obs_script_t *script);
 extern void obs_lua_script_update(obs_script_t *script, obs_data_t *settings);
@@ -47,6 +48,7 @@ extern void obs_python_script_unload(obs_script_t *s);
 extern void obs_python_script_destroy(obs_script_t *s);
 extern void obs_python_load(void);
 extern void obs_python_unload(void);
+extern void obs_python_tick(float seconds, uint64_t ts);
 
 extern obs_properties_t *obs_python_script_get_properties(obs_script_t *script);
 extern void obs_python_script_update(obs_script_t *script, obs_data_t *settings);
@@ -118,6 +120,185 @@ void defer_call_post(defer_call_cb call, void *cb)
 	os_sem_post(defer_call_semaphore);
 }
 
+/* -------------------------------------------- */
+/* script thread                                */
+
+#define DEFAULT_TIME_BUDGET_MS 10
+
+static pthread_mutex_t script_tick_mutex;
+static bool script_tick_exit = false;
+static bool script_tick_pending = false;
+static float script_tick_seconds = 0.0f;
+static uint64_t script_tick_ts = 0;
+static long script_ticks_coalesced = 0;
+static os_sem_t *script_tick_semaphore;
+static pthread_t script_tick_thread;
+
+static pthread_mutex_t graphics_call_mutex;
+static struct circlebuf graphics_call_queue;
+
+static void *script_thread(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	os_set_thread_name("scripting: script thread");
+
+	while (os_sem_wait(script_tick_semaphore) == 0) {
+		float seconds;
+		uint64_t ts;
+
+		pthread_mutex_lock(&script_tick_mutex);
+		if (script_tick_exit) {
+			pthread_mutex_unlock(&script_tick_mutex);
+			break;
+		}
+
+		seconds = script_tick_seconds;
+		ts = script_tick_ts;
+		script_tick_seconds = 0.0f;
+		script_tick_pending = false;
+		pthread_mutex_unlock(&script_tick_mutex);
+
+#if COMPILE_LUA
+		obs_lua_tick(seconds, ts);
+#endif
+#if COMPILE_PYTHON
+		obs_python_tick(seconds, ts);
+#endif
+	}
+
+	return NULL;
+}
+
+static void run_graphics_calls(void)
+{
+	size_t count;
+
+	/* only run what is queued right now, calls may queue themselves
+	 * again for the next frame */
+	pthread_mutex_lock(&graphics_call_mutex);
+	count = graphics_call_queue.size / sizeof(struct defer_call);
+	pthread_mutex_unlock(&graphics_call_mutex);
+
+	while (count--) {
+		struct defer_call info;
+
+		pthread_mutex_lock(&graphics_call_mutex);
+		circlebuf_pop_front(&graphics_call_queue, &info, sizeof(info));
+		pthread_mutex_unlock(&graphics_call_mutex);
+
+		info.call(info.cb);
+	}
+}
+
+/* runs on the graphics thread: never calls into scripts directly, only wakes
+ * up the script thread.  if the script thread is still busy with the last
+ * tick, the time is added to the pending tick instead of queueing another */
+static void scripting_tick(void *param, float seconds)
+{
+	bool post;
+
+	run_graphics_calls();
+
+	pthread_mutex_lock(&script_tick_mutex);
+	post = !script_tick_pending;
+	if (!post)
+		script_ticks_coalesced++;
+
+	script_tick_pending = true;
+	script_tick_seconds += seconds;
+	script_tick_ts = obs_get_video_frame_time();
+	pthread_mutex_unlock(&script_tick_mutex);
+
+	if (post)
+		os_sem_post(script_tick_semaphore);
+
+	UNUSED_PARAMETER(param);
+}
+
+void defer_graphics_call_post(defer_call_cb call, void *cb)
+{
+	struct defer_call info;
+	info.call = call;
+	info.cb = cb;
+
+	pthread_mutex_lock(&graphics_call_mutex);
+	circlebuf_push_back(&graphics_call_queue, &info, sizeof(info));
+	pthread_mutex_unlock(&graphics_call_mutex);
+}
+
+void script_check_budget(obs_script_t *script, uint64_t start_ns,
+		const char *what)
+{
+	uint64_t elapsed = os_gettime_ns() - start_ns;
+	long budget = os_atomic_load_long(&script->budget_ms);
+	long overruns;
+
+	if (!budget)
+		budget = DEFAULT_TIME_BUDGET_MS;
+	if (elapsed <= (uint64_t)budget * 1000000ULL)
+		return;
+
+	overruns = os_atomic_inc_long(&script->overruns);
+	if (overruns == 1 || overruns % 100 == 0)
+		script_warn(script, "%s took %.1f ms, exceeding the time budget "
+				"of %ld ms (%ld overruns so far)", what,
+				(double)elapsed / 1000000.0, budget, overruns);
+}
+
+static bool script_thread_init(void)
+{
+	circlebuf_init(&graphics_call_queue);
+
+	if (pthread_mutex_init(&graphics_call_mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init(&script_tick_mutex, NULL) != 0)
+		goto fail1;
+	if (os_sem_init(&script_tick_semaphore, 0) != 0)
+		goto fail2;
+
+	script_tick_exit = false;
+	script_tick_pending = false;
+	script_tick_seconds = 0.0f;
+	script_ticks_coalesced = 0;
+
+	if (pthread_create(&script_tick_thread, NULL, script_thread,
+				NULL) != 0)
+		goto fail3;
+
+	return true;
+
+fail3:
+	os_sem_destroy(script_tick_semaphore);
+fail2:
+	pthread_mutex_destroy(&script_tick_mutex);
+fail1:
+	pthread_mutex_destroy(&graphics_call_mutex);
+	return false;
+}
+
+static void script_thread_free(void)
+{
+	obs_remove_tick_callback(scripting_tick, NULL);
+
+	pthread_mutex_lock(&script_tick_mutex);
+	script_tick_exit = true;
+	pthread_mutex_unlock(&script_tick_mutex);
+
+	os_sem_post(script_tick_semaphore);
+	pthread_join(script_tick_thread, NULL);
+
+	if (script_ticks_coalesced)
+		blog(LOG_INFO, "[Scripting] Ticks coalesced because scripts "
+				"were still busy: %ld", script_ticks_coalesced);
+
+	os_sem_destroy(script_tick_semaphore);
+	pthread_mutex_destroy(&script_tick_mutex);
+
+	pthread_mutex_destroy(&graphics_call_mutex);
+	circlebuf_free(&graphics_call_queue);
+}
+
 /* -------------------------------------------- */
 
 bool obs_scripting_load(void)
@@ -144,6 +325,20 @@ bool obs_scripting_load(void)
 		return false;
 	}
 
+	if (!script_thread_init()) {
+		pthread_mutex_lock(&defer_call_mutex);
+		defer_call_exit = true;
+		pthread_mutex_unlock(&defer_call_mutex);
+
+		os_sem_post(defer_call_semaphore);
+		pthread_join(defer_call_thread, NULL);
+
+		os_sem_destroy(defer_call_semaphore);
+		pthread_mutex_destroy(&defer_call_mutex);
+		pthread_mutex_destroy(&detach_mutex);
+		return false;
+	}
+
 #if COMPILE_LUA
 	obs_lua_load();
 #endif
@@ -155,6 +350,8 @@ bool obs_scripting_load(void)
 #endif
 #endif
 
+	obs_add_tick_callback(scripting_tick, NULL);
+
 	scripting_loaded = true;
 	return true;
 }
@@ -166,6 +363,8 @@ void obs_scripting_unload(void)
 
 	/* ---------------------- */
 
+	script_thread_free();
+
 #if COMPILE_LUA
 	obs_lua_unload();
 #endif
@@ -419,6 +618,28 @@ bool obs_script_loaded(const obs_script_t *script)
 	return ptr_valid(script) ? script->loaded : false;
 }
 
+void obs_script_set_time_budget(obs_script_t *script, uint32_t ms)
+{
+	if (ptr_valid(script))
+		os_atomic_set_long(&script->budget_ms, (long)ms);
+}
+
+uint32_t obs_script_get_time_budget(const obs_script_t *script)
+{
+	long budget;
+
+	if (!ptr_valid(script))
+		return 0;
+
+	budget = os_atomic_load_long(&script->budget_ms);
+	return budget ? (uint32_t)budget : DEFAULT_TIME_BUDGET_MS;
+}
+
+long obs_script_get_overrun_count(const obs_script_t *script)
+{
+	return ptr_valid(script) ? os_atomic_load_long(&script->overruns) : 0;
+}
+
 void obs_script_destroy(obs_script_t *script)
 {
 	if (!script)
@@ -68,6 +68,13 @@ EXPORT void obs_script_update(obs_script_t *script, obs_data_t *settings);
 EXPORT bool obs_script_loaded(const obs_script_t *script);
 EXPORT bool obs_script_reload(obs_script_t *script);
 
+/* script_tick, timers and tick callbacks of scripts run on a dedicated
+ * script thread.  calls that take longer than the budget are logged and
+ * counted as overruns.  a budget of 0 restores the default */
+EXPORT void obs_script_set_time_budget(obs_script_t *script, uint32_t ms);
+EXPORT uint32_t obs_script_get_time_budget(const obs_script_t *script);
+EXPORT long obs_script_get_overrun_count(const obs_script_t *script);
+
 #ifdef __cplusplus
 }
 #endif
@@ -108,6 +108,8 @@ inline void gs_stage_surface::Rebuild(ID3D11Device *dev)
 	HRESULT hr = dev->CreateTexture2D(&td, nullptr, &texture);
 	if (FAILED(hr))
 		throw HRError("Failed to create staging surface", hr);
+
+	InitQuery(dev);
 }
 
 inline void gs_sampler_state::Rebuild(ID3D11Device *dev)
@@ -344,6 +346,8 @@ try {
 	for (auto &state : blendStates)
 		state.Rebuild(dev);
 
+	rebuildCount++;
+
 } catch (const char *error) {
 	bcrash("Failed to recreate D3D11: %s", error);
 
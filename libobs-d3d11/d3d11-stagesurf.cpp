@@ -40,4 +40,16 @@ gs_stage_surface::gs_stage_surface(gs_device_t *device, uint32_t width,
 	hr = device->device->CreateTexture2D(&td, NULL, texture.Assign());
 	if (FAILED(hr))
 		throw HRError("Failed to create staging surface", hr);
+
+	InitQuery(device->device);
+}
+
+void gs_stage_surface::InitQuery(ID3D11Device *dev)
+{
+	D3D11_QUERY_DESC qd = {};
+	qd.Query = D3D11_QUERY_EVENT;
+
+	HRESULT hr = dev->CreateQuery(&qd, copyQuery.Assign());
+	if (FAILED(hr))
+		throw HRError("Failed to create staging surface query", hr);
 }
@@ -719,6 +719,11 @@ uint32_t device_get_width(const gs_device_t *device)
 	}
 }
 
+uint32_t device_get_rebuild_count(const gs_device_t *device)
+{
+	return device->rebuildCount;
+}
+
 uint32_t device_get_height(const gs_device_t *device)
 {
 	if (device->curSwapChain) {
@@ -1326,6 +1331,10 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 
 		device->CopyTex(dst->texture, 0, 0, src, 0, 0, 0, 0);
 
+		/* the event completes once the copy has been executed */
+		device->context->End(dst->copyQuery);
+		dst->copyPending = true;
+
 	} catch (const char *error) {
 		blog(LOG_ERROR, "device_copy_texture (D3D11): %s", error);
 	}
@@ -1909,6 +1918,21 @@ bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
 	return true;
 }
 
+bool gs_stagesurface_is_ready(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf->copyPending)
+		return true;
+
+	/* do not flush, the graphics thread flushes once per frame anyway */
+	HRESULT hr = stagesurf->device->context->GetData(stagesurf->copyQuery,
+			nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	if (hr == S_FALSE)
+		return false;
+
+	stagesurf->copyPending = false;
+	return true;
+}
+
 void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 {
 	stagesurf->device->context->Unmap(stagesurf->texture, 0);
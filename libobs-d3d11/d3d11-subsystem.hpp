@@ -421,17 +421,22 @@ struct gs_zstencil_buffer : gs_obj {
 
 struct gs_stage_surface : gs_obj {
 	ComPtr<ID3D11Texture2D> texture;
+	ComPtr<ID3D11Query>     copyQuery;
 	D3D11_TEXTURE2D_DESC td = {};
+	bool            copyPending = false;
 
 	uint32_t        width, height;
 	gs_color_format format;
 	DXGI_FORMAT     dxgiFormat;
 
+	void InitQuery(ID3D11Device *dev);
 	inline void Rebuild(ID3D11Device *dev);
 
 	inline void Release()
 	{
 		texture.Release();
+		copyQuery.Release();
+		copyPending = false;
 	}
 
 	gs_stage_surface(gs_device_t *device, uint32_t width, uint32_t height,
@@ -779,6 +784,7 @@ struct gs_device {
 	ComPtr<ID3D11Device>        device;
 	ComPtr<ID3D11DeviceContext> context;
 	uint32_t                    adpIdx = 0;
+	uint32_t                    rebuildCount = 0;
 
 	gs_texture_2d               *curRenderTarget = nullptr;
 	gs_zstencil_buffer          *curZStencilBuffer = nullptr;
@@ -68,6 +68,8 @@ gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
 void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 {
 	if (stagesurf) {
+		if (stagesurf->fence)
+			glDeleteSync(stagesurf->fence);
 		if (stagesurf->pack_buffer)
 			gl_delete_buffers(1, &stagesurf->pack_buffer);
 
@@ -106,6 +108,17 @@ static bool can_stage(struct gs_stage_surface *dst, struct gs_texture_2d *src)
 	return true;
 }
 
+/* marks the point the pack buffer is written up to, so that mapping can be
+ * deferred until the GPU has actually finished the transfer */
+static void insert_fence(struct gs_stage_surface *dst)
+{
+	if (dst->fence)
+		glDeleteSync(dst->fence);
+
+	dst->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_success("glFenceSync");
+}
+
 #ifdef __APPLE__
 
 /* Apparently for mac, PBOs won't do an asynchronous transfer unless you use
@@ -141,6 +154,7 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glReadPixels"))
 		goto failed_unbind_all;
 
+	insert_fence(dst);
 	success = true;
 
 failed_unbind_all:
@@ -172,6 +186,8 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glGetTexImage"))
 		goto failed;
 
+	insert_fence(dst);
+
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 	return;
@@ -222,6 +238,22 @@ fail:
 	return false;
 }
 
+bool gs_stagesurface_is_ready(gs_stagesurf_t *stagesurf)
+{
+	GLenum status;
+
+	if (!stagesurf->fence)
+		return true;
+
+	status = glClientWaitSync(stagesurf->fence, 0, 0);
+	if (status == GL_WAIT_FAILED) {
+		gl_success("glClientWaitSync");
+		return true;
+	}
+
+	return status != GL_TIMEOUT_EXPIRED;
+}
+
 void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 {
 	if (!gl_bind_buffer(GL_PIXEL_PACK_BUFFER, stagesurf->pack_buffer))
@@ -0,0 +1,376 @@
+#include <math.h>
+#include <string.h>
+#include <graphics/math-defs.h>
+#include "sw-subsystem.h"
+
+/*
+ *   Conversion between the stored texel formats and the float RGBA values that
+ * shaders work with.  Components that a format does not have read as 0, and a
+ * missing alpha reads as 1, the same as sampling them on the GPU.
+ */
+
+static inline float half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h >> 15) << 31;
+	uint32_t exp  = (h >> 10) & 0x1F;
+	uint32_t mant = h & 0x3FF;
+	uint32_t bits;
+	float    f;
+
+	if (exp == 0) {
+		/* zero or denormal */
+		f = ldexpf((float)mant, -24);
+		return sign ? -f : f;
+	} else if (exp == 31) {
+		bits = sign | 0x7F800000 | (mant << 13);
+	} else {
+		bits = sign | ((exp + 112) << 23) | (mant << 13);
+	}
+
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static inline uint16_t float_to_half(float f)
+{
+	uint32_t bits;
+	uint16_t sign;
+	int      exp;
+	uint32_t mant;
+
+	memcpy(&bits, &f, sizeof(bits));
+	sign = (uint16_t)((bits >> 16) & 0x8000);
+	exp  = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	mant = bits & 0x7FFFFF;
+
+	if (((bits >> 23) & 0xFF) == 0xFF)
+		return sign | 0x7C00 | (mant ? 0x200 : 0);
+	if (exp >= 31)
+		return sign | 0x7C00;
+	if (exp <= 0) {
+		if (exp < -10)
+			return sign;
+		mant |= 0x800000;
+		return sign | (uint16_t)((mant >> (14 - exp)) +
+				((mant >> (13 - exp)) & 1));
+	}
+
+	/* round to nearest, a carry in to the exponent is still correct */
+	return (sign | (uint16_t)((exp << 10) | (mant >> 13))) +
+		(uint16_t)((mant >> 12) & 1);
+}
+
+static inline float unorm8(uint8_t v)
+{
+	return (float)v / 255.0f;
+}
+
+static inline float unorm16(uint16_t v)
+{
+	return (float)v / 65535.0f;
+}
+
+static inline uint32_t to_unorm(float v, uint32_t max)
+{
+	if (!(v > 0.0f))
+		return 0;
+	if (v >= 1.0f)
+		return max;
+	return (uint32_t)(v * (float)max + 0.5f);
+}
+
+void sw_read_pixel(enum gs_color_format format, const uint8_t *ptr,
+		float *rgba)
+{
+	const uint16_t *p16 = (const uint16_t*)ptr;
+	const float    *p32 = (const float*)ptr;
+	uint32_t       packed;
+
+	rgba[0] = rgba[1] = rgba[2] = 0.0f;
+	rgba[3] = 1.0f;
+
+	switch (format) {
+	case GS_A8:
+		rgba[3] = unorm8(ptr[0]);
+		break;
+	case GS_R8:
+		rgba[0] = unorm8(ptr[0]);
+		break;
+	case GS_RGBA:
+		rgba[0] = unorm8(ptr[0]);
+		rgba[1] = unorm8(ptr[1]);
+		rgba[2] = unorm8(ptr[2]);
+		rgba[3] = unorm8(ptr[3]);
+		break;
+	case GS_BGRA:
+		rgba[3] = unorm8(ptr[3]);
+		/* fall through */
+	case GS_BGRX:
+		rgba[0] = unorm8(ptr[2]);
+		rgba[1] = unorm8(ptr[1]);
+		rgba[2] = unorm8(ptr[0]);
+		break;
+	case GS_R10G10B10A2:
+		memcpy(&packed, ptr, sizeof(packed));
+		rgba[0] = (float)(packed & 0x3FF) / 1023.0f;
+		rgba[1] = (float)((packed >> 10) & 0x3FF) / 1023.0f;
+		rgba[2] = (float)((packed >> 20) & 0x3FF) / 1023.0f;
+		rgba[3] = (float)(packed >> 30) / 3.0f;
+		break;
+	case GS_RGBA16:
+		rgba[0] = unorm16(p16[0]);
+		rgba[1] = unorm16(p16[1]);
+		rgba[2] = unorm16(p16[2]);
+		rgba[3] = unorm16(p16[3]);
+		break;
+	case GS_R16:
+		rgba[0] = unorm16(p16[0]);
+		break;
+	case GS_RGBA16F:
+		rgba[3] = half_to_float(p16[3]);
+		rgba[2] = half_to_float(p16[2]);
+		/* fall through */
+	case GS_RG16F:
+		rgba[1] = half_to_float(p16[1]);
+		/* fall through */
+	case GS_R16F:
+		rgba[0] = half_to_float(p16[0]);
+		break;
+	case GS_RGBA32F:
+		rgba[3] = p32[3];
+		rgba[2] = p32[2];
+		/* fall through */
+	case GS_RG32F:
+		rgba[1] = p32[1];
+		/* fall through */
+	case GS_R32F:
+		rgba[0] = p32[0];
+		break;
+	case GS_DXT1:
+	case GS_DXT3:
+	case GS_DXT5:
+	case GS_UNKNOWN:
+		/* compressed textures are stored, but not decoded */
+		rgba[3] = 0.0f;
+		break;
+	}
+}
+
+void sw_write_pixel(enum gs_color_format format, uint8_t *ptr,
+		const float *rgba)
+{
+	uint16_t *p16 = (uint16_t*)ptr;
+	float    *p32 = (float*)ptr;
+	uint32_t packed;
+
+	switch (format) {
+	case GS_A8:
+		ptr[0] = (uint8_t)to_unorm(rgba[3], 255);
+		break;
+	case GS_R8:
+		ptr[0] = (uint8_t)to_unorm(rgba[0], 255);
+		break;
+	case GS_RGBA:
+		ptr[0] = (uint8_t)to_unorm(rgba[0], 255);
+		ptr[1] = (uint8_t)to_unorm(rgba[1], 255);
+		ptr[2] = (uint8_t)to_unorm(rgba[2], 255);
+		ptr[3] = (uint8_t)to_unorm(rgba[3], 255);
+		break;
+	case GS_BGRX:
+	case GS_BGRA:
+		ptr[0] = (uint8_t)to_unorm(rgba[2], 255);
+		ptr[1] = (uint8_t)to_unorm(rgba[1], 255);
+		ptr[2] = (uint8_t)to_unorm(rgba[0], 255);
+		ptr[3] = format == GS_BGRX ?
+			255 : (uint8_t)to_unorm(rgba[3], 255);
+		break;
+	case GS_R10G10B10A2:
+		packed = to_unorm(rgba[0], 1023) |
+			(to_unorm(rgba[1], 1023) << 10) |
+			(to_unorm(rgba[2], 1023) << 20) |
+			(to_unorm(rgba[3], 3) << 30);
+		memcpy(ptr, &packed, sizeof(packed));
+		break;
+	case GS_RGBA16:
+		p16[0] = (uint16_t)to_unorm(rgba[0], 65535);
+		p16[1] = (uint16_t)to_unorm(rgba[1], 65535);
+		p16[2] = (uint16_t)to_unorm(rgba[2], 65535);
+		p16[3] = (uint16_t)to_unorm(rgba[3], 65535);
+		break;
+	case GS_R16:
+		p16[0] = (uint16_t)to_unorm(rgba[0], 65535);
+		break;
+	case GS_RGBA16F:
+		p16[3] = float_to_half(rgba[3]);
+		p16[2] = float_to_half(rgba[2]);
+		/* fall through */
+	case GS_RG16F:
+		p16[1] = float_to_half(rgba[1]);
+		/* fall through */
+	case GS_R16F:
+		p16[0] = float_to_half(rgba[0]);
+		break;
+	case GS_RGBA32F:
+		p32[3] = rgba[3];
+		p32[2] = rgba[2];
+		/* fall through */
+	case GS_RG32F:
+		p32[1] = rgba[1];
+		/* fall through */
+	case GS_R32F:
+		p32[0] = rgba[0];
+		break;
+	case GS_DXT1:
+	case GS_DXT3:
+	case GS_DXT5:
+	case GS_UNKNOWN:
+		break;
+	}
+}
+
+static inline uint8_t *surface_ptr(const struct sw_surface *surf,
+		uint32_t x, uint32_t y)
+{
+	return surf->data + y * surf->linesize +
+		x * (gs_get_format_bpp(surf->format) / 8);
+}
+
+void sw_surface_load(const struct sw_surface *surf, int x, int y, float *rgba)
+{
+	if (x < 0 || y < 0 || (uint32_t)x >= surf->width ||
+	    (uint32_t)y >= surf->height ||
+	    gs_is_compressed_format(surf->format)) {
+		rgba[0] = rgba[1] = rgba[2] = rgba[3] = 0.0f;
+		return;
+	}
+
+	sw_read_pixel(surf->format, surface_ptr(surf, x, y), rgba);
+}
+
+/* returns false if the coordinate is outside of a border address */
+static inline bool address_coord(enum gs_address_mode mode, int *coord,
+		int size)
+{
+	int c = *coord;
+	int period;
+
+	switch (mode) {
+	case GS_ADDRESS_WRAP:
+		c %= size;
+		if (c < 0)
+			c += size;
+		break;
+
+	case GS_ADDRESS_MIRROR:
+		period = size * 2;
+		c %= period;
+		if (c < 0)
+			c += period;
+		if (c >= size)
+			c = period - 1 - c;
+		break;
+
+	case GS_ADDRESS_MIRRORONCE:
+		if (c < 0)
+			c = -c - 1;
+		if (c >= size)
+			c = size - 1;
+		break;
+
+	case GS_ADDRESS_BORDER:
+		if (c < 0 || c >= size)
+			return false;
+		break;
+
+	case GS_ADDRESS_CLAMP:
+	default:
+		if (c < 0)
+			c = 0;
+		else if (c >= size)
+			c = size - 1;
+	}
+
+	*coord = c;
+	return true;
+}
+
+static inline void fetch_texel(const struct sw_surface *surf,
+		const struct gs_sampler_state *ss, int x, int y, float *rgba)
+{
+	if (!address_coord(ss->address_u, &x, (int)surf->width) ||
+	    !address_coord(ss->address_v, &y, (int)surf->height)) {
+		memcpy(rgba, ss->border_color.ptr, sizeof(float) * 4);
+		return;
+	}
+
+	sw_read_pixel(surf->format, surface_ptr(surf, x, y), rgba);
+}
+
+void sw_surface_sample(const struct sw_surface *surf,
+		const struct gs_sampler_state *ss, const float *uv,
+		float *rgba)
+{
+	float u, v, fu, fv;
+	float t00[4], t10[4], t01[4], t11[4];
+	int   x, y;
+
+	if (!surf->width || !surf->height ||
+	    gs_is_compressed_format(surf->format)) {
+		rgba[0] = rgba[1] = rgba[2] = rgba[3] = 0.0f;
+		return;
+	}
+
+	u = uv[0] * (float)surf->width;
+	v = uv[1] * (float)surf->height;
+
+	if (!ss->linear) {
+		fetch_texel(surf, ss, (int)floorf(u), (int)floorf(v), rgba);
+		return;
+	}
+
+	u -= 0.5f;
+	v -= 0.5f;
+	x = (int)floorf(u);
+	y = (int)floorf(v);
+	fu = u - (float)x;
+	fv = v - (float)y;
+
+	fetch_texel(surf, ss, x,     y,     t00);
+	fetch_texel(surf, ss, x + 1, y,     t10);
+	fetch_texel(surf, ss, x,     y + 1, t01);
+	fetch_texel(surf, ss, x + 1, y + 1, t11);
+
+	for (int i = 0; i < 4; i++) {
+		float top    = t00[i] + (t10[i] - t00[i]) * fu;
+		float bottom = t01[i] + (t11[i] - t01[i]) * fu;
+		rgba[i] = top + (bottom - top) * fv;
+	}
+}
+
+void sw_surface_fill(const struct sw_surface *surf, const struct gs_rect *rect,
+		const float *rgba)
+{
+	uint32_t bytes = gs_get_format_bpp(surf->format) / 8;
+	uint8_t  texel[16];
+	int      x0, y0, x1, y1;
+
+	if (!bytes)
+		return;
+
+	x0 = rect->x < 0 ? 0 : rect->x;
+	y0 = rect->y < 0 ? 0 : rect->y;
+	x1 = rect->x + rect->cx;
+	y1 = rect->y + rect->cy;
+	if (x1 > (int)surf->width)  x1 = (int)surf->width;
+	if (y1 > (int)surf->height) y1 = (int)surf->height;
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	sw_write_pixel(surf->format, texel, rgba);
+
+	for (int y = y0; y < y1; y++) {
+		uint8_t *row = surface_ptr(surf, x0, y);
+		for (int x = x0; x < x1; x++, row += bytes)
+			memcpy(row, texel, bytes);
+	}
+}
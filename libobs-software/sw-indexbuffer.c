@@ -0,0 +1,78 @@
+#include "sw-subsystem.h"
+
+gs_indexbuffer_t *device_indexbuffer_create(gs_device_t *device,
+		enum gs_index_type type, void *indices, size_t num,
+		uint32_t flags)
+{
+	struct gs_index_buffer *ib = bzalloc(sizeof(struct gs_index_buffer));
+	size_t width = type == GS_UNSIGNED_LONG ?
+		sizeof(uint32_t) : sizeof(uint16_t);
+
+	ib->device  = device;
+	ib->data    = indices;
+	ib->dynamic = flags & GS_DYNAMIC;
+	ib->num     = num;
+	ib->width   = width;
+	ib->size    = width * num;
+	ib->type    = type;
+
+	/* dynamic buffers draw from a copy so the caller can keep writing
+	 * to the data until it flushes */
+	ib->indices = ib->dynamic ? bmemdup(indices, ib->size) : indices;
+	return ib;
+}
+
+void gs_indexbuffer_destroy(gs_indexbuffer_t *ib)
+{
+	if (ib) {
+		if (ib->device->cur_index_buffer == ib)
+			ib->device->cur_index_buffer = NULL;
+
+		if (ib->indices != ib->data)
+			bfree(ib->indices);
+		bfree(ib->data);
+		bfree(ib);
+	}
+}
+
+static inline void gs_indexbuffer_flush_internal(gs_indexbuffer_t *ib,
+		const void *data)
+{
+	if (!ib->dynamic) {
+		blog(LOG_ERROR, "Index buffer is not dynamic");
+		blog(LOG_ERROR, "gs_indexbuffer_flush (SW) failed");
+		return;
+	}
+
+	memcpy(ib->indices, data, ib->size);
+}
+
+void gs_indexbuffer_flush(gs_indexbuffer_t *ib)
+{
+	gs_indexbuffer_flush_internal(ib, ib->data);
+}
+
+void gs_indexbuffer_flush_direct(gs_indexbuffer_t *ib, const void *data)
+{
+	gs_indexbuffer_flush_internal(ib, data);
+}
+
+void *gs_indexbuffer_get_data(const gs_indexbuffer_t *ib)
+{
+	return ib->dynamic ? ib->data : NULL;
+}
+
+size_t gs_indexbuffer_get_num_indices(const gs_indexbuffer_t *ib)
+{
+	return ib->num;
+}
+
+enum gs_index_type gs_indexbuffer_get_type(const gs_indexbuffer_t *ib)
+{
+	return ib->type;
+}
+
+void device_load_indexbuffer(gs_device_t *device, gs_indexbuffer_t *ib)
+{
+	device->cur_index_buffer = ib;
+}
@@ -0,0 +1,783 @@
+#include <math.h>
+#include <graphics/vec4.h>
+#include "sw-subsystem.h"
+
+/*
+ *   Vertices are shaded on demand and cached by index for the duration of a
+ * draw, so indexed and strip geometry only runs the vertex shader once per
+ * vertex.  Triangles are clipped against the near plane, then rasterized with
+ * edge functions, sampling at pixel centers with the top-left fill rule.
+ */
+
+enum vs_input_kind {
+	VS_INPUT_NONE,
+	VS_INPUT_POSITION,
+	VS_INPUT_NORMAL,
+	VS_INPUT_TANGENT,
+	VS_INPUT_COLOR,
+	VS_INPUT_TEXCOORD
+};
+
+struct vs_input {
+	enum vs_input_kind kind;
+	size_t             index;
+	size_t             offset;
+	size_t             size;
+};
+
+struct varying {
+	size_t             ps_offset;
+	size_t             vs_offset;
+	size_t             size;
+	bool               position;
+	bool               missing;
+};
+
+#define MAX_BINDINGS 32
+
+struct raster {
+	gs_device_t        *device;
+	struct gs_shader   *vs;
+	struct gs_shader   *ps;
+	gs_vertbuffer_t    *vb;
+	gs_indexbuffer_t   *ib;
+
+	struct sw_surface  target;
+	gs_zstencil_t      *zs;
+	int                min_x, min_y, max_x, max_y;
+
+	struct vs_input    inputs[MAX_BINDINGS];
+	size_t             num_inputs;
+	struct varying     varyings[MAX_BINDINGS];
+	size_t             num_varyings;
+
+	size_t             out_size;
+	size_t             pos_offset;
+	size_t             color_offset;
+	size_t             color_size;
+
+	struct sl_exec     vs_exec;
+	struct sl_exec     ps_exec;
+	float              *ps_in;
+	float              *ps_out;
+};
+
+static inline bool is_position(const char *semantic)
+{
+	return astrcmpi(semantic, "POSITION") == 0 ||
+	       astrcmpi(semantic, "SV_Position") == 0;
+}
+
+static inline bool is_target(const char *semantic)
+{
+	return astrcmpi(semantic, "TARGET") == 0 ||
+	       astrcmpi(semantic, "SV_Target") == 0 ||
+	       astrcmpi(semantic, "COLOR") == 0;
+}
+
+static void get_vs_input(struct vs_input *input, const char *semantic)
+{
+	input->index = 0;
+
+	if (is_position(semantic)) {
+		input->kind = VS_INPUT_POSITION;
+	} else if (astrcmpi(semantic, "NORMAL") == 0) {
+		input->kind = VS_INPUT_NORMAL;
+	} else if (astrcmpi(semantic, "TANGENT") == 0) {
+		input->kind = VS_INPUT_TANGENT;
+	} else if (astrcmpi(semantic, "COLOR") == 0) {
+		input->kind = VS_INPUT_COLOR;
+	} else if (astrcmpi_n(semantic, "TEXCOORD", 8) == 0) {
+		input->kind  = VS_INPUT_TEXCOORD;
+		input->index = (size_t)atoi(semantic + 8);
+	} else {
+		input->kind = VS_INPUT_NONE;
+	}
+}
+
+static const struct sl_binding *find_binding(const struct sl_program *prog,
+		const char *semantic)
+{
+	for (size_t i = 0; i < prog->outputs.num; i++) {
+		const struct sl_binding *binding = prog->outputs.array + i;
+		if (astrcmpi(binding->semantic, semantic) == 0 ||
+		    (is_position(semantic) && is_position(binding->semantic)))
+			return binding;
+	}
+
+	return NULL;
+}
+
+static bool raster_init_bindings(struct raster *r)
+{
+	const struct sl_program *vprog = r->vs->program;
+	const struct sl_program *pprog = r->ps->program;
+	const struct sl_binding *pos = NULL;
+
+	if (vprog->inputs.num > MAX_BINDINGS ||
+	    pprog->inputs.num > MAX_BINDINGS) {
+		blog(LOG_ERROR, "Too many shader inputs");
+		return false;
+	}
+
+	for (size_t i = 0; i < vprog->inputs.num; i++) {
+		const struct sl_binding *binding = vprog->inputs.array + i;
+		struct vs_input *input = r->inputs + r->num_inputs++;
+
+		get_vs_input(input, binding->semantic);
+		input->offset = binding->offset;
+		input->size   = binding->size;
+	}
+
+	for (size_t i = 0; i < vprog->outputs.num && !pos; i++)
+		if (is_position(vprog->outputs.array[i].semantic))
+			pos = vprog->outputs.array + i;
+
+	if (!pos || pos->size < 4) {
+		blog(LOG_ERROR, "Vertex shader has no float4 POSITION output");
+		return false;
+	}
+
+	r->out_size   = vprog->output_size;
+	r->pos_offset = pos->offset;
+
+	for (size_t i = 0; i < pprog->inputs.num; i++) {
+		const struct sl_binding *binding = pprog->inputs.array + i;
+		const struct sl_binding *src = find_binding(vprog,
+				binding->semantic);
+		struct varying *v = r->varyings + r->num_varyings++;
+
+		v->ps_offset = binding->offset;
+		v->size      = binding->size;
+		v->position  = is_position(binding->semantic);
+		v->missing   = !src;
+		v->vs_offset = src ? src->offset : 0;
+
+		if (src && src->size < v->size)
+			v->size = src->size;
+	}
+
+	r->color_offset = 0;
+	r->color_size   = pprog->output_size;
+
+	for (size_t i = 0; i < pprog->outputs.num; i++) {
+		const struct sl_binding *binding = pprog->outputs.array + i;
+		if (is_target(binding->semantic)) {
+			r->color_offset = binding->offset;
+			r->color_size   = binding->size;
+			break;
+		}
+	}
+
+	if (r->color_size > 4)
+		r->color_size = 4;
+	return true;
+}
+
+static void raster_init_clip_rect(struct raster *r)
+{
+	const gs_device_t *device = r->device;
+	const struct gs_rect *vp = &device->cur_viewport;
+
+	r->min_x = vp->x > 0 ? vp->x : 0;
+	r->min_y = vp->y > 0 ? vp->y : 0;
+	r->max_x = vp->x + vp->cx;
+	r->max_y = vp->y + vp->cy;
+
+	if (r->max_x > (int)r->target.width)
+		r->max_x = (int)r->target.width;
+	if (r->max_y > (int)r->target.height)
+		r->max_y = (int)r->target.height;
+
+	if (device->scissor_enabled) {
+		const struct gs_rect *sc = &device->cur_scissor;
+		if (r->min_x < sc->x)          r->min_x = sc->x;
+		if (r->min_y < sc->y)          r->min_y = sc->y;
+		if (r->max_x > sc->x + sc->cx) r->max_x = sc->x + sc->cx;
+		if (r->max_y > sc->y + sc->cy) r->max_y = sc->y + sc->cy;
+	}
+}
+
+static bool raster_init(struct raster *r, gs_device_t *device)
+{
+	size_t stack_size;
+	size_t num;
+
+	memset(r, 0, sizeof(*r));
+	r->device = device;
+	r->vs     = device->cur_vertex_shader;
+	r->ps     = device->cur_pixel_shader;
+	r->vb     = device->cur_vertex_buffer;
+	r->ib     = device->cur_index_buffer;
+
+	if (!sw_get_target(device, &r->target))
+		return false;
+
+	r->zs = device->cur_render_target ?
+		device->cur_zstencil_buffer :
+		device->cur_swap->zs;
+
+	if (!raster_init_bindings(r))
+		return false;
+
+	raster_init_clip_rect(r);
+
+	stack_size = r->vs->program->stack_size;
+	if (stack_size < r->ps->program->stack_size)
+		stack_size = r->ps->program->stack_size;
+
+	num = r->vb->num;
+	da_resize(device->stack,      stack_size);
+	da_resize(device->vs_inputs,  r->vs->program->input_size);
+	da_resize(device->vs_outputs, num * r->out_size);
+	da_resize(device->vs_done,    num);
+	da_resize(device->ps_inputs,  r->ps->program->input_size +
+			r->ps->program->output_size);
+	da_resize(device->clip_verts, r->out_size * 2);
+
+	if (num)
+		memset(device->vs_done.array, 0, num);
+
+	r->vs_exec.prog    = r->vs->program;
+	r->vs_exec.globals = r->vs->globals.array;
+	r->vs_exec.stack   = device->stack.array;
+	r->vs_exec.funcs   = &shader_texture_funcs;
+	r->vs_exec.param   = r->vs;
+
+	r->ps_exec         = r->vs_exec;
+	r->ps_exec.prog    = r->ps->program;
+	r->ps_exec.globals = r->ps->globals.array;
+	r->ps_exec.param   = r->ps;
+
+	r->ps_in  = device->ps_inputs.array;
+	r->ps_out = r->ps_in + r->ps->program->input_size;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void load_vs_input(const struct raster *r, const struct vs_input *input,
+		uint32_t idx, float *dst)
+{
+	const struct gs_vertex_buffer *vb = r->vb;
+	float val[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+	size_t size = input->size;
+
+	switch (input->kind) {
+	case VS_INPUT_POSITION:
+		memcpy(val, vb->points[idx].ptr, sizeof(float) * 3);
+		break;
+	case VS_INPUT_NORMAL:
+		if (vb->normals)
+			memcpy(val, vb->normals[idx].ptr, sizeof(float) * 3);
+		break;
+	case VS_INPUT_TANGENT:
+		if (vb->tangents)
+			memcpy(val, vb->tangents[idx].ptr, sizeof(float) * 3);
+		break;
+	case VS_INPUT_COLOR:
+		if (vb->colors) {
+			struct vec4 color;
+			vec4_from_rgba(&color, vb->colors[idx]);
+			memcpy(val, color.ptr, sizeof(float) * 4);
+		}
+		break;
+	case VS_INPUT_TEXCOORD:
+		if (input->index < vb->uvs.num) {
+			size_t width = vb->uv_sizes.array[input->index];
+			const float *uv = vb->uvs.array[input->index];
+			if (width > 4)
+				width = 4;
+			if (uv)
+				memcpy(val, uv + idx * width,
+						sizeof(float) * width);
+		}
+		break;
+	case VS_INPUT_NONE:
+		break;
+	}
+
+	if (size > 4) {
+		memset(dst + 4, 0, (size - 4) * sizeof(float));
+		size = 4;
+	}
+	memcpy(dst, val, size * sizeof(float));
+}
+
+static const float *shade_vertex(struct raster *r, uint32_t idx)
+{
+	gs_device_t *device = r->device;
+	float *out = device->vs_outputs.array + (size_t)idx * r->out_size;
+	float *in  = device->vs_inputs.array;
+
+	if (device->vs_done.array[idx])
+		return out;
+
+	for (size_t i = 0; i < r->num_inputs; i++)
+		load_vs_input(r, r->inputs + i, idx, in + r->inputs[i].offset);
+
+	if (!sl_execute(&r->vs_exec, in, out))
+		memset(out, 0, r->out_size * sizeof(float));
+
+	device->vs_done.array[idx] = 1;
+	device->stats.vertices++;
+	return out;
+}
+
+static inline bool get_index(struct raster *r, uint32_t i, uint32_t *idx)
+{
+	if (r->ib) {
+		if (i >= r->ib->num)
+			return false;
+		*idx = indexbuffer_get(r->ib, i);
+	} else {
+		*idx = i;
+	}
+
+	return *idx < r->vb->num;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline float blend_factor(enum gs_blend_type type, const float *src,
+		const float *dst, int c)
+{
+	switch (type) {
+	case GS_BLEND_ZERO:        return 0.0f;
+	case GS_BLEND_ONE:         return 1.0f;
+	case GS_BLEND_SRCCOLOR:    return src[c];
+	case GS_BLEND_INVSRCCOLOR: return 1.0f - src[c];
+	case GS_BLEND_SRCALPHA:    return src[3];
+	case GS_BLEND_INVSRCALPHA: return 1.0f - src[3];
+	case GS_BLEND_DSTCOLOR:    return dst[c];
+	case GS_BLEND_INVDSTCOLOR: return 1.0f - dst[c];
+	case GS_BLEND_DSTALPHA:    return dst[3];
+	case GS_BLEND_INVDSTALPHA: return 1.0f - dst[3];
+	case GS_BLEND_SRCALPHASAT:
+		if (c == 3)
+			return 1.0f;
+		return src[3] < 1.0f - dst[3] ? src[3] : 1.0f - dst[3];
+	}
+
+	return 1.0f;
+}
+
+static inline bool depth_test(enum gs_depth_test test, float z, float cur)
+{
+	switch (test) {
+	case GS_NEVER:    return false;
+	case GS_LESS:     return z <  cur;
+	case GS_LEQUAL:   return z <= cur;
+	case GS_EQUAL:    return z == cur;
+	case GS_GEQUAL:   return z >= cur;
+	case GS_GREATER:  return z >  cur;
+	case GS_NOTEQUAL: return z != cur;
+	case GS_ALWAYS:   return true;
+	}
+
+	return true;
+}
+
+static void write_pixel(struct raster *r, int x, int y, const float *src)
+{
+	const gs_device_t *device = r->device;
+	uint32_t bytes = gs_get_format_bpp(r->target.format) / 8;
+	uint8_t *ptr = r->target.data + (size_t)y * r->target.linesize +
+		(size_t)x * bytes;
+	const bool *mask = device->color_mask;
+	float dst[4];
+	float out[4];
+
+	if (!device->blend_enabled && mask[0] && mask[1] && mask[2] &&
+	    mask[3]) {
+		sw_write_pixel(r->target.format, ptr, src);
+		return;
+	}
+
+	sw_read_pixel(r->target.format, ptr, dst);
+
+	for (int c = 0; c < 4; c++) {
+		enum gs_blend_type fs, fd;
+
+		if (!mask[c]) {
+			out[c] = dst[c];
+			continue;
+		}
+
+		if (!device->blend_enabled) {
+			out[c] = src[c];
+			continue;
+		}
+
+		fs = c == 3 ? device->blend_src_a  : device->blend_src_c;
+		fd = c == 3 ? device->blend_dest_a : device->blend_dest_c;
+
+		out[c] = src[c] * blend_factor(fs, src, dst, c) +
+		         dst[c] * blend_factor(fd, src, dst, c);
+	}
+
+	sw_write_pixel(r->target.format, ptr, out);
+}
+
+/*
+ * Shades one pixel.  'w' holds the perspective correct weight of each of the
+ * 'count' vertices, 'pos' is the pixel position given to the pixel shader.
+ */
+static void shade_pixel(struct raster *r, int x, int y, const float *pos,
+		const float **verts, const float *w, int count)
+{
+	gs_device_t *device = r->device;
+	float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+	float *depth = NULL;
+
+	if (pos[2] < 0.0f || pos[2] > 1.0f)
+		return;
+
+	if (r->zs && device->depth_enabled &&
+	    (uint32_t)x < r->zs->width && (uint32_t)y < r->zs->height) {
+		depth = r->zs->depth + (size_t)y * r->zs->width + x;
+		if (!depth_test(device->depth_function, pos[2], *depth))
+			return;
+	}
+
+	for (size_t i = 0; i < r->num_varyings; i++) {
+		const struct varying *v = r->varyings + i;
+		float *dst = r->ps_in + v->ps_offset;
+
+		if (v->position) {
+			memcpy(dst, pos, sizeof(float) * v->size);
+			continue;
+		}
+
+		for (size_t c = 0; c < v->size; c++) {
+			float val = 0.0f;
+			if (!v->missing)
+				for (int k = 0; k < count; k++)
+					val += w[k] * verts[k][v->vs_offset+c];
+			dst[c] = val;
+		}
+	}
+
+	if (!sl_execute(&r->ps_exec, r->ps_in, r->ps_out))
+		return;
+
+	memcpy(color, r->ps_out + r->color_offset,
+			r->color_size * sizeof(float));
+
+	if (depth)
+		*depth = pos[2];
+
+	write_pixel(r, x, y, color);
+	device->stats.pixels++;
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct screen_vert {
+	float x, y, z;
+	float inv_w;
+};
+
+static bool to_screen(const struct raster *r, const float *vert,
+		struct screen_vert *sv)
+{
+	const struct gs_rect *vp = &r->device->cur_viewport;
+	const float *pos = vert + r->pos_offset;
+
+	if (pos[3] <= 0.0f)
+		return false;
+
+	sv->inv_w = 1.0f / pos[3];
+	sv->x = (float)vp->x + (pos[0] * sv->inv_w + 1.0f) * 0.5f *
+		(float)vp->cx;
+	sv->y = (float)vp->y + (1.0f - pos[1] * sv->inv_w) * 0.5f *
+		(float)vp->cy;
+	sv->z = pos[2] * sv->inv_w;
+	return true;
+}
+
+static inline float edge(const struct screen_vert *a,
+		const struct screen_vert *b, float px, float py)
+{
+	return (b->x - a->x) * (py - a->y) - (b->y - a->y) * (px - a->x);
+}
+
+static inline bool is_top_left(const struct screen_vert *a,
+		const struct screen_vert *b)
+{
+	float dx = b->x - a->x;
+	float dy = b->y - a->y;
+	return dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+}
+
+static inline bool edge_inside(float e, bool top_left)
+{
+	return e > 0.0f || (e == 0.0f && top_left);
+}
+
+static inline int clamp_int(int val, int min, int max)
+{
+	return val < min ? min : (val > max ? max : val);
+}
+
+static void raster_triangle(struct raster *r, const float *v0,
+		const float *v1, const float *v2)
+{
+	const float *verts[3] = {v0, v1, v2};
+	struct screen_vert sv[3];
+	enum gs_cull_mode cull = r->device->cur_cull_mode;
+	const float *tmp;
+	float area, min_x, min_y, max_x, max_y;
+	bool tl0, tl1, tl2;
+	int x0, y0, x1, y1;
+
+	for (int i = 0; i < 3; i++)
+		if (!to_screen(r, verts[i], sv + i))
+			return;
+
+	/* counter-clockwise is the front face, which is a negative area once
+	 * y points down */
+	area = edge(sv, sv + 1, sv[2].x, sv[2].y);
+	if (area == 0.0f)
+		return;
+	if ((cull == GS_BACK && area > 0.0f) ||
+	    (cull == GS_FRONT && area < 0.0f))
+		return;
+
+	if (area < 0.0f) {
+		struct screen_vert s = sv[1];
+		sv[1] = sv[2];
+		sv[2] = s;
+		tmp = verts[1];
+		verts[1] = verts[2];
+		verts[2] = tmp;
+		area = -area;
+	}
+
+	r->device->stats.primitives++;
+
+	min_x = fminf(sv[0].x, fminf(sv[1].x, sv[2].x));
+	min_y = fminf(sv[0].y, fminf(sv[1].y, sv[2].y));
+	max_x = fmaxf(sv[0].x, fmaxf(sv[1].x, sv[2].x));
+	max_y = fmaxf(sv[0].y, fmaxf(sv[1].y, sv[2].y));
+
+	/* pixels whose centers are inside the bounds */
+	x0 = clamp_int((int)ceilf(min_x - 0.5f), r->min_x, r->max_x);
+	y0 = clamp_int((int)ceilf(min_y - 0.5f), r->min_y, r->max_y);
+	x1 = clamp_int((int)ceilf(max_x - 0.5f), r->min_x, r->max_x);
+	y1 = clamp_int((int)ceilf(max_y - 0.5f), r->min_y, r->max_y);
+
+	tl0 = is_top_left(sv + 1, sv + 2);
+	tl1 = is_top_left(sv + 2, sv);
+	tl2 = is_top_left(sv,     sv + 1);
+
+	for (int y = y0; y < y1; y++) {
+		float py = (float)y + 0.5f;
+		float px = (float)x0 + 0.5f;
+		float e0 = edge(sv + 1, sv + 2, px, py);
+		float e1 = edge(sv + 2, sv,     px, py);
+		float e2 = edge(sv,     sv + 1, px, py);
+		float d0 = -(sv[2].y - sv[1].y);
+		float d1 = -(sv[0].y - sv[2].y);
+		float d2 = -(sv[1].y - sv[0].y);
+
+		for (int x = x0; x < x1; x++, e0 += d0, e1 += d1, e2 += d2) {
+			float l[3], w[3], pos[4], inv_w;
+
+			if (!edge_inside(e0, tl0) || !edge_inside(e1, tl1) ||
+			    !edge_inside(e2, tl2))
+				continue;
+
+			l[0] = e0 / area;
+			l[1] = e1 / area;
+			l[2] = e2 / area;
+
+			inv_w = l[0] * sv[0].inv_w + l[1] * sv[1].inv_w +
+				l[2] * sv[2].inv_w;
+			for (int i = 0; i < 3; i++)
+				w[i] = l[i] * sv[i].inv_w / inv_w;
+
+			pos[0] = (float)x + 0.5f;
+			pos[1] = py;
+			pos[2] = l[0] * sv[0].z + l[1] * sv[1].z +
+				l[2] * sv[2].z;
+			pos[3] = 1.0f / inv_w;
+
+			shade_pixel(r, x, y, pos, verts, w, 3);
+		}
+	}
+}
+
+static void lerp_vert(float *dst, const float *a, const float *b, float t,
+		size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		dst[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+/* clips against the near plane, z >= 0 in clip space */
+static void draw_triangle(struct raster *r, const float *v0, const float *v1,
+		const float *v2)
+{
+	const float *in[3] = {v0, v1, v2};
+	const float *out[4];
+	float *clip = r->device->clip_verts.array;
+	size_t z = r->pos_offset + 2;
+	size_t num = 0;
+
+	if (v0[z] >= 0.0f && v1[z] >= 0.0f && v2[z] >= 0.0f) {
+		raster_triangle(r, v0, v1, v2);
+		return;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		const float *a = in[i];
+		const float *b = in[(i + 1) % 3];
+		bool a_in = a[z] >= 0.0f;
+		bool b_in = b[z] >= 0.0f;
+
+		if (a_in)
+			out[num++] = a;
+
+		if (a_in != b_in) {
+			lerp_vert(clip, a, b, a[z] / (a[z] - b[z]),
+					r->out_size);
+			out[num++] = clip;
+			clip += r->out_size;
+		}
+	}
+
+	for (size_t i = 1; i + 1 < num; i++)
+		raster_triangle(r, out[0], out[i], out[i + 1]);
+}
+
+static void draw_line(struct raster *r, const float *v0, const float *v1)
+{
+	const float *verts[2] = {v0, v1};
+	struct screen_vert s0, s1;
+	float dx, dy;
+	int steps;
+
+	/* lines crossing the near plane are not clipped, only dropped */
+	if (v0[r->pos_offset + 2] < 0.0f || v1[r->pos_offset + 2] < 0.0f)
+		return;
+	if (!to_screen(r, v0, &s0) || !to_screen(r, v1, &s1))
+		return;
+
+	r->device->stats.primitives++;
+
+	dx = s1.x - s0.x;
+	dy = s1.y - s0.y;
+	steps = (int)ceilf(fmaxf(fabsf(dx), fabsf(dy)));
+	if (steps < 1)
+		steps = 1;
+
+	for (int i = 0; i < steps; i++) {
+		float t = ((float)i + 0.5f) / (float)steps;
+		float inv_w = s0.inv_w + (s1.inv_w - s0.inv_w) * t;
+		float w[2], pos[4];
+		int x = (int)floorf(s0.x + dx * t);
+		int y = (int)floorf(s0.y + dy * t);
+
+		if (x < r->min_x || x >= r->max_x ||
+		    y < r->min_y || y >= r->max_y)
+			continue;
+
+		w[0] = (1.0f - t) * s0.inv_w / inv_w;
+		w[1] = t * s1.inv_w / inv_w;
+
+		pos[0] = (float)x + 0.5f;
+		pos[1] = (float)y + 0.5f;
+		pos[2] = s0.z + (s1.z - s0.z) * t;
+		pos[3] = 1.0f / inv_w;
+
+		shade_pixel(r, x, y, pos, verts, w, 2);
+	}
+}
+
+static void draw_point(struct raster *r, const float *v)
+{
+	struct screen_vert s;
+	float w = 1.0f, pos[4];
+	int x, y;
+
+	if (v[r->pos_offset + 2] < 0.0f || !to_screen(r, v, &s))
+		return;
+
+	x = (int)floorf(s.x);
+	y = (int)floorf(s.y);
+	if (x < r->min_x || x >= r->max_x || y < r->min_y || y >= r->max_y)
+		return;
+
+	r->device->stats.primitives++;
+
+	pos[0] = (float)x + 0.5f;
+	pos[1] = (float)y + 0.5f;
+	pos[2] = s.z;
+	pos[3] = 1.0f / s.inv_w;
+
+	shade_pixel(r, x, y, pos, &v, &w, 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void sw_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
+		uint32_t start_vert, uint32_t num_verts)
+{
+	struct raster r;
+	uint32_t end = start_vert + num_verts;
+	uint32_t idx[3];
+
+	if (!raster_init(&r, device)) {
+		blog(LOG_ERROR, "device_draw (SW) failed");
+		return;
+	}
+
+	device->stats.draws++;
+
+	if (r.min_x >= r.max_x || r.min_y >= r.max_y)
+		return;
+
+	switch (draw_mode) {
+	case GS_POINTS:
+		for (uint32_t i = start_vert; i < end; i++)
+			if (get_index(&r, i, idx))
+				draw_point(&r, shade_vertex(&r, idx[0]));
+		break;
+
+	case GS_LINES:
+	case GS_LINESTRIP:
+		for (uint32_t i = start_vert; i + 1 < end;
+				i += draw_mode == GS_LINES ? 2 : 1) {
+			if (!get_index(&r, i, idx) ||
+			    !get_index(&r, i + 1, idx + 1))
+				continue;
+
+			draw_line(&r, shade_vertex(&r, idx[0]),
+					shade_vertex(&r, idx[1]));
+		}
+		break;
+
+	case GS_TRIS:
+	case GS_TRISTRIP:
+		for (uint32_t i = start_vert; i + 2 < end;
+				i += draw_mode == GS_TRIS ? 3 : 1) {
+			/* every other strip triangle is reversed so that the
+			 * whole strip keeps the same winding */
+			bool odd = draw_mode == GS_TRISTRIP &&
+				((i - start_vert) & 1) != 0;
+			const float *v0, *v1, *v2;
+
+			if (!get_index(&r, i,     idx) ||
+			    !get_index(&r, i + 1, idx + 1) ||
+			    !get_index(&r, i + 2, idx + 2))
+				continue;
+
+			v0 = shade_vertex(&r, idx[odd ? 1 : 0]);
+			v1 = shade_vertex(&r, idx[odd ? 0 : 1]);
+			v2 = shade_vertex(&r, idx[2]);
+			draw_triangle(&r, v0, v1, v2);
+		}
+		break;
+	}
+}
@@ -0,0 +1,469 @@
+#include <assert.h>
+#include <math.h>
+
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+#include <graphics/vec4.h>
+#include <graphics/matrix3.h>
+#include <graphics/matrix4.h>
+#include "sw-subsystem.h"
+
+static inline void shader_param_free(struct gs_shader_param *param)
+{
+	bfree(param->name);
+	da_free(param->cur_value);
+	da_free(param->def_value);
+}
+
+static void sw_add_param(struct gs_shader *shader, struct shader_var *var,
+		int *texture_id, size_t idx)
+{
+	struct gs_shader_param param = {0};
+	int sampler;
+
+	param.array_count = var->array_count;
+	param.name        = bstrdup(var->name);
+	param.shader      = shader;
+	param.type        = get_shader_param_type(var->type);
+
+	if (param.type == GS_SHADER_PARAM_TEXTURE) {
+		sampler = shader->program->tex_samplers.array[idx];
+		param.sampler_id  = sampler == -1 ? (size_t)-1 : (size_t)sampler;
+		param.texture_id  = (*texture_id)++;
+	} else {
+		param.changed = true;
+	}
+
+	da_move(param.def_value, var->default_val);
+	da_copy(param.cur_value, param.def_value);
+
+	da_push_back(shader->params, &param);
+}
+
+static inline void sw_add_params(struct gs_shader *shader,
+		struct shader_parser *parser)
+{
+	int tex_id = 0;
+
+	for (size_t i = 0; i < parser->params.num; i++)
+		sw_add_param(shader, parser->params.array+i, &tex_id, i);
+
+	shader->viewproj = gs_shader_get_param_by_name(shader, "ViewProj");
+	shader->world    = gs_shader_get_param_by_name(shader, "World");
+}
+
+static inline void sw_add_samplers(struct gs_shader *shader,
+		struct shader_parser *parser)
+{
+	for (size_t i = 0; i < parser->samplers.num; i++) {
+		struct shader_sampler *sampler = parser->samplers.array+i;
+		gs_samplerstate_t *new_sampler;
+		struct gs_sampler_info info;
+
+		shader_sampler_convert(sampler, &info);
+		new_sampler = device_samplerstate_create(shader->device, &info);
+
+		da_push_back(shader->samplers, &new_sampler);
+	}
+}
+
+static struct gs_shader *shader_create(gs_device_t *device,
+		enum gs_shader_type type, const char *shader_str,
+		const char *file, char **error_string)
+{
+	struct gs_shader *shader = bzalloc(sizeof(struct gs_shader));
+	struct shader_parser parser;
+	char *errors;
+
+	shader->device = device;
+	shader->type   = type;
+
+	shader_parser_init(&parser);
+	if (shader_parse(&parser, shader_str, file))
+		shader->program = sl_program_compile(&parser, file);
+
+	errors = shader_parser_geterrors(&parser);
+	if (errors) {
+		blog(LOG_WARNING, "Shader parser errors/warnings:\n%s\n",
+				errors);
+		if (error_string)
+			*error_string = errors;
+		else
+			bfree(errors);
+	}
+
+	if (shader->program) {
+		sw_add_params(shader, &parser);
+		sw_add_samplers(shader, &parser);
+		da_resize(shader->globals, shader->program->globals_size);
+	} else {
+		gs_shader_destroy(shader);
+		shader = NULL;
+	}
+
+	shader_parser_free(&parser);
+	return shader;
+}
+
+gs_shader_t *device_vertexshader_create(gs_device_t *device,
+		const char *shader, const char *file,
+		char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_VERTEX, shader, file,
+			error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_vertexshader_create (SW) failed");
+	return ptr;
+}
+
+gs_shader_t *device_pixelshader_create(gs_device_t *device,
+		const char *shader, const char *file,
+		char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_PIXEL, shader, file,
+			error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_pixelshader_create (SW) failed");
+	return ptr;
+}
+
+void gs_shader_destroy(gs_shader_t *shader)
+{
+	if (!shader)
+		return;
+
+	for (size_t i = 0; i < shader->samplers.num; i++)
+		gs_samplerstate_destroy(shader->samplers.array[i]);
+
+	for (size_t i = 0; i < shader->params.num; i++)
+		shader_param_free(shader->params.array+i);
+
+	sl_program_destroy(shader->program);
+
+	da_free(shader->globals);
+	da_free(shader->samplers);
+	da_free(shader->params);
+	bfree(shader);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void load_global(const struct sl_global *global,
+		const struct gs_shader_param *param, size_t size, float *dst)
+{
+	const struct sl_type *type = &global->type;
+	const uint8_t *src = param->cur_value.array;
+	size_t count = type->array ? (size_t)type->array : 1;
+	size_t comps = (size_t)type->rows * type->cols;
+	size_t stride;
+	bool   ints = type->base == SL_INT || type->base == SL_BOOL;
+
+	memset(dst, 0, size * sizeof(float));
+
+	if (type->base != SL_FLOAT && !ints)
+		return;
+
+	if (type->rows > 1) {
+		/* matrices are set as 4x4 and read transposed, the same as
+		 * the default packing of HLSL */
+		if (param->cur_value.num < count * sizeof(struct matrix4))
+			return;
+
+		for (size_t i = 0; i < count; i++) {
+			const float *raw = (const float*)src + i * 16;
+			for (size_t r = 0; r < type->rows; r++)
+				for (size_t c = 0; c < type->cols; c++)
+					dst[r * type->cols + c] = raw[c * 4 + r];
+			dst += comps;
+		}
+		return;
+	}
+
+	/* gs_shader_set_vec3 sets a padded struct vec3, set_val does not */
+	stride = comps;
+	if (comps == 3 && param->cur_value.num >= count * sizeof(struct vec3))
+		stride = 4;
+
+	if (param->cur_value.num < ((count - 1) * stride + comps) * 4)
+		return;
+
+	for (size_t i = 0; i < count; i++) {
+		for (size_t c = 0; c < comps; c++) {
+			size_t idx = i * stride + c;
+			if (ints)
+				dst[c] = (float)((const int32_t*)src)[idx];
+			else
+				dst[c] = ((const float*)src)[idx];
+		}
+		dst += comps;
+	}
+}
+
+void shader_update_globals(struct gs_shader *shader)
+{
+	const struct sl_program *prog = shader->program;
+
+	for (size_t i = 0; i < prog->globals.num; i++) {
+		const struct sl_global *global = prog->globals.array + i;
+		struct gs_shader_param *param = shader->params.array + i;
+		size_t size = sl_type_size(prog, &global->type);
+
+		if (param->type == GS_SHADER_PARAM_TEXTURE)
+			continue;
+
+		load_global(global, param, size,
+				shader->globals.array + global->slot);
+		param->changed = false;
+	}
+}
+
+void shader_load_samplers(struct gs_shader *shader)
+{
+	gs_device_t *device = shader->device;
+
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array + i;
+
+		if (param->type != GS_SHADER_PARAM_TEXTURE ||
+		    !param->next_sampler)
+			continue;
+
+		if (param->sampler_id < GS_MAX_TEXTURES)
+			device->cur_samplers[param->sampler_id] =
+				param->next_sampler;
+		param->next_sampler = NULL;
+	}
+}
+
+static const struct gs_sampler_state default_sampler = {
+	.filter    = GS_FILTER_POINT,
+	.address_u = GS_ADDRESS_CLAMP,
+	.address_v = GS_ADDRESS_CLAMP,
+	.address_w = GS_ADDRESS_CLAMP,
+};
+
+static const gs_samplerstate_t *get_sampler(struct gs_shader *shader,
+		int sampler)
+{
+	gs_samplerstate_t *ss = NULL;
+
+	if (sampler >= 0 && sampler < GS_MAX_TEXTURES &&
+	    shader->type == GS_SHADER_PIXEL)
+		ss = shader->device->cur_samplers[sampler];
+	if (!ss && sampler >= 0 && (size_t)sampler < shader->samplers.num)
+		ss = shader->samplers.array[sampler];
+
+	return ss ? ss : &default_sampler;
+}
+
+static int get_cube_face(const float *dir, float *uv)
+{
+	float ax = fabsf(dir[0]), ay = fabsf(dir[1]), az = fabsf(dir[2]);
+	float sc, tc, ma;
+	int   face;
+
+	if (ax >= ay && ax >= az) {
+		face = dir[0] >= 0.0f ? GS_POSITIVE_X : GS_NEGATIVE_X;
+		sc   = dir[0] >= 0.0f ? -dir[2] : dir[2];
+		tc   = -dir[1];
+		ma   = ax;
+	} else if (ay >= az) {
+		face = dir[1] >= 0.0f ? GS_POSITIVE_Y : GS_NEGATIVE_Y;
+		sc   = dir[0];
+		tc   = dir[1] >= 0.0f ? dir[2] : -dir[2];
+		ma   = ay;
+	} else {
+		face = dir[2] >= 0.0f ? GS_POSITIVE_Z : GS_NEGATIVE_Z;
+		sc   = dir[2] >= 0.0f ? dir[0] : -dir[0];
+		tc   = -dir[1];
+		ma   = az;
+	}
+
+	if (ma == 0.0f)
+		ma = 1.0f;
+
+	uv[0] = (sc / ma + 1.0f) * 0.5f;
+	uv[1] = (tc / ma + 1.0f) * 0.5f;
+	return face;
+}
+
+static void shader_sample(void *data, int texture, int sampler,
+		const float *coord, float *out)
+{
+	struct gs_shader *shader = data;
+	struct gs_texture *tex = shader->params.array[texture].texture;
+	struct sw_surface surface;
+	float uv[2] = {coord[0], coord[1]};
+	int side = 0;
+
+	if (tex && tex->type == GS_TEXTURE_CUBE)
+		side = get_cube_face(coord, uv);
+
+	if (!tex || !texture_get_surface(tex, side, &surface)) {
+		out[0] = out[1] = out[2] = out[3] = 0.0f;
+		return;
+	}
+
+	sw_surface_sample(&surface, get_sampler(shader, sampler), uv, out);
+}
+
+static void shader_load(void *data, int texture, const float *coord,
+		float *out)
+{
+	struct gs_shader *shader = data;
+	struct gs_texture *tex = shader->params.array[texture].texture;
+	struct sw_surface surface;
+
+	if (!tex || !texture_get_surface(tex, 0, &surface)) {
+		out[0] = out[1] = out[2] = out[3] = 0.0f;
+		return;
+	}
+
+	sw_surface_load(&surface, (int)coord[0], (int)coord[1], out);
+}
+
+const struct sl_texture_funcs shader_texture_funcs = {
+	.sample = shader_sample,
+	.load   = shader_load
+};
+
+/* ------------------------------------------------------------------------- */
+
+int gs_shader_get_num_params(const gs_shader_t *shader)
+{
+	return (int)shader->params.num;
+}
+
+gs_sparam_t *gs_shader_get_param_by_idx(gs_shader_t *shader, uint32_t param)
+{
+	assert(param < shader->params.num);
+	return shader->params.array+param;
+}
+
+gs_sparam_t *gs_shader_get_param_by_name(gs_shader_t *shader, const char *name)
+{
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array+i;
+
+		if (strcmp(param->name, name) == 0)
+			return param;
+	}
+
+	return NULL;
+}
+
+gs_sparam_t *gs_shader_get_viewproj_matrix(const gs_shader_t *shader)
+{
+	return shader->viewproj;
+}
+
+gs_sparam_t *gs_shader_get_world_matrix(const gs_shader_t *shader)
+{
+	return shader->world;
+}
+
+void gs_shader_get_param_info(const gs_sparam_t *param,
+		struct gs_shader_param_info *info)
+{
+	info->type = param->type;
+	info->name = param->name;
+}
+
+void gs_shader_set_bool(gs_sparam_t *param, bool val)
+{
+	int int_val = val;
+	da_copy_array(param->cur_value, &int_val, sizeof(int_val));
+}
+
+void gs_shader_set_float(gs_sparam_t *param, float val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_int(gs_sparam_t *param, int val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
+{
+	struct matrix4 mat;
+	matrix4_from_matrix3(&mat, val);
+
+	da_copy_array(param->cur_value, &mat, sizeof(mat));
+}
+
+void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
+{
+	da_copy_array(param->cur_value, val, sizeof(*val));
+}
+
+void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
+{
+	param->texture = val;
+}
+
+void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
+{
+	int count = param->array_count;
+	size_t expected_size = 0;
+	if (!count)
+		count = 1;
+
+	switch ((uint32_t)param->type) {
+	case GS_SHADER_PARAM_FLOAT:     expected_size = sizeof(float); break;
+	case GS_SHADER_PARAM_BOOL:
+	case GS_SHADER_PARAM_INT:       expected_size = sizeof(int); break;
+	case GS_SHADER_PARAM_VEC2:      expected_size = sizeof(float)*2; break;
+	case GS_SHADER_PARAM_VEC3:      expected_size = sizeof(float)*3; break;
+	case GS_SHADER_PARAM_VEC4:      expected_size = sizeof(float)*4; break;
+	case GS_SHADER_PARAM_INT2:      expected_size = sizeof(int)*2; break;
+	case GS_SHADER_PARAM_INT3:      expected_size = sizeof(int)*3; break;
+	case GS_SHADER_PARAM_INT4:      expected_size = sizeof(int)*4; break;
+	case GS_SHADER_PARAM_MATRIX4X4: expected_size = sizeof(float)*4*4;break;
+	case GS_SHADER_PARAM_TEXTURE:   expected_size = sizeof(void*); break;
+	default:                        expected_size = 0;
+	}
+
+	expected_size *= count;
+	if (!expected_size)
+		return;
+
+	if (expected_size != size) {
+		blog(LOG_ERROR, "gs_shader_set_val (SW): Size of shader "
+		                "param does not match the size of the input");
+		return;
+	}
+
+	if (param->type == GS_SHADER_PARAM_TEXTURE)
+		gs_shader_set_texture(param, *(gs_texture_t**)val);
+	else
+		da_copy_array(param->cur_value, val, size);
+}
+
+void gs_shader_set_default(gs_sparam_t *param)
+{
+	gs_shader_set_val(param, param->def_value.array, param->def_value.num);
+}
+
+void gs_shader_set_next_sampler(gs_sparam_t *param, gs_samplerstate_t *sampler)
+{
+	param->next_sampler = sampler;
+}
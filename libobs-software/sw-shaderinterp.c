@@ -0,0 +1,795 @@
+#include <math.h>
+#include <string.h>
+#include <graphics/math-defs.h>
+#include "sw-shaderlang.h"
+
+enum exec_result {
+	EXEC_NEXT,
+	EXEC_BREAK,
+	EXEC_CONTINUE,
+	EXEC_RETURN,
+	EXEC_DISCARD
+};
+
+/* a writable value, optionally through a swizzle */
+struct sl_ref {
+	float   *ptr;
+	size_t  count;
+	uint8_t map[4];
+	bool    mapped;
+};
+
+static void eval(struct sl_exec *ex, const struct sl_expr *e, float *frame,
+		float *out);
+
+static inline size_t stride(const struct sl_expr *e)
+{
+	return e->size == 1 ? 0 : 1;
+}
+
+static inline float to_base(enum sl_base base, float val)
+{
+	if (base == SL_INT)
+		return truncf(val);
+	if (base == SL_BOOL)
+		return val != 0.0f ? 1.0f : 0.0f;
+	return val;
+}
+
+static inline int index_of(float val, size_t count)
+{
+	int idx = (int)val;
+	if (idx < 0)
+		idx = 0;
+	else if ((size_t)idx >= count)
+		idx = (int)count - 1;
+	return idx;
+}
+
+/* returns a pointer to the expression's value, evaluating it in to its
+ * temporary slot unless it can be read in place */
+static const float *value(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame)
+{
+	struct sl_expr **args = e->args.array;
+	const float *base;
+
+	switch (e->type) {
+	case SL_EXPR_CONST:
+		return ex->prog->consts.array + e->slot;
+	case SL_EXPR_LOCAL:
+		return frame + e->slot;
+	case SL_EXPR_GLOBAL:
+		return ex->globals + e->slot;
+	case SL_EXPR_MEMBER:
+		return value(ex, args[0], frame) + e->slot;
+	case SL_EXPR_INDEX:
+		base = value(ex, args[0], frame);
+		return base + index_of(*value(ex, args[1], frame), e->slot) *
+			e->size;
+	default:
+		eval(ex, e, frame, frame + e->tmp);
+		return frame + e->tmp;
+	}
+}
+
+static void get_ref(struct sl_exec *ex, const struct sl_expr *e, float *frame,
+		struct sl_ref *ref)
+{
+	struct sl_expr **args = e->args.array;
+	struct sl_ref base;
+	int idx;
+
+	switch (e->type) {
+	case SL_EXPR_LOCAL:
+		ref->ptr    = frame + e->slot;
+		ref->count  = e->size;
+		ref->mapped = false;
+		break;
+
+	case SL_EXPR_MEMBER:
+		get_ref(ex, args[0], frame, ref);
+		ref->ptr   += e->slot;
+		ref->count  = e->size;
+		break;
+
+	case SL_EXPR_INDEX:
+		get_ref(ex, args[0], frame, ref);
+		idx = index_of(*value(ex, args[1], frame), e->slot);
+
+		if (ref->mapped) {
+			ref->map[0] = ref->map[idx];
+		} else {
+			ref->ptr += idx * e->size;
+		}
+		ref->count = e->size;
+		break;
+
+	case SL_EXPR_SWIZZLE:
+		get_ref(ex, args[0], frame, &base);
+
+		for (size_t i = 0; i < e->size; i++)
+			ref->map[i] = base.mapped ?
+				base.map[e->swizzle[i]] : e->swizzle[i];
+
+		ref->ptr    = base.ptr;
+		ref->count  = e->size;
+		ref->mapped = true;
+		break;
+
+	default:
+		/* rejected by the compiler */
+		ref->ptr    = NULL;
+		ref->count  = 0;
+		ref->mapped = false;
+	}
+}
+
+static void ref_read(const struct sl_ref *ref, float *out)
+{
+	if (ref->mapped) {
+		for (size_t i = 0; i < ref->count; i++)
+			out[i] = ref->ptr[ref->map[i]];
+	} else {
+		memmove(out, ref->ptr, ref->count * sizeof(float));
+	}
+}
+
+static void ref_write(const struct sl_ref *ref, const float *val)
+{
+	if (ref->mapped) {
+		for (size_t i = 0; i < ref->count; i++)
+			ref->ptr[ref->map[i]] = val[i];
+	} else {
+		memmove(ref->ptr, val, ref->count * sizeof(float));
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* operators                                                                 */
+
+static inline float int_op(int op, float a, float b)
+{
+	int32_t ia = (int32_t)a;
+	int32_t ib = (int32_t)b;
+
+	switch (op) {
+	case SL_OP_BITAND: return (float)(ia & ib);
+	case SL_OP_BITOR:  return (float)(ia | ib);
+	case SL_OP_BITXOR: return (float)(ia ^ ib);
+	case SL_OP_SHL:    return (float)(int32_t)((uint32_t)ia << (ib & 31));
+	case SL_OP_SHR:    return (float)(ia >> (ib & 31));
+	}
+
+	return 0.0f;
+}
+
+static inline float binary_op(int op, enum sl_base operand, float a, float b)
+{
+	switch (op) {
+	case SL_OP_ADD: return a + b;
+	case SL_OP_SUB: return a - b;
+	case SL_OP_MUL: return a * b;
+	case SL_OP_DIV:
+		if (operand != SL_FLOAT)
+			return b != 0.0f ? truncf(a / b) : 0.0f;
+		return a / b;
+	case SL_OP_MOD:
+		if (operand != SL_FLOAT && b == 0.0f)
+			return 0.0f;
+		return fmodf(a, b);
+	case SL_OP_LT:  return a <  b ? 1.0f : 0.0f;
+	case SL_OP_GT:  return a >  b ? 1.0f : 0.0f;
+	case SL_OP_LE:  return a <= b ? 1.0f : 0.0f;
+	case SL_OP_GE:  return a >= b ? 1.0f : 0.0f;
+	case SL_OP_EQ:  return a == b ? 1.0f : 0.0f;
+	case SL_OP_NE:  return a != b ? 1.0f : 0.0f;
+	case SL_OP_AND: return (a != 0.0f && b != 0.0f) ? 1.0f : 0.0f;
+	case SL_OP_OR:  return (a != 0.0f || b != 0.0f) ? 1.0f : 0.0f;
+	}
+
+	return int_op(op, a, b);
+}
+
+static void apply_binary(int op, enum sl_base operand, const float *a,
+		size_t sa, const float *b, size_t sb, float *out, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		out[i] = binary_op(op, operand, a[i * sa], b[i * sb]);
+}
+
+static void eval_binary(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame, float *out)
+{
+	const struct sl_expr *a = e->args.array[0];
+	const struct sl_expr *b = e->args.array[1];
+	const float *va = value(ex, a, frame);
+	const float *vb;
+
+	/* && and || short circuit when both sides are scalars */
+	if (e->size == 1 && (e->op == SL_OP_AND || e->op == SL_OP_OR)) {
+		bool lhs = *va != 0.0f;
+
+		if (e->op == SL_OP_AND ? !lhs : lhs) {
+			*out = lhs ? 1.0f : 0.0f;
+			return;
+		}
+
+		*out = *value(ex, b, frame) != 0.0f ? 1.0f : 0.0f;
+		return;
+	}
+
+	vb = value(ex, b, frame);
+	apply_binary(e->op, e->operand, va, stride(a), vb, stride(b), out,
+			e->size);
+}
+
+static void eval_assign(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame, float *out)
+{
+	const struct sl_expr *lhs = e->args.array[0];
+	const struct sl_expr *rhs = e->args.array[1];
+	const float *val = value(ex, rhs, frame);
+	struct sl_ref ref;
+
+	get_ref(ex, lhs, frame, &ref);
+
+	if (e->op != SL_OP_NONE) {
+		float *cur = frame + e->slot;
+
+		ref_read(&ref, cur);
+		apply_binary(e->op, e->operand, cur, stride(lhs), val,
+				stride(rhs), cur, e->size);
+
+		for (size_t i = 0; i < e->size; i++)
+			cur[i] = to_base(e->vtype.base, cur[i]);
+		val = cur;
+	}
+
+	ref_write(&ref, val);
+
+	if (out != val)
+		memmove(out, val, e->size * sizeof(float));
+}
+
+static void eval_unary(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame, float *out)
+{
+	const struct sl_expr *arg = e->args.array[0];
+	const float *val;
+	struct sl_ref ref;
+	float delta;
+
+	switch (e->op) {
+	case SL_OP_PREINC:
+	case SL_OP_PREDEC:
+	case SL_OP_POSTINC:
+	case SL_OP_POSTDEC:
+		delta = (e->op == SL_OP_PREINC || e->op == SL_OP_POSTINC) ?
+			1.0f : -1.0f;
+
+		get_ref(ex, arg, frame, &ref);
+		ref_read(&ref, out);
+
+		for (size_t i = 0; i < e->size; i++)
+			out[i] += delta;
+		ref_write(&ref, out);
+
+		if (e->op == SL_OP_POSTINC || e->op == SL_OP_POSTDEC) {
+			for (size_t i = 0; i < e->size; i++)
+				out[i] -= delta;
+		}
+		return;
+	}
+
+	val = value(ex, arg, frame);
+
+	for (size_t i = 0; i < e->size; i++) {
+		switch (e->op) {
+		case SL_OP_NEG:
+			out[i] = -val[i];
+			break;
+		case SL_OP_NOT:
+			out[i] = val[i] == 0.0f ? 1.0f : 0.0f;
+			break;
+		case SL_OP_BITNOT:
+			out[i] = (float)~(int32_t)val[i];
+			break;
+		}
+	}
+}
+
+static void eval_ternary(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame, float *out)
+{
+	struct sl_expr **args = e->args.array;
+	const float *cond = value(ex, args[0], frame);
+	const float *a, *b;
+
+	if (args[0]->size == 1) {
+		const struct sl_expr *branch = *cond != 0.0f ? args[1] : args[2];
+		a = value(ex, branch, frame);
+		memmove(out, a, e->size * sizeof(float));
+		return;
+	}
+
+	/* vector conditions select per component */
+	a = value(ex, args[1], frame);
+	b = value(ex, args[2], frame);
+
+	for (size_t i = 0; i < e->size; i++) {
+		float c = i < args[0]->size ? cond[i] : 0.0f;
+		out[i] = c != 0.0f ? a[i] : b[i];
+	}
+}
+
+static void eval_convert(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame, float *out)
+{
+	struct sl_expr **args = e->args.array;
+	enum sl_base base = e->vtype.base;
+	const struct sl_expr *arg = args[0];
+	const float *val;
+	size_t pos = 0;
+
+	switch (e->op) {
+	case SL_CONVERT_BROADCAST:
+		val = value(ex, arg, frame);
+		for (size_t i = 0; i < e->size; i++)
+			out[i] = to_base(base, *val);
+		break;
+
+	case SL_CONVERT_COPY:
+		val = value(ex, arg, frame);
+		for (size_t i = 0; i < e->size; i++)
+			out[i] = i < arg->size ? to_base(base, val[i]) : 0.0f;
+		break;
+
+	case SL_CONVERT_MATRIX:
+		val = value(ex, arg, frame);
+		for (size_t r = 0; r < e->vtype.rows; r++) {
+			for (size_t c = 0; c < e->vtype.cols; c++) {
+				out[r * e->vtype.cols + c] = to_base(base,
+						val[r * arg->vtype.cols + c]);
+			}
+		}
+		break;
+
+	case SL_CONVERT_CONCAT:
+		for (size_t i = 0; i < e->args.num && pos < e->size; i++) {
+			arg = args[i];
+			val = value(ex, arg, frame);
+
+			for (size_t j = 0; j < arg->size && pos < e->size; j++)
+				out[pos++] = to_base(base, val[j]);
+		}
+
+		while (pos < e->size)
+			out[pos++] = 0.0f;
+		break;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* intrinsics                                                                */
+
+static inline float saturate(float val)
+{
+	return val < 0.0f ? 0.0f : (val > 1.0f ? 1.0f : val);
+}
+
+static inline float sign(float val)
+{
+	return val > 0.0f ? 1.0f : (val < 0.0f ? -1.0f : 0.0f);
+}
+
+static float unary_fn(int fn, float x)
+{
+	switch (fn) {
+	case SL_FN_ABS:      return fabsf(x);
+	case SL_FN_ACOS:     return acosf(x);
+	case SL_FN_ASIN:     return asinf(x);
+	case SL_FN_ATAN:     return atanf(x);
+	case SL_FN_CEIL:     return ceilf(x);
+	case SL_FN_COS:      return cosf(x);
+	case SL_FN_DEGREES:  return DEG(x);
+	case SL_FN_EXP:      return expf(x);
+	case SL_FN_EXP2:     return exp2f(x);
+	case SL_FN_FLOOR:    return floorf(x);
+	case SL_FN_FRAC:     return x - floorf(x);
+	case SL_FN_LOG:      return logf(x);
+	case SL_FN_LOG10:    return log10f(x);
+	case SL_FN_LOG2:     return log2f(x);
+	case SL_FN_RADIANS:  return RAD(x);
+	case SL_FN_RCP:      return 1.0f / x;
+	case SL_FN_ROUND:    return roundf(x);
+	case SL_FN_RSQRT:    return 1.0f / sqrtf(x);
+	case SL_FN_SATURATE: return saturate(x);
+	case SL_FN_SIGN:     return sign(x);
+	case SL_FN_SIN:      return sinf(x);
+	case SL_FN_SQRT:     return sqrtf(x);
+	case SL_FN_TAN:      return tanf(x);
+	case SL_FN_TRUNC:    return truncf(x);
+	}
+
+	/* derivatives can't be calculated one pixel at a time */
+	return 0.0f;
+}
+
+static float ternary_fn(int fn, float a, float b, float c)
+{
+	float t;
+
+	switch (fn) {
+	case SL_FN_ATAN2: return atan2f(a, b);
+	case SL_FN_FMOD:  return fmodf(a, b);
+	case SL_FN_MAX:   return a > b ? a : b;
+	case SL_FN_MIN:   return a < b ? a : b;
+	case SL_FN_POW:   return powf(a, b);
+	case SL_FN_STEP:  return b >= a ? 1.0f : 0.0f;
+	case SL_FN_CLAMP: return a < b ? b : (a > c ? c : a);
+	case SL_FN_LERP:  return a + (b - a) * c;
+	case SL_FN_MAD:   return a * b + c;
+	case SL_FN_SMOOTHSTEP:
+		t = saturate((c - a) / (b - a));
+		return t * t * (3.0f - 2.0f * t);
+	}
+
+	return 0.0f;
+}
+
+static float dot(const float *a, size_t sa, const float *b, size_t sb,
+		size_t n)
+{
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++)
+		sum += a[i * sa] * b[i * sb];
+	return sum;
+}
+
+static void intrinsic_mul(const struct sl_expr *ea, const float *a,
+		const struct sl_expr *eb, const float *b, float *out)
+{
+	const struct sl_type *ta = &ea->vtype;
+	const struct sl_type *tb = &eb->vtype;
+	float result[16];
+
+	/* the same cases as the compiler, in the same order */
+	if (ea->size == 1 || eb->size == 1) {
+		size_t n = ea->size > eb->size ? ea->size : eb->size;
+		apply_binary(SL_OP_MUL, SL_FLOAT, a, stride(ea), b, stride(eb),
+				result, n);
+		memcpy(out, result, n * sizeof(float));
+
+	} else if (ta->rows == 1 && tb->rows == 1 && ta->cols == tb->cols) {
+		*out = dot(a, 1, b, 1, ta->cols);
+
+	} else if (ta->rows == 1 && ta->cols == tb->rows) {
+		for (size_t c = 0; c < tb->cols; c++)
+			result[c] = dot(a, 1, b + c, tb->cols, ta->cols);
+		memcpy(out, result, tb->cols * sizeof(float));
+
+	} else if (tb->rows == 1 && ta->cols == tb->cols) {
+		for (size_t r = 0; r < ta->rows; r++)
+			result[r] = dot(a + r * ta->cols, 1, b, 1, ta->cols);
+		memcpy(out, result, ta->rows * sizeof(float));
+
+	} else {
+		for (size_t r = 0; r < ta->rows; r++) {
+			for (size_t c = 0; c < tb->cols; c++)
+				result[r * tb->cols + c] = dot(a + r * ta->cols,
+						1, b + c, tb->cols, ta->cols);
+		}
+		memcpy(out, result, ta->rows * tb->cols * sizeof(float));
+	}
+}
+
+static void eval_intrinsic(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame, float *out)
+{
+	struct sl_expr **args = e->args.array;
+	const float *v[3] = {NULL};
+	size_t s[3] = {0};
+	size_t n = 1;
+	float len, d;
+
+	for (size_t i = 0; i < e->args.num; i++) {
+		v[i] = value(ex, args[i], frame);
+		s[i] = stride(args[i]);
+		if (args[i]->size > n)
+			n = args[i]->size;
+	}
+
+	switch (e->op) {
+	case SL_FN_ALL:
+	case SL_FN_ANY: {
+		bool all = true, any = false;
+		for (size_t i = 0; i < n; i++) {
+			if (v[0][i] != 0.0f)
+				any = true;
+			else
+				all = false;
+		}
+		*out = (e->op == SL_FN_ALL ? all : any) ? 1.0f : 0.0f;
+		break;
+	}
+
+	case SL_FN_CLIP:
+		for (size_t i = 0; i < n; i++) {
+			if (v[0][i] < 0.0f)
+				ex->discarded = true;
+		}
+		break;
+
+	case SL_FN_CROSS: {
+		float result[3];
+		result[0] = v[0][1] * v[1][2] - v[0][2] * v[1][1];
+		result[1] = v[0][2] * v[1][0] - v[0][0] * v[1][2];
+		result[2] = v[0][0] * v[1][1] - v[0][1] * v[1][0];
+		memcpy(out, result, sizeof(result));
+		break;
+	}
+
+	case SL_FN_DISTANCE:
+		len = 0.0f;
+		for (size_t i = 0; i < n; i++) {
+			d = v[0][i * s[0]] - v[1][i * s[1]];
+			len += d * d;
+		}
+		*out = sqrtf(len);
+		break;
+
+	case SL_FN_DOT:
+		*out = dot(v[0], s[0], v[1], s[1], n);
+		break;
+
+	case SL_FN_LENGTH:
+		*out = sqrtf(dot(v[0], 1, v[0], 1, n));
+		break;
+
+	case SL_FN_NORMALIZE:
+		len = sqrtf(dot(v[0], 1, v[0], 1, n));
+		for (size_t i = 0; i < n; i++)
+			out[i] = v[0][i] / len;
+		break;
+
+	case SL_FN_REFLECT:
+		d = dot(v[0], s[0], v[1], s[1], n);
+		for (size_t i = 0; i < e->size; i++)
+			out[i] = v[0][i * s[0]] - 2.0f * d * v[1][i * s[1]];
+		break;
+
+	case SL_FN_MUL:
+		intrinsic_mul(args[0], v[0], args[1], v[1], out);
+		break;
+
+	case SL_FN_TRANSPOSE: {
+		float result[16];
+		size_t rows = args[0]->vtype.rows;
+		size_t cols = args[0]->vtype.cols;
+
+		for (size_t r = 0; r < rows; r++) {
+			for (size_t c = 0; c < cols; c++)
+				result[c * rows + r] = v[0][r * cols + c];
+		}
+		memcpy(out, result, rows * cols * sizeof(float));
+		break;
+	}
+
+	default:
+		if (e->args.num == 1) {
+			for (size_t i = 0; i < e->size; i++)
+				out[i] = unary_fn(e->op, v[0][i * s[0]]);
+		} else {
+			static const float zero = 0.0f;
+			if (!v[2])
+				v[2] = &zero;
+
+			for (size_t i = 0; i < e->size; i++)
+				out[i] = ternary_fn(e->op, v[0][i * s[0]],
+						v[1][i * s[1]], v[2][i * s[2]]);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* calls and statements                                                      */
+
+static enum exec_result exec(struct sl_exec *ex, const struct sl_stmt *s,
+		float *frame);
+
+static void eval_call(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame, float *out)
+{
+	const struct sl_func *func = e->func;
+	float *callee = frame + e->caller->frame_size;
+
+	for (size_t i = 0; i < func->params.num; i++) {
+		const struct sl_param *param = func->params.array + i;
+		const struct sl_expr *arg = e->args.array[i];
+
+		memcpy(callee + param->slot, value(ex, arg, frame),
+				arg->size * sizeof(float));
+	}
+
+	exec(ex, func->body, callee);
+
+	for (size_t i = 0; i < func->params.num; i++) {
+		const struct sl_param *param = func->params.array + i;
+		struct sl_ref ref;
+
+		if (param->out) {
+			get_ref(ex, e->args.array[i], frame, &ref);
+			ref_write(&ref, callee + param->slot);
+		}
+	}
+
+	if (e->size)
+		memcpy(out, callee + func->ret_slot, e->size * sizeof(float));
+}
+
+static void eval(struct sl_exec *ex, const struct sl_expr *e, float *frame,
+		float *out)
+{
+	struct sl_expr **args = e->args.array;
+	const float *val;
+	struct sl_ref ref;
+
+	switch (e->type) {
+	case SL_EXPR_CONST:
+	case SL_EXPR_LOCAL:
+	case SL_EXPR_GLOBAL:
+	case SL_EXPR_MEMBER:
+	case SL_EXPR_INDEX:
+		val = value(ex, e, frame);
+		memmove(out, val, e->size * sizeof(float));
+		break;
+
+	case SL_EXPR_SWIZZLE:
+		val = value(ex, args[0], frame);
+		ref.ptr    = (float*)val;
+		ref.count  = e->size;
+		ref.mapped = true;
+		memcpy(ref.map, e->swizzle, sizeof(ref.map));
+		ref_read(&ref, out);
+		break;
+
+	case SL_EXPR_UNARY:     eval_unary(ex, e, frame, out);     break;
+	case SL_EXPR_BINARY:    eval_binary(ex, e, frame, out);    break;
+	case SL_EXPR_TERNARY:   eval_ternary(ex, e, frame, out);   break;
+	case SL_EXPR_ASSIGN:    eval_assign(ex, e, frame, out);    break;
+	case SL_EXPR_CONVERT:   eval_convert(ex, e, frame, out);   break;
+	case SL_EXPR_CALL:      eval_call(ex, e, frame, out);      break;
+	case SL_EXPR_INTRINSIC: eval_intrinsic(ex, e, frame, out); break;
+
+	case SL_EXPR_SAMPLE:
+		val = value(ex, args[0], frame);
+		ex->funcs->sample(ex->param, e->texture, e->sampler, val, out);
+		break;
+
+	case SL_EXPR_LOAD:
+		val = value(ex, args[0], frame);
+		ex->funcs->load(ex->param, e->texture, val, out);
+		break;
+	}
+}
+
+static inline bool condition(struct sl_exec *ex, const struct sl_expr *e,
+		float *frame)
+{
+	return *value(ex, e, frame) != 0.0f;
+}
+
+/* runs a loop body, returning true if the loop should keep going */
+static inline bool exec_loop_body(struct sl_exec *ex, const struct sl_stmt *s,
+		float *frame, enum exec_result *result)
+{
+	enum exec_result r = exec(ex, s->body, frame);
+
+	if (r == EXEC_RETURN || r == EXEC_DISCARD) {
+		*result = r;
+		return false;
+	}
+
+	return r != EXEC_BREAK;
+}
+
+static enum exec_result exec(struct sl_exec *ex, const struct sl_stmt *s,
+		float *frame)
+{
+	enum exec_result result = EXEC_NEXT;
+
+	switch (s->type) {
+	case SL_STMT_EXPR:
+		value(ex, s->expr, frame);
+		break;
+
+	case SL_STMT_CLEAR:
+		memset(frame + s->slot, 0, s->size * sizeof(float));
+		break;
+
+	case SL_STMT_BLOCK:
+		for (size_t i = 0; i < s->stmts.num; i++) {
+			result = exec(ex, s->stmts.array[i], frame);
+			if (result != EXEC_NEXT)
+				return result;
+		}
+		break;
+
+	case SL_STMT_IF:
+		if (condition(ex, s->expr, frame))
+			result = exec(ex, s->body, frame);
+		else if (s->other)
+			result = exec(ex, s->other, frame);
+		break;
+
+	case SL_STMT_FOR:
+		if (s->init)
+			exec(ex, s->init, frame);
+
+		while (!ex->discarded &&
+		       (!s->expr || condition(ex, s->expr, frame))) {
+			if (!exec_loop_body(ex, s, frame, &result))
+				break;
+			if (s->step)
+				value(ex, s->step, frame);
+		}
+		break;
+
+	case SL_STMT_WHILE:
+		while (!ex->discarded && condition(ex, s->expr, frame)) {
+			if (!exec_loop_body(ex, s, frame, &result))
+				break;
+		}
+		break;
+
+	case SL_STMT_DO:
+		do {
+			if (!exec_loop_body(ex, s, frame, &result))
+				break;
+		} while (!ex->discarded && condition(ex, s->expr, frame));
+		break;
+
+	case SL_STMT_RETURN:
+		if (s->expr)
+			memmove(frame + s->slot, value(ex, s->expr, frame),
+					s->size * sizeof(float));
+		return EXEC_RETURN;
+
+	case SL_STMT_BREAK:
+		return EXEC_BREAK;
+
+	case SL_STMT_CONTINUE:
+		return EXEC_CONTINUE;
+
+	case SL_STMT_DISCARD:
+		ex->discarded = true;
+		return EXEC_DISCARD;
+	}
+
+	/* discards from within calls and clip() unwind from here */
+	if (ex->discarded)
+		return EXEC_DISCARD;
+
+	return result;
+}
+
+bool sl_execute(struct sl_exec *ex, const float *inputs, float *outputs)
+{
+	const struct sl_program *prog = ex->prog;
+	const struct sl_func *main_func = prog->main;
+	float *frame = ex->stack;
+
+	ex->discarded = false;
+
+	/* the parameters are at the start of the frame */
+	memcpy(frame, inputs, prog->input_size * sizeof(float));
+
+	if (exec(ex, main_func->body, frame) == EXEC_DISCARD ||
+	    ex->discarded)
+		return false;
+
+	memcpy(outputs, frame + main_func->ret_slot,
+			prog->output_size * sizeof(float));
+	return true;
+}
@@ -0,0 +1,2200 @@
+#include <ctype.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include "sw-shaderlang.h"
+
+struct sl_token {
+	const char         *str;
+	size_t             len;
+	enum cf_token_type type;
+	struct cf_token    *src;
+
+	double             num;
+	bool               is_float;
+
+	/* operators that the lexer splits up are merged in to 'buf' */
+	bool               merged;
+	char               buf[4];
+};
+
+struct sl_local {
+	const char     *name;
+	size_t         len;
+	struct sl_type type;
+	size_t         slot;
+};
+
+struct sl_compiler {
+	struct sl_program       *prog;
+	struct shader_parser    *parser;
+
+	DARRAY(struct sl_token) tokens;
+	size_t                  pos;
+	struct sl_token         eof;
+
+	struct sl_func          *func;
+	DARRAY(struct sl_local) locals;
+	int                     loops;
+	bool                    error;
+};
+
+/* ------------------------------------------------------------------------- */
+/* tokens                                                                    */
+
+static const char *multichar_ops[] = {
+	"++", "--", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=",
+	"==", "!=", "<=", ">=", "&&", "||", "<<", ">>", "<<=", ">>=",
+	NULL
+};
+
+static inline const char *tok_text(const struct sl_token *t)
+{
+	return t->merged ? t->buf : t->str;
+}
+
+static inline bool tok_is(const struct sl_token *t, const char *str)
+{
+	size_t len = strlen(str);
+	return t->type != CFTOKEN_NONE && t->len == len &&
+		strncmp(tok_text(t), str, len) == 0;
+}
+
+static void tok_copy(const struct sl_token *t, char *buf, size_t size)
+{
+	size_t len = t->len < size - 1 ? t->len : size - 1;
+	memcpy(buf, tok_text(t), len);
+	buf[len] = 0;
+}
+
+static void parse_number(struct sl_token *t, const char *str, size_t len)
+{
+	char buf[64];
+	size_t n = len < sizeof(buf) - 1 ? len : sizeof(buf) - 1;
+	bool hex;
+
+	memcpy(buf, str, n);
+	buf[n] = 0;
+
+	hex = n > 1 && buf[0] == '0' && (buf[1] == 'x' || buf[1] == 'X');
+
+	while (n && strchr(hex ? "uUlL" : "fFhHuUlL", buf[n - 1]))
+		buf[--n] = 0;
+
+	t->is_float = !hex && (strchr(buf, '.') || strchr(buf, 'e') ||
+			strchr(buf, 'E'));
+	t->num = t->is_float ? strtod(buf, NULL) :
+		(double)strtoll(buf, NULL, 0);
+}
+
+static bool merge_operator(struct sl_token *last, const struct cf_token *t)
+{
+	char op[4];
+
+	if (last->len + t->str.len >= sizeof(op))
+		return false;
+
+	memcpy(op, tok_text(last), last->len);
+	memcpy(op + last->len, t->str.array, t->str.len);
+	op[last->len + t->str.len] = 0;
+
+	for (const char **p = multichar_ops; *p; p++) {
+		if (strcmp(*p, op) == 0) {
+			strcpy(last->buf, op);
+			last->len = strlen(op);
+			last->merged = true;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* the lexer splits numbers such as 1e-5 in to "1e", "-" and "5" */
+static bool merge_exponent(struct sl_token *last, const struct cf_token *t,
+		const struct cf_token *end)
+{
+	const struct cf_token *exp = t + 1;
+	char buf[64];
+	char c = last->len ? last->str[last->len - 1] : 0;
+
+	if ((c != 'e' && c != 'E') || last->len < 2 ||
+	    last->str[1] == 'x' || last->str[1] == 'X')
+		return false;
+	if (t->str.len != 1 || (*t->str.array != '-' && *t->str.array != '+'))
+		return false;
+	if (exp == end || exp->type != CFTOKEN_NUM)
+		return false;
+	if (last->len + 1 + exp->str.len >= sizeof(buf))
+		return false;
+
+	memcpy(buf, last->str, last->len);
+	buf[last->len] = *t->str.array;
+	memcpy(buf + last->len + 1, exp->str.array, exp->str.len);
+
+	parse_number(last, buf, last->len + 1 + exp->str.len);
+	return true;
+}
+
+static void tokenize(struct sl_compiler *c, struct cf_token *start,
+		struct cf_token *end)
+{
+	struct cf_token *prev = NULL;
+
+	c->tokens.num = 0;
+	c->pos = 0;
+
+	for (struct cf_token *t = start; t != end; t++) {
+		struct sl_token *last = c->tokens.num ? da_end(c->tokens) : NULL;
+		bool adjacent = last && prev == t - 1;
+		struct sl_token *token;
+
+		if (t->type == CFTOKEN_NONE)
+			break;
+		if (t->type == CFTOKEN_SPACETAB || t->type == CFTOKEN_NEWLINE)
+			continue;
+
+		if (adjacent && last->type == CFTOKEN_OTHER &&
+		    t->type == CFTOKEN_OTHER && merge_operator(last, t)) {
+			prev = t;
+			continue;
+		}
+
+		if (adjacent && last->type == CFTOKEN_NUM &&
+		    t->type == CFTOKEN_OTHER && merge_exponent(last, t, end)) {
+			prev = ++t;
+			continue;
+		}
+
+		token = da_push_back_new(c->tokens);
+		token->str  = t->str.array;
+		token->len  = t->str.len;
+		token->type = t->type;
+		token->src  = t;
+
+		if (t->type == CFTOKEN_NUM)
+			parse_number(token, t->str.array, t->str.len);
+
+		prev = t;
+	}
+
+	c->eof.type = CFTOKEN_NONE;
+	c->eof.src  = c->tokens.num ?
+		c->tokens.array[c->tokens.num - 1].src : start;
+}
+
+static inline const struct sl_token *tok_peek(struct sl_compiler *c,
+		size_t ahead)
+{
+	size_t pos = c->pos + ahead;
+	return pos < c->tokens.num ? c->tokens.array + pos : &c->eof;
+}
+
+static inline const struct sl_token *tok(struct sl_compiler *c)
+{
+	return tok_peek(c, 0);
+}
+
+static inline void next(struct sl_compiler *c)
+{
+	if (c->pos < c->tokens.num)
+		c->pos++;
+}
+
+static inline bool is(struct sl_compiler *c, const char *str)
+{
+	return tok_is(tok(c), str);
+}
+
+static inline bool accept(struct sl_compiler *c, const char *str)
+{
+	if (!is(c, str))
+		return false;
+
+	next(c);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* errors                                                                    */
+
+static void sl_error(struct sl_compiler *c, const struct sl_token *t,
+		const char *msg, const char *val)
+{
+	struct cf_parser *cfp = &c->parser->cfp;
+
+	/* only the first error is useful, the rest tend to follow from it */
+	if (c->error)
+		return;
+
+	c->error = true;
+
+	if (t && t->src)
+		cfp->cur_token = t->src;
+	if (cfp->cur_token)
+		cf_adderror(cfp, msg, LEX_ERROR, val, NULL, NULL);
+}
+
+static void sl_error_tok(struct sl_compiler *c, const struct sl_token *t,
+		const char *msg)
+{
+	char buf[64];
+	if (t->type == CFTOKEN_NONE)
+		strcpy(buf, "end of function");
+	else
+		tok_copy(t, buf, sizeof(buf));
+
+	sl_error(c, t, msg, buf);
+}
+
+static inline bool expect(struct sl_compiler *c, const char *str)
+{
+	if (accept(c, str))
+		return true;
+
+	sl_error(c, tok(c), "Expected '$1'", str);
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+/* types                                                                     */
+
+static inline struct sl_type make_type(enum sl_base base, int rows, int cols)
+{
+	struct sl_type type = {0};
+	type.base = base;
+	type.rows = (uint8_t)rows;
+	type.cols = (uint8_t)cols;
+	return type;
+}
+
+static inline bool type_numeric(const struct sl_type *type)
+{
+	return type->array == 0 &&
+		(type->base == SL_BOOL || type->base == SL_INT ||
+		 type->base == SL_FLOAT);
+}
+
+static inline bool type_scalar(const struct sl_type *type)
+{
+	return type_numeric(type) && type->rows == 1 && type->cols == 1;
+}
+
+static inline bool type_matrix(const struct sl_type *type)
+{
+	return type_numeric(type) && type->rows > 1;
+}
+
+static inline bool type_equal(const struct sl_type *a, const struct sl_type *b)
+{
+	return a->base == b->base && a->rows == b->rows &&
+		a->cols == b->cols && a->array == b->array &&
+		(a->base != SL_STRUCT || a->st == b->st);
+}
+
+size_t sl_type_size(const struct sl_program *prog, const struct sl_type *type)
+{
+	size_t size;
+
+	switch (type->base) {
+	case SL_VOID:    size = 0; break;
+	case SL_TEXTURE:
+	case SL_SAMPLER: size = 1; break;
+	case SL_STRUCT:  size = prog->structs.array[type->st].size; break;
+	default:         size = (size_t)type->rows * type->cols;
+	}
+
+	return type->array ? size * type->array : size;
+}
+
+static bool builtin_type(const char *name, struct sl_type *type)
+{
+	static const struct {
+		const char   *name;
+		enum sl_base base;
+	} bases[] = {
+		{"bool",   SL_BOOL},
+		{"int",    SL_INT},
+		{"uint",   SL_INT},
+		{"float",  SL_FLOAT},
+		{"half",   SL_FLOAT},
+		{"double", SL_FLOAT}
+	};
+
+	if (strcmp(name, "void") == 0) {
+		*type = make_type(SL_VOID, 0, 0);
+		return true;
+	}
+
+	if (strcmp(name, "texture2d") == 0 ||
+	    strcmp(name, "texture_rect") == 0) {
+		*type = make_type(SL_TEXTURE, 1, 2);
+		return true;
+	}
+
+	if (strcmp(name, "texture3d") == 0 ||
+	    strcmp(name, "texture_cube") == 0) {
+		*type = make_type(SL_TEXTURE, 1, 3);
+		return true;
+	}
+
+	if (strcmp(name, "sampler_state") == 0 ||
+	    strcmp(name, "sampler") == 0) {
+		*type = make_type(SL_SAMPLER, 1, 1);
+		return true;
+	}
+
+	if (strcmp(name, "matrix") == 0) {
+		*type = make_type(SL_FLOAT, 4, 4);
+		return true;
+	}
+
+	if (strcmp(name, "vector") == 0) {
+		*type = make_type(SL_FLOAT, 1, 4);
+		return true;
+	}
+
+	for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+		size_t len = strlen(bases[i].name);
+		const char *rest = name + len;
+
+		if (strncmp(name, bases[i].name, len) != 0)
+			continue;
+
+		if (!*rest) {
+			*type = make_type(bases[i].base, 1, 1);
+			return true;
+		}
+
+		if (rest[0] < '1' || rest[0] > '4')
+			return false;
+
+		if (!rest[1]) {
+			*type = make_type(bases[i].base, 1, rest[0] - '0');
+			return true;
+		}
+
+		if (rest[1] == 'x' && rest[2] >= '1' && rest[2] <= '4' &&
+		    !rest[3]) {
+			*type = make_type(bases[i].base, rest[0] - '0',
+					rest[2] - '0');
+			return true;
+		}
+
+		return false;
+	}
+
+	return false;
+}
+
+static bool lookup_type(struct sl_compiler *c, const char *name,
+		struct sl_type *type)
+{
+	struct sl_program *prog = c->prog;
+
+	if (builtin_type(name, type))
+		return true;
+
+	for (size_t i = 0; i < prog->structs.num; i++) {
+		if (strcmp(prog->structs.array[i].name, name) == 0) {
+			*type = make_type(SL_STRUCT, 1, 1);
+			type->st = (int)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool token_type(struct sl_compiler *c, const struct sl_token *t,
+		struct sl_type *type)
+{
+	char name[64];
+
+	if (t->type != CFTOKEN_NAME)
+		return false;
+
+	tok_copy(t, name, sizeof(name));
+	return lookup_type(c, name, type);
+}
+
+/* ------------------------------------------------------------------------- */
+/* nodes                                                                     */
+
+static inline size_t frame_alloc(struct sl_compiler *c, size_t size)
+{
+	size_t slot = c->func->frame_size;
+	c->func->frame_size += size;
+	return slot;
+}
+
+static struct sl_expr *expr_new(struct sl_compiler *c,
+		enum sl_expr_type type, const struct sl_type *vtype)
+{
+	struct sl_expr *e = bzalloc(sizeof(struct sl_expr));
+	e->type    = type;
+	e->vtype   = *vtype;
+	e->size    = sl_type_size(c->prog, vtype);
+	e->operand = vtype->base;
+	e->texture = -1;
+	e->sampler = -1;
+
+	da_push_back(c->prog->expr_pool, &e);
+	return e;
+}
+
+static void expr_add_arg(struct sl_compiler *c, struct sl_expr *e,
+		struct sl_expr *arg)
+{
+	arg->tmp = frame_alloc(c, arg->size);
+	da_push_back(e->args, &arg);
+}
+
+static struct sl_stmt *stmt_new(struct sl_compiler *c, enum sl_stmt_type type)
+{
+	struct sl_stmt *s = bzalloc(sizeof(struct sl_stmt));
+	s->type = type;
+
+	da_push_back(c->prog->stmt_pool, &s);
+	return s;
+}
+
+static struct sl_expr *make_const(struct sl_compiler *c, enum sl_base base,
+		double val)
+{
+	struct sl_type type = make_type(base, 1, 1);
+	struct sl_expr *e = expr_new(c, SL_EXPR_CONST, &type);
+	float f = (float)val;
+
+	e->slot = c->prog->consts.num;
+	da_push_back(c->prog->consts, &f);
+	return e;
+}
+
+static struct sl_expr *coerce(struct sl_compiler *c, const struct sl_token *t,
+		struct sl_expr *e, const struct sl_type *to)
+{
+	struct sl_expr *conv;
+
+	if (!e || type_equal(&e->vtype, to))
+		return e;
+
+	if (!type_numeric(&e->vtype) || !type_numeric(to)) {
+		sl_error_tok(c, t, "Cannot convert value near '$1'");
+		return NULL;
+	}
+
+	conv = expr_new(c, SL_EXPR_CONVERT, to);
+	if (type_scalar(&e->vtype))
+		conv->op = SL_CONVERT_BROADCAST;
+	else if (type_matrix(&e->vtype) && type_matrix(to))
+		conv->op = SL_CONVERT_MATRIX;
+	else
+		conv->op = SL_CONVERT_COPY;
+
+	expr_add_arg(c, conv, e);
+	return conv;
+}
+
+static bool is_lvalue(const struct sl_expr *e)
+{
+	switch (e->type) {
+	case SL_EXPR_LOCAL:
+		return true;
+	case SL_EXPR_MEMBER:
+	case SL_EXPR_SWIZZLE:
+	case SL_EXPR_INDEX:
+		return is_lvalue(e->args.array[0]);
+	default:
+		return false;
+	}
+}
+
+static bool check_lvalue(struct sl_compiler *c, const struct sl_token *t,
+		const struct sl_expr *e)
+{
+	if (is_lvalue(e))
+		return true;
+
+	sl_error_tok(c, t, "Cannot assign to the value near '$1'");
+	return false;
+}
+
+static bool check_numeric(struct sl_compiler *c, const struct sl_token *t,
+		const struct sl_expr *e)
+{
+	if (type_numeric(&e->vtype))
+		return true;
+
+	sl_error_tok(c, t, "Expected a numeric value near '$1'");
+	return false;
+}
+
+/* promotes two operands to the type an operator is applied in */
+static bool combine_types(struct sl_compiler *c, const struct sl_token *t,
+		const struct sl_type *a, const struct sl_type *b,
+		struct sl_type *out)
+{
+	enum sl_base base = a->base > b->base ? a->base : b->base;
+
+	if (!type_numeric(a) || !type_numeric(b)) {
+		sl_error_tok(c, t, "Invalid operands for '$1'");
+		return false;
+	}
+
+	if (type_scalar(a)) {
+		*out = make_type(base, b->rows, b->cols);
+	} else if (type_scalar(b)) {
+		*out = make_type(base, a->rows, a->cols);
+	} else if (a->rows == b->rows && a->cols == b->cols) {
+		*out = make_type(base, a->rows, a->cols);
+	} else if (a->rows == 1 && b->rows == 1) {
+		*out = make_type(base, 1, a->cols < b->cols ? a->cols : b->cols);
+	} else {
+		sl_error_tok(c, t, "Mismatched operand sizes for '$1'");
+		return false;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* expressions                                                               */
+
+static struct sl_expr *parse_expr(struct sl_compiler *c);
+static struct sl_expr *parse_unary(struct sl_compiler *c);
+
+static const struct {
+	const char       *op;
+	int              prec;
+	enum sl_operator code;
+} binary_ops[] = {
+	{"||", 1,  SL_OP_OR},
+	{"&&", 2,  SL_OP_AND},
+	{"|",  3,  SL_OP_BITOR},
+	{"^",  4,  SL_OP_BITXOR},
+	{"&",  5,  SL_OP_BITAND},
+	{"==", 6,  SL_OP_EQ},
+	{"!=", 6,  SL_OP_NE},
+	{"<",  7,  SL_OP_LT},
+	{">",  7,  SL_OP_GT},
+	{"<=", 7,  SL_OP_LE},
+	{">=", 7,  SL_OP_GE},
+	{"<<", 8,  SL_OP_SHL},
+	{">>", 8,  SL_OP_SHR},
+	{"+",  9,  SL_OP_ADD},
+	{"-",  9,  SL_OP_SUB},
+	{"*",  10, SL_OP_MUL},
+	{"/",  10, SL_OP_DIV},
+	{"%",  10, SL_OP_MOD}
+};
+
+static const struct {
+	const char       *op;
+	enum sl_operator code;
+} assign_ops[] = {
+	{"=",   SL_OP_NONE},
+	{"+=",  SL_OP_ADD},
+	{"-=",  SL_OP_SUB},
+	{"*=",  SL_OP_MUL},
+	{"/=",  SL_OP_DIV},
+	{"%=",  SL_OP_MOD},
+	{"&=",  SL_OP_BITAND},
+	{"|=",  SL_OP_BITOR},
+	{"^=",  SL_OP_BITXOR},
+	{"<<=", SL_OP_SHL},
+	{">>=", SL_OP_SHR}
+};
+
+static inline bool is_comparison(int op)
+{
+	return op >= SL_OP_LT && op <= SL_OP_NE;
+}
+
+static inline bool is_logical(int op)
+{
+	return op == SL_OP_AND || op == SL_OP_OR;
+}
+
+static inline bool is_bitwise(int op)
+{
+	return op >= SL_OP_BITAND && op <= SL_OP_SHR;
+}
+
+static struct sl_expr *make_binary(struct sl_compiler *c,
+		const struct sl_token *t, int op,
+		struct sl_expr *a, struct sl_expr *b)
+{
+	struct sl_type operand;
+	struct sl_type result;
+	struct sl_expr *e;
+
+	if (!a || !b)
+		return NULL;
+	if (!combine_types(c, t, &a->vtype, &b->vtype, &operand))
+		return NULL;
+
+	if (is_bitwise(op) || operand.base == SL_BOOL)
+		operand.base = SL_INT;
+
+	result = operand;
+	if (is_comparison(op) || is_logical(op))
+		result.base = SL_BOOL;
+
+	e = expr_new(c, SL_EXPR_BINARY, &result);
+	e->op      = op;
+	e->operand = operand.base;
+	expr_add_arg(c, e, a);
+	expr_add_arg(c, e, b);
+	return e;
+}
+
+static struct sl_expr *make_assign(struct sl_compiler *c,
+		const struct sl_token *t, int op,
+		struct sl_expr *lhs, struct sl_expr *rhs)
+{
+	struct sl_type operand;
+	struct sl_expr *e;
+
+	if (!lhs || !rhs)
+		return NULL;
+	if (!check_lvalue(c, t, lhs))
+		return NULL;
+
+	if (op == SL_OP_NONE) {
+		rhs = coerce(c, t, rhs, &lhs->vtype);
+		if (!rhs)
+			return NULL;
+		operand = lhs->vtype;
+	} else {
+		if (!combine_types(c, t, &lhs->vtype, &rhs->vtype, &operand))
+			return NULL;
+		if (is_bitwise(op) || operand.base == SL_BOOL)
+			operand.base = SL_INT;
+
+		/* the result is always the size of the variable */
+		if (!type_scalar(&rhs->vtype)) {
+			struct sl_type to = make_type(rhs->vtype.base,
+					lhs->vtype.rows, lhs->vtype.cols);
+			rhs = coerce(c, t, rhs, &to);
+			if (!rhs)
+				return NULL;
+		}
+	}
+
+	e = expr_new(c, SL_EXPR_ASSIGN, &lhs->vtype);
+	e->op      = op;
+	e->operand = operand.base;
+	e->slot    = frame_alloc(c, e->size);
+	expr_add_arg(c, e, lhs);
+	expr_add_arg(c, e, rhs);
+	return e;
+}
+
+static struct sl_expr *make_incdec(struct sl_compiler *c,
+		const struct sl_token *t, int op, struct sl_expr *operand)
+{
+	struct sl_expr *e;
+
+	if (!operand)
+		return NULL;
+	if (!check_numeric(c, t, operand) || !check_lvalue(c, t, operand))
+		return NULL;
+
+	e = expr_new(c, SL_EXPR_UNARY, &operand->vtype);
+	e->op = op;
+	expr_add_arg(c, e, operand);
+	return e;
+}
+
+static bool parse_args(struct sl_compiler *c, struct darray *args)
+{
+	DARRAY(struct sl_expr*) list;
+	list.da = *args;
+
+	if (!expect(c, "("))
+		return false;
+
+	if (!accept(c, ")")) {
+		do {
+			struct sl_expr *arg = parse_expr(c);
+			if (!arg)
+				goto fail;
+			da_push_back(list, &arg);
+		} while (accept(c, ","));
+
+		if (!expect(c, ")"))
+			goto fail;
+	}
+
+	*args = list.da;
+	return true;
+
+fail:
+	*args = list.da;
+	return false;
+}
+
+static struct sl_expr *make_constructor(struct sl_compiler *c,
+		const struct sl_token *t, const struct sl_type *type,
+		struct sl_expr **args, size_t num)
+{
+	struct sl_expr *e;
+
+	if (!type_numeric(type) || !num) {
+		sl_error_tok(c, t, "Invalid constructor '$1'");
+		return NULL;
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		if (!type_numeric(&args[i]->vtype) &&
+		    !(args[i]->vtype.array && args[i]->vtype.base != SL_STRUCT)) {
+			sl_error_tok(c, t, "Invalid constructor argument for '$1'");
+			return NULL;
+		}
+	}
+
+	if (num == 1 && type_numeric(&args[0]->vtype))
+		return coerce(c, t, args[0], type);
+
+	e = expr_new(c, SL_EXPR_CONVERT, type);
+	e->op = SL_CONVERT_CONCAT;
+	for (size_t i = 0; i < num; i++)
+		expr_add_arg(c, e, args[i]);
+	return e;
+}
+
+static struct sl_func *find_func(struct sl_compiler *c, const char *name,
+		size_t num_args)
+{
+	for (size_t i = 0; i < c->prog->funcs.num; i++) {
+		struct sl_func *func = c->prog->funcs.array[i];
+		if (strcmp(func->name, name) == 0 &&
+		    func->params.num == num_args)
+			return func;
+	}
+
+	return NULL;
+}
+
+static struct sl_expr *make_call(struct sl_compiler *c,
+		const struct sl_token *t, struct sl_func *func,
+		struct sl_expr **args, size_t num)
+{
+	struct sl_expr *e;
+	bool found = false;
+
+	if (func == c->func) {
+		sl_error_tok(c, t, "Recursive call to '$1'");
+		return NULL;
+	}
+
+	e = expr_new(c, SL_EXPR_CALL, &func->ret);
+	e->func   = func;
+	e->caller = c->func;
+
+	for (size_t i = 0; i < num; i++) {
+		struct sl_param *param = func->params.array + i;
+		struct sl_expr *arg = args[i];
+
+		if (param->out) {
+			if (!check_lvalue(c, t, arg))
+				return NULL;
+			if (!type_equal(&arg->vtype, &param->type)) {
+				sl_error_tok(c, t, "Mismatched out parameter "
+						"type in call to '$1'");
+				return NULL;
+			}
+		} else if (param->type.base == SL_TEXTURE ||
+		           param->type.base == SL_SAMPLER) {
+			sl_error_tok(c, t, "Texture and sampler parameters are "
+					"not supported in call to '$1'");
+			return NULL;
+		} else {
+			arg = coerce(c, t, arg, &param->type);
+			if (!arg)
+				return NULL;
+		}
+
+		expr_add_arg(c, e, arg);
+	}
+
+	for (size_t i = 0; i < c->func->callees.num; i++) {
+		if (c->func->callees.array[i] == func) {
+			found = true;
+			break;
+		}
+	}
+	if (!found)
+		da_push_back(c->func->callees, &func);
+
+	return e;
+}
+
+enum sl_fn_kind {
+	SL_KIND_FLOAT,
+	SL_KIND_SAME,
+	SL_KIND_SCALAR,
+	SL_KIND_BOOL,
+	SL_KIND_VOID,
+	SL_KIND_MUL,
+	SL_KIND_TRANSPOSE,
+	SL_KIND_CROSS
+};
+
+static const struct {
+	const char        *name;
+	enum sl_intrinsic id;
+	size_t            num_args;
+	enum sl_fn_kind   kind;
+} intrinsics[] = {
+	{"abs",        SL_FN_ABS,        1, SL_KIND_SAME},
+	{"acos",       SL_FN_ACOS,       1, SL_KIND_FLOAT},
+	{"all",        SL_FN_ALL,        1, SL_KIND_BOOL},
+	{"any",        SL_FN_ANY,        1, SL_KIND_BOOL},
+	{"asin",       SL_FN_ASIN,       1, SL_KIND_FLOAT},
+	{"atan",       SL_FN_ATAN,       1, SL_KIND_FLOAT},
+	{"atan2",      SL_FN_ATAN2,      2, SL_KIND_FLOAT},
+	{"ceil",       SL_FN_CEIL,       1, SL_KIND_FLOAT},
+	{"clamp",      SL_FN_CLAMP,      3, SL_KIND_SAME},
+	{"clip",       SL_FN_CLIP,       1, SL_KIND_VOID},
+	{"cos",        SL_FN_COS,        1, SL_KIND_FLOAT},
+	{"cross",      SL_FN_CROSS,      2, SL_KIND_CROSS},
+	{"ddx",        SL_FN_DDX,        1, SL_KIND_FLOAT},
+	{"ddy",        SL_FN_DDY,        1, SL_KIND_FLOAT},
+	{"degrees",    SL_FN_DEGREES,    1, SL_KIND_FLOAT},
+	{"distance",   SL_FN_DISTANCE,   2, SL_KIND_SCALAR},
+	{"dot",        SL_FN_DOT,        2, SL_KIND_SCALAR},
+	{"exp",        SL_FN_EXP,        1, SL_KIND_FLOAT},
+	{"exp2",       SL_FN_EXP2,       1, SL_KIND_FLOAT},
+	{"floor",      SL_FN_FLOOR,      1, SL_KIND_FLOAT},
+	{"fmod",       SL_FN_FMOD,       2, SL_KIND_FLOAT},
+	{"frac",       SL_FN_FRAC,       1, SL_KIND_FLOAT},
+	{"length",     SL_FN_LENGTH,     1, SL_KIND_SCALAR},
+	{"lerp",       SL_FN_LERP,       3, SL_KIND_FLOAT},
+	{"log",        SL_FN_LOG,        1, SL_KIND_FLOAT},
+	{"log10",      SL_FN_LOG10,      1, SL_KIND_FLOAT},
+	{"log2",       SL_FN_LOG2,       1, SL_KIND_FLOAT},
+	{"mad",        SL_FN_MAD,        3, SL_KIND_SAME},
+	{"max",        SL_FN_MAX,        2, SL_KIND_SAME},
+	{"min",        SL_FN_MIN,        2, SL_KIND_SAME},
+	{"mul",        SL_FN_MUL,        2, SL_KIND_MUL},
+	{"normalize",  SL_FN_NORMALIZE,  1, SL_KIND_FLOAT},
+	{"pow",        SL_FN_POW,        2, SL_KIND_FLOAT},
+	{"radians",    SL_FN_RADIANS,    1, SL_KIND_FLOAT},
+	{"rcp",        SL_FN_RCP,        1, SL_KIND_FLOAT},
+	{"reflect",    SL_FN_REFLECT,    2, SL_KIND_FLOAT},
+	{"round",      SL_FN_ROUND,      1, SL_KIND_FLOAT},
+	{"rsqrt",      SL_FN_RSQRT,      1, SL_KIND_FLOAT},
+	{"saturate",   SL_FN_SATURATE,   1, SL_KIND_FLOAT},
+	{"sign",       SL_FN_SIGN,       1, SL_KIND_SAME},
+	{"sin",        SL_FN_SIN,        1, SL_KIND_FLOAT},
+	{"smoothstep", SL_FN_SMOOTHSTEP, 3, SL_KIND_FLOAT},
+	{"sqrt",       SL_FN_SQRT,       1, SL_KIND_FLOAT},
+	{"step",       SL_FN_STEP,       2, SL_KIND_FLOAT},
+	{"tan",        SL_FN_TAN,        1, SL_KIND_FLOAT},
+	{"transpose",  SL_FN_TRANSPOSE,  1, SL_KIND_TRANSPOSE},
+	{"trunc",      SL_FN_TRUNC,      1, SL_KIND_FLOAT}
+};
+
+static bool mul_type(struct sl_compiler *c, const struct sl_token *t,
+		const struct sl_type *a, const struct sl_type *b,
+		struct sl_type *out)
+{
+	enum sl_base base = a->base > b->base ? a->base : b->base;
+
+	if (base == SL_BOOL)
+		base = SL_INT;
+
+	if (type_scalar(a)) {
+		*out = make_type(base, b->rows, b->cols);
+	} else if (type_scalar(b)) {
+		*out = make_type(base, a->rows, a->cols);
+	} else if (a->rows == 1 && b->rows == 1 && a->cols == b->cols) {
+		*out = make_type(base, 1, 1);
+	} else if (a->rows == 1 && a->cols == b->rows) {
+		*out = make_type(base, 1, b->cols);
+	} else if (b->rows == 1 && a->cols == b->cols) {
+		*out = make_type(base, 1, a->rows);
+	} else if (a->rows > 1 && b->rows > 1 && a->cols == b->rows) {
+		*out = make_type(base, a->rows, b->cols);
+	} else {
+		sl_error_tok(c, t, "Mismatched matrix sizes in call to '$1'");
+		return false;
+	}
+
+	return true;
+}
+
+static struct sl_expr *make_intrinsic(struct sl_compiler *c,
+		const struct sl_token *t, size_t idx,
+		struct sl_expr **args, size_t num)
+{
+	enum sl_fn_kind kind = intrinsics[idx].kind;
+	const struct sl_type *largest = NULL;
+	enum sl_base base = SL_BOOL;
+	struct sl_type dims;
+	struct sl_type result;
+	struct sl_expr *e;
+
+	if (num != intrinsics[idx].num_args) {
+		sl_error_tok(c, t, "Wrong number of arguments to '$1'");
+		return NULL;
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		const struct sl_type *type = &args[i]->vtype;
+
+		if (!check_numeric(c, t, args[i]))
+			return NULL;
+
+		if (!largest || sl_type_size(c->prog, type) >
+				sl_type_size(c->prog, largest))
+			largest = type;
+		if (type->base > base)
+			base = type->base;
+	}
+
+	dims = make_type(base, largest->rows, largest->cols);
+
+	switch (kind) {
+	case SL_KIND_FLOAT:
+		result = make_type(SL_FLOAT, dims.rows, dims.cols);
+		break;
+	case SL_KIND_SAME:
+		result = dims;
+		if (result.base == SL_BOOL)
+			result.base = SL_INT;
+		break;
+	case SL_KIND_SCALAR:
+		result = make_type(SL_FLOAT, 1, 1);
+		break;
+	case SL_KIND_BOOL:
+		result = make_type(SL_BOOL, 1, 1);
+		break;
+	case SL_KIND_VOID:
+		result = make_type(SL_VOID, 0, 0);
+		break;
+	case SL_KIND_CROSS:
+		result = make_type(SL_FLOAT, 1, 3);
+		dims   = result;
+		break;
+	case SL_KIND_TRANSPOSE:
+		result = make_type(base, args[0]->vtype.cols,
+				args[0]->vtype.rows);
+		break;
+	case SL_KIND_MUL:
+		if (!mul_type(c, t, &args[0]->vtype, &args[1]->vtype, &result))
+			return NULL;
+		break;
+	}
+
+	e = expr_new(c, SL_EXPR_INTRINSIC, &result);
+	e->op      = intrinsics[idx].id;
+	e->operand = base;
+
+	for (size_t i = 0; i < num; i++) {
+		struct sl_expr *arg = args[i];
+
+		/* arguments are either scalars or the size of the result,
+		 * which the interpreter relies on */
+		if (kind != SL_KIND_MUL && kind != SL_KIND_TRANSPOSE &&
+		    !type_scalar(&arg->vtype)) {
+			struct sl_type to = make_type(arg->vtype.base,
+					dims.rows, dims.cols);
+			arg = coerce(c, t, arg, &to);
+			if (!arg)
+				return NULL;
+		}
+
+		expr_add_arg(c, e, arg);
+	}
+
+	return e;
+}
+
+static struct sl_expr *parse_call(struct sl_compiler *c)
+{
+	const struct sl_token *t = tok(c);
+	DARRAY(struct sl_expr*) args;
+	struct sl_expr *e = NULL;
+	struct sl_type type;
+	struct sl_func *func;
+	char name[64];
+
+	da_init(args);
+	tok_copy(t, name, sizeof(name));
+	next(c);
+
+	if (!parse_args(c, &args.da))
+		goto done;
+
+	if (builtin_type(name, &type)) {
+		e = make_constructor(c, t, &type, args.array, args.num);
+		goto done;
+	}
+
+	func = find_func(c, name, args.num);
+	if (func) {
+		e = make_call(c, t, func, args.array, args.num);
+		goto done;
+	}
+
+	for (size_t i = 0; i < sizeof(intrinsics) / sizeof(intrinsics[0]);
+			i++) {
+		if (strcmp(intrinsics[i].name, name) == 0) {
+			e = make_intrinsic(c, t, i, args.array, args.num);
+			goto done;
+		}
+	}
+
+	sl_error(c, t, "Unknown function '$1'", name);
+
+done:
+	da_free(args);
+	return e;
+}
+
+static const struct sl_local *find_local(struct sl_compiler *c,
+		const struct sl_token *t)
+{
+	for (size_t i = c->locals.num; i > 0; i--) {
+		const struct sl_local *local = c->locals.array + (i - 1);
+		if (local->len == t->len &&
+		    strncmp(local->name, tok_text(t), t->len) == 0)
+			return local;
+	}
+
+	return NULL;
+}
+
+static int find_global(struct sl_compiler *c, const char *name)
+{
+	for (size_t i = 0; i < c->prog->globals.num; i++) {
+		if (strcmp(c->prog->globals.array[i].name, name) == 0)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+static int find_sampler(struct sl_compiler *c, const char *name)
+{
+	for (size_t i = 0; i < c->parser->samplers.num; i++) {
+		if (strcmp(c->parser->samplers.array[i].name, name) == 0)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+static struct sl_expr *parse_identifier(struct sl_compiler *c)
+{
+	const struct sl_token *t = tok(c);
+	const struct sl_local *local;
+	struct sl_global *global;
+	struct sl_expr *e;
+	char name[64];
+	int idx;
+
+	if (tok_is(tok_peek(c, 1), "("))
+		return parse_call(c);
+
+	if (tok_is(t, "true") || tok_is(t, "false")) {
+		next(c);
+		return make_const(c, SL_BOOL, tok_is(t, "true") ? 1.0 : 0.0);
+	}
+
+	local = find_local(c, t);
+	if (local) {
+		next(c);
+		e = expr_new(c, SL_EXPR_LOCAL, &local->type);
+		e->slot = local->slot;
+		return e;
+	}
+
+	tok_copy(t, name, sizeof(name));
+	idx = find_global(c, name);
+	if (idx == -1) {
+		sl_error(c, t, "Unknown identifier '$1'", name);
+		return NULL;
+	}
+
+	next(c);
+	global = c->prog->globals.array + idx;
+	e = expr_new(c, SL_EXPR_GLOBAL, &global->type);
+	e->slot    = global->slot;
+	e->texture = idx;
+	return e;
+}
+
+static struct sl_expr *parse_texture_call(struct sl_compiler *c,
+		const struct sl_token *t, struct sl_expr *tex)
+{
+	bool load = tok_is(t, "Load");
+	struct sl_type float4 = make_type(SL_FLOAT, 1, 4);
+	struct sl_type coord_type;
+	struct sl_expr *coord;
+	struct sl_expr *e;
+
+	if (!load && !tok_is(t, "Sample") && !tok_is(t, "SampleLevel") &&
+	    !tok_is(t, "SampleBias") && !tok_is(t, "SampleGrad")) {
+		sl_error_tok(c, t, "Unknown texture function '$1'");
+		return NULL;
+	}
+
+	if (tex->type != SL_EXPR_GLOBAL) {
+		sl_error_tok(c, t, "Only global textures can be used with '$1'");
+		return NULL;
+	}
+
+	e = expr_new(c, load ? SL_EXPR_LOAD : SL_EXPR_SAMPLE, &float4);
+	e->texture = tex->texture;
+
+	if (!expect(c, "("))
+		return NULL;
+
+	if (!load) {
+		const struct sl_token *st = tok(c);
+		char name[64];
+
+		tok_copy(st, name, sizeof(name));
+		e->sampler = find_sampler(c, name);
+		if (e->sampler == -1) {
+			sl_error(c, st, "Unknown sampler '$1'", name);
+			return NULL;
+		}
+
+		next(c);
+		if (!expect(c, ","))
+			return NULL;
+
+		if (c->prog->tex_samplers.array[e->texture] == -1)
+			c->prog->tex_samplers.array[e->texture] = e->sampler;
+	}
+
+	/* Load takes the mip level as an extra coordinate */
+	coord_type = make_type(load ? SL_INT : SL_FLOAT, 1,
+			tex->vtype.cols + (load ? 1 : 0));
+
+	coord = coerce(c, t, parse_expr(c), &coord_type);
+	if (!coord)
+		return NULL;
+	expr_add_arg(c, e, coord);
+
+	/* levels, offsets and gradients are not used */
+	while (accept(c, ",")) {
+		struct sl_expr *arg = parse_expr(c);
+		if (!arg)
+			return NULL;
+		expr_add_arg(c, e, arg);
+	}
+
+	if (!expect(c, ")"))
+		return NULL;
+
+	return e;
+}
+
+static int swizzle_index(char ch, bool *rgba)
+{
+	const char *xyzw = "xyzw";
+	const char *rgb  = "rgba";
+
+	for (int i = 0; i < 4; i++) {
+		if (ch == xyzw[i])
+			return i;
+		if (ch == rgb[i]) {
+			*rgba = true;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static struct sl_expr *parse_member(struct sl_compiler *c, struct sl_expr *base)
+{
+	const struct sl_token *t = tok(c);
+	const struct sl_type *type = &base->vtype;
+	struct sl_type swz_type;
+	struct sl_expr *e;
+	uint8_t swizzle[4];
+	bool rgba = false;
+
+	if (t->type != CFTOKEN_NAME) {
+		sl_error_tok(c, t, "Expected a member name, got '$1'");
+		return NULL;
+	}
+
+	next(c);
+
+	if (type->base == SL_TEXTURE && !type->array)
+		return parse_texture_call(c, t, base);
+
+	if (type->base == SL_STRUCT && !type->array) {
+		struct sl_struct *st = c->prog->structs.array + type->st;
+
+		for (size_t i = 0; i < st->members.num; i++) {
+			struct sl_member *member = st->members.array + i;
+
+			if (strlen(member->name) == t->len &&
+			    strncmp(member->name, tok_text(t), t->len) == 0) {
+				e = expr_new(c, SL_EXPR_MEMBER, &member->type);
+				e->slot = member->offset;
+				expr_add_arg(c, e, base);
+				return e;
+			}
+		}
+
+		sl_error_tok(c, t, "Unknown member '$1'");
+		return NULL;
+	}
+
+	if (!type_numeric(type) || type->rows != 1 || t->len > 4) {
+		sl_error_tok(c, t, "Invalid swizzle '$1'");
+		return NULL;
+	}
+
+	for (size_t i = 0; i < t->len; i++) {
+		int idx = swizzle_index(tok_text(t)[i], &rgba);
+		if (idx < 0 || idx >= type->cols) {
+			sl_error_tok(c, t, "Invalid swizzle '$1'");
+			return NULL;
+		}
+		swizzle[i] = (uint8_t)idx;
+	}
+
+	swz_type = make_type(type->base, 1, (int)t->len);
+	e = expr_new(c, SL_EXPR_SWIZZLE, &swz_type);
+	memcpy(e->swizzle, swizzle, sizeof(swizzle));
+	expr_add_arg(c, e, base);
+	return e;
+}
+
+static struct sl_expr *parse_index(struct sl_compiler *c, struct sl_expr *base)
+{
+	const struct sl_token *t = tok(c);
+	struct sl_type int_type = make_type(SL_INT, 1, 1);
+	struct sl_type elem = base->vtype;
+	struct sl_expr *idx;
+	struct sl_expr *e;
+	size_t count;
+
+	if (elem.array) {
+		count = elem.array;
+		elem.array = 0;
+	} else if (type_matrix(&elem)) {
+		count = elem.rows;
+		elem.rows = 1;
+	} else if (type_numeric(&elem) && elem.cols > 1) {
+		count = elem.cols;
+		elem.cols = 1;
+	} else {
+		sl_error_tok(c, t, "Cannot index the value near '$1'");
+		return NULL;
+	}
+
+	idx = coerce(c, t, parse_expr(c), &int_type);
+	if (!idx || !expect(c, "]"))
+		return NULL;
+
+	e = expr_new(c, SL_EXPR_INDEX, &elem);
+	e->slot = count;
+	expr_add_arg(c, e, base);
+	expr_add_arg(c, e, idx);
+	return e;
+}
+
+static struct sl_expr *parse_primary(struct sl_compiler *c)
+{
+	const struct sl_token *t = tok(c);
+	struct sl_expr *e;
+
+	if (t->type == CFTOKEN_NUM) {
+		next(c);
+		return make_const(c, t->is_float ? SL_FLOAT : SL_INT, t->num);
+	}
+
+	if (t->type == CFTOKEN_NAME)
+		return parse_identifier(c);
+
+	if (accept(c, "(")) {
+		e = parse_expr(c);
+		if (!e || !expect(c, ")"))
+			return NULL;
+		return e;
+	}
+
+	sl_error_tok(c, t, "Unexpected '$1'");
+	return NULL;
+}
+
+static struct sl_expr *parse_postfix(struct sl_compiler *c)
+{
+	struct sl_expr *e = parse_primary(c);
+
+	while (e) {
+		const struct sl_token *t = tok(c);
+
+		if (accept(c, ".")) {
+			e = parse_member(c, e);
+		} else if (accept(c, "[")) {
+			e = parse_index(c, e);
+		} else if (accept(c, "++")) {
+			e = make_incdec(c, t, SL_OP_POSTINC, e);
+		} else if (accept(c, "--")) {
+			e = make_incdec(c, t, SL_OP_POSTDEC, e);
+		} else {
+			break;
+		}
+	}
+
+	return e;
+}
+
+static struct sl_expr *parse_cast(struct sl_compiler *c)
+{
+	const struct sl_token *t = tok(c);
+	struct sl_type type;
+	struct sl_expr *e;
+
+	token_type(c, tok_peek(c, 1), &type);
+	next(c);
+	next(c);
+	next(c);
+
+	e = parse_unary(c);
+	if (!e)
+		return NULL;
+
+	return make_constructor(c, t, &type, &e, 1);
+}
+
+static struct sl_expr *parse_unary(struct sl_compiler *c)
+{
+	const struct sl_token *t = tok(c);
+	struct sl_type type;
+	struct sl_expr *operand;
+	struct sl_expr *e;
+	int op;
+
+	if (accept(c, "++"))
+		return make_incdec(c, t, SL_OP_PREINC, parse_unary(c));
+	if (accept(c, "--"))
+		return make_incdec(c, t, SL_OP_PREDEC, parse_unary(c));
+
+	if (tok_is(t, "(") && token_type(c, tok_peek(c, 1), &type) &&
+	    tok_is(tok_peek(c, 2), ")"))
+		return parse_cast(c);
+
+	if (accept(c, "+"))
+		op = SL_OP_NONE;
+	else if (accept(c, "-"))
+		op = SL_OP_NEG;
+	else if (accept(c, "!"))
+		op = SL_OP_NOT;
+	else if (accept(c, "~"))
+		op = SL_OP_BITNOT;
+	else
+		return parse_postfix(c);
+
+	operand = parse_unary(c);
+	if (!operand || !check_numeric(c, t, operand))
+		return NULL;
+	if (op == SL_OP_NONE)
+		return operand;
+
+	type = operand->vtype;
+	if (op == SL_OP_NOT)
+		type.base = SL_BOOL;
+	else if (op == SL_OP_BITNOT || type.base == SL_BOOL)
+		type.base = SL_INT;
+
+	e = expr_new(c, SL_EXPR_UNARY, &type);
+	e->op = op;
+	expr_add_arg(c, e, operand);
+	return e;
+}
+
+static struct sl_expr *parse_binary(struct sl_compiler *c, int min_prec)
+{
+	struct sl_expr *lhs = parse_unary(c);
+
+	while (lhs) {
+		const struct sl_token *t = tok(c);
+		size_t i;
+
+		for (i = 0; i < sizeof(binary_ops) / sizeof(binary_ops[0]); i++)
+			if (tok_is(t, binary_ops[i].op))
+				break;
+
+		if (i == sizeof(binary_ops) / sizeof(binary_ops[0]) ||
+		    binary_ops[i].prec < min_prec)
+			break;
+
+		next(c);
+		lhs = make_binary(c, t, binary_ops[i].code, lhs,
+				parse_binary(c, binary_ops[i].prec + 1));
+	}
+
+	return lhs;
+}
+
+static struct sl_expr *parse_ternary(struct sl_compiler *c)
+{
+	struct sl_expr *cond = parse_binary(c, 1);
+	const struct sl_token *t = tok(c);
+	struct sl_expr *a, *b, *e;
+	struct sl_type type;
+
+	if (!cond || !accept(c, "?"))
+		return cond;
+	if (!check_numeric(c, t, cond))
+		return NULL;
+
+	a = parse_expr(c);
+	if (!a || !expect(c, ":"))
+		return NULL;
+	b = parse_expr(c);
+	if (!b)
+		return NULL;
+
+	if (type_equal(&a->vtype, &b->vtype))
+		type = a->vtype;
+	else if (!combine_types(c, t, &a->vtype, &b->vtype, &type))
+		return NULL;
+
+	if (!type_scalar(&cond->vtype) &&
+	    (!type_numeric(&type) || type_scalar(&type))) {
+		sl_error_tok(c, t, "Invalid condition for '$1'");
+		return NULL;
+	}
+
+	a = coerce(c, t, a, &type);
+	b = coerce(c, t, b, &type);
+	if (!a || !b)
+		return NULL;
+
+	e = expr_new(c, SL_EXPR_TERNARY, &type);
+	expr_add_arg(c, e, cond);
+	expr_add_arg(c, e, a);
+	expr_add_arg(c, e, b);
+	return e;
+}
+
+static struct sl_expr *parse_expr(struct sl_compiler *c)
+{
+	struct sl_expr *lhs = parse_ternary(c);
+	const struct sl_token *t = tok(c);
+
+	if (!lhs)
+		return NULL;
+
+	for (size_t i = 0; i < sizeof(assign_ops) / sizeof(assign_ops[0]);
+			i++) {
+		if (tok_is(t, assign_ops[i].op)) {
+			next(c);
+			return make_assign(c, t, assign_ops[i].code, lhs,
+					parse_expr(c));
+		}
+	}
+
+	return lhs;
+}
+
+/* ------------------------------------------------------------------------- */
+/* statements                                                                */
+
+static struct sl_stmt *parse_statement(struct sl_compiler *c);
+
+static inline bool is_qualifier(const struct sl_token *t)
+{
+	return tok_is(t, "const") || tok_is(t, "static") ||
+		tok_is(t, "uniform") || tok_is(t, "precise");
+}
+
+static bool is_declaration(struct sl_compiler *c)
+{
+	struct sl_type type;
+	size_t i = 0;
+
+	while (is_qualifier(tok_peek(c, i)))
+		i++;
+
+	return token_type(c, tok_peek(c, i), &type) &&
+		tok_peek(c, i + 1)->type == CFTOKEN_NAME;
+}
+
+static struct sl_expr *parse_init_list(struct sl_compiler *c,
+		const struct sl_token *t, const struct sl_type *type)
+{
+	DARRAY(struct sl_expr*) args;
+	struct sl_expr *e = NULL;
+
+	da_init(args);
+
+	if (!type_numeric(type) && !(type->array && type->base != SL_STRUCT)) {
+		sl_error_tok(c, t, "Invalid initializer list for '$1'");
+		return NULL;
+	}
+
+	do {
+		struct sl_expr *arg;
+
+		if (is(c, "}"))
+			break;
+
+		arg = parse_expr(c);
+		if (!arg)
+			goto done;
+		da_push_back(args, &arg);
+	} while (accept(c, ","));
+
+	if (!expect(c, "}") || !args.num)
+		goto done;
+
+	e = expr_new(c, SL_EXPR_CONVERT, type);
+	e->op = SL_CONVERT_CONCAT;
+	for (size_t i = 0; i < args.num; i++)
+		expr_add_arg(c, e, args.array[i]);
+
+done:
+	da_free(args);
+	return e;
+}
+
+static struct sl_stmt *parse_declaration(struct sl_compiler *c)
+{
+	struct sl_stmt *block = stmt_new(c, SL_STMT_BLOCK);
+	struct sl_type base_type;
+
+	while (is_qualifier(tok(c)))
+		next(c);
+
+	token_type(c, tok(c), &base_type);
+	next(c);
+
+	do {
+		const struct sl_token *name = tok(c);
+		struct sl_type type = base_type;
+		struct sl_local local;
+		struct sl_stmt *s;
+
+		if (name->type != CFTOKEN_NAME) {
+			sl_error_tok(c, name, "Expected a variable name, "
+					"got '$1'");
+			return NULL;
+		}
+		next(c);
+
+		if (accept(c, "[")) {
+			const struct sl_token *count = tok(c);
+			if (count->type != CFTOKEN_NUM || count->is_float ||
+			    count->num < 1) {
+				sl_error_tok(c, count, "Invalid array size "
+						"'$1'");
+				return NULL;
+			}
+			type.array = (int)count->num;
+			next(c);
+			if (!expect(c, "]"))
+				return NULL;
+		}
+
+		if (type.base == SL_TEXTURE || type.base == SL_SAMPLER ||
+		    type.base == SL_VOID) {
+			sl_error_tok(c, name, "Invalid type for local '$1'");
+			return NULL;
+		}
+
+		local.name = tok_text(name);
+		local.len  = name->len;
+		local.type = type;
+		local.slot = frame_alloc(c, sl_type_size(c->prog, &type));
+
+		if (accept(c, "=")) {
+			const struct sl_token *t = tok(c);
+			struct sl_expr *var = expr_new(c, SL_EXPR_LOCAL, &type);
+			struct sl_expr *init;
+
+			var->slot = local.slot;
+
+			if (accept(c, "{"))
+				init = parse_init_list(c, t, &type);
+			else
+				init = parse_expr(c);
+
+			s = stmt_new(c, SL_STMT_EXPR);
+			s->expr = make_assign(c, t, SL_OP_NONE, var, init);
+			if (!s->expr)
+				return NULL;
+			s->expr->tmp = frame_alloc(c, s->expr->size);
+		} else {
+			s = stmt_new(c, SL_STMT_CLEAR);
+			s->slot = local.slot;
+			s->size = sl_type_size(c->prog, &type);
+		}
+
+		da_push_back(c->locals, &local);
+		da_push_back(block->stmts, &s);
+	} while (accept(c, ","));
+
+	if (!expect(c, ";"))
+		return NULL;
+
+	return block;
+}
+
+static struct sl_expr *parse_condition(struct sl_compiler *c)
+{
+	const struct sl_token *t = tok(c);
+	struct sl_expr *e = parse_expr(c);
+
+	if (!e || !check_numeric(c, t, e))
+		return NULL;
+
+	e->tmp = frame_alloc(c, e->size);
+	return e;
+}
+
+static struct sl_expr *parse_expr_stmt_expr(struct sl_compiler *c)
+{
+	struct sl_expr *e = parse_expr(c);
+	if (e)
+		e->tmp = frame_alloc(c, e->size);
+	return e;
+}
+
+static struct sl_stmt *parse_block(struct sl_compiler *c)
+{
+	struct sl_stmt *block = stmt_new(c, SL_STMT_BLOCK);
+	size_t scope = c->locals.num;
+
+	if (!expect(c, "{"))
+		return NULL;
+
+	while (!accept(c, "}")) {
+		struct sl_stmt *s;
+
+		if (tok(c)->type == CFTOKEN_NONE) {
+			sl_error(c, tok(c), "Expected '$1'", "}");
+			return NULL;
+		}
+
+		s = parse_statement(c);
+		if (!s)
+			return NULL;
+		da_push_back(block->stmts, &s);
+	}
+
+	c->locals.num = scope;
+	return block;
+}
+
+static struct sl_stmt *parse_if(struct sl_compiler *c)
+{
+	struct sl_stmt *s = stmt_new(c, SL_STMT_IF);
+
+	if (!expect(c, "("))
+		return NULL;
+	s->expr = parse_condition(c);
+	if (!s->expr || !expect(c, ")"))
+		return NULL;
+
+	s->body = parse_statement(c);
+	if (!s->body)
+		return NULL;
+
+	if (accept(c, "else")) {
+		s->other = parse_statement(c);
+		if (!s->other)
+			return NULL;
+	}
+
+	return s;
+}
+
+static struct sl_stmt *parse_loop_body(struct sl_compiler *c)
+{
+	struct sl_stmt *body;
+
+	c->loops++;
+	body = parse_statement(c);
+	c->loops--;
+
+	return body;
+}
+
+static struct sl_stmt *parse_for(struct sl_compiler *c)
+{
+	struct sl_stmt *s = stmt_new(c, SL_STMT_FOR);
+	size_t scope = c->locals.num;
+
+	if (!expect(c, "("))
+		return NULL;
+
+	if (is_declaration(c)) {
+		s->init = parse_declaration(c);
+		if (!s->init)
+			return NULL;
+	} else if (!accept(c, ";")) {
+		s->init = stmt_new(c, SL_STMT_EXPR);
+		s->init->expr = parse_expr_stmt_expr(c);
+		if (!s->init->expr || !expect(c, ";"))
+			return NULL;
+	}
+
+	if (!accept(c, ";")) {
+		s->expr = parse_condition(c);
+		if (!s->expr || !expect(c, ";"))
+			return NULL;
+	}
+
+	if (!accept(c, ")")) {
+		s->step = parse_expr_stmt_expr(c);
+		if (!s->step || !expect(c, ")"))
+			return NULL;
+	}
+
+	s->body = parse_loop_body(c);
+	c->locals.num = scope;
+	return s->body ? s : NULL;
+}
+
+static struct sl_stmt *parse_while(struct sl_compiler *c)
+{
+	struct sl_stmt *s = stmt_new(c, SL_STMT_WHILE);
+
+	if (!expect(c, "("))
+		return NULL;
+	s->expr = parse_condition(c);
+	if (!s->expr || !expect(c, ")"))
+		return NULL;
+
+	s->body = parse_loop_body(c);
+	return s->body ? s : NULL;
+}
+
+static struct sl_stmt *parse_do(struct sl_compiler *c)
+{
+	struct sl_stmt *s = stmt_new(c, SL_STMT_DO);
+
+	s->body = parse_loop_body(c);
+	if (!s->body)
+		return NULL;
+
+	if (!expect(c, "while") || !expect(c, "("))
+		return NULL;
+	s->expr = parse_condition(c);
+	if (!s->expr || !expect(c, ")") || !expect(c, ";"))
+		return NULL;
+
+	return s;
+}
+
+static struct sl_stmt *parse_return(struct sl_compiler *c)
+{
+	const struct sl_token *t = tok(c);
+	struct sl_stmt *s = stmt_new(c, SL_STMT_RETURN);
+
+	if (accept(c, ";")) {
+		if (c->func->ret.base != SL_VOID) {
+			sl_error_tok(c, t, "Missing return value at '$1'");
+			return NULL;
+		}
+		return s;
+	}
+
+	s->expr = coerce(c, t, parse_expr(c), &c->func->ret);
+	if (!s->expr || !expect(c, ";"))
+		return NULL;
+
+	s->slot = c->func->ret_slot;
+	s->size = s->expr->size;
+	s->expr->tmp = frame_alloc(c, s->expr->size);
+	return s;
+}
+
+static struct sl_stmt *parse_statement(struct sl_compiler *c)
+{
+	const struct sl_token *t = tok(c);
+	struct sl_stmt *s;
+
+	if (is(c, "{")) {
+		return parse_block(c);
+
+	} else if (accept(c, "[")) {
+		/* attributes such as [unroll] and [branch] */
+		while (!accept(c, "]")) {
+			if (tok(c)->type == CFTOKEN_NONE) {
+				sl_error(c, tok(c), "Expected '$1'", "]");
+				return NULL;
+			}
+			next(c);
+		}
+		return parse_statement(c);
+
+	} else if (accept(c, "if")) {
+		return parse_if(c);
+
+	} else if (accept(c, "for")) {
+		return parse_for(c);
+
+	} else if (accept(c, "while")) {
+		return parse_while(c);
+
+	} else if (accept(c, "do")) {
+		return parse_do(c);
+
+	} else if (accept(c, "return")) {
+		return parse_return(c);
+
+	} else if (accept(c, "break") || accept(c, "continue")) {
+		if (!c->loops) {
+			sl_error_tok(c, t, "'$1' outside of a loop");
+			return NULL;
+		}
+		s = stmt_new(c, tok_is(t, "break") ?
+				SL_STMT_BREAK : SL_STMT_CONTINUE);
+		return expect(c, ";") ? s : NULL;
+
+	} else if (accept(c, "discard")) {
+		s = stmt_new(c, SL_STMT_DISCARD);
+		return expect(c, ";") ? s : NULL;
+
+	} else if (accept(c, ";")) {
+		return stmt_new(c, SL_STMT_BLOCK);
+
+	} else if (is_declaration(c)) {
+		return parse_declaration(c);
+	}
+
+	s = stmt_new(c, SL_STMT_EXPR);
+	s->expr = parse_expr_stmt_expr(c);
+	if (!s->expr || !expect(c, ";"))
+		return NULL;
+
+	return s;
+}
+
+/* ------------------------------------------------------------------------- */
+/* program                                                                   */
+
+static bool add_structs(struct sl_compiler *c)
+{
+	struct shader_parser *sp = c->parser;
+
+	for (size_t i = 0; i < sp->structs.num; i++) {
+		struct shader_struct *src = sp->structs.array + i;
+		struct sl_struct st = {0};
+		bool success = true;
+
+		st.name = bstrdup(src->name);
+
+		/* the struct is added after its members so that it can't
+		 * contain itself */
+		for (size_t j = 0; j < src->vars.num && success; j++) {
+			struct shader_var *var = src->vars.array + j;
+			struct sl_member *member = da_push_back_new(st.members);
+
+			member->name     = bstrdup(var->name);
+			member->semantic = bstrdup(var->mapping);
+			member->offset   = st.size;
+
+			success = lookup_type(c, var->type, &member->type);
+			if (!success) {
+				blog(LOG_WARNING, "Unknown type '%s' of struct "
+						"member '%s.%s'", var->type,
+						src->name, var->name);
+				break;
+			}
+
+			member->type.array = var->array_count;
+			st.size += sl_type_size(c->prog, &member->type);
+		}
+
+		da_push_back(c->prog->structs, &st);
+		if (!success)
+			return false;
+	}
+
+	return true;
+}
+
+static bool add_globals(struct sl_compiler *c)
+{
+	struct shader_parser *sp = c->parser;
+	struct sl_program *prog = c->prog;
+
+	for (size_t i = 0; i < sp->params.num; i++) {
+		struct shader_var *var = sp->params.array + i;
+		struct sl_global *global = da_push_back_new(prog->globals);
+		int no_sampler = -1;
+
+		global->name = bstrdup(var->name);
+		global->slot = prog->globals_size;
+
+		if (!lookup_type(c, var->type, &global->type)) {
+			blog(LOG_WARNING, "Unknown type '%s' of parameter '%s'",
+					var->type, var->name);
+			return false;
+		}
+
+		global->type.array = var->array_count;
+		prog->globals_size += sl_type_size(prog, &global->type);
+
+		da_push_back(prog->tex_samplers, &no_sampler);
+	}
+
+	return true;
+}
+
+static bool add_func(struct sl_compiler *c, struct shader_func *src)
+{
+	struct sl_func *func = bzalloc(sizeof(struct sl_func));
+	da_push_back(c->prog->funcs, &func);
+
+	func->name     = bstrdup(src->name);
+	func->semantic = bstrdup(src->mapping);
+
+	if (!lookup_type(c, src->return_type, &func->ret)) {
+		blog(LOG_WARNING, "Unknown return type '%s' of function '%s'",
+				src->return_type, src->name);
+		return false;
+	}
+
+	for (size_t i = 0; i < src->params.num; i++) {
+		struct shader_var *var = src->params.array + i;
+		struct sl_param *param = da_push_back_new(func->params);
+
+		param->name     = bstrdup(var->name);
+		param->semantic = bstrdup(var->mapping);
+		param->out      = var->var_type == SHADER_VAR_OUT ||
+		                  var->var_type == SHADER_VAR_INOUT;
+
+		if (!lookup_type(c, var->type, &param->type)) {
+			blog(LOG_WARNING, "Unknown type '%s' of parameter "
+					"'%s' in function '%s'", var->type,
+					var->name, src->name);
+			return false;
+		}
+
+		param->type.array = var->array_count;
+		param->slot = func->frame_size;
+		func->frame_size += sl_type_size(c->prog, &param->type);
+	}
+
+	func->ret_slot = func->frame_size;
+	func->frame_size += sl_type_size(c->prog, &func->ret);
+	return true;
+}
+
+static bool compile_func(struct sl_compiler *c, struct sl_func *func,
+		struct shader_func *src)
+{
+	c->func = func;
+	c->locals.num = 0;
+	c->loops = 0;
+
+	for (size_t i = 0; i < func->params.num; i++) {
+		struct sl_param *param = func->params.array + i;
+		struct sl_local *local = da_push_back_new(c->locals);
+
+		local->name = param->name;
+		local->len  = strlen(param->name);
+		local->type = param->type;
+		local->slot = param->slot;
+	}
+
+	tokenize(c, src->start, src->end);
+
+	func->body = parse_block(c);
+	if (func->body && tok(c)->type != CFTOKEN_NONE)
+		sl_error_tok(c, tok(c), "Unexpected '$1'");
+
+	return !c->error;
+}
+
+static bool calc_stack_size(struct sl_func *func)
+{
+	size_t callee_size = 0;
+
+	if (func->visit == 2)
+		return true;
+	if (func->visit == 1) {
+		blog(LOG_WARNING, "Recursive call to '%s'", func->name);
+		return false;
+	}
+
+	func->visit = 1;
+
+	for (size_t i = 0; i < func->callees.num; i++) {
+		struct sl_func *callee = func->callees.array[i];
+		if (!calc_stack_size(callee))
+			return false;
+		if (callee->stack_size > callee_size)
+			callee_size = callee->stack_size;
+	}
+
+	func->stack_size = func->frame_size + callee_size;
+	func->visit = 2;
+	return true;
+}
+
+static void add_bindings(struct sl_program *prog, struct darray *list,
+		const struct sl_type *type, const char *semantic,
+		size_t offset)
+{
+	DARRAY(struct sl_binding) bindings;
+	bindings.da = *list;
+
+	if (type->base == SL_STRUCT && !type->array) {
+		struct sl_struct *st = prog->structs.array + type->st;
+
+		for (size_t i = 0; i < st->members.num; i++) {
+			struct sl_member *member = st->members.array + i;
+			*list = bindings.da;
+			add_bindings(prog, list, &member->type,
+					member->semantic,
+					offset + member->offset);
+			bindings.da = *list;
+		}
+
+	} else if (type->base != SL_VOID) {
+		struct sl_binding *binding = da_push_back_new(bindings);
+		binding->semantic = semantic ? semantic : "";
+		binding->offset   = offset;
+		binding->size     = sl_type_size(prog, type);
+	}
+
+	*list = bindings.da;
+}
+
+static bool link_program(struct sl_program *prog)
+{
+	struct sl_func *main_func = NULL;
+
+	for (size_t i = 0; i < prog->funcs.num; i++) {
+		if (strcmp(prog->funcs.array[i]->name, "main") == 0) {
+			main_func = prog->funcs.array[i];
+			break;
+		}
+	}
+
+	if (!main_func) {
+		blog(LOG_WARNING, "Shader has no main function");
+		return false;
+	}
+
+	if (!calc_stack_size(main_func))
+		return false;
+
+	prog->main       = main_func;
+	prog->stack_size = main_func->stack_size;
+
+	for (size_t i = 0; i < main_func->params.num; i++) {
+		struct sl_param *param = main_func->params.array + i;
+		add_bindings(prog, &prog->inputs.da, &param->type,
+				param->semantic, param->slot);
+		prog->input_size += sl_type_size(prog, &param->type);
+	}
+
+	add_bindings(prog, &prog->outputs.da, &main_func->ret,
+			main_func->semantic, 0);
+	prog->output_size = sl_type_size(prog, &main_func->ret);
+	return true;
+}
+
+struct sl_program *sl_program_compile(struct shader_parser *parser,
+		const char *file)
+{
+	struct sl_compiler c = {0};
+	bool success = true;
+
+	c.prog   = bzalloc(sizeof(struct sl_program));
+	c.parser = parser;
+
+	if (!add_structs(&c) || !add_globals(&c))
+		goto fail;
+
+	for (size_t i = 0; i < parser->funcs.num; i++)
+		if (!add_func(&c, parser->funcs.array + i))
+			goto fail;
+
+	for (size_t i = 0; i < parser->funcs.num && success; i++)
+		success = compile_func(&c, c.prog->funcs.array[i],
+				parser->funcs.array + i);
+
+	if (!success || !link_program(c.prog))
+		goto fail;
+
+	da_free(c.tokens);
+	da_free(c.locals);
+	return c.prog;
+
+fail:
+	blog(LOG_WARNING, "Failed to compile shader '%s'", file);
+	da_free(c.tokens);
+	da_free(c.locals);
+	sl_program_destroy(c.prog);
+	return NULL;
+}
+
+static void func_destroy(struct sl_func *func)
+{
+	for (size_t i = 0; i < func->params.num; i++) {
+		bfree(func->params.array[i].name);
+		bfree(func->params.array[i].semantic);
+	}
+
+	da_free(func->params);
+	da_free(func->callees);
+	bfree(func->name);
+	bfree(func->semantic);
+	bfree(func);
+}
+
+void sl_program_destroy(struct sl_program *prog)
+{
+	if (!prog)
+		return;
+
+	for (size_t i = 0; i < prog->expr_pool.num; i++) {
+		da_free(prog->expr_pool.array[i]->args);
+		bfree(prog->expr_pool.array[i]);
+	}
+
+	for (size_t i = 0; i < prog->stmt_pool.num; i++) {
+		da_free(prog->stmt_pool.array[i]->stmts);
+		bfree(prog->stmt_pool.array[i]);
+	}
+
+	for (size_t i = 0; i < prog->funcs.num; i++)
+		func_destroy(prog->funcs.array[i]);
+
+	for (size_t i = 0; i < prog->structs.num; i++) {
+		struct sl_struct *st = prog->structs.array + i;
+
+		for (size_t j = 0; j < st->members.num; j++) {
+			bfree(st->members.array[j].name);
+			bfree(st->members.array[j].semantic);
+		}
+
+		da_free(st->members);
+		bfree(st->name);
+	}
+
+	for (size_t i = 0; i < prog->globals.num; i++)
+		bfree(prog->globals.array[i].name);
+
+	da_free(prog->expr_pool);
+	da_free(prog->stmt_pool);
+	da_free(prog->funcs);
+	da_free(prog->structs);
+	da_free(prog->globals);
+	da_free(prog->consts);
+	da_free(prog->inputs);
+	da_free(prog->outputs);
+	da_free(prog->tex_samplers);
+	bfree(prog);
+}
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <util/darray.h>
+#include <graphics/shader-parser.h>
+
+/*
+ *   Compiles the functions of a parsed shader in to a tree that is evaluated
+ * once per vertex or pixel.
+ *
+ *   Every value is stored as floats, including ints and bools, which are kept
+ * as whole numbers and truncated after each operation.  Matrices are stored
+ * row by row.  Variables live in a frame of floats that is allocated when the
+ * shader is compiled, so evaluating a shader does not allocate memory.
+ */
+
+enum sl_base {
+	SL_VOID,
+	SL_BOOL,
+	SL_INT,
+	SL_FLOAT,
+	SL_TEXTURE,
+	SL_SAMPLER,
+	SL_STRUCT
+};
+
+struct sl_type {
+	enum sl_base base;
+	uint8_t      rows;   /* 1 unless a matrix */
+	uint8_t      cols;   /* components per row */
+	int          st;     /* struct index, SL_STRUCT only */
+	int          array;  /* element count, 0 if not an array */
+};
+
+struct sl_member {
+	char           *name;
+	char           *semantic;
+	struct sl_type type;
+	size_t         offset;
+};
+
+struct sl_struct {
+	char                     *name;
+	DARRAY(struct sl_member) members;
+	size_t                   size;
+};
+
+/** A semantic of the main function's inputs or output */
+struct sl_binding {
+	const char *semantic;
+	size_t     offset;
+	size_t     size;
+};
+
+struct sl_global {
+	char           *name;
+	struct sl_type type;
+	size_t         slot;
+};
+
+enum sl_expr_type {
+	SL_EXPR_CONST,
+	SL_EXPR_LOCAL,
+	SL_EXPR_GLOBAL,
+	SL_EXPR_MEMBER,
+	SL_EXPR_SWIZZLE,
+	SL_EXPR_INDEX,
+	SL_EXPR_UNARY,
+	SL_EXPR_BINARY,
+	SL_EXPR_TERNARY,
+	SL_EXPR_ASSIGN,
+	SL_EXPR_CONVERT,
+	SL_EXPR_CALL,
+	SL_EXPR_INTRINSIC,
+	SL_EXPR_SAMPLE,
+	SL_EXPR_LOAD
+};
+
+enum sl_operator {
+	SL_OP_NONE,
+	SL_OP_ADD,
+	SL_OP_SUB,
+	SL_OP_MUL,
+	SL_OP_DIV,
+	SL_OP_MOD,
+	SL_OP_LT,
+	SL_OP_GT,
+	SL_OP_LE,
+	SL_OP_GE,
+	SL_OP_EQ,
+	SL_OP_NE,
+	SL_OP_AND,
+	SL_OP_OR,
+	SL_OP_BITAND,
+	SL_OP_BITOR,
+	SL_OP_BITXOR,
+	SL_OP_SHL,
+	SL_OP_SHR,
+	SL_OP_NEG,
+	SL_OP_NOT,
+	SL_OP_BITNOT,
+	SL_OP_PREINC,
+	SL_OP_PREDEC,
+	SL_OP_POSTINC,
+	SL_OP_POSTDEC
+};
+
+enum sl_convert {
+	SL_CONVERT_BROADCAST,
+	SL_CONVERT_COPY,
+	SL_CONVERT_MATRIX,
+	SL_CONVERT_CONCAT
+};
+
+enum sl_intrinsic {
+	SL_FN_ABS,
+	SL_FN_ACOS,
+	SL_FN_ALL,
+	SL_FN_ANY,
+	SL_FN_ASIN,
+	SL_FN_ATAN,
+	SL_FN_ATAN2,
+	SL_FN_CEIL,
+	SL_FN_CLAMP,
+	SL_FN_CLIP,
+	SL_FN_COS,
+	SL_FN_CROSS,
+	SL_FN_DDX,
+	SL_FN_DDY,
+	SL_FN_DEGREES,
+	SL_FN_DISTANCE,
+	SL_FN_DOT,
+	SL_FN_EXP,
+	SL_FN_EXP2,
+	SL_FN_FLOOR,
+	SL_FN_FMOD,
+	SL_FN_FRAC,
+	SL_FN_LENGTH,
+	SL_FN_LERP,
+	SL_FN_LOG,
+	SL_FN_LOG10,
+	SL_FN_LOG2,
+	SL_FN_MAD,
+	SL_FN_MAX,
+	SL_FN_MIN,
+	SL_FN_MUL,
+	SL_FN_NORMALIZE,
+	SL_FN_POW,
+	SL_FN_RADIANS,
+	SL_FN_RCP,
+	SL_FN_REFLECT,
+	SL_FN_ROUND,
+	SL_FN_RSQRT,
+	SL_FN_SATURATE,
+	SL_FN_SIGN,
+	SL_FN_SIN,
+	SL_FN_SMOOTHSTEP,
+	SL_FN_SQRT,
+	SL_FN_STEP,
+	SL_FN_TAN,
+	SL_FN_TRANSPOSE,
+	SL_FN_TRUNC
+};
+
+struct sl_expr {
+	enum sl_expr_type       type;
+	int                     op;
+	struct sl_type          vtype;
+	size_t                  size;
+	/* type the operator is applied in, before comparisons etc. */
+	enum sl_base            operand;
+
+	/* const/local/global slot, or offset of a struct member */
+	size_t                  slot;
+	/* frame slot the parent evaluates this expression in to */
+	size_t                  tmp;
+
+	uint8_t                 swizzle[4];
+	int                     texture;
+	int                     sampler;
+
+	struct sl_func          *func;
+	struct sl_func          *caller;
+	DARRAY(struct sl_expr*) args;
+};
+
+enum sl_stmt_type {
+	SL_STMT_EXPR,
+	SL_STMT_CLEAR,
+	SL_STMT_BLOCK,
+	SL_STMT_IF,
+	SL_STMT_FOR,
+	SL_STMT_WHILE,
+	SL_STMT_DO,
+	SL_STMT_RETURN,
+	SL_STMT_BREAK,
+	SL_STMT_CONTINUE,
+	SL_STMT_DISCARD
+};
+
+struct sl_stmt {
+	enum sl_stmt_type       type;
+	struct sl_expr          *expr;
+	struct sl_stmt          *init;
+	struct sl_expr          *step;
+	struct sl_stmt          *body;
+	struct sl_stmt          *other;
+	DARRAY(struct sl_stmt*) stmts;
+
+	/* range of the frame cleared by a declaration, or written by a
+	 * return statement */
+	size_t                  slot;
+	size_t                  size;
+};
+
+struct sl_param {
+	char           *name;
+	char           *semantic;
+	struct sl_type type;
+	size_t         slot;
+	bool           out;
+};
+
+struct sl_func {
+	char                     *name;
+	char                     *semantic;
+	struct sl_type           ret;
+	DARRAY(struct sl_param)  params;
+	struct sl_stmt           *body;
+
+	size_t                   ret_slot;
+	size_t                   frame_size;
+	size_t                   stack_size;
+
+	DARRAY(struct sl_func*)  callees;
+	int                      visit;
+};
+
+struct sl_program {
+	DARRAY(struct sl_struct)  structs;
+	DARRAY(struct sl_global)  globals;
+	DARRAY(struct sl_func*)   funcs;
+	DARRAY(float)             consts;
+	size_t                    globals_size;
+
+	struct sl_func            *main;
+	size_t                    stack_size;
+
+	DARRAY(struct sl_binding) inputs;
+	DARRAY(struct sl_binding) outputs;
+	size_t                    input_size;
+	size_t                    output_size;
+
+	/* texture parameter -> sampler it is used with, -1 if none */
+	DARRAY(int)               tex_samplers;
+
+	DARRAY(struct sl_expr*)   expr_pool;
+	DARRAY(struct sl_stmt*)   stmt_pool;
+};
+
+/** Texture access, implemented by the device */
+struct sl_texture_funcs {
+	void (*sample)(void *param, int texture, int sampler,
+			const float *coord, float *out);
+	void (*load)(void *param, int texture, const float *coord,
+			float *out);
+};
+
+struct sl_exec {
+	const struct sl_program       *prog;
+	const float                   *globals;
+	float                         *stack;
+
+	const struct sl_texture_funcs *funcs;
+	void                          *param;
+
+	/* set by discard and clip() */
+	bool                          discarded;
+};
+
+extern struct sl_program *sl_program_compile(struct shader_parser *parser,
+		const char *file);
+extern void sl_program_destroy(struct sl_program *prog);
+
+extern size_t sl_type_size(const struct sl_program *prog,
+		const struct sl_type *type);
+
+/**
+ * Runs the main function.  'inputs' holds the main function's parameters
+ * (program->input_size floats) and 'outputs' receives its return value
+ * (program->output_size floats).  'ex->stack' must hold at least
+ * program->stack_size floats.
+ *
+ * @return  false if the shader discarded the pixel
+ */
+extern bool sl_execute(struct sl_exec *ex, const float *inputs,
+		float *outputs);
@@ -0,0 +1,119 @@
+#include "sw-subsystem.h"
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf;
+
+	if (!width || !height || !gs_get_format_bpp(color_format)) {
+		blog(LOG_ERROR, "device_stagesurface_create (SW) failed");
+		return NULL;
+	}
+
+	surf = bzalloc(sizeof(struct gs_stage_surface));
+	surf->device = device;
+	surf->format = color_format;
+	surf->width  = width;
+	surf->height = height;
+
+	surf->surface.width    = width;
+	surf->surface.height   = height;
+	surf->surface.format   = color_format;
+	surf->surface.linesize = sw_get_linesize(color_format, width);
+	surf->surface.data     = bzalloc(sw_get_data_size(color_format,
+				width, height));
+
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (stagesurf) {
+		bfree(stagesurf->surface.data);
+		bfree(stagesurf);
+	}
+}
+
+static bool can_stage(struct gs_stage_surface *dst, struct gs_texture_2d *src)
+{
+	if (!src) {
+		blog(LOG_ERROR, "Source texture is NULL");
+		return false;
+	}
+
+	if (src->base.type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "Source texture must be a 2D texture");
+		return false;
+	}
+
+	if (!dst) {
+		blog(LOG_ERROR, "Destination surface is NULL");
+		return false;
+	}
+
+	if (src->base.format != dst->format) {
+		blog(LOG_ERROR, "Source and destination formats do not match");
+		return false;
+	}
+
+	if (src->width != dst->width || src->height != dst->height) {
+		blog(LOG_ERROR, "Source and destination must have the same "
+		                "dimensions");
+		return false;
+	}
+
+	return true;
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
+		gs_texture_t *src)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)src;
+
+	if (!can_stage(dst, tex2d)) {
+		blog(LOG_ERROR, "device_stage_texture (SW) failed");
+		return;
+	}
+
+	/* both use the same packing, so the whole image is one copy */
+	memcpy(dst->surface.data, tex2d->surface.data,
+			sw_get_data_size(dst->format, dst->width, dst->height));
+
+	UNUSED_PARAMETER(device);
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format gs_stagesurface_get_color_format(
+		const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+		uint32_t *linesize)
+{
+	*data     = stagesurf->surface.data;
+	*linesize = stagesurf->surface.linesize;
+	return true;
+}
+
+bool gs_stagesurface_is_ready(gs_stagesurf_t *stagesurf)
+{
+	/* the copy is complete by the time device_stage_texture returns */
+	UNUSED_PARAMETER(stagesurf);
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
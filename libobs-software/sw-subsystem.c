@@ -0,0 +1,870 @@
+#include <inttypes.h>
+#include <graphics/matrix3.h>
+#include "sw-subsystem.h"
+
+const char *device_get_name(void)
+{
+	return "Software";
+}
+
+int device_get_type(void)
+{
+	return GS_DEVICE_SOFTWARE;
+}
+
+const char *device_preprocessor_name(void)
+{
+	return "_SOFTWARE";
+}
+
+int device_create(gs_device_t **p_device, uint32_t adapter)
+{
+	struct gs_device *device = bzalloc(sizeof(struct gs_device));
+
+	blog(LOG_INFO, "---------------------------------");
+	blog(LOG_INFO, "Initializing software renderer...");
+
+	/* the same initial state as the Direct3D 11 subsystem */
+	device->cur_cull_mode  = GS_BACK;
+	device->blend_enabled  = true;
+	device->blend_src_c    = GS_BLEND_SRCALPHA;
+	device->blend_dest_c   = GS_BLEND_INVSRCALPHA;
+	device->blend_src_a    = GS_BLEND_ONE;
+	device->blend_dest_a   = GS_BLEND_ONE;
+	device->depth_enabled  = true;
+	device->depth_function = GS_LESS;
+	device->stencil_write  = true;
+
+	for (size_t i = 0; i < 4; i++)
+		device->color_mask[i] = true;
+
+	matrix4_identity(&device->cur_proj);
+	matrix4_identity(&device->cur_view);
+	matrix4_identity(&device->cur_viewproj);
+
+	blog(LOG_INFO, "Software renderer loaded successfully");
+
+	*p_device = device;
+	return GS_SUCCESS;
+
+	UNUSED_PARAMETER(adapter);
+}
+
+void device_destroy(gs_device_t *device)
+{
+	if (device) {
+		struct sw_stats *stats = &device->stats;
+
+		blog(LOG_INFO, "Software renderer: %"PRIu64" draws, "
+				"%"PRIu64" vertices, %"PRIu64" primitives, "
+				"%"PRIu64" pixels, %"PRIu64" presents",
+				stats->draws, stats->vertices,
+				stats->primitives, stats->pixels,
+				stats->presents);
+
+		da_free(device->proj_stack);
+		da_free(device->vs_inputs);
+		da_free(device->vs_outputs);
+		da_free(device->vs_done);
+		da_free(device->ps_inputs);
+		da_free(device->clip_verts);
+		da_free(device->stack);
+		bfree(device);
+	}
+}
+
+void device_enter_context(gs_device_t *device)
+{
+	/* there is no context, every thread can render */
+	UNUSED_PARAMETER(device);
+}
+
+void device_leave_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+static bool swapchain_init_buffers(struct gs_swap_chain *swap)
+{
+	gs_texture_destroy(swap->target);
+	gs_zstencil_destroy(swap->zs);
+	swap->target = NULL;
+	swap->zs     = NULL;
+
+	swap->target = device_texture_create(swap->device, swap->info.cx,
+			swap->info.cy, swap->info.format, 1, NULL,
+			GS_RENDER_TARGET);
+	if (!swap->target)
+		return false;
+
+	if (swap->info.zsformat != GS_ZS_NONE) {
+		swap->zs = device_zstencil_create(swap->device, swap->info.cx,
+				swap->info.cy, swap->info.zsformat);
+		if (!swap->zs)
+			return false;
+	}
+
+	return true;
+}
+
+gs_swapchain_t *device_swapchain_create(gs_device_t *device,
+		const struct gs_init_data *info)
+{
+	struct gs_swap_chain *swap = bzalloc(sizeof(struct gs_swap_chain));
+
+	/* there is no window to present to, the back buffer is only kept so
+	 * that rendering to the swap chain behaves the same as on a GPU */
+	swap->device = device;
+	swap->info   = *info;
+
+	if (!swapchain_init_buffers(swap)) {
+		blog(LOG_ERROR, "device_swapchain_create (SW) failed");
+		gs_swapchain_destroy(swap);
+		return NULL;
+	}
+
+	return swap;
+}
+
+void device_resize(gs_device_t *device, uint32_t cx, uint32_t cy)
+{
+	struct gs_swap_chain *swap = device->cur_swap;
+
+	if (!swap) {
+		blog(LOG_WARNING, "device_resize (SW): No active swap");
+		return;
+	}
+
+	if (swap->info.cx == cx && swap->info.cy == cy)
+		return;
+
+	swap->info.cx = cx;
+	swap->info.cy = cy;
+
+	if (!swapchain_init_buffers(swap))
+		blog(LOG_ERROR, "device_resize (SW) failed");
+}
+
+void device_get_size(const gs_device_t *device, uint32_t *cx, uint32_t *cy)
+{
+	if (device->cur_swap) {
+		*cx = device->cur_swap->info.cx;
+		*cy = device->cur_swap->info.cy;
+	} else {
+		blog(LOG_WARNING, "device_get_size (SW): No active swap");
+		*cx = 0;
+		*cy = 0;
+	}
+}
+
+uint32_t device_get_width(const gs_device_t *device)
+{
+	if (device->cur_swap) {
+		return device->cur_swap->info.cx;
+	} else {
+		blog(LOG_WARNING, "device_get_width (SW): No active swap");
+		return 0;
+	}
+}
+
+uint32_t device_get_height(const gs_device_t *device)
+{
+	if (device->cur_swap) {
+		return device->cur_swap->info.cy;
+	} else {
+		blog(LOG_WARNING, "device_get_height (SW): No active swap");
+		return 0;
+	}
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width,
+		uint32_t height, uint32_t depth,
+		enum gs_color_format color_format, uint32_t levels,
+		const uint8_t **data, uint32_t flags)
+{
+	/* TODO */
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+	return NULL;
+}
+
+static inline bool is_linear_filter(enum gs_sample_filter filter)
+{
+	/* mipmaps are not used, so only the magnification filter matters */
+	switch (filter) {
+	case GS_FILTER_POINT:
+	case GS_FILTER_MIN_MAG_POINT_MIP_LINEAR:
+	case GS_FILTER_MIN_LINEAR_MAG_MIP_POINT:
+	case GS_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR:
+		return false;
+	default:
+		return true;
+	}
+}
+
+gs_samplerstate_t *device_samplerstate_create(gs_device_t *device,
+		const struct gs_sampler_info *info)
+{
+	struct gs_sampler_state *sampler;
+
+	sampler = bzalloc(sizeof(struct gs_sampler_state));
+	sampler->device    = device;
+	sampler->ref       = 1;
+	sampler->filter    = info->filter;
+	sampler->linear    = is_linear_filter(info->filter);
+	sampler->address_u = info->address_u;
+	sampler->address_v = info->address_v;
+	sampler->address_w = info->address_w;
+
+	vec4_from_rgba(&sampler->border_color, info->border_color);
+	return sampler;
+}
+
+enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
+{
+	return texture->type;
+}
+
+static inline struct gs_shader_param *get_texture_param(gs_device_t *device,
+		int unit)
+{
+	struct gs_shader *shader = device->cur_pixel_shader;
+
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array+i;
+		if (param->type == GS_SHADER_PARAM_TEXTURE) {
+			if (param->texture_id == unit)
+				return param;
+		}
+	}
+
+	return NULL;
+}
+
+void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	struct gs_shader_param *param;
+
+	/* need a pixel shader to properly bind textures */
+	if (!device->cur_pixel_shader) {
+		blog(LOG_ERROR, "device_load_texture (SW) failed");
+		return;
+	}
+
+	device->cur_textures[unit] = tex;
+
+	param = get_texture_param(device, unit);
+	if (param)
+		param->texture = tex;
+}
+
+static inline void clear_textures(struct gs_device *device)
+{
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++)
+		device->cur_textures[i] = NULL;
+}
+
+void device_load_samplerstate(gs_device_t *device, gs_samplerstate_t *ss,
+		int unit)
+{
+	/* need a pixel shader to properly bind samplers */
+	if (!device->cur_pixel_shader)
+		ss = NULL;
+
+	device->cur_samplers[unit] = ss;
+}
+
+void device_load_vertexshader(gs_device_t *device, gs_shader_t *vertshader)
+{
+	if (device->cur_vertex_shader == vertshader)
+		return;
+
+	if (vertshader && vertshader->type != GS_SHADER_VERTEX) {
+		blog(LOG_ERROR, "Specified shader is not a vertex shader");
+		blog(LOG_ERROR, "device_load_vertexshader (SW) failed");
+		return;
+	}
+
+	device->cur_vertex_shader = vertshader;
+}
+
+static void load_default_pixelshader_samplers(struct gs_device *device,
+		struct gs_shader *ps)
+{
+	size_t i;
+	if (!ps)
+		return;
+
+	for (i = 0; i < ps->samplers.num && i < GS_MAX_TEXTURES; i++)
+		device->cur_samplers[i] = ps->samplers.array[i];
+
+	for (; i < GS_MAX_TEXTURES; i++)
+		device->cur_samplers[i] = NULL;
+}
+
+void device_load_pixelshader(gs_device_t *device, gs_shader_t *pixelshader)
+{
+	if (device->cur_pixel_shader == pixelshader)
+		return;
+
+	if (pixelshader && pixelshader->type != GS_SHADER_PIXEL) {
+		blog(LOG_ERROR, "Specified shader is not a pixel shader");
+		blog(LOG_ERROR, "device_load_pixelshader (SW) failed");
+		return;
+	}
+
+	device->cur_pixel_shader = pixelshader;
+
+	clear_textures(device);
+
+	if (pixelshader)
+		load_default_pixelshader_samplers(device, pixelshader);
+}
+
+void device_load_default_samplerstate(gs_device_t *device, bool b_3d, int unit)
+{
+	/* TODO */
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(b_3d);
+	UNUSED_PARAMETER(unit);
+}
+
+gs_shader_t *device_get_vertex_shader(const gs_device_t *device)
+{
+	return device->cur_vertex_shader;
+}
+
+gs_shader_t *device_get_pixel_shader(const gs_device_t *device)
+{
+	return device->cur_pixel_shader;
+}
+
+gs_texture_t *device_get_render_target(const gs_device_t *device)
+{
+	return device->cur_render_target;
+}
+
+gs_zstencil_t *device_get_zstencil_target(const gs_device_t *device)
+{
+	return device->cur_zstencil_buffer;
+}
+
+void device_set_render_target(gs_device_t *device, gs_texture_t *tex,
+		gs_zstencil_t *zstencil)
+{
+	if (tex) {
+		if (tex->type != GS_TEXTURE_2D) {
+			blog(LOG_ERROR, "Texture is not a 2D texture");
+			goto fail;
+		}
+
+		if (!tex->is_render_target) {
+			blog(LOG_ERROR, "Texture is not a render target");
+			goto fail;
+		}
+	}
+
+	device->cur_render_target   = tex;
+	device->cur_render_side     = 0;
+	device->cur_zstencil_buffer = zstencil;
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_set_render_target (SW) failed");
+}
+
+void device_set_cube_render_target(gs_device_t *device, gs_texture_t *cubetex,
+		int side, gs_zstencil_t *zstencil)
+{
+	if (cubetex) {
+		if (cubetex->type != GS_TEXTURE_CUBE) {
+			blog(LOG_ERROR, "Texture is not a cube texture");
+			goto fail;
+		}
+
+		if (!cubetex->is_render_target) {
+			blog(LOG_ERROR, "Texture is not a render target");
+			goto fail;
+		}
+	}
+
+	device->cur_render_target   = cubetex;
+	device->cur_render_side     = side;
+	device->cur_zstencil_buffer = zstencil;
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_set_cube_render_target (SW) failed");
+}
+
+bool sw_get_target(const gs_device_t *device, struct sw_surface *surface)
+{
+	if (device->cur_render_target)
+		return texture_get_surface(device->cur_render_target,
+				device->cur_render_side, surface);
+	if (device->cur_swap)
+		return texture_get_surface(device->cur_swap->target, 0,
+				surface);
+
+	return false;
+}
+
+void device_copy_texture_region(gs_device_t *device,
+		gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
+		gs_texture_t *src, uint32_t src_x, uint32_t src_y,
+		uint32_t src_w, uint32_t src_h)
+{
+	struct gs_texture_2d *src2d = (struct gs_texture_2d*)src;
+	struct gs_texture_2d *dst2d = (struct gs_texture_2d*)dst;
+	uint32_t bytes;
+
+	if (!src) {
+		blog(LOG_ERROR, "Source texture is NULL");
+		goto fail;
+	}
+
+	if (!dst) {
+		blog(LOG_ERROR, "Destination texture is NULL");
+		goto fail;
+	}
+
+	if (dst->type != GS_TEXTURE_2D || src->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "Source and destination textures must be 2D "
+		                "textures");
+		goto fail;
+	}
+
+	if (dst->format != src->format) {
+		blog(LOG_ERROR, "Source and destination formats do not match");
+		goto fail;
+	}
+
+	if (gs_is_compressed_format(src->format)) {
+		blog(LOG_ERROR, "Compressed textures cannot be copied");
+		goto fail;
+	}
+
+	uint32_t nw = (uint32_t)src_w ?
+		(uint32_t)src_w : (src2d->width - src_x);
+	uint32_t nh = (uint32_t)src_h ?
+		(uint32_t)src_h : (src2d->height - src_y);
+
+	if (src2d->width - src_x < nw || src2d->height - src_y < nh) {
+		blog(LOG_ERROR, "Source texture region is out of bounds");
+		goto fail;
+	}
+
+	if (dst2d->width - dst_x < nw || dst2d->height - dst_y < nh) {
+		blog(LOG_ERROR, "Destination texture region is not big "
+		                "enough to hold the source region");
+		goto fail;
+	}
+
+	bytes = gs_get_format_bpp(src->format) / 8;
+
+	for (uint32_t y = 0; y < nh; y++) {
+		const struct sw_surface *s = &src2d->surface;
+		const struct sw_surface *d = &dst2d->surface;
+
+		memmove(d->data + (dst_y + y) * d->linesize + dst_x * bytes,
+			s->data + (src_y + y) * s->linesize + src_x * bytes,
+			nw * bytes);
+	}
+
+	UNUSED_PARAMETER(device);
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_copy_texture (SW) failed");
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst,
+		gs_texture_t *src)
+{
+	device_copy_texture_region(device, dst, 0, 0, src, 0, 0, 0, 0);
+}
+
+void device_begin_scene(gs_device_t *device)
+{
+	clear_textures(device);
+}
+
+static inline bool can_render(const gs_device_t *device)
+{
+	if (!device->cur_vertex_shader) {
+		blog(LOG_ERROR, "No vertex shader specified");
+		return false;
+	}
+
+	if (!device->cur_pixel_shader) {
+		blog(LOG_ERROR, "No pixel shader specified");
+		return false;
+	}
+
+	if (!device->cur_vertex_buffer) {
+		blog(LOG_ERROR, "No vertex buffer specified");
+		return false;
+	}
+
+	if (!device->cur_swap && !device->cur_render_target) {
+		blog(LOG_ERROR, "No active swap chain or render target");
+		return false;
+	}
+
+	return true;
+}
+
+static void update_viewproj_matrix(struct gs_device *device)
+{
+	struct gs_shader *vs = device->cur_vertex_shader;
+
+	gs_matrix_get(&device->cur_view);
+
+	/* negate Z col of the view matrix for right-handed coordinate system */
+	device->cur_view.x.z = -device->cur_view.x.z;
+	device->cur_view.y.z = -device->cur_view.y.z;
+	device->cur_view.z.z = -device->cur_view.z.z;
+	device->cur_view.t.z = -device->cur_view.t.z;
+
+	matrix4_mul(&device->cur_viewproj, &device->cur_view,
+			&device->cur_proj);
+	matrix4_transpose(&device->cur_viewproj, &device->cur_viewproj);
+
+	if (vs->viewproj)
+		gs_shader_set_matrix4(vs->viewproj, &device->cur_viewproj);
+}
+
+void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
+		uint32_t start_vert, uint32_t num_verts)
+{
+	struct gs_index_buffer *ib = device->cur_index_buffer;
+	gs_effect_t *effect = gs_get_effect();
+
+	if (!can_render(device)) {
+		blog(LOG_ERROR, "device_draw (SW) failed");
+		return;
+	}
+
+	if (effect)
+		gs_effect_update_params(effect);
+
+	update_viewproj_matrix(device);
+
+	shader_load_samplers(device->cur_vertex_shader);
+	shader_load_samplers(device->cur_pixel_shader);
+	shader_update_globals(device->cur_vertex_shader);
+	shader_update_globals(device->cur_pixel_shader);
+
+	if (num_verts == 0)
+		num_verts = ib ? (uint32_t)ib->num :
+			(uint32_t)device->cur_vertex_buffer->num;
+
+	sw_draw(device, draw_mode, start_vert, num_verts);
+}
+
+void device_end_scene(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+void device_load_swapchain(gs_device_t *device, gs_swapchain_t *swapchain)
+{
+	device->cur_swap = swapchain;
+}
+
+void device_clear(gs_device_t *device, uint32_t clear_flags,
+		const struct vec4 *color, float depth, uint8_t stencil)
+{
+	struct gs_zstencil_buffer *zs = device->cur_zstencil_buffer;
+	struct sw_surface surface;
+	size_t pixels;
+
+	if (!device->cur_render_target && device->cur_swap)
+		zs = device->cur_swap->zs;
+
+	if ((clear_flags & GS_CLEAR_COLOR) && sw_get_target(device, &surface)) {
+		struct gs_rect rect = {0, 0, (int)surface.width,
+			(int)surface.height};
+		sw_surface_fill(&surface, &rect, color->ptr);
+	}
+
+	if (!zs)
+		return;
+
+	pixels = (size_t)zs->width * zs->height;
+
+	if (clear_flags & GS_CLEAR_DEPTH) {
+		for (size_t i = 0; i < pixels; i++)
+			zs->depth[i] = depth;
+	}
+
+	if ((clear_flags & GS_CLEAR_STENCIL) && zs->stencil)
+		memset(zs->stencil, stencil, pixels);
+}
+
+void device_present(gs_device_t *device)
+{
+	/* nothing is displayed, the frame stays in the swap chain target */
+	device->stats.presents++;
+}
+
+void device_flush(gs_device_t *device)
+{
+	/* draws are complete when they return */
+	UNUSED_PARAMETER(device);
+}
+
+void device_set_cull_mode(gs_device_t *device, enum gs_cull_mode mode)
+{
+	device->cur_cull_mode = mode;
+}
+
+enum gs_cull_mode device_get_cull_mode(const gs_device_t *device)
+{
+	return device->cur_cull_mode;
+}
+
+void device_enable_blending(gs_device_t *device, bool enable)
+{
+	device->blend_enabled = enable;
+}
+
+void device_enable_depth_test(gs_device_t *device, bool enable)
+{
+	device->depth_enabled = enable;
+}
+
+void device_enable_stencil_test(gs_device_t *device, bool enable)
+{
+	/* stencil state is tracked, but not applied when drawing */
+	device->stencil_enabled = enable;
+}
+
+void device_enable_stencil_write(gs_device_t *device, bool enable)
+{
+	device->stencil_write = enable;
+}
+
+void device_enable_color(gs_device_t *device, bool red, bool green,
+		bool blue, bool alpha)
+{
+	device->color_mask[0] = red;
+	device->color_mask[1] = green;
+	device->color_mask[2] = blue;
+	device->color_mask[3] = alpha;
+}
+
+void device_blend_function(gs_device_t *device, enum gs_blend_type src,
+		enum gs_blend_type dest)
+{
+	device->blend_src_c  = src;
+	device->blend_dest_c = dest;
+	device->blend_src_a  = src;
+	device->blend_dest_a = dest;
+}
+
+void device_blend_function_separate(gs_device_t *device,
+		enum gs_blend_type src_c, enum gs_blend_type dest_c,
+		enum gs_blend_type src_a, enum gs_blend_type dest_a)
+{
+	device->blend_src_c  = src_c;
+	device->blend_dest_c = dest_c;
+	device->blend_src_a  = src_a;
+	device->blend_dest_a = dest_a;
+}
+
+void device_depth_function(gs_device_t *device, enum gs_depth_test test)
+{
+	device->depth_function = test;
+}
+
+void device_stencil_function(gs_device_t *device, enum gs_stencil_side side,
+		enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_op(gs_device_t *device, enum gs_stencil_side side,
+		enum gs_stencil_op_type fail, enum gs_stencil_op_type zfail,
+		enum gs_stencil_op_type zpass)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(fail);
+	UNUSED_PARAMETER(zfail);
+	UNUSED_PARAMETER(zpass);
+}
+
+void device_set_viewport(gs_device_t *device, int x, int y, int width,
+		int height)
+{
+	device->cur_viewport.x  = x;
+	device->cur_viewport.y  = y;
+	device->cur_viewport.cx = width;
+	device->cur_viewport.cy = height;
+}
+
+void device_get_viewport(const gs_device_t *device, struct gs_rect *rect)
+{
+	*rect = device->cur_viewport;
+}
+
+void device_set_scissor_rect(gs_device_t *device, const struct gs_rect *rect)
+{
+	if (rect)
+		device->cur_scissor = *rect;
+	device->scissor_enabled = rect != NULL;
+}
+
+void device_ortho(gs_device_t *device, float left, float right,
+		float top, float bottom, float zNear, float zFar)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right-left;
+	float bmt = bottom-top;
+	float fmn = zFar-zNear;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x =         2.0f /  rml;
+	dst->t.x = (left+right) / -rml;
+
+	dst->y.y =         2.0f / -bmt;
+	dst->t.y = (bottom+top) /  bmt;
+
+	dst->z.z =         1.0f /  fmn;
+	dst->t.z =        zNear / -fmn;
+
+	dst->t.w = 1.0f;
+}
+
+void device_frustum(gs_device_t *device, float left, float right,
+		float top, float bottom, float zNear, float zFar)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml    = right-left;
+	float bmt    = bottom-top;
+	float fmn    = zFar-zNear;
+	float nearx2 = 2.0f*zNear;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x =       nearx2 /  rml;
+	dst->z.x = (left+right) / -rml;
+
+	dst->y.y =       nearx2 / -bmt;
+	dst->z.y = (bottom+top) /  bmt;
+
+	dst->z.z =         zFar /  fmn;
+	dst->t.z = (zNear*zFar) / -fmn;
+
+	dst->z.w = 1.0f;
+}
+
+void device_projection_push(gs_device_t *device)
+{
+	da_push_back(device->proj_stack, &device->cur_proj);
+}
+
+void device_projection_pop(gs_device_t *device)
+{
+	struct matrix4 *end;
+	if (!device->proj_stack.num)
+		return;
+
+	end = da_end(device->proj_stack);
+	device->cur_proj = *end;
+	da_pop_back(device->proj_stack);
+}
+
+void gs_swapchain_destroy(gs_swapchain_t *swapchain)
+{
+	if (!swapchain)
+		return;
+
+	if (swapchain->device->cur_swap == swapchain)
+		device_load_swapchain(swapchain->device, NULL);
+
+	gs_texture_destroy(swapchain->target);
+	gs_zstencil_destroy(swapchain->zs);
+	bfree(swapchain);
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	/* TODO */
+	UNUSED_PARAMETER(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	/* TODO */
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	/* TODO */
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	/* TODO */
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	/* TODO */
+	UNUSED_PARAMETER(voltex);
+	return GS_UNKNOWN;
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
+{
+	if (!samplerstate)
+		return;
+
+	if (samplerstate->device)
+		for (int i = 0; i < GS_MAX_TEXTURES; i++)
+			if (samplerstate->device->cur_samplers[i] ==
+					samplerstate)
+				samplerstate->device->cur_samplers[i] = NULL;
+
+	samplerstate_release(samplerstate);
+}
+
+#ifdef _WIN32
+
+EXPORT bool device_gdi_texture_available(void)
+{
+	return false;
+}
+
+EXPORT bool device_shared_texture_available(void)
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <util/darray.h>
+#include <util/threading.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/matrix4.h>
+#include <graphics/vec4.h>
+
+#include "sw-shaderlang.h"
+
+/*
+ *   Graphics subsystem that renders entirely on the CPU, so that full render
+ * pipelines can run without a GPU or a display (headless servers, CI and
+ * performance regression tests).
+ *
+ *   It follows the conventions of the Direct3D 11 subsystem: clip space depth
+ * is 0..1, the viewport origin is the top left, counter-clockwise triangles
+ * are front facing, and matrices are passed to shaders the way HLSL expects
+ * them.  Shaders are compiled by sw-shaderlang.c and interpreted once per
+ * vertex and once per pixel.
+ */
+
+/** A single image of a texture or render target */
+struct sw_surface {
+	uint8_t              *data;
+	uint32_t             width;
+	uint32_t             height;
+	uint32_t             linesize;
+	enum gs_color_format format;
+};
+
+extern void sw_read_pixel(enum gs_color_format format, const uint8_t *ptr,
+		float *rgba);
+extern void sw_write_pixel(enum gs_color_format format, uint8_t *ptr,
+		const float *rgba);
+
+extern void sw_surface_load(const struct sw_surface *surf, int x, int y,
+		float *rgba);
+extern void sw_surface_sample(const struct sw_surface *surf,
+		const struct gs_sampler_state *ss, const float *uv,
+		float *rgba);
+extern void sw_surface_fill(const struct sw_surface *surf,
+		const struct gs_rect *rect, const float *rgba);
+
+static inline uint32_t sw_get_linesize(enum gs_color_format format,
+		uint32_t width)
+{
+	/* rows are tightly packed, the same as the data given to
+	 * device_texture_create */
+	return width * gs_get_format_bpp(format) / 8;
+}
+
+static inline uint32_t sw_get_data_size(enum gs_color_format format,
+		uint32_t width, uint32_t height)
+{
+	if (gs_is_compressed_format(format)) {
+		uint32_t block_size = (format == GS_DXT1) ? 8 : 16;
+		return ((width + 3) / 4) * ((height + 3) / 4) * block_size;
+	}
+
+	return sw_get_linesize(format, width) * height;
+}
+
+struct gs_sampler_state {
+	gs_device_t          *device;
+	volatile long        ref;
+
+	enum gs_sample_filter filter;
+	bool                 linear;
+	enum gs_address_mode address_u;
+	enum gs_address_mode address_v;
+	enum gs_address_mode address_w;
+	struct vec4          border_color;
+};
+
+static inline void samplerstate_addref(gs_samplerstate_t *ss)
+{
+	os_atomic_inc_long(&ss->ref);
+}
+
+static inline void samplerstate_release(gs_samplerstate_t *ss)
+{
+	if (os_atomic_dec_long(&ss->ref) == 0)
+		bfree(ss);
+}
+
+struct gs_shader_param {
+	enum gs_shader_param_type type;
+
+	char                 *name;
+	gs_shader_t          *shader;
+	gs_samplerstate_t    *next_sampler;
+	int                  texture_id;
+	size_t               sampler_id;
+	int                  array_count;
+
+	struct gs_texture    *texture;
+
+	DARRAY(uint8_t)      cur_value;
+	DARRAY(uint8_t)      def_value;
+	bool                 changed;
+};
+
+struct gs_shader {
+	gs_device_t          *device;
+	enum gs_shader_type  type;
+	struct sl_program    *program;
+
+	struct gs_shader_param  *viewproj;
+	struct gs_shader_param  *world;
+
+	DARRAY(struct gs_shader_param) params;
+	DARRAY(gs_samplerstate_t*)     samplers;
+
+	/* parameter values as the program reads them, see
+	 * shader_update_globals */
+	DARRAY(float)        globals;
+};
+
+extern void shader_update_globals(struct gs_shader *shader);
+extern void shader_load_samplers(struct gs_shader *shader);
+
+/** Texture callbacks for programs, 'param' is the gs_shader */
+extern const struct sl_texture_funcs shader_texture_funcs;
+
+struct gs_vertex_buffer {
+	gs_device_t          *device;
+	size_t               num;
+	bool                 dynamic;
+
+	/* the vertices that are drawn, updated by flushing */
+	struct vec3          *points;
+	struct vec3          *normals;
+	struct vec3          *tangents;
+	uint32_t             *colors;
+	DARRAY(float*)       uvs;
+	DARRAY(size_t)       uv_sizes;
+
+	/* kept for dynamic buffers so the caller can update it */
+	struct gs_vb_data    *data;
+};
+
+struct gs_index_buffer {
+	enum gs_index_type   type;
+
+	gs_device_t          *device;
+	void                 *data;
+	void                 *indices;
+	size_t               num;
+	size_t               width;
+	size_t               size;
+	bool                 dynamic;
+};
+
+static inline uint32_t indexbuffer_get(const struct gs_index_buffer *ib,
+		size_t idx)
+{
+	return ib->type == GS_UNSIGNED_LONG ?
+		((const uint32_t*)ib->indices)[idx] :
+		((const uint16_t*)ib->indices)[idx];
+}
+
+struct gs_texture {
+	gs_device_t          *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t             levels;
+	bool                 is_dynamic;
+	bool                 is_render_target;
+	bool                 gen_mipmaps;
+};
+
+struct gs_texture_2d {
+	struct gs_texture    base;
+
+	uint32_t             width;
+	uint32_t             height;
+	struct sw_surface    surface;
+};
+
+struct gs_texture_cube {
+	struct gs_texture    base;
+
+	uint32_t             size;
+	struct sw_surface    faces[6];
+};
+
+extern bool texture_get_surface(const gs_texture_t *tex, int side,
+		struct sw_surface *surface);
+
+struct gs_stage_surface {
+	gs_device_t          *device;
+
+	enum gs_color_format format;
+	uint32_t             width;
+	uint32_t             height;
+
+	struct sw_surface    surface;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t          *device;
+	enum gs_zstencil_format format;
+	uint32_t             width;
+	uint32_t             height;
+
+	float                *depth;
+	uint8_t              *stencil;
+};
+
+struct gs_swap_chain {
+	gs_device_t          *device;
+	struct gs_init_data  info;
+
+	gs_texture_t         *target;
+	gs_zstencil_t        *zs;
+};
+
+/** Values that are tracked over the lifetime of the device */
+struct sw_stats {
+	uint64_t             draws;
+	uint64_t             vertices;
+	uint64_t             primitives;
+	uint64_t             pixels;
+	uint64_t             presents;
+};
+
+struct gs_device {
+	gs_texture_t         *cur_render_target;
+	gs_zstencil_t        *cur_zstencil_buffer;
+	int                  cur_render_side;
+	gs_texture_t         *cur_textures[GS_MAX_TEXTURES];
+	gs_samplerstate_t    *cur_samplers[GS_MAX_TEXTURES];
+	gs_vertbuffer_t      *cur_vertex_buffer;
+	gs_indexbuffer_t     *cur_index_buffer;
+	gs_shader_t          *cur_vertex_shader;
+	gs_shader_t          *cur_pixel_shader;
+	gs_swapchain_t       *cur_swap;
+
+	enum gs_cull_mode    cur_cull_mode;
+	struct gs_rect       cur_viewport;
+	struct gs_rect       cur_scissor;
+	bool                 scissor_enabled;
+
+	bool                 blend_enabled;
+	enum gs_blend_type   blend_src_c;
+	enum gs_blend_type   blend_dest_c;
+	enum gs_blend_type   blend_src_a;
+	enum gs_blend_type   blend_dest_a;
+
+	bool                 depth_enabled;
+	enum gs_depth_test   depth_function;
+	bool                 stencil_enabled;
+	bool                 stencil_write;
+
+	bool                 color_mask[4];
+
+	struct matrix4       cur_proj;
+	struct matrix4       cur_view;
+	struct matrix4       cur_viewproj;
+
+	DARRAY(struct matrix4) proj_stack;
+
+	/* scratch memory reused between draws */
+	DARRAY(float)        vs_inputs;
+	DARRAY(float)        vs_outputs;
+	DARRAY(uint8_t)      vs_done;
+	DARRAY(float)        ps_inputs;
+	DARRAY(float)        clip_verts;
+	DARRAY(float)        stack;
+
+	struct sw_stats      stats;
+};
+
+extern void sw_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
+		uint32_t start_vert, uint32_t num_verts);
+extern bool sw_get_target(const gs_device_t *device,
+		struct sw_surface *surface);
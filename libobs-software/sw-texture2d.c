@@ -0,0 +1,153 @@
+#include "sw-subsystem.h"
+
+static void upload_texture_2d(struct gs_texture_2d *tex, const uint8_t **data)
+{
+	/* only the top level is stored, the rasterizer does not use mipmaps */
+	if (data && data[0])
+		memcpy(tex->surface.data, data[0],
+				sw_get_data_size(tex->base.format, tex->width,
+					tex->height));
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_color_format color_format,
+		uint32_t levels, const uint8_t **data, uint32_t flags)
+{
+	struct gs_texture_2d *tex = bzalloc(sizeof(struct gs_texture_2d));
+	tex->base.device             = device;
+	tex->base.type               = GS_TEXTURE_2D;
+	tex->base.format             = color_format;
+	tex->base.levels             = levels;
+	tex->base.is_dynamic         = (flags & GS_DYNAMIC)       != 0;
+	tex->base.is_render_target   = (flags & GS_RENDER_TARGET) != 0;
+	tex->base.gen_mipmaps        = (flags & GS_BUILD_MIPMAPS) != 0;
+	tex->width                   = width;
+	tex->height                  = height;
+
+	tex->surface.width    = width;
+	tex->surface.height   = height;
+	tex->surface.format   = color_format;
+	tex->surface.linesize = sw_get_linesize(color_format, width);
+
+	if (!width || !height || !gs_get_format_bpp(color_format))
+		goto fail;
+
+	tex->surface.data = bzalloc(sw_get_data_size(color_format, width,
+				height));
+	upload_texture_2d(tex, data);
+
+	return (gs_texture_t*)tex;
+
+fail:
+	gs_texture_destroy((gs_texture_t*)tex);
+	blog(LOG_ERROR, "device_texture_create (SW) failed");
+	return NULL;
+}
+
+static inline bool is_texture_2d(const gs_texture_t *tex, const char *func)
+{
+	bool is_tex2d = tex->type == GS_TEXTURE_2D;
+	if (!is_tex2d)
+		blog(LOG_ERROR, "%s (SW) failed:  Not a 2D texture", func);
+	return is_tex2d;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)tex;
+	if (!tex)
+		return;
+
+	if (!is_texture_2d(tex, "gs_texture_destroy"))
+		return;
+
+	bfree(tex2d->surface.data);
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	const struct gs_texture_2d *tex2d = (const struct gs_texture_2d*)tex;
+	if (!is_texture_2d(tex, "gs_texture_get_width"))
+		return 0;
+
+	return tex2d->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	const struct gs_texture_2d *tex2d = (const struct gs_texture_2d*)tex;
+	if (!is_texture_2d(tex, "gs_texture_get_height"))
+		return 0;
+
+	return tex2d->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)tex;
+
+	if (!is_texture_2d(tex, "gs_texture_map"))
+		goto fail;
+
+	if (!tex2d->base.is_dynamic) {
+		blog(LOG_ERROR, "Texture is not dynamic");
+		goto fail;
+	}
+
+	/* the texture is written in place, draws are always complete by the
+	 * time device_draw returns */
+	*ptr      = tex2d->surface.data;
+	*linesize = tex2d->surface.linesize;
+	return true;
+
+fail:
+	blog(LOG_ERROR, "gs_texture_map (SW) failed");
+	return false;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	if (!is_texture_2d(tex, "gs_texture_unmap"))
+		blog(LOG_ERROR, "gs_texture_unmap (SW) failed");
+}
+
+bool gs_texture_is_rect(const gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return false;
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d*)tex;
+	if (!is_texture_2d(tex, "gs_texture_get_obj")) {
+		blog(LOG_ERROR, "gs_texture_get_obj (SW) failed");
+		return NULL;
+	}
+
+	return tex2d->surface.data;
+}
+
+bool texture_get_surface(const gs_texture_t *tex, int side,
+		struct sw_surface *surface)
+{
+	if (tex->type == GS_TEXTURE_2D) {
+		*surface = ((const struct gs_texture_2d*)tex)->surface;
+		return true;
+
+	} else if (tex->type == GS_TEXTURE_CUBE) {
+		if (side < 0 || side >= 6)
+			return false;
+
+		*surface = ((const struct gs_texture_cube*)tex)->faces[side];
+		return true;
+	}
+
+	return false;
+}
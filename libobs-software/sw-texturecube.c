@@ -0,0 +1,94 @@
+#include "sw-subsystem.h"
+
+static void upload_texture_cube(struct gs_texture_cube *tex,
+		const uint8_t **data)
+{
+	uint32_t num_levels = tex->base.levels;
+	uint32_t size = sw_get_data_size(tex->base.format, tex->size,
+			tex->size);
+
+	if (!num_levels)
+		num_levels = gs_get_total_levels(tex->size, tex->size);
+	if (!num_levels)
+		num_levels = 1;
+
+	/* the levels of each face follow each other, only the top level of
+	 * each face is stored */
+	for (uint32_t i = 0; i < 6; i++) {
+		if (data && data[i * num_levels])
+			memcpy(tex->faces[i].data, data[i * num_levels], size);
+	}
+}
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size,
+		enum gs_color_format color_format, uint32_t levels,
+		const uint8_t **data, uint32_t flags)
+{
+	struct gs_texture_cube *tex = bzalloc(sizeof(struct gs_texture_cube));
+	tex->base.device             = device;
+	tex->base.type               = GS_TEXTURE_CUBE;
+	tex->base.format             = color_format;
+	tex->base.levels             = levels;
+	tex->base.is_render_target   = (flags & GS_RENDER_TARGET) != 0;
+	tex->base.gen_mipmaps        = (flags & GS_BUILD_MIPMAPS) != 0;
+	tex->size                    = size;
+
+	if (!size || !gs_get_format_bpp(color_format))
+		goto fail;
+
+	for (int i = 0; i < 6; i++) {
+		struct sw_surface *face = tex->faces + i;
+
+		face->width    = size;
+		face->height   = size;
+		face->format   = color_format;
+		face->linesize = sw_get_linesize(color_format, size);
+		face->data     = bzalloc(sw_get_data_size(color_format, size,
+					size));
+	}
+
+	upload_texture_cube(tex, data);
+	return (gs_texture_t*)tex;
+
+fail:
+	gs_cubetexture_destroy((gs_texture_t*)tex);
+	blog(LOG_ERROR, "device_cubetexture_create (SW) failed");
+	return NULL;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *tex)
+{
+	struct gs_texture_cube *cube = (struct gs_texture_cube*)tex;
+	if (!tex)
+		return;
+
+	for (int i = 0; i < 6; i++)
+		bfree(cube->faces[i].data);
+
+	bfree(tex);
+}
+
+static inline bool is_texture_cube(const gs_texture_t *tex, const char *func)
+{
+	bool is_texcube = tex->type == GS_TEXTURE_CUBE;
+	if (!is_texcube)
+		blog(LOG_ERROR, "%s (SW) failed:  Not a cubemap texture", func);
+	return is_texcube;
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	const struct gs_texture_cube *cube =
+		(const struct gs_texture_cube*)cubetex;
+
+	if (!is_texture_cube(cubetex, "gs_cubetexture_get_size"))
+		return 0;
+
+	return cube->size;
+}
+
+enum gs_color_format gs_cubetexture_get_color_format(
+		const gs_texture_t *cubetex)
+{
+	return cubetex->format;
+}
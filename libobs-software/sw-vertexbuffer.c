@@ -0,0 +1,159 @@
+#include <graphics/vec3.h>
+#include "sw-subsystem.h"
+
+static inline void *dup_array(const void *src, size_t size)
+{
+	return src ? bmemdup(src, size) : NULL;
+}
+
+static void create_buffers(struct gs_vertex_buffer *vb)
+{
+	struct gs_vb_data *data = vb->data;
+	size_t num = data->num;
+
+	da_reserve(vb->uvs,      data->num_tex);
+	da_reserve(vb->uv_sizes, data->num_tex);
+
+	if (vb->dynamic) {
+		/* the caller keeps writing to the data between flushes, so
+		 * the vertices that are drawn are a separate copy */
+		vb->points   = dup_array(data->points,
+				num * sizeof(struct vec3));
+		vb->normals  = dup_array(data->normals,
+				num * sizeof(struct vec3));
+		vb->tangents = dup_array(data->tangents,
+				num * sizeof(struct vec3));
+		vb->colors   = dup_array(data->colors, num * sizeof(uint32_t));
+
+		for (size_t i = 0; i < data->num_tex; i++) {
+			struct gs_tvertarray *tv = data->tvarray+i;
+			float *uv = dup_array(tv->array,
+					num * tv->width * sizeof(float));
+
+			da_push_back(vb->uvs,      &uv);
+			da_push_back(vb->uv_sizes, &tv->width);
+		}
+		return;
+	}
+
+	/* static buffers take ownership of the arrays instead of copying */
+	vb->points   = data->points;
+	vb->normals  = data->normals;
+	vb->tangents = data->tangents;
+	vb->colors   = data->colors;
+	data->points = data->normals = data->tangents = NULL;
+	data->colors = NULL;
+
+	for (size_t i = 0; i < data->num_tex; i++) {
+		struct gs_tvertarray *tv = data->tvarray+i;
+		float *uv = tv->array;
+
+		da_push_back(vb->uvs,      &uv);
+		da_push_back(vb->uv_sizes, &tv->width);
+		tv->array = NULL;
+	}
+
+	gs_vbdata_destroy(vb->data);
+	vb->data = NULL;
+}
+
+gs_vertbuffer_t *device_vertexbuffer_create(gs_device_t *device,
+		struct gs_vb_data *data, uint32_t flags)
+{
+	struct gs_vertex_buffer *vb = bzalloc(sizeof(struct gs_vertex_buffer));
+	vb->device  = device;
+	vb->data    = data;
+	vb->num     = data->num;
+	vb->dynamic = flags & GS_DYNAMIC;
+
+	if (!data->points) {
+		blog(LOG_ERROR, "device_vertexbuffer_create (SW) failed");
+		gs_vertexbuffer_destroy(vb);
+		return NULL;
+	}
+
+	create_buffers(vb);
+	return vb;
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vb)
+{
+	if (vb) {
+		if (vb->device->cur_vertex_buffer == vb)
+			vb->device->cur_vertex_buffer = NULL;
+
+		bfree(vb->points);
+		bfree(vb->normals);
+		bfree(vb->tangents);
+		bfree(vb->colors);
+		for (size_t i = 0; i < vb->uvs.num; i++)
+			bfree(vb->uvs.array[i]);
+
+		da_free(vb->uv_sizes);
+		da_free(vb->uvs);
+		gs_vbdata_destroy(vb->data);
+
+		bfree(vb);
+	}
+}
+
+static inline void update_array(void *dst, const void *src, size_t size)
+{
+	if (dst && src)
+		memcpy(dst, src, size);
+}
+
+static inline void gs_vertexbuffer_flush_internal(gs_vertbuffer_t *vb,
+		const struct gs_vb_data *data)
+{
+	size_t num_tex;
+	size_t num;
+
+	if (!vb->dynamic) {
+		blog(LOG_ERROR, "vertex buffer is not dynamic");
+		blog(LOG_ERROR, "gs_vertexbuffer_flush (SW) failed");
+		return;
+	}
+
+	num_tex = data->num_tex < vb->uvs.num ? data->num_tex : vb->uvs.num;
+	num     = data->num < vb->num ? data->num : vb->num;
+
+	update_array(vb->points,   data->points,   num * sizeof(struct vec3));
+	update_array(vb->normals,  data->normals,  num * sizeof(struct vec3));
+	update_array(vb->tangents, data->tangents, num * sizeof(struct vec3));
+	update_array(vb->colors,   data->colors,   num * sizeof(uint32_t));
+
+	for (size_t i = 0; i < num_tex; i++) {
+		struct gs_tvertarray *tv = data->tvarray+i;
+
+		if (tv->width != vb->uv_sizes.array[i]) {
+			blog(LOG_ERROR, "gs_vertexbuffer_flush (SW): texture "
+			                "coordinate width does not match");
+			continue;
+		}
+
+		update_array(vb->uvs.array[i], tv->array,
+				num * tv->width * sizeof(float));
+	}
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vb)
+{
+	gs_vertexbuffer_flush_internal(vb, vb->data);
+}
+
+void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vb,
+		const struct gs_vb_data *data)
+{
+	gs_vertexbuffer_flush_internal(vb, data);
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vb)
+{
+	return vb->data;
+}
+
+void device_load_vertexbuffer(gs_device_t *device, gs_vertbuffer_t *vb)
+{
+	device->cur_vertex_buffer = vb;
+}
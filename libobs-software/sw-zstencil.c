@@ -0,0 +1,41 @@
+#include "sw-subsystem.h"
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device, uint32_t width,
+		uint32_t height, enum gs_zstencil_format format)
+{
+	struct gs_zstencil_buffer *zs;
+	size_t pixels = (size_t)width * height;
+
+	if (!pixels || format == GS_ZS_NONE) {
+		blog(LOG_ERROR, "device_zstencil_create (SW) failed");
+		return NULL;
+	}
+
+	zs = bzalloc(sizeof(struct gs_zstencil_buffer));
+	zs->device = device;
+	zs->format = format;
+	zs->width  = width;
+	zs->height = height;
+
+	/* depth is always stored as float, whatever the requested precision */
+	zs->depth = bmalloc(pixels * sizeof(float));
+	for (size_t i = 0; i < pixels; i++)
+		zs->depth[i] = 1.0f;
+
+	if (format == GS_Z24_S8 || format == GS_Z32F_S8X24)
+		zs->stencil = bzalloc(pixels);
+
+	return zs;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zs)
+{
+	if (zs) {
+		if (zs->device->cur_zstencil_buffer == zs)
+			zs->device->cur_zstencil_buffer = NULL;
+
+		bfree(zs->depth);
+		bfree(zs->stencil);
+		bfree(zs);
+	}
+}
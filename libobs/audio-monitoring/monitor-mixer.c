@@ -0,0 +1,323 @@
+#include "monitor-mixer.h"
+
+#define blog(level, msg, ...) blog(level, "monitor-mixer: " msg, ##__VA_ARGS__)
+
+/* audio buffered per source ahead of the device, to absorb packet sizes */
+#define TARGET_LATENCY_NS  40000000ULL
+/* buffered audio beyond this is dropped back down to the target */
+#define MAX_LATENCY_NS    200000000ULL
+/* timestamp variance tolerated before a source is realigned */
+#define MAX_INPUT_TS_VAR   20000000ULL
+
+struct mixer_input {
+	struct monitor_mixer *mixer;
+	obs_source_t         *source;
+	struct circlebuf     buf[MAX_AUDIO_CHANNELS];
+	uint64_t             next_ts;
+};
+
+struct monitor_mixer {
+	pthread_mutex_t            mutex;
+	DARRAY(struct mixer_input*) inputs;
+
+	size_t                     channels;
+	size_t                     sample_rate;
+
+	/* timestamp of the next frame to be mixed, 0 until audio arrives */
+	uint64_t                   cursor_ts;
+
+	DARRAY(float)              mix[MAX_AUDIO_CHANNELS];
+	DARRAY(float)              temp;
+
+	struct monitor_mixer_stats stats;
+};
+
+static inline uint64_t uint64_diff(uint64_t ts1, uint64_t ts2)
+{
+	return (ts1 < ts2) ? (ts2 - ts1) : (ts1 - ts2);
+}
+
+static inline size_t input_frames(const struct mixer_input *input)
+{
+	return input->buf[0].size / sizeof(float);
+}
+
+static void input_clear(struct mixer_input *input, size_t channels)
+{
+	for (size_t i = 0; i < channels; i++)
+		circlebuf_pop_front(&input->buf[i], NULL, input->buf[i].size);
+}
+
+static bool mixer_idle(const struct monitor_mixer *mixer)
+{
+	for (size_t i = 0; i < mixer->inputs.num; i++) {
+		if (input_frames(mixer->inputs.array[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/* Works out where a source's audio belongs relative to the mix.  Returns the
+ * number of frames of silence to insert before the audio (positive) or the
+ * number of frames to skip from the start of it (negative). */
+static int64_t input_align(struct mixer_input *input, uint64_t ts)
+{
+	struct monitor_mixer *mixer = input->mixer;
+	uint64_t frames;
+
+	input_clear(input, mixer->channels);
+	mixer->stats.realigns++;
+
+	if (!mixer->cursor_ts || (mixer_idle(mixer) &&
+	    uint64_diff(ts, mixer->cursor_ts + TARGET_LATENCY_NS) >
+	    MAX_LATENCY_NS))
+		mixer->cursor_ts = ts - TARGET_LATENCY_NS;
+
+	if (ts < mixer->cursor_ts) {
+		frames = ns_to_audio_frames(mixer->sample_rate,
+				mixer->cursor_ts - ts);
+		return -(int64_t)frames;
+	}
+
+	if (ts - mixer->cursor_ts > MAX_LATENCY_NS)
+		ts = mixer->cursor_ts + TARGET_LATENCY_NS;
+
+	frames = ns_to_audio_frames(mixer->sample_rate, ts - mixer->cursor_ts);
+	return (int64_t)frames;
+}
+
+static void input_push_silence(struct mixer_input *input, size_t frames)
+{
+	for (size_t i = 0; i < input->mixer->channels; i++)
+		circlebuf_push_back_zero(&input->buf[i],
+				frames * sizeof(float));
+}
+
+static void input_trim(struct mixer_input *input)
+{
+	struct monitor_mixer *mixer = input->mixer;
+	size_t max_frames = ns_to_audio_frames(mixer->sample_rate,
+			MAX_LATENCY_NS);
+	size_t target_frames = ns_to_audio_frames(mixer->sample_rate,
+			TARGET_LATENCY_NS);
+	size_t frames = input_frames(input);
+	size_t drop;
+
+	if (frames <= max_frames)
+		return;
+
+	drop = frames - target_frames;
+	for (size_t i = 0; i < mixer->channels; i++)
+		circlebuf_pop_front(&input->buf[i], NULL, drop * sizeof(float));
+
+	mixer->stats.frames_dropped += drop;
+}
+
+static void input_audio(void *param, obs_source_t *source,
+		const struct audio_data *audio_data, bool muted)
+{
+	struct mixer_input *input = param;
+	struct monitor_mixer *mixer = input->mixer;
+	size_t frames = audio_data->frames;
+	size_t offset = 0;
+	uint64_t ts;
+
+	if (os_atomic_load_long(&source->activate_refs) == 0)
+		return;
+
+	/* capture callbacks get the source's own timestamps, so convert to
+	 * system time the same way the source does for the main mix */
+	ts = audio_data->timestamp + source->timing_adjust +
+		source->sync_offset - source->resample_offset;
+
+	pthread_mutex_lock(&mixer->mutex);
+
+	if (!input_frames(input) ||
+	    uint64_diff(ts, input->next_ts) > MAX_INPUT_TS_VAR) {
+		int64_t align = input_align(input, ts);
+
+		if (align < 0) {
+			offset = (size_t)-align;
+			if (offset >= frames) {
+				mixer->stats.frames_dropped += frames;
+				goto unlock;
+			}
+
+			mixer->stats.frames_dropped += offset;
+		} else if (align > 0) {
+			input_push_silence(input, (size_t)align);
+		}
+	}
+
+	input->next_ts = ts + audio_frames_to_ns(mixer->sample_rate, frames);
+
+	if (muted) {
+		input_push_silence(input, frames - offset);
+	} else {
+		for (size_t i = 0; i < mixer->channels; i++) {
+			const float *data = (const float*)audio_data->data[i];
+			circlebuf_push_back(&input->buf[i], data + offset,
+					(frames - offset) * sizeof(float));
+		}
+	}
+
+	input_trim(input);
+
+unlock:
+	pthread_mutex_unlock(&mixer->mutex);
+}
+
+struct monitor_mixer *monitor_mixer_create(void)
+{
+	struct monitor_mixer *mixer = bzalloc(sizeof(struct monitor_mixer));
+
+	if (pthread_mutex_init(&mixer->mutex, NULL) != 0) {
+		blog(LOG_WARNING, "Failed to init mutex");
+		bfree(mixer);
+		return NULL;
+	}
+
+	mixer->channels = audio_output_get_channels(obs->audio.audio);
+	mixer->sample_rate = audio_output_get_sample_rate(obs->audio.audio);
+	return mixer;
+}
+
+static void input_destroy(struct mixer_input *input)
+{
+	obs_source_remove_audio_capture_callback(input->source, input_audio,
+			input);
+
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		circlebuf_free(&input->buf[i]);
+	bfree(input);
+}
+
+void monitor_mixer_destroy(struct monitor_mixer *mixer)
+{
+	if (!mixer)
+		return;
+
+	for (size_t i = 0; i < mixer->inputs.num; i++)
+		input_destroy(mixer->inputs.array[i]);
+
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		da_free(mixer->mix[i]);
+
+	da_free(mixer->temp);
+	da_free(mixer->inputs);
+	pthread_mutex_destroy(&mixer->mutex);
+	bfree(mixer);
+}
+
+void monitor_mixer_add_source(struct monitor_mixer *mixer,
+		obs_source_t *source)
+{
+	struct mixer_input *input = bzalloc(sizeof(struct mixer_input));
+	input->mixer = mixer;
+	input->source = source;
+
+	pthread_mutex_lock(&mixer->mutex);
+	da_push_back(mixer->inputs, &input);
+	pthread_mutex_unlock(&mixer->mutex);
+
+	obs_source_add_audio_capture_callback(source, input_audio, input);
+}
+
+void monitor_mixer_remove_source(struct monitor_mixer *mixer,
+		obs_source_t *source)
+{
+	struct mixer_input *input = NULL;
+
+	pthread_mutex_lock(&mixer->mutex);
+	for (size_t i = 0; i < mixer->inputs.num; i++) {
+		if (mixer->inputs.array[i]->source == source) {
+			input = mixer->inputs.array[i];
+			da_erase(mixer->inputs, i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mixer->mutex);
+
+	/* removing the callback waits for any call in progress, so this must
+	 * not be done with the mixer locked */
+	if (input)
+		input_destroy(input);
+}
+
+size_t monitor_mixer_num_sources(struct monitor_mixer *mixer)
+{
+	size_t num;
+
+	pthread_mutex_lock(&mixer->mutex);
+	num = mixer->inputs.num;
+	pthread_mutex_unlock(&mixer->mutex);
+
+	return num;
+}
+
+static void mix_input(struct monitor_mixer *mixer, struct mixer_input *input,
+		size_t frames)
+{
+	float vol = input->source->user_volume;
+	bool apply_vol = !close_float(vol, 1.0f, EPSILON);
+
+	da_resize(mixer->temp, frames);
+
+	for (size_t i = 0; i < mixer->channels; i++) {
+		float *mix = mixer->mix[i].array;
+		float *temp = mixer->temp.array;
+
+		circlebuf_pop_front(&input->buf[i], temp,
+				frames * sizeof(float));
+
+		if (apply_vol) {
+			for (size_t j = 0; j < frames; j++)
+				mix[j] += temp[j] * vol;
+		} else {
+			for (size_t j = 0; j < frames; j++)
+				mix[j] += temp[j];
+		}
+	}
+}
+
+size_t monitor_mixer_mix(struct monitor_mixer *mixer,
+		uint8_t *out[MAX_AV_PLANES], size_t frames)
+{
+	size_t mixed = 0;
+
+	pthread_mutex_lock(&mixer->mutex);
+
+	for (size_t i = 0; i < mixer->channels; i++) {
+		da_resize(mixer->mix[i], frames);
+		memset(mixer->mix[i].array, 0, frames * sizeof(float));
+		out[i] = (uint8_t*)mixer->mix[i].array;
+	}
+
+	for (size_t i = 0; i < mixer->inputs.num; i++) {
+		struct mixer_input *input = mixer->inputs.array[i];
+		size_t avail = input_frames(input);
+
+		if (!avail)
+			continue;
+
+		mix_input(mixer, input, avail < frames ? avail : frames);
+		mixed++;
+	}
+
+	if (mixer->cursor_ts)
+		mixer->cursor_ts += audio_frames_to_ns(mixer->sample_rate,
+				frames);
+	mixer->stats.frames_mixed += frames;
+
+	pthread_mutex_unlock(&mixer->mutex);
+	return mixed;
+}
+
+void monitor_mixer_get_stats(struct monitor_mixer *mixer,
+		struct monitor_mixer_stats *stats)
+{
+	pthread_mutex_lock(&mixer->mutex);
+	*stats = mixer->stats;
+	pthread_mutex_unlock(&mixer->mutex);
+}
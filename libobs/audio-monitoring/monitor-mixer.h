@@ -0,0 +1,48 @@
+#pragma once
+
+#include "obs-internal.h"
+
+/*
+ *   Sums the audio of every monitored source in to a single stream, so that
+ * a monitoring backend only has to drive one stream per device no matter how
+ * many sources are being monitored.
+ *
+ *   Sources push audio from their own threads.  Each source is aligned to the
+ * mix by its timestamp when it starts (or resumes after running dry), and
+ * then plays back in order with a small amount of buffering to absorb the
+ * size of the packets it outputs.  The backend pulls mixed audio at the pace
+ * of its device, in the output's sample rate and speaker layout as float
+ * planar audio.
+ */
+
+struct monitor_mixer;
+
+struct monitor_mixer_stats {
+	uint64_t frames_mixed;
+	/** Frames of source audio dropped because they arrived too late or
+	 * because a source buffered too far ahead of the device */
+	uint64_t frames_dropped;
+	/** Number of times a source had to be realigned to the mix */
+	uint64_t realigns;
+};
+
+extern struct monitor_mixer *monitor_mixer_create(void);
+extern void monitor_mixer_destroy(struct monitor_mixer *mixer);
+
+extern void monitor_mixer_add_source(struct monitor_mixer *mixer,
+		obs_source_t *source);
+extern void monitor_mixer_remove_source(struct monitor_mixer *mixer,
+		obs_source_t *source);
+extern size_t monitor_mixer_num_sources(struct monitor_mixer *mixer);
+
+/**
+ * Mixes the next 'frames' frames of audio.  The planes of 'out' point to
+ * buffers owned by the mixer that stay valid until the next call.
+ *
+ * @return  Number of sources that contributed audio
+ */
+extern size_t monitor_mixer_mix(struct monitor_mixer *mixer,
+		uint8_t *out[MAX_AV_PLANES], size_t frames);
+
+extern void monitor_mixer_get_stats(struct monitor_mixer *mixer,
+		struct monitor_mixer_stats *stats);
@@ -0,0 +1,179 @@
+#include <obs-internal.h>
+#include <inttypes.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "../monitor-mixer.h"
+
+#define blog(level, msg, ...) blog(level, "null-am: " msg, ##__VA_ARGS__)
+
+/*
+ *   Monitoring backend without a device: monitored sources are mixed at the
+ * pace of a real device and the result is thrown away.  Only built with
+ * LIBOBS_NULL_AUDIO_MONITORING, for automated tests, where it exercises the
+ * same mixing path as a real backend.
+ */
+
+/* mix in 10ms chunks */
+#define NULL_MIX_INTERVAL_NS 10000000ULL
+
+struct null_output {
+	struct monitor_mixer *mixer;
+	size_t               mix_frames;
+
+	pthread_t            thread;
+	bool                 thread_valid;
+	os_event_t           *stop_event;
+
+	uint64_t             frames;
+	long                 refs;
+};
+
+struct audio_monitor {
+	obs_source_t         *source;
+	bool                 attached;
+};
+
+/* protected by obs->audio.monitoring_mutex */
+static struct null_output *output = NULL;
+
+void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb, void *data)
+{
+	UNUSED_PARAMETER(cb);
+	UNUSED_PARAMETER(data);
+}
+
+static void *null_output_thread(void *param)
+{
+	struct null_output *out = param;
+	uint8_t *mix[MAX_AV_PLANES] = {0};
+	uint64_t next_ts = os_gettime_ns();
+
+	os_set_thread_name("null-am: mix");
+
+	while (os_event_try(out->stop_event) == EAGAIN) {
+		monitor_mixer_mix(out->mixer, mix, out->mix_frames);
+		out->frames += out->mix_frames;
+
+		next_ts += NULL_MIX_INTERVAL_NS;
+		os_sleepto_ns(next_ts);
+	}
+
+	return NULL;
+}
+
+static void null_output_destroy(struct null_output *out)
+{
+	struct monitor_mixer_stats stats;
+
+	if (out->thread_valid) {
+		os_event_signal(out->stop_event);
+		pthread_join(out->thread, NULL);
+	}
+
+	if (out->mixer) {
+		monitor_mixer_get_stats(out->mixer, &stats);
+		blog(LOG_INFO, "Stopped monitoring: mixed %"PRIu64" frames, "
+				"dropped %"PRIu64" source frames, "
+				"%"PRIu64" realignments",
+				out->frames, stats.frames_dropped,
+				stats.realigns);
+		monitor_mixer_destroy(out->mixer);
+	}
+
+	os_event_destroy(out->stop_event);
+	bfree(out);
+}
+
+static struct null_output *null_output_get(void)
+{
+	struct null_output *out;
+	const struct audio_output_info *info;
+
+	if (output) {
+		output->refs++;
+		return output;
+	}
+
+	out = bzalloc(sizeof(struct null_output));
+	out->refs = 1;
+
+	info = audio_output_get_info(obs->audio.audio);
+	out->mix_frames = info->samples_per_sec / 100;
+
+	out->mixer = monitor_mixer_create();
+	if (!out->mixer)
+		goto fail;
+	if (os_event_init(&out->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+	if (pthread_create(&out->thread, NULL, null_output_thread, out) != 0)
+		goto fail;
+
+	out->thread_valid = true;
+	output = out;
+
+	blog(LOG_INFO, "Started monitoring");
+	return out;
+
+fail:
+	blog(LOG_WARNING, "Failed to start monitoring");
+	null_output_destroy(out);
+	return NULL;
+}
+
+static void null_output_release(void)
+{
+	if (--output->refs == 0) {
+		null_output_destroy(output);
+		output = NULL;
+	}
+}
+
+static void audio_monitor_attach(struct audio_monitor *monitor)
+{
+	struct null_output *out = null_output_get();
+	if (!out)
+		return;
+
+	monitor_mixer_add_source(out->mixer, monitor->source);
+	monitor->attached = true;
+}
+
+static void audio_monitor_detach(struct audio_monitor *monitor)
+{
+	if (monitor->attached) {
+		monitor_mixer_remove_source(output->mixer, monitor->source);
+		null_output_release();
+		monitor->attached = false;
+	}
+}
+
+struct audio_monitor *audio_monitor_create(obs_source_t *source)
+{
+	struct audio_monitor *monitor = bzalloc(sizeof(struct audio_monitor));
+	monitor->source = source;
+
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+	audio_monitor_attach(monitor);
+	da_push_back(obs->audio.monitors, &monitor);
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+	return monitor;
+}
+
+void audio_monitor_reset(struct audio_monitor *monitor)
+{
+	/* there is only ever one device, so there is nothing to move */
+	UNUSED_PARAMETER(monitor);
+}
+
+void audio_monitor_destroy(struct audio_monitor *monitor)
+{
+	if (monitor) {
+		pthread_mutex_lock(&obs->audio.monitoring_mutex);
+		audio_monitor_detach(monitor);
+		da_erase_item(obs->audio.monitors, &monitor);
+		pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+		bfree(monitor);
+	}
+}
@@ -1,33 +1,40 @@
 #include "obs-internal.h"
 #include "pulseaudio-wrapper.h"
+#include "../monitor-mixer.h"
 
-#define PULSE_DATA(voidptr) struct audio_monitor *data = voidptr;
+#define PULSE_DATA(voidptr) struct pulse_output *data = voidptr;
 #define blog(level, msg, ...) blog(level, "pulse-am: " msg, ##__VA_ARGS__)
 
-struct audio_monitor {
-	obs_source_t 		*source;
-	pa_stream    		*stream;
-	char         		*device;
+/* All monitored sources are mixed in to a single stream per device */
+struct pulse_output {
+	char 			*id;
+	char 			*device;
+	pa_stream 		*stream;
 	pa_buffer_attr 		attr;
 	enum speaker_layout 	speakers;
-	pa_sample_format_t  	format;
-	uint_fast32_t       	samples_per_sec;
-	uint_fast32_t       	bytes_per_frame;
-	uint_fast8_t        	channels;
+	pa_sample_format_t 	format;
+	uint_fast32_t 		samples_per_sec;
+	uint_fast32_t 		bytes_per_frame;
+	uint_fast8_t 		channels;
 
-	uint_fast32_t 		packets;
 	uint_fast64_t 		frames;
 
-	struct circlebuf  	new_data;
+	struct monitor_mixer 	*mixer;
+	size_t 			mix_frames;
 	audio_resampler_t 	*resampler;
-	size_t            	buffer_size;
-	size_t            	bytesRemaining;
-	size_t          	bytes_per_channel;
+	struct circlebuf 	new_data;
 
-	bool 			ignore;
-	pthread_mutex_t 	playback_mutex;
+	long 			refs;
 };
 
+struct audio_monitor {
+	obs_source_t 		*source;
+	struct pulse_output 	*output;
+};
+
+/* protected by obs->audio.monitoring_mutex */
+static DARRAY(struct pulse_output*) outputs;
+
 static enum speaker_layout pulseaudio_channels_to_obs_speakers(
 		uint_fast32_t channels)
 {
@@ -116,147 +123,64 @@ static pa_channel_map pulseaudio_channel_map(enum speaker_layout layout)
 	return ret;
 }
 
-static void process_byte(void *p, size_t frames, size_t channels, float vol)
+static void fill_output_data(struct pulse_output *output, size_t bytes)
 {
-	register char *cur = (char *) p;
-	register char *end = cur + frames * channels;
-
-	while (cur < end)
-		*(cur++) *= vol;
-}
-
-static void process_short(void *p, size_t frames, size_t channels, float vol)
-{
-	register short *cur = (short *) p;
-	register short *end = cur + frames * channels;
-
-	while (cur < end)
-		*(cur++) *= vol;
-}
-
-static void process_float(void *p, size_t frames, size_t channels, float vol)
-{
-	register float *cur = (float *) p;
-	register float *end = cur + frames * channels;
-
-	while (cur < end)
-		*(cur++) *= vol;
-}
-
-void process_volume(const struct audio_monitor *monitor, float vol,
-		uint8_t *const *resample_data, uint32_t resample_frames)
-{
-	switch (monitor->bytes_per_channel) {
-	case 1:
-		process_byte(resample_data[0], resample_frames,
-				monitor->channels, vol);
-		break;
-	case 2:
-		process_short(resample_data[0], resample_frames,
-				monitor->channels, vol);
-		break;
-	default:
-		process_float(resample_data[0], resample_frames,
-				monitor->channels, vol);
-		break;
-	}
-}
-
-static void do_stream_write(void *param)
-{
-	PULSE_DATA(param);
-	uint8_t *buffer = NULL;
-
-	while (data->new_data.size >= data->buffer_size &&
-			data->bytesRemaining > 0) {
-		size_t bytesToFill = data->buffer_size;
-
-		if (bytesToFill > data->bytesRemaining)
-			bytesToFill = data->bytesRemaining;
-
-		pa_stream_begin_write(data->stream, (void **) &buffer,
-				&bytesToFill);
-
-		circlebuf_pop_front(&data->new_data, buffer, bytesToFill);
-
-		pulseaudio_lock();
-		pa_stream_write(data->stream, buffer, bytesToFill, NULL,
-				0LL, PA_SEEK_RELATIVE);
-		pulseaudio_unlock();
-
-		data->bytesRemaining -= bytesToFill;
-	}
-}
-
-static void on_audio_playback(void *param, obs_source_t *source,
-		const struct audio_data *audio_data, bool muted)
-{
-	struct audio_monitor *monitor = param;
-	float vol = source->user_volume;
-	size_t bytes;
-
+	uint8_t *mix[MAX_AV_PLANES] = {0};
 	uint8_t *resample_data[MAX_AV_PLANES];
 	uint32_t resample_frames;
 	uint64_t ts_offset;
 	bool success;
 
-	if (pthread_mutex_trylock(&monitor->playback_mutex) != 0)
-		return;
-
-	if (os_atomic_load_long(&source->activate_refs) == 0)
-		goto unlock;
-
-	success = audio_resampler_resample(monitor->resampler, resample_data,
-			&resample_frames, &ts_offset,
-			(const uint8_t *const *) audio_data->data,
-			(uint32_t) audio_data->frames);
-
-	if (!success)
-		goto unlock;
-
-	bytes = monitor->bytes_per_frame * resample_frames;
-
-	if (muted) {
-		memset(resample_data[0], 0, bytes);
-	} else {
-		if (!close_float(vol, 1.0f, EPSILON)) {
-			process_volume(monitor, vol, resample_data,
-					resample_frames);
+	while (output->new_data.size < bytes) {
+		monitor_mixer_mix(output->mixer, mix, output->mix_frames);
+
+		success = audio_resampler_resample(output->resampler,
+				resample_data, &resample_frames, &ts_offset,
+				(const uint8_t *const *) mix,
+				(uint32_t) output->mix_frames);
+		if (!success) {
+			circlebuf_push_back_zero(&output->new_data,
+					bytes - output->new_data.size);
+			break;
 		}
-	}
-
-	circlebuf_push_back(&monitor->new_data, resample_data[0], bytes);
-	monitor->packets++;
-	monitor->frames += resample_frames;
 
-unlock:
-	pthread_mutex_unlock(&monitor->playback_mutex);
-	do_stream_write(param);
+		circlebuf_push_back(&output->new_data, resample_data[0],
+				resample_frames * output->bytes_per_frame);
+	}
 }
 
 static void pulseaudio_stream_write(pa_stream *p, size_t nbytes, void *userdata)
 {
-	UNUSED_PARAMETER(p);
 	PULSE_DATA(userdata);
+	uint8_t *buffer = NULL;
+
+	while (nbytes > 0) {
+		size_t bytes = nbytes;
+
+		if (pa_stream_begin_write(p, (void **) &buffer, &bytes) < 0 ||
+		    !bytes)
+			break;
 
-	pthread_mutex_lock(&data->playback_mutex);
-	data->bytesRemaining += nbytes;
-	pthread_mutex_unlock(&data->playback_mutex);
+		fill_output_data(data, bytes);
+		circlebuf_pop_front(&data->new_data, buffer, bytes);
+
+		pa_stream_write(p, buffer, bytes, NULL, 0LL, PA_SEEK_RELATIVE);
+
+		data->frames += bytes / data->bytes_per_frame;
+		nbytes -= bytes;
+	}
 
 	pulseaudio_signal(0);
 }
 
 static void pulseaudio_underflow(pa_stream *p, void *userdata)
 {
-	UNUSED_PARAMETER(p);
 	PULSE_DATA(userdata);
 
-	pthread_mutex_lock(&data->playback_mutex);
-	if (obs_source_active(data->source))
+	if (monitor_mixer_num_sources(data->mixer))
 		data->attr.tlength = (data->attr.tlength * 3) / 2;
 
-	pa_stream_set_buffer_attr(data->stream, &data->attr, NULL, NULL);
-	pthread_mutex_unlock(&data->playback_mutex);
+	pa_stream_set_buffer_attr(p, &data->attr, NULL, NULL);
 
 	pulseaudio_signal(0);
 }
@@ -319,78 +243,72 @@ skip:
 	pulseaudio_signal(0);
 }
 
-static void pulseaudio_stop_playback(struct audio_monitor *monitor)
+static void pulse_output_destroy(struct pulse_output *output)
 {
-	if (monitor->stream) {
-		pa_stream_disconnect(monitor->stream);
-		pa_stream_unref(monitor->stream);
-		monitor->stream = NULL;
-	}
+	struct monitor_mixer_stats stats;
 
-	blog(LOG_INFO, "Stopped Monitoring in '%s'", monitor->device);
-	blog(LOG_INFO, "Got %"PRIuFAST32" packets with %"PRIuFAST64" frames",
-			monitor->packets, monitor->frames);
-
-	monitor->packets = 0;
-	monitor->frames = 0;
-}
-
-static bool audio_monitor_init(struct audio_monitor *monitor,
-		obs_source_t *source)
-{
-	pthread_mutex_init_value(&monitor->playback_mutex);
+	if (output->stream) {
+		pulseaudio_lock();
+		pa_stream_set_write_callback(output->stream, NULL, NULL);
+		pa_stream_set_underflow_callback(output->stream, NULL, NULL);
+		pa_stream_disconnect(output->stream);
+		pa_stream_unref(output->stream);
+		pulseaudio_unlock();
 
-	monitor->source = source;
+		blog(LOG_INFO, "Stopped Monitoring in '%s'", output->device);
+	}
 
-	const char *id = obs->audio.monitoring_device_id;
-	if (!id)
-		return false;
+	if (output->mixer) {
+		monitor_mixer_get_stats(output->mixer, &stats);
+		blog(LOG_INFO, "Wrote %"PRIuFAST64" frames, dropped %"PRIu64
+				" source frames, %"PRIu64" realignments",
+				output->frames, stats.frames_dropped,
+				stats.realigns);
+		monitor_mixer_destroy(output->mixer);
+	}
 
-	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
-		obs_data_t *s = obs_source_get_settings(source);
-		const char *s_dev_id = obs_data_get_string(s, "device_id");
-		bool match = devices_match(s_dev_id, id);
-		obs_data_release(s);
+	audio_resampler_destroy(output->resampler);
+	circlebuf_free(&output->new_data);
+	pulseaudio_unref();
 
-		if (match) {
-			monitor->ignore = true;
-			blog(LOG_INFO, "Prevented feedback-loop in '%s'",
-					s_dev_id);
-			return true;
-		}
-	}
+	bfree(output->device);
+	bfree(output->id);
+	bfree(output);
+}
 
-	pulseaudio_init();
+static bool pulse_output_init(struct pulse_output *output)
+{
+	const char *id = output->id;
 
 	if (strcmp(id, "default") == 0)
-		get_default_id(&monitor->device);
+		get_default_id(&output->device);
 	else
-		monitor->device = bstrdup(id);
+		output->device = bstrdup(id);
 
-	if (!monitor->device)
+	if (!output->device)
 		return false;
 
 	if (pulseaudio_get_server_info(pulseaudio_server_info,
-			(void *) monitor) < 0) {
+			(void *) output) < 0) {
 		blog(LOG_ERROR, "Unable to get server info !");
 		return false;
 	}
 
-	if (pulseaudio_get_source_info(pulseaudio_source_info, monitor->device,
-			(void *) monitor) < 0) {
+	if (pulseaudio_get_source_info(pulseaudio_source_info, output->device,
+			(void *) output) < 0) {
 		blog(LOG_ERROR, "Unable to get source info !");
 		return false;
 	}
-	if (monitor->format == PA_SAMPLE_INVALID) {
+	if (output->format == PA_SAMPLE_INVALID) {
 		blog(LOG_ERROR,
 				"An error occurred while getting the source info!");
 		return false;
 	}
 
 	pa_sample_spec spec;
-	spec.format = monitor->format;
-	spec.rate = (uint32_t) monitor->samples_per_sec;
-	spec.channels = monitor->channels;
+	spec.format = output->format;
+	spec.rate = (uint32_t) output->samples_per_sec;
+	spec.channels = output->channels;
 
 	if (!pa_sample_spec_valid(&spec)) {
 		blog(LOG_ERROR, "Sample spec is not valid");
@@ -406,144 +324,164 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 		.format		 = AUDIO_FORMAT_FLOAT_PLANAR
 	};
 	struct resample_info to = {
-		.samples_per_sec = (uint32_t) monitor->samples_per_sec,
+		.samples_per_sec = (uint32_t) output->samples_per_sec,
 		.speakers	 = pulseaudio_channels_to_obs_speakers(
-				monitor->channels),
+				output->channels),
 		.format 	 = pulseaudio_to_obs_audio_format
-				(monitor->format)
+				(output->format)
 	};
 
-	monitor->resampler = audio_resampler_create(&to, &from);
-	if (!monitor->resampler) {
+	output->resampler = audio_resampler_create(&to, &from);
+	if (!output->resampler) {
 		blog(LOG_WARNING, "%s: %s", __FUNCTION__,
 				"Failed to create resampler");
 		return false;
 	}
 
-	monitor->bytes_per_channel = get_audio_bytes_per_channel(
-			pulseaudio_to_obs_audio_format(monitor->format));
-	monitor->speakers = pulseaudio_channels_to_obs_speakers(spec.channels);
-	monitor->bytes_per_frame = pa_frame_size(&spec);
+	output->mixer = monitor_mixer_create();
+	if (!output->mixer)
+		return false;
+
+	/* mix in 5ms chunks */
+	output->mix_frames = info->samples_per_sec / 200;
+
+	output->speakers = pulseaudio_channels_to_obs_speakers(spec.channels);
+	output->bytes_per_frame = pa_frame_size(&spec);
 
-	pa_channel_map channel_map = pulseaudio_channel_map(monitor->speakers);
+	pa_channel_map channel_map = pulseaudio_channel_map(output->speakers);
 
-	monitor->stream = pulseaudio_stream_new(
-		obs_source_get_name(monitor->source), &spec, &channel_map);
-	if (!monitor->stream) {
+	output->stream = pulseaudio_stream_new("Audio Monitoring", &spec,
+			&channel_map);
+	if (!output->stream) {
 		blog(LOG_ERROR, "Unable to create stream");
 		return false;
 	}
 
-	monitor->attr.fragsize = (uint32_t) -1;
-	monitor->attr.maxlength = (uint32_t) -1;
-	monitor->attr.minreq = (uint32_t) -1;
-	monitor->attr.prebuf = (uint32_t) -1;
-	monitor->attr.tlength = pa_usec_to_bytes(25000, &spec);
-
-	monitor->buffer_size = monitor->bytes_per_frame *
-			pa_usec_to_bytes(5000, &spec);
+	output->attr.fragsize = (uint32_t) -1;
+	output->attr.maxlength = (uint32_t) -1;
+	output->attr.minreq = (uint32_t) -1;
+	output->attr.prebuf = (uint32_t) -1;
+	output->attr.tlength = pa_usec_to_bytes(25000, &spec);
 
 	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING |
 			PA_STREAM_AUTO_TIMING_UPDATE;
 
-	if (pthread_mutex_init(&monitor->playback_mutex, NULL) != 0) {
-		blog(LOG_WARNING, "%s: %s", __FUNCTION__,
-				"Failed to init mutex");
-		return false;
-	}
+	pulseaudio_write_callback(output->stream, pulseaudio_stream_write,
+			(void *) output);
 
-	int_fast32_t ret = pulseaudio_connect_playback(monitor->stream,
-			monitor->device, &monitor->attr, flags);
+	pulseaudio_set_underflow_callback(output->stream, pulseaudio_underflow,
+			(void *) output);
+
+	int_fast32_t ret = pulseaudio_connect_playback(output->stream,
+			output->device, &output->attr, flags);
 	if (ret < 0) {
-		pulseaudio_stop_playback(monitor);
 		blog(LOG_ERROR, "Unable to connect to stream");
 		return false;
 	}
 
-	blog(LOG_INFO, "Started Monitoring in '%s'", monitor->device);
+	blog(LOG_INFO, "Started Monitoring in '%s'", output->device);
 	return true;
 }
 
-static void audio_monitor_init_final(struct audio_monitor *monitor)
+static struct pulse_output *pulse_output_get(const char *id)
 {
-	if (monitor->ignore)
-		return;
+	struct pulse_output *output;
+
+	for (size_t i = 0; i < outputs.num; i++) {
+		output = outputs.array[i];
+		if (strcmp(output->id, id) == 0) {
+			output->refs++;
+			return output;
+		}
+	}
+
+	pulseaudio_init();
 
-	obs_source_add_audio_capture_callback(monitor->source,
-			on_audio_playback, monitor);
+	output = bzalloc(sizeof(struct pulse_output));
+	output->id = bstrdup(id);
+	output->refs = 1;
 
-	pulseaudio_write_callback(monitor->stream, pulseaudio_stream_write,
-			(void *) monitor);
+	if (!pulse_output_init(output)) {
+		pulse_output_destroy(output);
+		return NULL;
+	}
 
-	pulseaudio_set_underflow_callback(monitor->stream, pulseaudio_underflow,
-			(void *) monitor);
+	da_push_back(outputs, &output);
+	return output;
 }
 
-static inline void audio_monitor_free(struct audio_monitor *monitor)
+static void pulse_output_release(struct pulse_output *output)
 {
-	if (monitor->ignore)
+	if (--output->refs == 0) {
+		da_erase_item(outputs, &output);
+		if (!outputs.num)
+			da_free(outputs);
+
+		pulse_output_destroy(output);
+	}
+}
+
+static void audio_monitor_attach(struct audio_monitor *monitor)
+{
+	obs_source_t *source = monitor->source;
+	const char *id = obs->audio.monitoring_device_id;
+	if (!id)
 		return;
 
-	if (monitor->source)
-		obs_source_remove_audio_capture_callback(monitor->source,
-				on_audio_playback, monitor);
+	if (source->info.output_flags & OBS_SOURCE_DO_NOT_SELF_MONITOR) {
+		obs_data_t *s = obs_source_get_settings(source);
+		const char *s_dev_id = obs_data_get_string(s, "device_id");
+		bool match = devices_match(s_dev_id, id);
+		obs_data_release(s);
 
-	audio_resampler_destroy(monitor->resampler);
-	circlebuf_free(&monitor->new_data);
+		if (match) {
+			blog(LOG_INFO, "Prevented feedback-loop in '%s'",
+					s_dev_id);
+			return;
+		}
+	}
 
-	if (monitor->stream)
-		pulseaudio_stop_playback(monitor);
-	pulseaudio_unref();
+	monitor->output = pulse_output_get(id);
+	if (monitor->output)
+		monitor_mixer_add_source(monitor->output->mixer, source);
+}
 
-	bfree(monitor->device);
+static void audio_monitor_detach(struct audio_monitor *monitor)
+{
+	if (monitor->output) {
+		monitor_mixer_remove_source(monitor->output->mixer,
+				monitor->source);
+		pulse_output_release(monitor->output);
+		monitor->output = NULL;
+	}
 }
 
 struct audio_monitor *audio_monitor_create(obs_source_t *source)
 {
-	struct audio_monitor monitor = {0};
-	struct audio_monitor *out;
-
-	if (!audio_monitor_init(&monitor, source))
-		goto fail;
-
-	out = bmemdup(&monitor, sizeof(monitor));
+	struct audio_monitor *monitor = bzalloc(sizeof(struct audio_monitor));
+	monitor->source = source;
 
 	pthread_mutex_lock(&obs->audio.monitoring_mutex);
-	da_push_back(obs->audio.monitors, &out);
+	audio_monitor_attach(monitor);
+	da_push_back(obs->audio.monitors, &monitor);
 	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
 
-	audio_monitor_init_final(out);
-	return out;
-
-fail:
-	audio_monitor_free(&monitor);
-	return NULL;
+	return monitor;
 }
 
 void audio_monitor_reset(struct audio_monitor *monitor)
 {
-	struct audio_monitor new_monitor = {0};
-	bool success;
-	audio_monitor_free(monitor);
-
-	pthread_mutex_lock(&monitor->playback_mutex);
-	success = audio_monitor_init(&new_monitor, monitor->source);
-	pthread_mutex_unlock(&monitor->playback_mutex);
-
-	if (success) {
-		*monitor = new_monitor;
-		audio_monitor_init_final(monitor);
-	} else {
-		audio_monitor_free(&new_monitor);
-	}
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+	audio_monitor_detach(monitor);
+	audio_monitor_attach(monitor);
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
 }
 
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
-		audio_monitor_free(monitor);
-
 		pthread_mutex_lock(&obs->audio.monitoring_mutex);
+		audio_monitor_detach(monitor);
 		da_erase_item(obs->audio.monitors, &monitor);
 		pthread_mutex_unlock(&obs->audio.monitoring_mutex);
 
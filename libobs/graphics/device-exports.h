@@ -39,6 +39,7 @@ EXPORT void device_resize(gs_device_t *device, uint32_t x, uint32_t y);
 EXPORT void device_get_size(const gs_device_t *device, uint32_t *x, uint32_t *y);
 EXPORT uint32_t device_get_width(const gs_device_t *device);
 EXPORT uint32_t device_get_height(const gs_device_t *device);
+EXPORT uint32_t device_get_rebuild_count(const gs_device_t *device);
 EXPORT gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
 		uint32_t height, enum gs_color_format color_format,
 		uint32_t levels, const uint8_t **data, uint32_t flags);
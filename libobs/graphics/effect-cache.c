@@ -0,0 +1,482 @@
+/******************************************************************************
+    Copyright (C) 2017 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+#include "../util/file-serializer.h"
+#include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/crc32.h"
+#include "../util/dstr.h"
+#include "graphics-internal.h"
+#include "effect-cache.h"
+#include "effect.h"
+
+/*
+ *   Cached effects store the output of the effect parser: the effect params
+ * and, for every technique pass, the generated vertex/pixel shader text and
+ * the names of the effect params that each shader uses.  Loading an effect
+ * from the cache skips lexing, preprocessing and parsing the effect file;
+ * only the backend shader compile remains.
+ *
+ *   Cache files are keyed by effect path and graphics backend, and are only
+ * used if the effect file and every file it includes are unchanged.
+ */
+
+#define EFFECT_CACHE_MAGIC   "OBSEFFC"
+#define EFFECT_CACHE_VERSION 1
+
+extern const char *gs_preprocessor_name(void);
+extern void gs_effect_actually_destroy(gs_effect_t *effect);
+
+static pthread_mutex_t cache_dir_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char *cache_dir = NULL;
+
+void gs_effect_cache_set_dir(const char *dir)
+{
+	pthread_mutex_lock(&cache_dir_mutex);
+	bfree(cache_dir);
+	cache_dir = (dir && *dir) ? bstrdup(dir) : NULL;
+	if (cache_dir && os_mkdirs(cache_dir) == MKDIR_ERROR) {
+		blog(LOG_WARNING, "Failed to create effect cache "
+				"directory '%s'", cache_dir);
+		bfree(cache_dir);
+		cache_dir = NULL;
+	}
+	pthread_mutex_unlock(&cache_dir_mutex);
+}
+
+static inline uint64_t hash_str64(uint64_t hash, const char *str)
+{
+	while (*str) {
+		hash ^= (uint8_t)*(str++);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static bool get_cache_file(struct dstr *path, const char *file,
+		const char *backend)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	pthread_mutex_lock(&cache_dir_mutex);
+	if (cache_dir) {
+		hash = hash_str64(hash, backend);
+		hash = hash_str64(hash, "|");
+		hash = hash_str64(hash, file);
+
+		dstr_printf(path, "%s/%016"PRIx64".effc", cache_dir, hash);
+	}
+	pthread_mutex_unlock(&cache_dir_mutex);
+
+	return path->len != 0;
+}
+
+static inline const char *get_backend_name(void)
+{
+	const char *name = gs_preprocessor_name();
+	return name ? name : "";
+}
+
+/* ------------------------------------------------------------------------- */
+/* writing */
+
+static inline void write_str(struct serializer *s, const char *str)
+{
+	uint32_t len = str ? (uint32_t)strlen(str) : 0;
+	s_wl32(s, len);
+	s_write(s, str, len);
+}
+
+static inline void write_file_check(struct serializer *s, const char *text)
+{
+	size_t len = text ? strlen(text) : 0;
+	s_wl32(s, (uint32_t)len);
+	s_wl32(s, calc_crc32(0, text, len));
+}
+
+static void write_shader(struct serializer *s, const char *shader,
+		const char **params, size_t num_params)
+{
+	write_str(s, shader);
+	s_wl32(s, (uint32_t)num_params);
+	for (size_t i = 0; i < num_params; i++)
+		write_str(s, params[i]);
+}
+
+void effect_cache_save(struct effect_parser *ep, const char *file,
+		const char *effect_string)
+{
+	struct cf_preprocessor *pp = &ep->cfp.pp;
+	gs_effect_t *effect = ep->effect;
+	struct serializer s;
+	struct dstr path = {0};
+
+	if (!file || !get_cache_file(&path, file, get_backend_name()))
+		return;
+
+	if (!file_output_serializer_init_safe(&s, path.array, "tmp")) {
+		blog(LOG_DEBUG, "Failed to write effect cache for '%s'",
+				file);
+		dstr_free(&path);
+		return;
+	}
+
+	s_write(&s, EFFECT_CACHE_MAGIC, sizeof(EFFECT_CACHE_MAGIC));
+	s_wl32(&s, EFFECT_CACHE_VERSION);
+	write_str(&s, get_backend_name());
+	write_str(&s, file);
+	write_file_check(&s, effect_string);
+
+	s_wl32(&s, (uint32_t)pp->dependencies.num);
+	for (size_t i = 0; i < pp->dependencies.num; i++) {
+		struct cf_lexer *dep = pp->dependencies.array + i;
+		write_str(&s, dep->file);
+		write_file_check(&s, dep->base_lexer.text);
+	}
+
+	s_wl32(&s, (uint32_t)effect->params.num);
+	for (size_t i = 0; i < effect->params.num; i++) {
+		struct gs_effect_param *param = effect->params.array + i;
+
+		write_str(&s, param->name);
+		s_wl32(&s, (uint32_t)param->type);
+		s_wl32(&s, (uint32_t)param->default_val.num);
+		s_write(&s, param->default_val.array,
+				param->default_val.num);
+	}
+
+	s_wl32(&s, (uint32_t)ep->techniques.num);
+	for (size_t i = 0; i < ep->techniques.num; i++) {
+		struct ep_technique *tech = ep->techniques.array + i;
+
+		write_str(&s, tech->name);
+		s_wl32(&s, (uint32_t)tech->passes.num);
+
+		for (size_t j = 0; j < tech->passes.num; j++) {
+			struct ep_pass *pass = tech->passes.array + j;
+
+			write_str(&s, pass->name);
+			write_shader(&s, pass->vertex_shader,
+					(const char**)pass->vertex_params.array,
+					pass->vertex_params.num);
+			write_shader(&s, pass->pixel_shader,
+					(const char**)pass->pixel_params.array,
+					pass->pixel_params.num);
+		}
+	}
+
+	file_output_serializer_free(&s);
+	dstr_free(&path);
+}
+
+/* ------------------------------------------------------------------------- */
+/* reading */
+
+struct cache_reader {
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+	bool error;
+};
+
+static inline const uint8_t *read_data(struct cache_reader *r, size_t size)
+{
+	const uint8_t *data;
+
+	if (r->error || size > r->size - r->pos) {
+		r->error = true;
+		return NULL;
+	}
+
+	data = r->data + r->pos;
+	r->pos += size;
+	return data;
+}
+
+static inline uint32_t read_u32(struct cache_reader *r)
+{
+	const uint8_t *d = read_data(r, 4);
+	if (!d)
+		return 0;
+
+	return (uint32_t)d[0]        | ((uint32_t)d[1] << 8) |
+	       ((uint32_t)d[2] << 16) | ((uint32_t)d[3] << 24);
+}
+
+/* returns a newly allocated string */
+static char *read_str(struct cache_reader *r)
+{
+	uint32_t len = read_u32(r);
+	const uint8_t *data = read_data(r, len);
+	char *str;
+
+	if (!data)
+		return NULL;
+
+	str = bmalloc(len + 1);
+	memcpy(str, data, len);
+	str[len] = 0;
+	return str;
+}
+
+static bool read_str_matches(struct cache_reader *r, const char *expected)
+{
+	uint32_t len = read_u32(r);
+	const uint8_t *data = read_data(r, len);
+
+	return data && len == strlen(expected) &&
+		memcmp(data, expected, len) == 0;
+}
+
+static bool read_file_check(struct cache_reader *r, const char *text)
+{
+	size_t len = text ? strlen(text) : 0;
+	uint32_t cached_len = read_u32(r);
+	uint32_t cached_crc = read_u32(r);
+
+	return !r->error && cached_len == (uint32_t)len &&
+		cached_crc == calc_crc32(0, text, len);
+}
+
+static bool dependencies_unchanged(struct cache_reader *r)
+{
+	uint32_t num = read_u32(r);
+
+	for (uint32_t i = 0; i < num && !r->error; i++) {
+		char *dep_file = read_str(r);
+		char *dep_text = dep_file ?
+			os_quick_read_utf8_file(dep_file) : NULL;
+		bool unchanged = dep_text && read_file_check(r, dep_text);
+
+		bfree(dep_file);
+		bfree(dep_text);
+
+		if (!unchanged)
+			return false;
+	}
+
+	return !r->error;
+}
+
+static void read_params(struct cache_reader *r, gs_effect_t *effect)
+{
+	uint32_t num = read_u32(r);
+
+	if (r->error || num > r->size)
+		return;
+
+	da_resize(effect->params, num);
+
+	for (uint32_t i = 0; i < num && !r->error; i++) {
+		struct gs_effect_param *param = effect->params.array + i;
+		uint32_t default_size;
+		const uint8_t *default_val;
+
+		param->name    = read_str(r);
+		param->section = EFFECT_PARAM;
+		param->effect  = effect;
+		param->type    = (enum gs_shader_param_type)read_u32(r);
+
+		default_size = read_u32(r);
+		default_val = read_data(r, default_size);
+		if (default_val && default_size)
+			da_push_back_array(param->default_val, default_val,
+					default_size);
+
+		if (!param->name)
+			continue;
+
+		if (strcmp(param->name, "ViewProj") == 0)
+			effect->view_proj = param;
+		else if (strcmp(param->name, "World") == 0)
+			effect->world = param;
+	}
+}
+
+static gs_shader_t *read_shader(struct cache_reader *r, gs_effect_t *effect,
+		const char *tech_name, size_t pass_idx,
+		enum gs_shader_type type, struct darray *pass_params)
+{
+	char *shader_str = read_str(r);
+	uint32_t num_params = read_u32(r);
+	gs_shader_t *shader = NULL;
+	struct dstr location = {0};
+
+	if (r->error || !shader_str || num_params > r->size)
+		goto fail;
+
+	dstr_printf(&location, "%s (%s shader, technique %s, pass %u)",
+			effect->effect_path,
+			type == GS_SHADER_VERTEX ? "Vertex" : "Pixel",
+			tech_name, (unsigned)pass_idx);
+
+	shader = (type == GS_SHADER_VERTEX) ?
+		gs_vertexshader_create(shader_str, location.array, NULL) :
+		gs_pixelshader_create(shader_str, location.array, NULL);
+	if (!shader)
+		goto fail;
+
+	darray_resize(sizeof(struct pass_shaderparam), pass_params,
+			num_params);
+
+	for (uint32_t i = 0; i < num_params; i++) {
+		struct pass_shaderparam *param = darray_item(
+				sizeof(struct pass_shaderparam),
+				pass_params, i);
+		char *name = read_str(r);
+
+		if (!name)
+			goto fail;
+
+		param->eparam = gs_effect_get_param_by_name(effect, name);
+		param->sparam = gs_shader_get_param_by_name(shader, name);
+		bfree(name);
+
+		if (!param->sparam)
+			goto fail;
+	}
+
+	dstr_free(&location);
+	bfree(shader_str);
+	return shader;
+
+fail:
+	r->error = true;
+	dstr_free(&location);
+	bfree(shader_str);
+	return shader;
+}
+
+static void read_techniques(struct cache_reader *r, gs_effect_t *effect)
+{
+	uint32_t num = read_u32(r);
+
+	if (r->error || num > r->size)
+		return;
+
+	da_resize(effect->techniques, num);
+
+	for (uint32_t i = 0; i < num && !r->error; i++) {
+		struct gs_effect_technique *tech = effect->techniques.array + i;
+		uint32_t num_passes;
+
+		tech->name    = read_str(r);
+		tech->section = EFFECT_TECHNIQUE;
+		tech->effect  = effect;
+
+		num_passes = read_u32(r);
+		if (r->error || !tech->name || num_passes > r->size) {
+			r->error = true;
+			return;
+		}
+
+		da_resize(tech->passes, num_passes);
+
+		for (uint32_t j = 0; j < num_passes && !r->error; j++) {
+			struct gs_effect_pass *pass = tech->passes.array + j;
+
+			pass->name    = read_str(r);
+			pass->section = EFFECT_PASS;
+
+			pass->vertshader = read_shader(r, effect, tech->name,
+					j, GS_SHADER_VERTEX,
+					&pass->vertshader_params.da);
+			pass->pixelshader = read_shader(r, effect, tech->name,
+					j, GS_SHADER_PIXEL,
+					&pass->pixelshader_params.da);
+		}
+	}
+}
+
+static uint8_t *read_cache_file(const char *path, size_t *size)
+{
+	int64_t file_size = os_get_file_size(path);
+	uint8_t *data;
+	FILE *f;
+
+	if (file_size <= 0)
+		return NULL;
+
+	f = os_fopen(path, "rb");
+	if (!f)
+		return NULL;
+
+	data = bmalloc((size_t)file_size);
+	if (fread(data, 1, (size_t)file_size, f) != (size_t)file_size) {
+		bfree(data);
+		data = NULL;
+	}
+
+	fclose(f);
+	*size = (size_t)file_size;
+	return data;
+}
+
+gs_effect_t *effect_cache_load(const char *file, const char *effect_string)
+{
+	struct cache_reader r = {0};
+	struct dstr path = {0};
+	gs_effect_t *effect = NULL;
+	const uint8_t *magic;
+	uint8_t *data;
+	size_t size = 0;
+
+	if (!file || !get_cache_file(&path, file, get_backend_name()))
+		return NULL;
+
+	data = read_cache_file(path.array, &size);
+	if (!data)
+		goto exit;
+
+	r.data = data;
+	r.size = size;
+
+	magic = read_data(&r, sizeof(EFFECT_CACHE_MAGIC));
+	if (!magic || memcmp(magic, EFFECT_CACHE_MAGIC,
+				sizeof(EFFECT_CACHE_MAGIC)) != 0)
+		goto exit;
+	if (read_u32(&r) != EFFECT_CACHE_VERSION)
+		goto exit;
+	if (!read_str_matches(&r, get_backend_name()))
+		goto exit;
+	if (!read_str_matches(&r, file))
+		goto exit;
+	if (!read_file_check(&r, effect_string))
+		goto exit;
+	if (!dependencies_unchanged(&r))
+		goto exit;
+
+	effect = bzalloc(sizeof(struct gs_effect));
+	effect->graphics = gs_get_context();
+	effect->effect_path = bstrdup(file);
+
+	read_params(&r, effect);
+	read_techniques(&r, effect);
+
+	if (r.error) {
+		blog(LOG_DEBUG, "Effect cache for '%s' is invalid, "
+				"reparsing", file);
+		gs_effect_actually_destroy(effect);
+		effect = NULL;
+	}
+
+exit:
+	bfree(data);
+	dstr_free(&path);
+	return effect;
+}
@@ -0,0 +1,34 @@
+/******************************************************************************
+    Copyright (C) 2017 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "effect-parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* both must be called with the graphics context entered */
+extern gs_effect_t *effect_cache_load(const char *file,
+		const char *effect_string);
+extern void effect_cache_save(struct effect_parser *ep, const char *file,
+		const char *effect_string);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1406,6 +1406,28 @@ static bool ep_compile_pass_shaderparams(struct effect_parser *ep,
 	return true;
 }
 
+/* moves the generated shader text and param names into the pass so the
+ * effect cache can store them */
+static void ep_keep_shader_data(struct ep_pass *pass_in,
+		enum gs_shader_type type, struct dstr *shader_str,
+		struct darray *used_params)
+{
+	char **shader = (type == GS_SHADER_VERTEX) ?
+		&pass_in->vertex_shader : &pass_in->pixel_shader;
+	struct darray *params = (type == GS_SHADER_VERTEX) ?
+		&pass_in->vertex_params.da : &pass_in->pixel_params.da;
+	struct dstr *names = used_params->array;
+
+	bfree(*shader);
+	*shader = shader_str->array;
+	dstr_init(shader_str);
+
+	for (size_t i = 0; i < used_params->num; i++) {
+		darray_push_back(sizeof(char*), params, &names[i].array);
+		dstr_init(&names[i]);
+	}
+}
+
 static inline bool ep_compile_pass_shader(struct effect_parser *ep,
 		struct gs_effect_technique *tech,
 		struct gs_effect_pass *pass, struct ep_pass *pass_in,
@@ -1468,6 +1490,9 @@ static inline bool ep_compile_pass_shader(struct effect_parser *ep,
 	else
 		success = false;
 
+	if (success)
+		ep_keep_shader_data(pass_in, type, &shader_str, &used_params);
+
 	dstr_free(&location);
 	dstr_array_free(used_params.array, used_params.num);
 	darray_free(&used_params);
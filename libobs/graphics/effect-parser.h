@@ -171,6 +171,13 @@ struct ep_pass {
 	DARRAY(struct cf_token) vertex_program;
 	DARRAY(struct cf_token) fragment_program;
 	struct gs_effect_pass *pass;
+
+	/* generated shader text and the effect params each shader uses, kept
+	 * after compiling so that they can be written to the effect cache */
+	char *vertex_shader;
+	char *pixel_shader;
+	DARRAY(char*) vertex_params;
+	DARRAY(char*) pixel_params;
 };
 
 static inline void ep_pass_init(struct ep_pass *epp)
@@ -180,7 +187,17 @@ static inline void ep_pass_init(struct ep_pass *epp)
 
 static inline void ep_pass_free(struct ep_pass *epp)
 {
+	size_t i;
+
 	bfree(epp->name);
+	bfree(epp->vertex_shader);
+	bfree(epp->pixel_shader);
+	for (i = 0; i < epp->vertex_params.num; i++)
+		bfree(epp->vertex_params.array[i]);
+	for (i = 0; i < epp->pixel_params.num; i++)
+		bfree(epp->pixel_params.array[i]);
+	da_free(epp->vertex_params);
+	da_free(epp->pixel_params);
 	da_free(epp->vertex_program);
 	da_free(epp->fragment_program);
 }
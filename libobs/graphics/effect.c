@@ -100,6 +100,8 @@ size_t gs_technique_begin(gs_technique_t *tech)
 {
 	if (!tech) return 0;
 
+	graphics_flush_sprites(tech->effect->graphics);
+
 	tech->effect->cur_technique = tech;
 	tech->effect->graphics->cur_effect = tech->effect;
 
@@ -201,6 +203,8 @@ bool gs_technique_begin_pass(gs_technique_t *tech, size_t idx)
 	passes = tech->passes.array;
 	cur_pass = passes+idx;
 
+	graphics_flush_sprites(tech->effect->graphics);
+
 	tech->effect->cur_pass = cur_pass;
 	gs_load_vertexshader(cur_pass->vertshader);
 	gs_load_pixelshader(cur_pass->pixelshader);
@@ -323,13 +327,17 @@ static inline void effect_setval_inline(gs_eparam_t *param,
 
 	size_changed = param->cur_val.num != size;
 
+	if (!size_changed && memcmp(param->cur_val.array, data, size) == 0)
+		return;
+
+	/* queued sprites have to be drawn with the old value */
+	graphics_flush_sprites(param->effect->graphics);
+
 	if (size_changed)
 		da_resize(param->cur_val, size);
 
-	if (size_changed || memcmp(param->cur_val.array, data, size) != 0) {
-		memcpy(param->cur_val.array, data, size);
-		param->changed = true;
-	}
+	memcpy(param->cur_val.array, data, size);
+	param->changed = true;
 }
 
 void gs_effect_set_bool(gs_eparam_t *param, bool val)
@@ -398,6 +406,9 @@ void gs_effect_set_next_sampler(gs_eparam_t *param, gs_samplerstate_t *sampler)
 		return;
 	}
 
-	if (param->type == GS_SHADER_PARAM_TEXTURE)
+	if (param->type == GS_SHADER_PARAM_TEXTURE &&
+	    param->next_sampler != sampler) {
+		graphics_flush_sprites(param->effect->graphics);
 		param->next_sampler = sampler;
+	}
 }
@@ -53,6 +53,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_get_size);
 	GRAPHICS_IMPORT(device_get_width);
 	GRAPHICS_IMPORT(device_get_height);
+	GRAPHICS_IMPORT_OPTIONAL(device_get_rebuild_count);
 	GRAPHICS_IMPORT(device_texture_create);
 	GRAPHICS_IMPORT(device_cubetexture_create);
 	GRAPHICS_IMPORT(device_voltexture_create);
@@ -134,6 +135,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(gs_stagesurface_get_color_format);
 	GRAPHICS_IMPORT(gs_stagesurface_map);
 	GRAPHICS_IMPORT(gs_stagesurface_unmap);
+	GRAPHICS_IMPORT_OPTIONAL(gs_stagesurface_is_ready);
 
 	GRAPHICS_IMPORT(gs_zstencil_destroy);
 
@@ -41,6 +41,7 @@ struct gs_exports {
 			uint32_t *x, uint32_t *y);
 	uint32_t (*device_get_width)(const gs_device_t *device);
 	uint32_t (*device_get_height)(const gs_device_t *device);
+	uint32_t (*device_get_rebuild_count)(const gs_device_t *device);
 	gs_texture_t *(*device_texture_create)(gs_device_t *device,
 			uint32_t width, uint32_t height,
 			enum gs_color_format color_format, uint32_t levels,
@@ -182,6 +183,7 @@ struct gs_exports {
 	bool     (*gs_stagesurface_map)(gs_stagesurf_t *stagesurf,
 			uint8_t **data, uint32_t *linesize);
 	void     (*gs_stagesurface_unmap)(gs_stagesurf_t *stagesurf);
+	bool     (*gs_stagesurface_is_ready)(gs_stagesurf_t *stagesurf);
 
 	void (*gs_zstencil_destroy)(gs_zstencil_t *zstencil);
 
@@ -286,6 +288,8 @@ struct graphics_subsystem {
 	struct gs_effect       *cur_effect;
 
 	gs_vertbuffer_t        *sprite_buffer;
+	gs_vertbuffer_t        *sprite_batch_buffer;
+	size_t                 sprite_batch_count;
 
 	bool                   using_immediate;
 	struct gs_vb_data      *vbd;
@@ -304,3 +308,5 @@ struct graphics_subsystem {
 	struct blend_state     cur_blend_state;
 	DARRAY(struct blend_state) blend_state_stack;
 };
+
+extern void graphics_flush_sprites(struct graphics_subsystem *graphics);
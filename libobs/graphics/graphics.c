@@ -20,12 +20,14 @@
 #include "../util/base.h"
 #include "../util/bmem.h"
 #include "../util/platform.h"
+#include "../util/profiler.h"
 #include "graphics-internal.h"
 #include "vec2.h"
 #include "vec3.h"
 #include "quat.h"
 #include "axisang.h"
 #include "effect-parser.h"
+#include "effect-cache.h"
 #include "effect.h"
 
 static THREAD_LOCAL graphics_t *thread_graphics = NULL;
@@ -67,6 +69,11 @@ static inline bool gs_valid(const char *f)
 
 #define IMMEDIATE_COUNT 512
 
+/* sprites are batched as two triangles each, so they can be drawn with any
+ * transform in a single draw call */
+#define SPRITE_BATCH_COUNT 64
+#define SPRITE_BATCH_VERTS (SPRITE_BATCH_COUNT * 6)
+
 void gs_enum_adapters(
 		bool (*callback)(void *param, const char *name, uint32_t id),
 		void *param)
@@ -140,6 +147,27 @@ static bool graphics_init_sprite_vb(struct graphics_subsystem *graphics)
 	return true;
 }
 
+static bool graphics_init_sprite_batch_vb(struct graphics_subsystem *graphics)
+{
+	struct gs_vb_data *vbd;
+
+	vbd = gs_vbdata_create();
+	vbd->num     = SPRITE_BATCH_VERTS;
+	vbd->points  = bzalloc(sizeof(struct vec3) * SPRITE_BATCH_VERTS);
+	vbd->num_tex = 1;
+	vbd->tvarray = bmalloc(sizeof(struct gs_tvertarray));
+	vbd->tvarray[0].width = 2;
+	vbd->tvarray[0].array =
+		bzalloc(sizeof(struct vec2) * SPRITE_BATCH_VERTS);
+
+	graphics->sprite_batch_buffer = graphics->exports.
+		device_vertexbuffer_create(graphics->device, vbd, GS_DYNAMIC);
+	if (!graphics->sprite_batch_buffer)
+		return false;
+
+	return true;
+}
+
 static bool graphics_init(struct graphics_subsystem *graphics)
 {
 	struct matrix4 top_mat;
@@ -153,6 +181,8 @@ static bool graphics_init(struct graphics_subsystem *graphics)
 		return false;
 	if (!graphics_init_sprite_vb(graphics))
 		return false;
+	if (!graphics_init_sprite_batch_vb(graphics))
+		return false;
 	if (pthread_mutex_init(&graphics->mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&graphics->effect_mutex, NULL) != 0)
@@ -230,6 +260,8 @@ void gs_destroy(graphics_t *graphics)
 			effect = next;
 		}
 
+		graphics->exports.gs_vertexbuffer_destroy(
+				graphics->sprite_batch_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(
 				graphics->sprite_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(
@@ -277,6 +309,7 @@ void gs_leave_context(void)
 		if (!os_atomic_dec_long(&thread_graphics->ref)) {
 			graphics_t *graphics = thread_graphics;
 
+			graphics_flush_sprites(graphics);
 			graphics->exports.device_leave_context(
 					graphics->device);
 			pthread_mutex_unlock(&graphics->mutex);
@@ -785,6 +818,19 @@ static inline struct gs_effect *find_cached_effect(const char *filename)
 	return effect;
 }
 
+static void add_cached_effect(struct gs_effect *effect)
+{
+	pthread_mutex_lock(&thread_graphics->effect_mutex);
+
+	if (effect->effect_path) {
+		effect->cached = true;
+		effect->next = thread_graphics->first_effect;
+		thread_graphics->first_effect = effect;
+	}
+
+	pthread_mutex_unlock(&thread_graphics->effect_mutex);
+}
+
 gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string)
 {
 	char *file_string;
@@ -803,7 +849,11 @@ gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string)
 		return NULL;
 	}
 
-	effect = gs_effect_create(file_string, file, error_string);
+	effect = effect_cache_load(file, file_string);
+	if (effect)
+		add_cached_effect(effect);
+	else
+		effect = gs_effect_create(file_string, file, error_string);
 	bfree(file_string);
 
 	return effect;
@@ -833,15 +883,8 @@ gs_effect_t *gs_effect_create(const char *effect_string, const char *filename,
 	}
 
 	if (effect) {
-		pthread_mutex_lock(&thread_graphics->effect_mutex);
-
-		if (effect->effect_path) {
-			effect->cached = true;
-			effect->next = thread_graphics->first_effect;
-			thread_graphics->first_effect = effect;
-		}
-
-		pthread_mutex_unlock(&thread_graphics->effect_mutex);
+		effect_cache_save(&parser, filename, effect_string);
+		add_cached_effect(effect);
 	}
 
 	ep_free(&parser);
@@ -997,6 +1040,137 @@ static inline void build_sprite_rect(struct gs_vb_data *data, gs_texture_t *tex,
 	build_sprite(data, fcx, fcy, start_u, end_u, start_v, end_v);
 }
 
+static const char *sprite_upload_name = "gs_sprite_upload";
+static const char *sprite_draw_name = "gs_sprite_draw";
+
+void graphics_flush_sprites(struct graphics_subsystem *graphics)
+{
+	struct gs_vb_data *batch;
+	gs_vertbuffer_t *vb;
+	enum gs_draw_mode mode;
+	uint32_t num_verts;
+	size_t count;
+
+	/* sprites are only ever queued by the thread in the context */
+	if (!graphics || graphics != thread_graphics)
+		return;
+
+	count = graphics->sprite_batch_count;
+	if (!count)
+		return;
+
+	/* the draw uploads effect parameters, which would flush again */
+	graphics->sprite_batch_count = 0;
+
+	batch = gs_vertexbuffer_get_data(graphics->sprite_batch_buffer);
+
+	profile_start(sprite_upload_name);
+
+	if (count == 1) {
+		/* a lone sprite goes through the small strip buffer so that
+		 * it never uploads the whole batch buffer.  the strip buffer's
+		 * own data is left alone, it may hold the next sprite */
+		const struct vec2 *batch_uv = batch->tvarray[0].array;
+		struct vec3 points[4];
+		struct vec2 uvs[4];
+		struct gs_tvertarray tvarray = {2, uvs};
+		struct gs_vb_data strip = {0};
+
+		for (size_t i = 0; i < 4; i++) {
+			size_t idx = i == 3 ? 5 : i;
+			vec3_copy(points + i, batch->points + idx);
+			vec2_copy(uvs + i, batch_uv + idx);
+		}
+
+		strip.num     = 4;
+		strip.points  = points;
+		strip.num_tex = 1;
+		strip.tvarray = &tvarray;
+
+		vb        = graphics->sprite_buffer;
+		mode      = GS_TRISTRIP;
+		num_verts = 4;
+		gs_vertexbuffer_flush_direct(vb, &strip);
+
+	} else {
+		struct gs_vb_data upload = *batch;
+		upload.num = count * 6;
+
+		vb        = graphics->sprite_batch_buffer;
+		mode      = GS_TRIS;
+		num_verts = (uint32_t)upload.num;
+		gs_vertexbuffer_flush_direct(vb, &upload);
+	}
+
+	profile_end(sprite_upload_name);
+
+	/* the vertices are already transformed */
+	gs_matrix_push();
+	gs_matrix_identity();
+
+	profile_start(sprite_draw_name);
+	gs_load_vertexbuffer(vb);
+	gs_load_indexbuffer(NULL);
+	gs_draw(mode, 0, num_verts);
+	profile_end(sprite_draw_name);
+
+	gs_matrix_pop();
+}
+
+static inline bool matrix_is_affine(const struct matrix4 *m)
+{
+	return m->x.w == 0.0f && m->y.w == 0.0f && m->z.w == 0.0f &&
+		m->t.w == 1.0f;
+}
+
+/* sprite strip vertex order as two triangles with the same winding */
+static const size_t sprite_tri_verts[6] = {0, 1, 2, 2, 1, 3};
+
+static void queue_sprite(struct graphics_subsystem *graphics,
+		const struct gs_vb_data *sprite)
+{
+	const struct vec2 *sprite_uv = sprite->tvarray[0].array;
+	struct gs_vb_data *batch;
+	struct vec2 *batch_uv;
+	struct matrix4 world;
+	size_t start;
+
+	gs_matrix_get(&world);
+
+	/* projective transforms can't be applied per vertex without w, so
+	 * draw those as they are */
+	if (!matrix_is_affine(&world)) {
+		graphics_flush_sprites(graphics);
+
+		profile_start(sprite_upload_name);
+		gs_vertexbuffer_flush(graphics->sprite_buffer);
+		profile_end(sprite_upload_name);
+
+		profile_start(sprite_draw_name);
+		gs_load_vertexbuffer(graphics->sprite_buffer);
+		gs_load_indexbuffer(NULL);
+		gs_draw(GS_TRISTRIP, 0, 0);
+		profile_end(sprite_draw_name);
+		return;
+	}
+
+	if (graphics->sprite_batch_count == SPRITE_BATCH_COUNT)
+		graphics_flush_sprites(graphics);
+
+	batch    = gs_vertexbuffer_get_data(graphics->sprite_batch_buffer);
+	batch_uv = batch->tvarray[0].array;
+	start    = graphics->sprite_batch_count * 6;
+
+	for (size_t i = 0; i < 6; i++) {
+		size_t idx = sprite_tri_verts[i];
+		vec3_transform(batch->points + start + i, sprite->points + idx,
+				&world);
+		vec2_copy(batch_uv + start + i, sprite_uv + idx);
+	}
+
+	graphics->sprite_batch_count++;
+}
+
 void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
 		uint32_t height)
 {
@@ -1026,11 +1200,7 @@ void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
 	else
 		build_sprite_norm(data, fcx, fcy, flip);
 
-	gs_vertexbuffer_flush(graphics->sprite_buffer);
-	gs_load_vertexbuffer(graphics->sprite_buffer);
-	gs_load_indexbuffer(NULL);
-
-	gs_draw(GS_TRISTRIP, 0, 0);
+	queue_sprite(graphics, data);
 }
 
 void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip,
@@ -1057,11 +1227,7 @@ void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip,
 			(float)sub_cx, (float)sub_cy,
 			fcx, fcy, flip);
 
-	gs_vertexbuffer_flush(graphics->sprite_buffer);
-	gs_load_vertexbuffer(graphics->sprite_buffer);
-	gs_load_indexbuffer(NULL);
-
-	gs_draw(GS_TRISTRIP, 0, 0);
+	queue_sprite(graphics, data);
 }
 
 void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
@@ -1194,6 +1360,7 @@ void gs_perspective(float angle, float aspect, float near, float far)
 	xmin = ymin * aspect;
 	xmax = ymax * aspect;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_frustum(graphics->device, xmin, xmax,
 			ymin, ymax, near, far);
 }
@@ -1280,6 +1447,7 @@ void gs_resize(uint32_t x, uint32_t y)
 	if (!gs_valid("gs_resize"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_resize(graphics->device, x, y);
 }
 
@@ -1313,6 +1481,20 @@ uint32_t gs_get_height(void)
 	return graphics->exports.device_get_height(graphics->device);
 }
 
+uint32_t gs_get_device_rebuild_count(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_get_device_rebuild_count"))
+		return 0;
+
+	/* modules that cannot lose their device never rebuild it */
+	if (!graphics->exports.device_get_rebuild_count)
+		return 0;
+
+	return graphics->exports.device_get_rebuild_count(graphics->device);
+}
+
 static inline bool is_pow2(uint32_t size)
 {
 	return size >= 2 && (size & (size-1)) == 0;
@@ -1544,6 +1726,7 @@ void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer)
 	if (!gs_valid("gs_load_vertexbuffer"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_load_vertexbuffer(graphics->device,
 			vertbuffer);
 }
@@ -1555,6 +1738,7 @@ void gs_load_indexbuffer(gs_indexbuffer_t *indexbuffer)
 	if (!gs_valid("gs_load_indexbuffer"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_load_indexbuffer(graphics->device,
 			indexbuffer);
 }
@@ -1566,6 +1750,7 @@ void gs_load_texture(gs_texture_t *tex, int unit)
 	if (!gs_valid("gs_load_texture"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_load_texture(graphics->device, tex, unit);
 }
 
@@ -1576,6 +1761,7 @@ void gs_load_samplerstate(gs_samplerstate_t *samplerstate, int unit)
 	if (!gs_valid("gs_load_samplerstate"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_load_samplerstate(graphics->device,
 			samplerstate, unit);
 }
@@ -1587,6 +1773,7 @@ void gs_load_vertexshader(gs_shader_t *vertshader)
 	if (!gs_valid("gs_load_vertexshader"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_load_vertexshader(graphics->device,
 			vertshader);
 }
@@ -1598,6 +1785,7 @@ void gs_load_pixelshader(gs_shader_t *pixelshader)
 	if (!gs_valid("gs_load_pixelshader"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_load_pixelshader(graphics->device,
 			pixelshader);
 }
@@ -1609,6 +1797,7 @@ void gs_load_default_samplerstate(bool b_3d, int unit)
 	if (!gs_valid("gs_load_default_samplerstate"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_load_default_samplerstate(graphics->device,
 			b_3d, unit);
 }
@@ -1660,6 +1849,7 @@ void gs_set_render_target(gs_texture_t *tex, gs_zstencil_t *zstencil)
 	if (!gs_valid("gs_set_render_target"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_set_render_target(graphics->device, tex,
 			zstencil);
 }
@@ -1672,6 +1862,7 @@ void gs_set_cube_render_target(gs_texture_t *cubetex, int side,
 	if (!gs_valid("gs_set_cube_render_target"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_set_cube_render_target(graphics->device,
 			cubetex, side, zstencil);
 }
@@ -1683,6 +1874,7 @@ void gs_copy_texture(gs_texture_t *dst, gs_texture_t *src)
 	if (!gs_valid_p2("gs_copy_texture", dst, src))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_copy_texture(graphics->device, dst, src);
 }
 
@@ -1695,6 +1887,7 @@ void gs_copy_texture_region(gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
 	if (!gs_valid_p("gs_copy_texture_region", dst))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_copy_texture_region(graphics->device,
 			dst, dst_x, dst_y,
 			src, src_x, src_y, src_w, src_h);
@@ -1707,6 +1900,7 @@ void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src)
 	if (!gs_valid("gs_stage_texture"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_stage_texture(graphics->device, dst, src);
 }
 
@@ -1717,6 +1911,7 @@ void gs_begin_scene(void)
 	if (!gs_valid("gs_begin_scene"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_begin_scene(graphics->device);
 }
 
@@ -1728,6 +1923,7 @@ void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert,
 	if (!gs_valid("gs_draw"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_draw(graphics->device, draw_mode,
 			start_vert, num_verts);
 }
@@ -1739,6 +1935,7 @@ void gs_end_scene(void)
 	if (!gs_valid("gs_end_scene"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_end_scene(graphics->device);
 }
 
@@ -1749,6 +1946,7 @@ void gs_load_swapchain(gs_swapchain_t *swapchain)
 	if (!gs_valid("gs_load_swapchain"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_load_swapchain(graphics->device, swapchain);
 }
 
@@ -1760,6 +1958,7 @@ void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth,
 	if (!gs_valid("gs_clear"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_clear(graphics->device, clear_flags, color,
 			depth, stencil);
 }
@@ -1771,6 +1970,7 @@ void gs_present(void)
 	if (!gs_valid("gs_present"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_present(graphics->device);
 }
 
@@ -1781,6 +1981,7 @@ void gs_flush(void)
 	if (!gs_valid("gs_flush"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_flush(graphics->device);
 }
 
@@ -1791,6 +1992,7 @@ void gs_set_cull_mode(enum gs_cull_mode mode)
 	if (!gs_valid("gs_set_cull_mode"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_set_cull_mode(graphics->device, mode);
 }
 
@@ -1812,6 +2014,7 @@ void gs_enable_blending(bool enable)
 		return;
 
 	graphics->cur_blend_state.enabled = enable;
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_enable_blending(graphics->device, enable);
 }
 
@@ -1822,6 +2025,7 @@ void gs_enable_depth_test(bool enable)
 	if (!gs_valid("gs_enable_depth_test"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_enable_depth_test(graphics->device, enable);
 }
 
@@ -1832,6 +2036,7 @@ void gs_enable_stencil_test(bool enable)
 	if (!gs_valid("gs_enable_stencil_test"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_enable_stencil_test(graphics->device, enable);
 }
 
@@ -1842,6 +2047,7 @@ void gs_enable_stencil_write(bool enable)
 	if (!gs_valid("gs_enable_stencil_write"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_enable_stencil_write(graphics->device, enable);
 }
 
@@ -1852,6 +2058,7 @@ void gs_enable_color(bool red, bool green, bool blue, bool alpha)
 	if (!gs_valid("gs_enable_color"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_enable_color(graphics->device, red, green,
 			blue, alpha);
 }
@@ -1867,6 +2074,7 @@ void gs_blend_function(enum gs_blend_type src, enum gs_blend_type dest)
 	graphics->cur_blend_state.dest_c = dest;
 	graphics->cur_blend_state.src_a  = src;
 	graphics->cur_blend_state.dest_a = dest;
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_blend_function(graphics->device, src, dest);
 }
 
@@ -1883,6 +2091,7 @@ void gs_blend_function_separate(
 	graphics->cur_blend_state.dest_c = dest_c;
 	graphics->cur_blend_state.src_a  = src_a;
 	graphics->cur_blend_state.dest_a = dest_a;
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_blend_function_separate(graphics->device,
 			src_c, dest_c, src_a, dest_a);
 }
@@ -1894,6 +2103,7 @@ void gs_depth_function(enum gs_depth_test test)
 	if (!gs_valid("gs_depth_function"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_depth_function(graphics->device, test);
 }
 
@@ -1904,6 +2114,7 @@ void gs_stencil_function(enum gs_stencil_side side, enum gs_depth_test test)
 	if (!gs_valid("gs_stencil_function"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_stencil_function(graphics->device, side, test);
 }
 
@@ -1915,6 +2126,7 @@ void gs_stencil_op(enum gs_stencil_side side, enum gs_stencil_op_type fail,
 	if (!gs_valid("gs_stencil_op"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_stencil_op(graphics->device, side, fail, zfail,
 			zpass);
 }
@@ -1926,6 +2138,7 @@ void gs_set_viewport(int x, int y, int width, int height)
 	if (!gs_valid("gs_set_viewport"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_set_viewport(graphics->device, x, y, width,
 			height);
 }
@@ -1947,6 +2160,7 @@ void gs_set_scissor_rect(const struct gs_rect *rect)
 	if (!gs_valid("gs_set_scissor_rect"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_set_scissor_rect(graphics->device, rect);
 }
 
@@ -1958,6 +2172,7 @@ void gs_ortho(float left, float right, float top, float bottom, float znear,
 	if (!gs_valid("gs_ortho"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_ortho(graphics->device, left, right, top,
 			bottom, znear, zfar);
 }
@@ -1970,6 +2185,7 @@ void gs_frustum(float left, float right, float top, float bottom, float znear,
 	if (!gs_valid("gs_frustum"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_frustum(graphics->device, left, right, top,
 			bottom, znear, zfar);
 }
@@ -1991,6 +2207,7 @@ void gs_projection_pop(void)
 	if (!gs_valid("gs_projection_pop"))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.device_projection_pop(graphics->device);
 }
 
@@ -2015,6 +2232,7 @@ void gs_shader_destroy(gs_shader_t *shader)
 	if (!shader)
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_destroy(shader);
 }
 
@@ -2086,6 +2304,7 @@ void gs_shader_set_bool(gs_sparam_t *param, bool val)
 	if (!gs_valid_p("gs_shader_set_bool", param))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_bool(param, val);
 }
 
@@ -2096,6 +2315,7 @@ void gs_shader_set_float(gs_sparam_t *param, float val)
 	if (!gs_valid_p("gs_shader_set_float", param))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_float(param, val);
 }
 
@@ -2106,6 +2326,7 @@ void gs_shader_set_int(gs_sparam_t *param, int val)
 	if (!gs_valid_p("gs_shader_set_int", param))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_int(param, val);
 }
 
@@ -2116,6 +2337,7 @@ void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
 	if (!gs_valid_p2("gs_shader_set_matrix3", param, val))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_matrix3(param, val);
 }
 
@@ -2126,6 +2348,7 @@ void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
 	if (!gs_valid_p2("gs_shader_set_matrix4", param, val))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_matrix4(param, val);
 }
 
@@ -2136,6 +2359,7 @@ void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
 	if (!gs_valid_p2("gs_shader_set_vec2", param, val))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_vec2(param, val);
 }
 
@@ -2146,6 +2370,7 @@ void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
 	if (!gs_valid_p2("gs_shader_set_vec3", param, val))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_vec3(param, val);
 }
 
@@ -2156,6 +2381,7 @@ void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
 	if (!gs_valid_p2("gs_shader_set_vec4", param, val))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_vec4(param, val);
 }
 
@@ -2166,6 +2392,7 @@ void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
 	if (!gs_valid_p("gs_shader_set_texture", param))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_texture(param, val);
 }
 
@@ -2176,6 +2403,7 @@ void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
 	if (!gs_valid_p2("gs_shader_set_val", param, val))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_val(param, val, size);
 }
 
@@ -2186,6 +2414,7 @@ void gs_shader_set_default(gs_sparam_t *param)
 	if (!gs_valid_p("gs_shader_set_default", param))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_default(param);
 }
 
@@ -2196,6 +2425,7 @@ void gs_shader_set_next_sampler(gs_sparam_t *param, gs_samplerstate_t *sampler)
 	if (!gs_valid_p("gs_shader_set_next_sampler", param))
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_shader_set_next_sampler(param, sampler);
 }
 
@@ -2208,6 +2438,7 @@ void gs_texture_destroy(gs_texture_t *tex)
 	if (!tex)
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_texture_destroy(tex);
 }
 
@@ -2248,6 +2479,7 @@ bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
 	if (!gs_valid_p3("gs_texture_map", tex, ptr, linesize))
 		return false;
 
+	graphics_flush_sprites(graphics);
 	return graphics->exports.gs_texture_map(tex, ptr, linesize);
 }
 
@@ -2293,6 +2525,7 @@ void gs_cubetexture_destroy(gs_texture_t *cubetex)
 	if (!cubetex)
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_cubetexture_destroy(cubetex);
 }
 
@@ -2326,6 +2559,7 @@ void gs_voltexture_destroy(gs_texture_t *voltex)
 	if (!voltex)
 		return;
 
+	graphics_flush_sprites(graphics);
 	graphics->exports.gs_voltexture_destroy(voltex);
 }
 
@@ -2433,6 +2667,20 @@ void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 	graphics->exports.gs_stagesurface_unmap(stagesurf);
 }
 
+bool gs_stagesurface_is_ready(gs_stagesurf_t *stagesurf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_stagesurface_is_ready", stagesurf))
+		return false;
+
+	/* without a way to check, the map is assumed to be able to wait */
+	if (!graphics->exports.gs_stagesurface_is_ready)
+		return true;
+
+	return graphics->exports.gs_stagesurface_is_ready(stagesurf);
+}
+
 void gs_zstencil_destroy(gs_zstencil_t *zstencil)
 {
 	if (!gs_valid("gs_zstencil_destroy"))
@@ -2450,6 +2698,7 @@ void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
 	if (!samplerstate)
 		return;
 
+	graphics_flush_sprites(thread_graphics);
 	thread_graphics->exports.gs_samplerstate_destroy(samplerstate);
 }
 
@@ -2570,6 +2819,7 @@ bool gs_texture_rebind_iosurface(gs_texture_t *texture, void *iosurf)
 	if (!graphics->exports.gs_texture_rebind_iosurface)
 		return false;
 
+	graphics_flush_sprites(graphics);
 	return graphics->exports.gs_texture_rebind_iosurface(texture, iosurf);
 }
 
@@ -2634,6 +2884,7 @@ bool gs_duplicator_update_frame(gs_duplicator_t *duplicator)
 	if (!thread_graphics->exports.gs_duplicator_get_texture)
 		return false;
 
+	graphics_flush_sprites(thread_graphics);
 	return thread_graphics->exports.gs_duplicator_update_frame(duplicator);
 }
 
@@ -2666,6 +2917,7 @@ void *gs_texture_get_dc(gs_texture_t *gdi_tex)
 	if (!gs_valid_p("gs_texture_release_dc", gdi_tex))
 		return NULL;
 
+	graphics_flush_sprites(thread_graphics);
 	if (thread_graphics->exports.gs_texture_get_dc)
 		return thread_graphics->exports.gs_texture_get_dc(gdi_tex);
 	return NULL;
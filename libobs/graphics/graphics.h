@@ -462,6 +462,7 @@ struct gs_init_data {
 
 #define GS_DEVICE_OPENGL      1
 #define GS_DEVICE_DIRECT3D_11 2
+#define GS_DEVICE_SOFTWARE    3
 
 EXPORT const char *gs_get_device_name(void);
 EXPORT int gs_get_device_type(void);
@@ -514,6 +515,12 @@ EXPORT gs_effect_t *gs_effect_create_from_file(const char *file,
 EXPORT gs_effect_t *gs_effect_create(const char *effect_string,
 		const char *filename, char **error_string);
 
+/**
+ * Sets the directory used to cache parsed effect files between runs, or NULL
+ * to disable the effect cache.  Can be called without a graphics context.
+ */
+EXPORT void gs_effect_cache_set_dir(const char *dir);
+
 EXPORT gs_shader_t *gs_vertexshader_create_from_file(const char *file,
 		char **error_string);
 EXPORT gs_shader_t *gs_pixelshader_create_from_file(const char *file,
@@ -573,6 +580,9 @@ EXPORT void gs_resize(uint32_t x, uint32_t y);
 EXPORT void gs_get_size(uint32_t *x, uint32_t *y);
 EXPORT uint32_t gs_get_width(void);
 EXPORT uint32_t gs_get_height(void);
+/** returns the number of times the device has been lost and rebuilt, the
+ * contents of all render targets are lost whenever this changes */
+EXPORT uint32_t gs_get_device_rebuild_count(void);
 
 EXPORT gs_texture_t *gs_texture_create(uint32_t width, uint32_t height,
 		enum gs_color_format color_format, uint32_t levels,
@@ -720,6 +730,9 @@ EXPORT enum gs_color_format gs_stagesurface_get_color_format(
 EXPORT bool     gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
 		uint32_t *linesize);
 EXPORT void     gs_stagesurface_unmap(gs_stagesurf_t *stagesurf);
+/** returns true if the last gs_stage_texture to the surface has completed
+ * and mapping it will not wait for the GPU */
+EXPORT bool     gs_stagesurface_is_ready(gs_stagesurf_t *stagesurf);
 
 EXPORT void     gs_zstencil_destroy(gs_zstencil_t *zstencil);
 
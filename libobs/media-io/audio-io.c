@@ -17,6 +17,7 @@
 
 #include <math.h>
 #include <inttypes.h>
+#include <xmmintrin.h>
 
 #include "../util/threading.h"
 #include "../util/darray.h"
@@ -25,7 +26,9 @@
 #include "../util/profiler.h"
 
 #include "audio-io.h"
+#include "audio-math.h"
 #include "audio-resampler.h"
+#include "audio-loudness.h"
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
@@ -33,6 +36,13 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define nop() do {int invalid = 0;} while(0)
 
+/* the normalizer follows the short term loudness of a mix, but holds its
+ * gain while the momentary loudness is below the gate so that pauses and
+ * silence don't get amplified.  gain is reduced faster than it is raised */
+#define NORMALIZER_GATE      -50.0f
+#define NORMALIZER_RISE_RATE 3.0f
+#define NORMALIZER_FALL_RATE 10.0f
+
 struct audio_input {
 	struct audio_convert_info conversion;
 	audio_resampler_t         *resampler;
@@ -46,9 +56,22 @@ static inline void audio_input_free(struct audio_input *input)
 	audio_resampler_destroy(input->resampler);
 }
 
+struct normalizer_settings {
+	bool  enabled;
+	float target;
+	float max_gain;
+};
+
 struct audio_mix {
 	DARRAY(struct audio_input) inputs;
 	float buffer[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
+
+	/* only touched by the audio thread */
+	bool                       active;
+	audio_loudness_t           *loudness;
+	bool                       normalizing;
+	audio_loudness_t           *normalizer_input;
+	float                      normalizer_gain;
 };
 
 struct audio_output {
@@ -66,6 +89,11 @@ struct audio_output {
 	void                       *input_param;
 	pthread_mutex_t            input_mutex;
 	struct audio_mix           mixes[MAX_AUDIO_MIXES];
+
+	pthread_mutex_t            loudness_mutex;
+	struct normalizer_settings normalizers[MAX_AUDIO_MIXES];
+	uint32_t                   loudness_resets;
+	struct audio_loudness_info loudness[MAX_AUDIO_MIXES];
 };
 
 /* ------------------------------------------------------------------------- */
@@ -189,6 +217,149 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 	}
 }
 
+static inline void get_mix_planes(struct audio_mix *mix,
+		const float *planes[MAX_AUDIO_CHANNELS])
+{
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		planes[i] = mix->buffer[i];
+}
+
+/* ramps the gain from one value to the next over the whole buffer so that
+ * gain changes don't click */
+static void apply_gain_ramp(struct audio_output *audio,
+		struct audio_mix *mix, float start_gain, float end_gain)
+{
+	float step = (end_gain - start_gain) / (float)AUDIO_OUTPUT_FRAMES;
+	__m128 step4 = _mm_set1_ps(step * 4.0f);
+	__m128 start = _mm_add_ps(_mm_set1_ps(start_gain),
+			_mm_mul_ps(_mm_set1_ps(step),
+				_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f)));
+
+	for (size_t plane = 0; plane < audio->planes; plane++) {
+		float *mix_data = mix->buffer[plane];
+		__m128 gain = start;
+
+		for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i += 4) {
+			__m128 val = _mm_loadu_ps(mix_data + i);
+			_mm_storeu_ps(mix_data + i, _mm_mul_ps(val, gain));
+			gain = _mm_add_ps(gain, step4);
+		}
+	}
+}
+
+static void normalize_mix(struct audio_output *audio, struct audio_mix *mix,
+		const struct normalizer_settings *settings)
+{
+	float seconds = (float)AUDIO_OUTPUT_FRAMES /
+		(float)audio->info.samples_per_sec;
+	const float *planes[MAX_AUDIO_CHANNELS];
+	float prev_gain;
+
+	if (!settings->enabled || !mix->normalizer_input) {
+		mix->normalizing = false;
+		return;
+	}
+
+	if (!mix->normalizing) {
+		audio_loudness_reset(mix->normalizer_input);
+		mix->normalizer_gain = 0.0f;
+		mix->normalizing = true;
+	}
+
+	get_mix_planes(mix, planes);
+	audio_loudness_process(mix->normalizer_input, planes,
+			AUDIO_OUTPUT_FRAMES);
+
+	prev_gain = mix->normalizer_gain;
+
+	if (audio_loudness_momentary(mix->normalizer_input) >
+			NORMALIZER_GATE) {
+		float input = audio_loudness_short_term(mix->normalizer_input);
+		float gain = settings->target - input;
+		float max_rise = NORMALIZER_RISE_RATE * seconds;
+		float max_fall = NORMALIZER_FALL_RATE * seconds;
+
+		if (gain > settings->max_gain)
+			gain = settings->max_gain;
+		if (gain > prev_gain + max_rise)
+			gain = prev_gain + max_rise;
+		else if (gain < prev_gain - max_fall)
+			gain = prev_gain - max_fall;
+
+		mix->normalizer_gain = gain;
+	}
+
+	if (prev_gain != 0.0f || mix->normalizer_gain != 0.0f)
+		apply_gain_ramp(audio, mix, db_to_mul(prev_gain),
+				db_to_mul(mix->normalizer_gain));
+}
+
+static void measure_mix(struct audio_mix *mix, bool reset,
+		struct audio_loudness_info *info)
+{
+	const float *planes[MAX_AUDIO_CHANNELS];
+
+	if (!mix->active || reset)
+		audio_loudness_reset(mix->loudness);
+	mix->active = true;
+
+	get_mix_planes(mix, planes);
+	audio_loudness_process(mix->loudness, planes, AUDIO_OUTPUT_FRAMES);
+
+	info->active          = true;
+	info->momentary       = audio_loudness_momentary(mix->loudness);
+	info->short_term      = audio_loudness_short_term(mix->loudness);
+	info->integrated      = audio_loudness_integrated(mix->loudness);
+	info->normalizer_gain = mix->normalizing ? mix->normalizer_gain : 0.0f;
+}
+
+static void normalize_audio_output(struct audio_output *audio,
+		uint32_t active_mixes)
+{
+	struct normalizer_settings normalizers[MAX_AUDIO_MIXES];
+
+	pthread_mutex_lock(&audio->loudness_mutex);
+	memcpy(normalizers, audio->normalizers, sizeof(normalizers));
+	pthread_mutex_unlock(&audio->loudness_mutex);
+
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+		struct audio_mix *mix = &audio->mixes[mix_idx];
+
+		if ((active_mixes & (1 << mix_idx)) == 0)
+			mix->normalizing = false;
+		else
+			normalize_mix(audio, mix, &normalizers[mix_idx]);
+	}
+}
+
+static void measure_audio_output(struct audio_output *audio,
+		uint32_t active_mixes)
+{
+	struct audio_loudness_info loudness[MAX_AUDIO_MIXES];
+	uint32_t resets;
+
+	pthread_mutex_lock(&audio->loudness_mutex);
+	resets = audio->loudness_resets;
+	audio->loudness_resets = 0;
+	pthread_mutex_unlock(&audio->loudness_mutex);
+
+	memset(loudness, 0, sizeof(loudness));
+
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+		struct audio_mix *mix = &audio->mixes[mix_idx];
+
+		if ((active_mixes & (1 << mix_idx)) == 0)
+			mix->active = false;
+		else
+			measure_mix(mix, (resets & (1 << mix_idx)) != 0,
+					&loudness[mix_idx]);
+	}
+
+	pthread_mutex_lock(&audio->loudness_mutex);
+	memcpy(audio->loudness, loudness, sizeof(loudness));
+	pthread_mutex_unlock(&audio->loudness_mutex);
+}
+
 static void input_and_output(struct audio_output *audio,
 		uint64_t audio_time, uint64_t prev_time)
 {
@@ -230,9 +401,13 @@ static void input_and_output(struct audio_output *audio,
 	if (!success)
 		return;
 
+	normalize_audio_output(audio, active_mixes);
+
 	/* clamps audio data to -1.0..1.0 */
 	clamp_audio_output(audio, bytes);
 
+	measure_audio_output(audio, active_mixes);
+
 	/* output */
 	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
 		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
@@ -416,6 +591,22 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 	out->block_size = (planar ? 1 : out->channels) *
 	                  get_audio_bytes_per_channel(info->format);
 
+	pthread_mutex_init_value(&out->loudness_mutex);
+
+	/* loudness can only be measured on planar float mixes */
+	if (info->format == AUDIO_FORMAT_FLOAT_PLANAR) {
+		for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+			struct audio_mix *mix = &out->mixes[i];
+
+			mix->loudness = audio_loudness_create(
+					info->samples_per_sec, info->speakers);
+			mix->normalizer_input = audio_loudness_create(
+					info->samples_per_sec, info->speakers);
+		}
+	}
+
+	if (pthread_mutex_init(&out->loudness_mutex, NULL) != 0)
+		goto fail;
 	if (pthread_mutexattr_init(&attr) != 0)
 		goto fail;
 	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
@@ -455,8 +646,11 @@ void audio_output_close(audio_t *audio)
 			audio_input_free(mix->inputs.array+i);
 
 		da_free(mix->inputs);
+		audio_loudness_destroy(mix->loudness);
+		audio_loudness_destroy(mix->normalizer_input);
 	}
 
+	pthread_mutex_destroy(&audio->loudness_mutex);
 	os_event_destroy(audio->stop_event);
 	bfree(audio);
 }
@@ -499,3 +693,42 @@ uint32_t audio_output_get_sample_rate(const audio_t *audio)
 {
 	return audio ? audio->info.samples_per_sec : 0;
 }
+
+bool audio_output_get_loudness(audio_t *audio, size_t mix_idx,
+		struct audio_loudness_info *info)
+{
+	if (!audio || mix_idx >= MAX_AUDIO_MIXES || !info)
+		return false;
+
+	pthread_mutex_lock(&audio->loudness_mutex);
+	*info = audio->loudness[mix_idx];
+	pthread_mutex_unlock(&audio->loudness_mutex);
+
+	return info->active;
+}
+
+void audio_output_reset_loudness(audio_t *audio, size_t mix_idx)
+{
+	if (!audio || mix_idx >= MAX_AUDIO_MIXES)
+		return;
+
+	pthread_mutex_lock(&audio->loudness_mutex);
+	audio->loudness_resets |= (1 << mix_idx);
+	pthread_mutex_unlock(&audio->loudness_mutex);
+}
+
+void audio_output_set_normalizer(audio_t *audio, size_t mix_idx,
+		bool enable, float target_lufs, float max_gain_db)
+{
+	struct normalizer_settings *settings;
+
+	if (!audio || mix_idx >= MAX_AUDIO_MIXES)
+		return;
+
+	pthread_mutex_lock(&audio->loudness_mutex);
+	settings = &audio->normalizers[mix_idx];
+	settings->enabled  = enable;
+	settings->target   = target_lufs;
+	settings->max_gain = max_gain_db;
+	pthread_mutex_unlock(&audio->loudness_mutex);
+}
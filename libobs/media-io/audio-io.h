@@ -227,6 +227,30 @@ EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
 EXPORT const struct audio_output_info *audio_output_get_info(
 		const audio_t *audio);
 
+/* loudness of a mix as it is output, in LUFS.  momentary, short term and
+ * integrated are -INFINITY until there is enough audio to measure */
+struct audio_loudness_info {
+	bool  active;
+	float momentary;
+	float short_term;
+	float integrated;
+
+	/* gain applied by the normalizer in dB, 0 when it's disabled */
+	float normalizer_gain;
+};
+
+/* returns false if the mix is not active */
+EXPORT bool audio_output_get_loudness(audio_t *audio, size_t mix_idx,
+		struct audio_loudness_info *info);
+
+/* starts a new integrated loudness measurement for a mix */
+EXPORT void audio_output_reset_loudness(audio_t *audio, size_t mix_idx);
+
+/* automatically adjusts the gain of a mix so that its short term loudness
+ * moves towards target_lufs, boosting it by at most max_gain_db */
+EXPORT void audio_output_set_normalizer(audio_t *audio, size_t mix_idx,
+		bool enable, float target_lufs, float max_gain_db);
+
 
 #ifdef __cplusplus
 }
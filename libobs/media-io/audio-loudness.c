@@ -0,0 +1,470 @@
+/******************************************************************************
+    Copyright (C) 2017 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <emmintrin.h>
+
+#include "../util/bmem.h"
+#include "audio-loudness.h"
+
+/* loudness is measured in blocks of 100 ms.  the momentary loudness covers
+ * the last 400 ms, the short term loudness the last 3 seconds, and every
+ * 400 ms window (overlapping by 75%) is a gating block for the integrated
+ * loudness */
+#define BLOCKS_PER_SEC      10
+#define MOMENTARY_BLOCKS    4
+#define SHORT_TERM_BLOCKS   30
+
+#define ABSOLUTE_GATE       -70.0
+#define RELATIVE_GATE       -10.0
+
+/* gating blocks are kept as a histogram with 0.1 LU steps from -70 to
+ * +10 LUFS, so measuring for hours takes no more memory than measuring for
+ * seconds.  only the relative gate is rounded to the histogram steps, the
+ * energy of each step is summed exactly */
+#define HISTOGRAM_STEPS_PER_LU 10
+#define HISTOGRAM_BINS      800
+
+/* channels are filtered in pairs, one pair per SSE2 register */
+#define MAX_PAIRS           ((MAX_AUDIO_CHANNELS + 1) / 2)
+
+struct biquad {
+	double b0, b1, b2, a1, a2;
+};
+
+struct audio_loudness {
+	size_t        channels;
+	size_t        pairs;
+	uint32_t      samples_per_sec;
+
+	struct biquad shelf;
+	struct biquad highpass;
+
+	/* one lane per channel.  with an odd number of channels, the last
+	 * pair filters the last channel twice and the extra lane gets a
+	 * weight of 0 */
+	double        weights[MAX_PAIRS * 2];
+	double        state[MAX_PAIRS][4][2];
+	double        lane_sums[MAX_PAIRS * 2];
+
+	size_t        block_size;
+	size_t        block_frames;
+	double        blocks[SHORT_TERM_BLOCKS];
+	size_t        block_count;
+	size_t        block_pos;
+
+	uint64_t      histogram_count[HISTOGRAM_BINS];
+	double        histogram_energy[HISTOGRAM_BINS];
+	uint64_t      gated_count;
+	double        gated_energy;
+
+	float         momentary;
+	float         short_term;
+	float         integrated;
+};
+
+static inline double energy_to_lufs(double energy)
+{
+	return energy > 0.0 ? -0.691 + 10.0 * log10(energy) : -INFINITY;
+}
+
+static inline double lufs_to_energy(double lufs)
+{
+	return pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+/* K-weighting filter coefficients for the given sample rate, as specified in
+ * BS.1770 for 48 kHz and recalculated for other rates */
+static void init_k_weighting(struct audio_loudness *meter, uint32_t rate)
+{
+	double f0 = 1681.974450955533;
+	double gain = 3.999843853973347;
+	double q = 0.7071752369554196;
+	double k = tan(M_PI * f0 / (double)rate);
+	double vh = pow(10.0, gain / 20.0);
+	double vb = pow(vh, 0.4996667741545416);
+	double a0 = 1.0 + k / q + k * k;
+
+	meter->shelf.b0 = (vh + vb * k / q + k * k) / a0;
+	meter->shelf.b1 = 2.0 * (k * k - vh) / a0;
+	meter->shelf.b2 = (vh - vb * k / q + k * k) / a0;
+	meter->shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+	meter->shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+	f0 = 38.13547087602444;
+	q = 0.5003270373238773;
+	k = tan(M_PI * f0 / (double)rate);
+	a0 = 1.0 + k / q + k * k;
+
+	meter->highpass.b0 = 1.0;
+	meter->highpass.b1 = -2.0;
+	meter->highpass.b2 = 1.0;
+	meter->highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+	meter->highpass.a2 = (1.0 - k / q + k * k) / a0;
+}
+
+/* LFE channels are left out, surround channels count 1.41 times as much as
+ * the front channels */
+static void init_channel_weights(struct audio_loudness *meter,
+		enum speaker_layout speakers)
+{
+	for (size_t i = 0; i < MAX_PAIRS * 2; i++)
+		meter->weights[i] = i < meter->channels ? 1.0 : 0.0;
+
+	switch (speakers) {
+	case SPEAKERS_2POINT1:
+		meter->weights[2] = 0.0;
+		break;
+	case SPEAKERS_4POINT0:
+		meter->weights[3] = 1.41;
+		break;
+	case SPEAKERS_4POINT1:
+		meter->weights[3] = 0.0;
+		meter->weights[4] = 1.41;
+		break;
+	case SPEAKERS_5POINT1:
+	case SPEAKERS_7POINT1:
+		meter->weights[3] = 0.0;
+		for (size_t i = 4; i < meter->channels; i++)
+			meter->weights[i] = 1.41;
+		break;
+	default:
+		break;
+	}
+}
+
+audio_loudness_t *audio_loudness_create(uint32_t samples_per_sec,
+		enum speaker_layout speakers)
+{
+	struct audio_loudness *meter;
+	size_t channels = get_audio_channels(speakers);
+
+	if (!samples_per_sec || !channels || channels > MAX_AUDIO_CHANNELS)
+		return NULL;
+
+	meter = bzalloc(sizeof(struct audio_loudness));
+	meter->channels        = channels;
+	meter->pairs           = (channels + 1) / 2;
+	meter->samples_per_sec = samples_per_sec;
+	meter->block_size      = samples_per_sec / BLOCKS_PER_SEC;
+
+	init_k_weighting(meter, samples_per_sec);
+	init_channel_weights(meter, speakers);
+	audio_loudness_reset(meter);
+	return meter;
+}
+
+void audio_loudness_destroy(audio_loudness_t *meter)
+{
+	bfree(meter);
+}
+
+void audio_loudness_reset(audio_loudness_t *meter)
+{
+	if (!meter)
+		return;
+
+	memset(meter->state, 0, sizeof(meter->state));
+	memset(meter->lane_sums, 0, sizeof(meter->lane_sums));
+	memset(meter->histogram_count, 0, sizeof(meter->histogram_count));
+	memset(meter->histogram_energy, 0, sizeof(meter->histogram_energy));
+	meter->block_frames = 0;
+	meter->block_count  = 0;
+	meter->block_pos    = 0;
+	meter->gated_count  = 0;
+	meter->gated_energy = 0.0;
+	meter->momentary    = -INFINITY;
+	meter->short_term   = -INFINITY;
+	meter->integrated   = -INFINITY;
+}
+
+/* ------------------------------------------------------------------------- */
+/* K-weighting */
+
+struct k_weight_coeffs {
+	__m128d sb0, sb1, sb2, sa1, sa2;
+	__m128d ha1, ha2;
+};
+
+static inline void load_k_weight_coeffs(struct k_weight_coeffs *c,
+		const struct audio_loudness *meter)
+{
+	c->sb0 = _mm_set1_pd(meter->shelf.b0);
+	c->sb1 = _mm_set1_pd(meter->shelf.b1);
+	c->sb2 = _mm_set1_pd(meter->shelf.b2);
+	c->sa1 = _mm_set1_pd(meter->shelf.a1);
+	c->sa2 = _mm_set1_pd(meter->shelf.a2);
+	c->ha1 = _mm_set1_pd(meter->highpass.a1);
+	c->ha2 = _mm_set1_pd(meter->highpass.a2);
+}
+
+/* both filters in transposed direct form II.  the high pass filter has
+ * b0 = 1, b1 = -2 and b2 = 1, so those multiplications are left out */
+#define K_WEIGHT_PAIR(c, s, x, sum)                                           \
+do {                                                                          \
+	__m128d y = _mm_add_pd(_mm_mul_pd(c.sb0, x), s[0]);                   \
+	__m128d z;                                                            \
+	s[0] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(c.sb1, x),                    \
+				_mm_mul_pd(c.sa1, y)), s[1]);                 \
+	s[1] = _mm_sub_pd(_mm_mul_pd(c.sb2, x), _mm_mul_pd(c.sa2, y));        \
+	z = _mm_add_pd(y, s[2]);                                              \
+	s[2] = _mm_sub_pd(_mm_sub_pd(s[3], _mm_add_pd(y, y)),                 \
+			_mm_mul_pd(c.ha1, z));                                \
+	s[3] = _mm_sub_pd(y, _mm_mul_pd(c.ha2, z));                           \
+	sum = _mm_add_pd(sum, _mm_mul_pd(z, z));                              \
+} while (false)
+
+static inline __m128d load_pair(const float *a, const float *b, size_t i)
+{
+	return _mm_set_pd((double)b[i], (double)a[i]);
+}
+
+/* keeps silence from leaving the filters running on denormals */
+static inline __m128d flush_tiny(__m128d val)
+{
+	__m128d abs_val = _mm_andnot_pd(_mm_set1_pd(-0.0), val);
+	return _mm_and_pd(val, _mm_cmpge_pd(abs_val, _mm_set1_pd(1e-20)));
+}
+
+static inline void load_state(__m128d *s, double (*state)[2])
+{
+	for (size_t i = 0; i < 4; i++)
+		s[i] = _mm_loadu_pd(state[i]);
+}
+
+static inline void store_state(double (*state)[2], const __m128d *s)
+{
+	for (size_t i = 0; i < 4; i++)
+		_mm_storeu_pd(state[i], flush_tiny(s[i]));
+}
+
+static inline void add_lane_sums(double *lane_sums, __m128d sum)
+{
+	_mm_storeu_pd(lane_sums, _mm_add_pd(_mm_loadu_pd(lane_sums), sum));
+}
+
+static inline const float *pair_plane(const struct audio_loudness *meter,
+		const float *const planes[], size_t channel, size_t offset)
+{
+	if (channel >= meter->channels)
+		channel = meter->channels - 1;
+	return planes[channel] + offset;
+}
+
+static void k_weight_pair(struct audio_loudness *meter,
+		const struct k_weight_coeffs *coeffs, size_t pair,
+		const float *const planes[], size_t offset, size_t frames)
+{
+	const float *a = pair_plane(meter, planes, pair * 2, offset);
+	const float *b = pair_plane(meter, planes, pair * 2 + 1, offset);
+	struct k_weight_coeffs c = *coeffs;
+	__m128d sum = _mm_setzero_pd();
+	__m128d s[4];
+
+	load_state(s, meter->state[pair]);
+
+	for (size_t i = 0; i < frames; i++) {
+		__m128d x = load_pair(a, b, i);
+		K_WEIGHT_PAIR(c, s, x, sum);
+	}
+
+	store_state(meter->state[pair], s);
+	add_lane_sums(meter->lane_sums + pair * 2, sum);
+}
+
+/* the filters are recursive, so each pair is one long dependency chain.
+ * filtering two pairs in the same loop lets them overlap */
+static void k_weight_two_pairs(struct audio_loudness *meter,
+		const struct k_weight_coeffs *coeffs, size_t pair,
+		const float *const planes[], size_t offset, size_t frames)
+{
+	const float *a0 = pair_plane(meter, planes, pair * 2, offset);
+	const float *b0 = pair_plane(meter, planes, pair * 2 + 1, offset);
+	const float *a1 = pair_plane(meter, planes, pair * 2 + 2, offset);
+	const float *b1 = pair_plane(meter, planes, pair * 2 + 3, offset);
+	struct k_weight_coeffs c = *coeffs;
+	__m128d sum0 = _mm_setzero_pd();
+	__m128d sum1 = _mm_setzero_pd();
+	__m128d s0[4];
+	__m128d s1[4];
+
+	load_state(s0, meter->state[pair]);
+	load_state(s1, meter->state[pair + 1]);
+
+	for (size_t i = 0; i < frames; i++) {
+		__m128d x0 = load_pair(a0, b0, i);
+		__m128d x1 = load_pair(a1, b1, i);
+		K_WEIGHT_PAIR(c, s0, x0, sum0);
+		K_WEIGHT_PAIR(c, s1, x1, sum1);
+	}
+
+	store_state(meter->state[pair], s0);
+	store_state(meter->state[pair + 1], s1);
+	add_lane_sums(meter->lane_sums + pair * 2, sum0);
+	add_lane_sums(meter->lane_sums + pair * 2 + 2, sum1);
+}
+
+static void k_weight(struct audio_loudness *meter,
+		const float *const planes[], size_t offset, size_t frames)
+{
+	struct k_weight_coeffs coeffs;
+	size_t pair = 0;
+
+	load_k_weight_coeffs(&coeffs, meter);
+
+	for (; pair + 1 < meter->pairs; pair += 2)
+		k_weight_two_pairs(meter, &coeffs, pair, planes, offset,
+				frames);
+	if (pair < meter->pairs)
+		k_weight_pair(meter, &coeffs, pair, planes, offset, frames);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Gating */
+
+static size_t histogram_index(double energy)
+{
+	double lufs = energy_to_lufs(energy);
+	double idx = (lufs - ABSOLUTE_GATE) * HISTOGRAM_STEPS_PER_LU;
+
+	if (!(idx > 0.0))
+		return 0;
+	if (idx >= (double)(HISTOGRAM_BINS - 1))
+		return HISTOGRAM_BINS - 1;
+	return (size_t)idx;
+}
+
+static void update_integrated(struct audio_loudness *meter)
+{
+	double threshold;
+	double energy = 0.0;
+	uint64_t count = 0;
+
+	if (!meter->gated_count)
+		return;
+
+	threshold = meter->gated_energy / (double)meter->gated_count *
+		pow(10.0, RELATIVE_GATE / 10.0);
+
+	for (size_t i = histogram_index(threshold); i < HISTOGRAM_BINS; i++) {
+		energy += meter->histogram_energy[i];
+		count  += meter->histogram_count[i];
+	}
+
+	if (count)
+		meter->integrated = (float)energy_to_lufs(
+				energy / (double)count);
+}
+
+static void add_gating_block(struct audio_loudness *meter, double energy)
+{
+	size_t idx;
+
+	if (energy <= lufs_to_energy(ABSOLUTE_GATE))
+		return;
+
+	idx = histogram_index(energy);
+	meter->histogram_count[idx]++;
+	meter->histogram_energy[idx] += energy;
+	meter->gated_count++;
+	meter->gated_energy += energy;
+
+	update_integrated(meter);
+}
+
+/* mean energy of the most recent blocks */
+static double recent_energy(const struct audio_loudness *meter,
+		size_t blocks)
+{
+	size_t pos = meter->block_pos;
+	double sum = 0.0;
+
+	if (blocks > meter->block_count)
+		blocks = meter->block_count;
+
+	for (size_t i = 0; i < blocks; i++) {
+		pos = (pos + SHORT_TERM_BLOCKS - 1) % SHORT_TERM_BLOCKS;
+		sum += meter->blocks[pos];
+	}
+
+	return sum / (double)blocks;
+}
+
+static void finish_block(struct audio_loudness *meter)
+{
+	double energy = 0.0;
+	double momentary;
+
+	for (size_t i = 0; i < MAX_PAIRS * 2; i++) {
+		energy += meter->weights[i] * meter->lane_sums[i];
+		meter->lane_sums[i] = 0.0;
+	}
+
+	meter->blocks[meter->block_pos] = energy / (double)meter->block_size;
+	meter->block_pos = (meter->block_pos + 1) % SHORT_TERM_BLOCKS;
+	if (meter->block_count < SHORT_TERM_BLOCKS)
+		meter->block_count++;
+	meter->block_frames = 0;
+
+	momentary = recent_energy(meter, MOMENTARY_BLOCKS);
+	meter->momentary  = (float)energy_to_lufs(momentary);
+	meter->short_term = (float)energy_to_lufs(
+			recent_energy(meter, SHORT_TERM_BLOCKS));
+
+	if (meter->block_count >= MOMENTARY_BLOCKS)
+		add_gating_block(meter, momentary);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void audio_loudness_process(audio_loudness_t *meter,
+		const float *const planes[], size_t frames)
+{
+	size_t offset = 0;
+
+	if (!meter || !planes)
+		return;
+
+	while (offset < frames) {
+		size_t count = meter->block_size - meter->block_frames;
+		if (count > frames - offset)
+			count = frames - offset;
+
+		k_weight(meter, planes, offset, count);
+
+		meter->block_frames += count;
+		offset += count;
+
+		if (meter->block_frames == meter->block_size)
+			finish_block(meter);
+	}
+}
+
+float audio_loudness_momentary(const audio_loudness_t *meter)
+{
+	return meter ? meter->momentary : -INFINITY;
+}
+
+float audio_loudness_short_term(const audio_loudness_t *meter)
+{
+	return meter ? meter->short_term : -INFINITY;
+}
+
+float audio_loudness_integrated(const audio_loudness_t *meter)
+{
+	return meter ? meter->integrated : -INFINITY;
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+    Copyright (C) 2017 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+#include "audio-io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *   Loudness meter as specified by ITU-R BS.1770 and EBU R128.  Takes planar
+ * float audio and measures the momentary (400 ms), short term (3 s) and gated
+ * integrated loudness.  All values are in LUFS, and are -INFINITY when there
+ * is nothing to measure yet.
+ */
+
+struct audio_loudness;
+typedef struct audio_loudness audio_loudness_t;
+
+EXPORT audio_loudness_t *audio_loudness_create(uint32_t samples_per_sec,
+		enum speaker_layout speakers);
+EXPORT void audio_loudness_destroy(audio_loudness_t *meter);
+
+/* starts a new measurement, including the integrated loudness */
+EXPORT void audio_loudness_reset(audio_loudness_t *meter);
+
+/* planes must contain one plane per channel of the speaker layout */
+EXPORT void audio_loudness_process(audio_loudness_t *meter,
+		const float *const planes[], size_t frames);
+
+EXPORT float audio_loudness_momentary(const audio_loudness_t *meter);
+EXPORT float audio_loudness_short_term(const audio_loudness_t *meter);
+EXPORT float audio_loudness_integrated(const audio_loudness_t *meter);
+
+#ifdef __cplusplus
+}
+#endif
@@ -273,6 +273,43 @@ EXPORT void obs_volmeter_add_callback(obs_volmeter_t *volmeter,
 EXPORT void obs_volmeter_remove_callback(obs_volmeter_t *volmeter,
 		obs_volmeter_updated_t callback, void *param);
 
+/**
+ * @brief Audio levels of a source
+ *
+ * Levels are linear and don't include the volume of the source.  Loudness is
+ * in LUFS as specified by EBU R128, or -INFINITY if there is no loudness yet.
+ */
+struct obs_audio_levels {
+	int      channels;
+	float    peak[MAX_AUDIO_CHANNELS];
+	float    true_peak[MAX_AUDIO_CHANNELS];
+	float    magnitude[MAX_AUDIO_CHANNELS];
+
+	/** loudness over the last 400 ms */
+	float    momentary_loudness;
+	/** loudness over the last 3 seconds */
+	float    short_term_loudness;
+
+	/** false if no attached meter uses true peak, true_peak then contains
+	 * the sample peak */
+	bool     true_peak_valid;
+	bool     muted;
+	uint64_t timestamp;
+};
+
+/**
+ * @brief Get the most recent audio levels of a source
+ * @param source pointer to the source object
+ * @param levels receives the levels
+ * @return false if no volume meter is attached to the source
+ *
+ * The levels are calculated once per source on the audio thread while at
+ * least one volume meter is attached, no matter how many meters there are.
+ * This can be called from any thread and never blocks the audio thread.
+ */
+EXPORT bool obs_source_get_audio_levels(obs_source_t *source,
+		struct obs_audio_levels *levels);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,427 @@
+/******************************************************************************
+    Copyright (C) 2017 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <xmmintrin.h>
+
+#include "util/threading.h"
+#include "util/bmem.h"
+#include "media-io/audio-loudness.h"
+#include "obs-internal.h"
+#include "obs-audio-controls.h"
+
+/*
+ *   Audio level analysis of a source.  Done once per audio packet on the
+ * thread outputting the source's audio, no matter how many volume meters are
+ * attached to it, and published as a snapshot that can be read from any
+ * thread without locking.
+ */
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4056)
+#pragma warning(disable : 4756)
+#endif
+
+#define CLAMP(x, min, max) ((x) < min ? min : ((x) > max ? max : (x)))
+
+struct audio_levels {
+	obs_source_t            *source;
+
+	/* only touched by the thread processing the audio */
+	uint32_t                sample_rate;
+	enum speaker_layout     speakers;
+	float                   prev_samples[MAX_AUDIO_CHANNELS][4];
+	float                   peak[MAX_AUDIO_CHANNELS];
+	float                   true_peak[MAX_AUDIO_CHANNELS];
+	float                   magnitude[MAX_AUDIO_CHANNELS];
+	bool                    warned_unaligned;
+
+	audio_loudness_t        *loudness;
+
+	/* odd while the snapshot is being written */
+	volatile long           seq;
+	struct obs_audio_levels snapshot;
+};
+
+static int get_nr_channels_from_audio_data(const struct audio_data *data)
+{
+	int nr_channels = 0;
+	for (int i = 0; i < MAX_AV_PLANES; i++) {
+		if (data->data[i])
+			nr_channels++;
+	}
+	return CLAMP(nr_channels, 0, MAX_AUDIO_CHANNELS);
+}
+
+/* msb(h, g, f, e) lsb(d, c, b, a)   -->  msb(h, h, g, f) lsb(e, d, c, b)
+ */
+#define SHIFT_RIGHT_2PS(msb, lsb) {\
+	__m128 tmp = _mm_shuffle_ps(lsb, msb, _MM_SHUFFLE(0, 0, 3, 3));\
+	lsb = _mm_shuffle_ps(lsb, tmp, _MM_SHUFFLE(2, 1, 2, 1));\
+	msb = _mm_shuffle_ps(msb, msb, _MM_SHUFFLE(3, 3, 2, 1));\
+}
+
+/* x(d, c, b, a) --> (|d|, |c|, |b|, |a|)
+ */
+#define abs_ps(v) \
+	_mm_andnot_ps(_mm_set1_ps(-0.f), v)
+
+/* Take cross product of a vector with a matrix resulting in vector.
+ */
+#define VECTOR_MATRIX_CROSS_PS(out, v, m0, m1, m2, m3) \
+{\
+	out = _mm_mul_ps(v, m0);\
+	__m128 mul1 = _mm_mul_ps(v, m1);\
+	__m128 mul2 = _mm_mul_ps(v, m2);\
+	__m128 mul3 = _mm_mul_ps(v, m3);\
+\
+	_MM_TRANSPOSE4_PS(out, mul1, mul2, mul3);\
+\
+	out = _mm_add_ps(out, mul1);\
+	out = _mm_add_ps(out, mul2);\
+	out = _mm_add_ps(out, mul3);\
+}
+
+/* x4(d, c, b, a)  -->  max(a, b, c, d)
+ */
+#define hmax_ps(r, x4) \
+	do { \
+		float x4_mem[4]; \
+		_mm_storeu_ps(x4_mem, x4); \
+		r = x4_mem[0]; \
+		r = fmaxf(r, x4_mem[1]); \
+		r = fmaxf(r, x4_mem[2]); \
+		r = fmaxf(r, x4_mem[3]); \
+	} while (false)
+
+/* Calculate the true peak over a set of samples.
+ * The algorithm implements 5x oversampling by using Whittaker–Shannon
+ * interpolation over four samples.
+ *
+ * The four samples have location t=-1.5, -0.5, +0.5, +1.5
+ * The oversamples are taken at locations t=-0.3, -0.1, +0.1, +0.3
+ *
+ * @param previous_samples  Last 4 samples from the previous iteration.
+ * @param samples           The samples to find the peak in.
+ * @param nr_samples        Number of sets of 4 samples.
+ * @returns 5 times oversampled true-peak from the set of samples.
+ */
+static float get_true_peak(__m128 previous_samples, const float *samples,
+	size_t nr_samples)
+{
+	/* These are normalized-sinc parameters for interpolating over sample
+	 * points which are located at x-coords: -1.5, -0.5, +0.5, +1.5.
+	 * And oversample points at x-coords: -0.3, -0.1, 0.1, 0.3. */
+	const __m128 m3 = _mm_set_ps(-0.155915f, 0.935489f, 0.233872f, -0.103943f);
+	const __m128 m1 = _mm_set_ps(-0.216236f, 0.756827f, 0.504551f, -0.189207f);
+	const __m128 p1 = _mm_set_ps(-0.189207f, 0.504551f, 0.756827f, -0.216236f);
+	const __m128 p3 = _mm_set_ps(-0.103943f, 0.233872f, 0.935489f, -0.155915f);
+
+	__m128 work = previous_samples;
+	__m128 peak = previous_samples;
+	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
+		__m128 new_work = _mm_load_ps(&samples[i]);
+		__m128 intrp_samples;
+
+		/* Include the actual sample values in the peak. */
+		__m128 abs_new_work = abs_ps(new_work);
+		peak = _mm_max_ps(peak, abs_new_work);
+
+		/* Shift in the next point. */
+		SHIFT_RIGHT_2PS(new_work, work);
+		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
+		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
+
+		SHIFT_RIGHT_2PS(new_work, work);
+		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
+		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
+
+		SHIFT_RIGHT_2PS(new_work, work);
+		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
+		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
+
+		SHIFT_RIGHT_2PS(new_work, work);
+		VECTOR_MATRIX_CROSS_PS(intrp_samples, work, m3, m1, p1, p3);
+		peak = _mm_max_ps(peak, abs_ps(intrp_samples));
+	}
+
+	float r;
+	hmax_ps(r, peak);
+	return r;
+}
+
+/* points contain the first four samples to calculate the sinc interpolation
+ * over. They will have come from a previous iteration.
+ */
+static float get_sample_peak(__m128 previous_samples, const float *samples,
+	size_t nr_samples)
+{
+	__m128 peak = previous_samples;
+	for (size_t i = 0; (i + 3) < nr_samples; i += 4) {
+		__m128 new_work = _mm_load_ps(&samples[i]);
+		peak = _mm_max_ps(peak, abs_ps(new_work));
+	}
+
+	float r;
+	hmax_ps(r, peak);
+	return r;
+}
+
+static void process_peak_last_samples(struct audio_levels *levels,
+		int channel_nr, float *samples, size_t nr_samples)
+{
+	float *prev = levels->prev_samples[channel_nr];
+
+	/* Take the last 4 samples that need to be used for the next peak
+	 * calculation. If there are less than 4 samples in total the new
+	 * samples shift out the old samples. */
+
+	switch (nr_samples) {
+	case 0:
+		break;
+	case 1:
+		prev[0] = prev[1];
+		prev[1] = prev[2];
+		prev[2] = prev[3];
+		prev[3] = samples[nr_samples-1];
+		break;
+	case 2:
+		prev[0] = prev[2];
+		prev[1] = prev[3];
+		prev[2] = samples[nr_samples-2];
+		prev[3] = samples[nr_samples-1];
+		break;
+	case 3:
+		prev[0] = prev[3];
+		prev[1] = samples[nr_samples-3];
+		prev[2] = samples[nr_samples-2];
+		prev[3] = samples[nr_samples-1];
+		break;
+	default:
+		prev[0] = samples[nr_samples-4];
+		prev[1] = samples[nr_samples-3];
+		prev[2] = samples[nr_samples-2];
+		prev[3] = samples[nr_samples-1];
+	}
+}
+
+/* the true peak is only calculated while a meter needs it, it's several
+ * times more expensive than the sample peak */
+static void process_peak(struct audio_levels *levels,
+		const struct audio_data *data, int nr_channels,
+		bool true_peak)
+{
+	int nr_samples = data->frames;
+	int channel_nr = 0;
+	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
+		float *samples = (float *)data->data[plane_nr];
+		if (!samples) {
+			continue;
+		}
+		if (((uintptr_t)samples & 0xf) > 0) {
+			if (!levels->warned_unaligned) {
+				blog(LOG_WARNING, "Source '%s': audio plane %i "
+						"is not aligned %p, skipping "
+						"peak volume measurement",
+						obs_source_get_name(
+							levels->source),
+						plane_nr, samples);
+				levels->warned_unaligned = true;
+			}
+			levels->peak[channel_nr] = 1.0;
+			levels->true_peak[channel_nr] = 1.0;
+			channel_nr++;
+			continue;
+		}
+
+		/* levels->prev_samples may not be aligned to 16 bytes;
+		 * use unaligned load. */
+		__m128 previous_samples = _mm_loadu_ps(
+				levels->prev_samples[channel_nr]);
+
+		levels->peak[channel_nr] = get_sample_peak(previous_samples,
+				samples, nr_samples);
+		levels->true_peak[channel_nr] = true_peak ?
+			get_true_peak(previous_samples, samples, nr_samples) :
+			levels->peak[channel_nr];
+
+		process_peak_last_samples(levels, channel_nr, samples,
+			nr_samples);
+
+		channel_nr++;
+	}
+
+	/* Clear the peak of the channels that have not been handled. */
+	for (; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
+		levels->peak[channel_nr] = 0.0;
+		levels->true_peak[channel_nr] = 0.0;
+	}
+}
+
+static void process_magnitude(struct audio_levels *levels,
+	const struct audio_data *data, int nr_channels)
+{
+	size_t nr_samples = data->frames;
+
+	int channel_nr = 0;
+	for (int plane_nr = 0; channel_nr < nr_channels; plane_nr++) {
+		float *samples = (float *)data->data[plane_nr];
+		if (!samples) {
+			continue;
+		}
+
+		float sum = 0.0;
+		for (size_t i = 0; i < nr_samples; i++) {
+			float sample = samples[i];
+			sum += sample * sample;
+		}
+		levels->magnitude[channel_nr] = sqrtf(sum / nr_samples);
+
+		channel_nr++;
+	}
+
+	for (; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++)
+		levels->magnitude[channel_nr] = 0.0f;
+}
+
+/* the loudness meter is recreated whenever the audio format changes */
+static void update_audio_format(struct audio_levels *levels)
+{
+	const struct audio_output_info *info =
+		audio_output_get_info(obs->audio.audio);
+
+	if (levels->loudness &&
+	    levels->sample_rate == info->samples_per_sec &&
+	    levels->speakers == info->speakers)
+		return;
+
+	levels->sample_rate = info->samples_per_sec;
+	levels->speakers    = info->speakers;
+
+	audio_loudness_destroy(levels->loudness);
+	levels->loudness = audio_loudness_create(info->samples_per_sec,
+			info->speakers);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct audio_levels *audio_levels_create(obs_source_t *source)
+{
+	struct audio_levels *levels = bzalloc(sizeof(struct audio_levels));
+	levels->source = source;
+	return levels;
+}
+
+void audio_levels_destroy(struct audio_levels *levels)
+{
+	if (levels) {
+		audio_loudness_destroy(levels->loudness);
+		bfree(levels);
+	}
+}
+
+static void publish_snapshot(struct audio_levels *levels,
+		const struct audio_data *data, int nr_channels,
+		bool true_peak, bool muted)
+{
+	struct obs_audio_levels *snapshot = &levels->snapshot;
+
+	os_atomic_inc_long(&levels->seq);
+
+	snapshot->channels        = nr_channels;
+	snapshot->true_peak_valid = true_peak;
+	snapshot->muted           = muted;
+	snapshot->timestamp       = data->timestamp;
+	memcpy(snapshot->peak, levels->peak, sizeof(levels->peak));
+	memcpy(snapshot->true_peak, levels->true_peak,
+			sizeof(levels->true_peak));
+	memcpy(snapshot->magnitude, levels->magnitude,
+			sizeof(levels->magnitude));
+	snapshot->momentary_loudness =
+		audio_loudness_momentary(levels->loudness);
+	snapshot->short_term_loudness =
+		audio_loudness_short_term(levels->loudness);
+
+	os_atomic_inc_long(&levels->seq);
+}
+
+void audio_levels_process(struct audio_levels *levels,
+		const struct audio_data *data, bool true_peak, bool muted)
+{
+	int nr_channels = get_nr_channels_from_audio_data(data);
+
+	update_audio_format(levels);
+
+	process_peak(levels, data, nr_channels, true_peak);
+	process_magnitude(levels, data, nr_channels);
+	audio_loudness_process(levels->loudness,
+			(const float *const *)data->data, data->frames);
+
+	publish_snapshot(levels, data, nr_channels, true_peak, muted);
+}
+
+/* the final compare and swap doubles as a full memory barrier, so the copy
+ * can't be reordered after the check */
+void audio_levels_get(struct audio_levels *levels,
+		struct obs_audio_levels *out)
+{
+	long seq;
+
+	do {
+		seq = os_atomic_load_long(&levels->seq);
+		if (seq & 1)
+			continue;
+
+		*out = levels->snapshot;
+	} while ((seq & 1) ||
+	         !os_atomic_compare_swap_long(&levels->seq, seq, seq));
+}
+
+void obs_source_audio_levels_addref(obs_source_t *source)
+{
+	pthread_mutex_lock(&source->audio_cb_mutex);
+	if (!source->audio_levels)
+		source->audio_levels = audio_levels_create(source);
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+
+	os_atomic_inc_long(&source->audio_levels_refs);
+}
+
+void obs_source_audio_levels_release(obs_source_t *source)
+{
+	os_atomic_dec_long(&source->audio_levels_refs);
+}
+
+void obs_source_audio_levels_set_true_peak(obs_source_t *source, bool enable)
+{
+	if (enable)
+		os_atomic_inc_long(&source->audio_levels_true_peak_refs);
+	else
+		os_atomic_dec_long(&source->audio_levels_true_peak_refs);
+}
+
+bool obs_source_get_audio_levels(obs_source_t *source,
+		struct obs_audio_levels *levels)
+{
+	if (!obs_source_valid(source, "obs_source_get_audio_levels"))
+		return false;
+	if (!os_atomic_load_long(&source->audio_levels_refs))
+		return false;
+
+	audio_levels_get(source->audio_levels, levels);
+	return true;
+}
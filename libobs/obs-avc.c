@@ -15,10 +15,15 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <emmintrin.h>
+
 #include "obs.h"
 #include "obs-avc.h"
+#include "obs-internal.h"
 #include "util/array-serializer.h"
 
+static pthread_mutex_t avc_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 bool obs_avc_keyframe(const uint8_t *data, size_t size)
 {
 	const uint8_t *nal_start, *nal_end;
@@ -44,50 +49,54 @@ bool obs_avc_keyframe(const uint8_t *data, size_t size)
 	return false;
 }
 
-/* NOTE: I noticed that FFmpeg does some unusual special handling of certain
- * scenarios that I was unaware of, so instead of just searching for {0, 0, 1}
- * we'll just use the code from FFmpeg - http://www.ffmpeg.org/ */
-static const uint8_t *ff_avc_find_startcode_internal(const uint8_t *p,
+static inline const uint8_t *find_startcode_scalar(const uint8_t *p,
 		const uint8_t *end)
 {
-	const uint8_t *a = p + 4 - ((intptr_t)p & 3);
-
-	for (end -= 3; p < a && p < end; p++) {
+	for (; end - p >= 3; p++) {
 		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
 			return p;
 	}
 
-	for (end -= 3; p < end; p += 4) {
-		uint32_t x = *(const uint32_t*)p;
-
-		if ((x - 0x01010101) & (~x) & 0x80808080) {
-			if (p[1] == 0) {
-				if (p[0] == 0 && p[2] == 1)
-					return p;
-				if (p[2] == 0 && p[3] == 1)
-					return p+1;
-			}
+	return end;
+}
 
-			if (p[3] == 0) {
-				if (p[2] == 0 && p[4] == 1)
-					return p+2;
-				if (p[4] == 0 && p[5] == 1)
-					return p+3;
+/* Finds the first {0, 0, 1} sequence, or returns 'end' if there is none.
+ * Sixteen candidate positions are tested at once by comparing the bytes at
+ * p, p+1 and p+2 in parallel, which is considerably faster than the
+ * word-at-a-time search FFmpeg uses on large slices. */
+static const uint8_t *find_startcode_internal(const uint8_t *p,
+		const uint8_t *end)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one  = _mm_set1_epi8(1);
+
+	/* each iteration reads up to p[17] */
+	while (end - p >= 18) {
+		__m128i b0 = _mm_loadu_si128((const __m128i*)p);
+		__m128i b1 = _mm_loadu_si128((const __m128i*)(p + 1));
+		__m128i b2 = _mm_loadu_si128((const __m128i*)(p + 2));
+		__m128i hit = _mm_and_si128(
+				_mm_and_si128(_mm_cmpeq_epi8(b0, zero),
+				              _mm_cmpeq_epi8(b1, zero)),
+				_mm_cmpeq_epi8(b2, one));
+		int mask = _mm_movemask_epi8(hit);
+
+		if (mask) {
+			for (int i = 0; i < 16; i++) {
+				if (mask & (1 << i))
+					return p + i;
 			}
 		}
-	}
 
-	for (end += 3; p < end; p++) {
-		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
-			return p;
+		p += 16;
 	}
 
-	return end + 3;
+	return find_startcode_scalar(p, end);
 }
 
 const uint8_t *obs_avc_find_startcode(const uint8_t *p, const uint8_t *end)
 {
-	const uint8_t *out= ff_avc_find_startcode_internal(p, end);
+	const uint8_t *out = find_startcode_internal(p, end);
 	if (p < out && out < end && !out[-1]) out--;
 	return out;
 }
@@ -132,18 +141,46 @@ void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 {
 	struct array_output_data output;
 	struct serializer s;
-	long ref = 1;
+	uint8_t header[ENCODER_PACKET_HEADER_SIZE] = {0};
 
 	array_output_serializer_init(&s, &output);
 	*avc_packet = *src;
 
-	serialize(&s, &ref, sizeof(ref));
+	s_write(&s, header, sizeof(header));
 	serialize_avc_data(&s, src->data, src->size, &avc_packet->keyframe,
 			&avc_packet->priority);
 
-	avc_packet->data          = output.bytes.array + sizeof(ref);
-	avc_packet->size          = output.bytes.num - sizeof(ref);
+	avc_packet->data          = output.bytes.array + sizeof(header);
+	avc_packet->size          = output.bytes.num - sizeof(header);
 	avc_packet->drop_priority = get_drop_priority(avc_packet->priority);
+	init_encoder_packet_header(avc_packet->data);
+}
+
+void obs_parse_avc_packet_ref(struct encoder_packet *avc_packet,
+		const struct encoder_packet *src)
+{
+	struct encoder_packet_header *header =
+		get_encoder_packet_header(src->data);
+	struct encoder_packet *cached;
+
+	pthread_mutex_lock(&avc_cache_mutex);
+	if (!header->avc) {
+		header->avc = bmalloc(sizeof(struct encoder_packet));
+		obs_parse_avc_packet(header->avc, src);
+	}
+
+	cached = header->avc;
+	os_atomic_inc_long(&get_encoder_packet_header(cached->data)->refs);
+	pthread_mutex_unlock(&avc_cache_mutex);
+
+	/* timestamps can differ between the copies each output holds, so only
+	 * the converted data and what was parsed from it come from the cache */
+	*avc_packet               = *src;
+	avc_packet->data          = cached->data;
+	avc_packet->size          = cached->size;
+	avc_packet->keyframe      = cached->keyframe;
+	avc_packet->priority      = cached->priority;
+	avc_packet->drop_priority = cached->drop_priority;
 }
 
 static inline bool has_start_code(const uint8_t *data)
@@ -53,6 +53,12 @@ EXPORT const uint8_t *obs_avc_find_startcode(const uint8_t *p,
 		const uint8_t *end);
 EXPORT void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 		const struct encoder_packet *src);
+
+/* Same as obs_parse_avc_packet, but for reference counted packets given to
+ * outputs: the conversion is done once per packet and shared between every
+ * caller.  Release the result with obs_encoder_packet_release. */
+EXPORT void obs_parse_avc_packet_ref(struct encoder_packet *avc_packet,
+		const struct encoder_packet *src);
 EXPORT size_t obs_parse_avc_header(uint8_t **header, const uint8_t *data,
 		size_t size);
 EXPORT void obs_extract_avc_headers(const uint8_t *packet, size_t size,
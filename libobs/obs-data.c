@@ -26,7 +26,10 @@
 #include "graphics/quat.h"
 #include "obs-data.h"
 
-#include <jansson.h>
+#include <locale.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
 
 struct obs_data_item {
 	volatile long        ref;
@@ -468,155 +471,1310 @@ static inline void obs_data_item_set_autoselect_data(
 }
 
 /* ------------------------------------------------------------------------- */
+/* JSON reader.  Parses text directly into obs_data without building a
+ * jansson tree first, accepting the same input as json_loads with
+ * JSON_REJECT_DUPLICATES. */
+
+#define JSON_MAX_DEPTH 2048
+
+/* keys of the object being read at a depth.  key stays valid while its
+ * value is read, seen holds every key of the object read so far (null
+ * separated) so duplicates are rejected even when their values are not
+ * stored, such as null values or objects that are only parsed */
+struct json_object_keys {
+	struct dstr key;
+	struct dstr seen;
+};
+
+struct json_reader {
+	const char          *pos;
+	int                 line;
+	int                 depth;
+	struct dstr         str;
+	DARRAY(struct json_object_keys) keys;
+	char                error[128];
+};
+
+static bool json_error(struct json_reader *r, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(r->error, sizeof(r->error), format, args);
+	va_end(args);
+	return false;
+}
+
+static inline void json_skip_whitespace(struct json_reader *r)
+{
+	for (;;) {
+		char c = *r->pos;
+
+		if (c == '\n')
+			r->line++;
+		else if (c != ' ' && c != '\t' && c != '\r')
+			return;
+
+		r->pos++;
+	}
+}
+
+static inline void json_str_clear(struct dstr *str)
+{
+	if (str->array) {
+		str->array[0] = 0;
+		str->len = 0;
+	}
+}
+
+/* returns the length of a valid UTF-8 sequence, or 0 if invalid */
+static size_t json_utf8_sequence(const char *str)
+{
+	const uint8_t *s = (const uint8_t*)str;
+	uint32_t value;
+	size_t size;
+
+	if (s[0] < 0x80)
+		return 1;
+	else if (s[0] >= 0xC2 && s[0] <= 0xDF)
+		size = 2, value = s[0] & 0x1F;
+	else if (s[0] >= 0xE0 && s[0] <= 0xEF)
+		size = 3, value = s[0] & 0x0F;
+	else if (s[0] >= 0xF0 && s[0] <= 0xF4)
+		size = 4, value = s[0] & 0x07;
+	else
+		return 0;
+
+	for (size_t i = 1; i < size; i++) {
+		if (s[i] < 0x80 || s[i] > 0xBF)
+			return 0;
+		value = (value << 6) | (s[i] & 0x3F);
+	}
+
+	if (value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+		return 0;
+	if ((size == 3 && value < 0x800) || (size == 4 && value < 0x10000))
+		return 0;
+
+	return size;
+}
 
-static void obs_data_add_json_item(obs_data_t *data, const char *key,
-		json_t *json);
+static bool json_utf8_valid(const char *str)
+{
+	while (*str) {
+		size_t size = json_utf8_sequence(str);
+		if (!size)
+			return false;
+		str += size;
+	}
+
+	return true;
+}
 
-static inline void obs_data_add_json_object_data(obs_data_t *data, json_t *jobj)
+static void json_cat_codepoint(struct dstr *str, uint32_t cp)
 {
-	const char *item_key;
-	json_t *jitem;
+	char buf[4];
+	size_t size;
 
-	json_object_foreach (jobj, item_key, jitem) {
-		obs_data_add_json_item(data, item_key, jitem);
+	if (cp < 0x80) {
+		buf[0] = (char)cp;
+		size = 1;
+	} else if (cp < 0x800) {
+		buf[0] = (char)(0xC0 | (cp >> 6));
+		buf[1] = (char)(0x80 | (cp & 0x3F));
+		size = 2;
+	} else if (cp < 0x10000) {
+		buf[0] = (char)(0xE0 | (cp >> 12));
+		buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		buf[2] = (char)(0x80 | (cp & 0x3F));
+		size = 3;
+	} else {
+		buf[0] = (char)(0xF0 | (cp >> 18));
+		buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+		buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		buf[3] = (char)(0x80 | (cp & 0x3F));
+		size = 4;
 	}
+
+	dstr_ncat(str, buf, size);
 }
 
-static inline void obs_data_add_json_object(obs_data_t *data, const char *key,
-		json_t *jobj)
+static bool json_read_hex4(const char *pos, uint32_t *value)
 {
-	obs_data_t *sub_obj = obs_data_create();
+	*value = 0;
 
-	obs_data_add_json_object_data(sub_obj, jobj);
-	obs_data_set_obj(data, key, sub_obj);
-	obs_data_release(sub_obj);
+	for (int i = 0; i < 4; i++) {
+		char c = pos[i];
+		uint32_t digit;
+
+		if (c >= '0' && c <= '9')
+			digit = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			digit = c - 'A' + 10;
+		else
+			return false;
+
+		*value = (*value << 4) | digit;
+	}
+
+	return true;
+}
+
+static bool json_read_unicode_escape(struct json_reader *r, struct dstr *str)
+{
+	uint32_t cp;
+	uint32_t low;
+
+	/* r->pos is at the 'u' */
+	if (!json_read_hex4(r->pos + 1, &cp))
+		return json_error(r, "invalid Unicode escape '\\u%.4s'",
+				r->pos + 1);
+	r->pos += 5;
+
+	if (cp >= 0xD800 && cp <= 0xDBFF) {
+		if (r->pos[0] != '\\' || r->pos[1] != 'u')
+			return json_error(r, "invalid Unicode '\\u%04X'", cp);
+		if (!json_read_hex4(r->pos + 2, &low))
+			return json_error(r, "invalid Unicode escape '\\u%.4s'",
+					r->pos + 2);
+		if (low < 0xDC00 || low > 0xDFFF)
+			return json_error(r, "invalid Unicode '\\u%04X\\u%04X'",
+					cp, low);
+
+		cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+		r->pos += 6;
+
+	} else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+		return json_error(r, "invalid Unicode '\\u%04X'", cp);
+
+	} else if (cp == 0) {
+		return json_error(r, "\\u0000 is not supported");
+	}
+
+	json_cat_codepoint(str, cp);
+	return true;
 }
 
-static void obs_data_add_json_array(obs_data_t *data, const char *key,
-		json_t *jarray)
+/* unescaped runs of the string are copied in one go */
+static bool json_read_string(struct json_reader *r, struct dstr *str)
 {
-	obs_data_array_t *array = obs_data_array_create();
-	size_t idx;
-	json_t *jitem;
+	const char *start = ++r->pos;
 
-	json_array_foreach (jarray, idx, jitem) {
-		obs_data_t *item;
+	json_str_clear(str);
 
-		if (!json_is_object(jitem))
+	for (;;) {
+		uint8_t c = (uint8_t)*r->pos;
+		const char *esc;
+
+		if (c == '"')
+			break;
+
+		if (c >= 0x80) {
+			size_t size = json_utf8_sequence(r->pos);
+			if (!size)
+				return json_error(r, "invalid UTF-8");
+			r->pos += size;
 			continue;
 
-		item = obs_data_create();
-		obs_data_add_json_object_data(item, jitem);
-		obs_data_array_push_back(array, item);
-		obs_data_release(item);
+		} else if (c == 0) {
+			return json_error(r, "premature end of input");
+
+		} else if (c == '\n') {
+			return json_error(r, "unexpected newline");
+
+		} else if (c < 0x20) {
+			return json_error(r, "control character 0x%x", c);
+
+		} else if (c != '\\') {
+			r->pos++;
+			continue;
+		}
+
+		dstr_ncat(str, start, r->pos - start);
+		r->pos++;
+
+		switch (*r->pos) {
+		case '"':  esc = "\""; break;
+		case '\\': esc = "\\"; break;
+		case '/':  esc = "/";  break;
+		case 'b':  esc = "\b"; break;
+		case 'f':  esc = "\f"; break;
+		case 'n':  esc = "\n"; break;
+		case 'r':  esc = "\r"; break;
+		case 't':  esc = "\t"; break;
+		case 'u':  esc = NULL; break;
+		default:
+			return json_error(r, "invalid escape");
+		}
+
+		if (esc) {
+			dstr_cat_ch(str, *esc);
+			r->pos++;
+		} else if (!json_read_unicode_escape(r, str)) {
+			return false;
+		}
+
+		start = r->pos;
 	}
 
-	obs_data_set_array(data, key, array);
-	obs_data_array_release(array);
+	dstr_ncat(str, start, r->pos - start);
+	r->pos++;
+	return true;
 }
 
-static void obs_data_add_json_item(obs_data_t *data, const char *key,
-		json_t *json)
+static inline bool json_is_digit(char c)
 {
-	if (json_is_object(json))
-		obs_data_add_json_object(data, key, json);
-	else if (json_is_array(json))
-		obs_data_add_json_array(data, key, json);
-	else if (json_is_string(json))
-		obs_data_set_string(data, key, json_string_value(json));
-	else if (json_is_integer(json))
-		obs_data_set_int(data, key, json_integer_value(json));
-	else if (json_is_real(json))
-		obs_data_set_double(data, key, json_real_value(json));
-	else if (json_is_true(json))
-		obs_data_set_bool(data, key, true);
-	else if (json_is_false(json))
-		obs_data_set_bool(data, key, false);
+	return c >= '0' && c <= '9';
 }
 
-/* ------------------------------------------------------------------------- */
+/* like os_strtod, without its length limit */
+static double json_strtod(char *str)
+{
+	const char *point = localeconv()->decimal_point;
+
+	if (*point != '.') {
+		char *pos = strchr(str, '.');
+		if (pos)
+			*pos = *point;
+	}
+
+	return strtod(str, NULL);
+}
+
+static bool json_read_number(struct json_reader *r, obs_data_t *data,
+		const char *key)
+{
+	const char *start = r->pos;
+	const char *pos = r->pos;
+	bool negative = *pos == '-';
+	bool real = false;
+
+	if (negative)
+		pos++;
+
+	if (*pos == '0') {
+		pos++;
+	} else if (json_is_digit(*pos)) {
+		while (json_is_digit(*pos))
+			pos++;
+	} else {
+		return json_error(r, "invalid token");
+	}
+
+	if (*pos == '.') {
+		if (!json_is_digit(*++pos))
+			return json_error(r, "invalid token");
+		while (json_is_digit(*pos))
+			pos++;
+		real = true;
+	}
+
+	if (*pos == 'e' || *pos == 'E') {
+		pos++;
+		if (*pos == '+' || *pos == '-')
+			pos++;
+		if (!json_is_digit(*pos))
+			return json_error(r, "invalid token");
+		while (json_is_digit(*pos))
+			pos++;
+		real = true;
+	}
+
+	if (json_is_digit(*pos))
+		return json_error(r, "invalid token");
+
+	dstr_ncopy(&r->str, start, pos - start);
+	r->pos = pos;
+	errno = 0;
+
+	if (real) {
+		double val = json_strtod(r->str.array);
+		if ((val == HUGE_VAL || val == -HUGE_VAL) && errno == ERANGE)
+			return json_error(r, "real number overflow");
+		if (data)
+			obs_data_set_double(data, key, val);
+
+	} else {
+		long long val = strtoll(r->str.array, NULL, 10);
+		if (errno == ERANGE)
+			return json_error(r, negative ?
+					"too big negative integer" :
+					"too big integer");
+		if (data)
+			obs_data_set_int(data, key, val);
+	}
+
+	return true;
+}
+
+static bool json_read_literal(struct json_reader *r, const char *literal)
+{
+	size_t len = strlen(literal);
+
+	if (strncmp(r->pos, literal, len) != 0 ||
+	    isalpha((unsigned char)r->pos[len]))
+		return json_error(r, "invalid token");
+
+	r->pos += len;
+	return true;
+}
+
+static bool json_read_value(struct json_reader *r, obs_data_t *data,
+		const char *key);
+
+static inline struct json_object_keys *json_get_object_keys(
+		struct json_reader *r)
+{
+	if (r->keys.num <= (size_t)r->depth)
+		da_resize(r->keys, r->depth + 1);
+
+	return &r->keys.array[r->depth];
+}
+
+/* returns false if the key was already seen, otherwise adds it */
+static bool json_add_object_key(struct json_object_keys *keys)
+{
+	const char *name = keys->key.array ? keys->key.array : "";
+	const char *pos = keys->seen.array;
+	const char *end = pos + keys->seen.len;
+	size_t len = keys->key.len;
+
+	while (pos < end) {
+		size_t cur_len = strlen(pos);
 
-static inline void set_json_string(json_t *json, const char *name,
-		obs_data_item_t *item)
+		if (cur_len == len && memcmp(pos, name, len) == 0)
+			return false;
+
+		pos += cur_len + 1;
+	}
+
+	dstr_ncat(&keys->seen, name, len);
+	dstr_cat_ch(&keys->seen, 0);
+	return true;
+}
+
+/* data is NULL for objects that are only parsed, not stored */
+static bool json_read_object(struct json_reader *r, obs_data_t *data)
+{
+	struct json_object_keys *keys = json_get_object_keys(r);
+
+	json_str_clear(&keys->seen);
+
+	r->pos++;
+	json_skip_whitespace(r);
+
+	if (*r->pos == '}') {
+		r->pos++;
+		return true;
+	}
+
+	for (;;) {
+		const char *name;
+
+		/* nested values may have grown the array */
+		keys = &r->keys.array[r->depth];
+
+		if (*r->pos != '"')
+			return json_error(r, "string or '}' expected");
+		if (!json_read_string(r, &keys->key))
+			return false;
+
+		if (!json_add_object_key(keys))
+			return json_error(r, "duplicate object key");
+
+		name = keys->key.array ? keys->key.array : "";
+
+		json_skip_whitespace(r);
+		if (*r->pos != ':')
+			return json_error(r, "':' expected");
+
+		r->pos++;
+		json_skip_whitespace(r);
+
+		if (!json_read_value(r, data, name))
+			return false;
+
+		json_skip_whitespace(r);
+		if (*r->pos == '}') {
+			r->pos++;
+			return true;
+		} else if (*r->pos != ',') {
+			return json_error(r, "'}' expected");
+		}
+
+		r->pos++;
+		json_skip_whitespace(r);
+	}
+}
+
+/* only objects are stored in obs_data arrays, anything else is skipped */
+static bool json_read_array(struct json_reader *r, obs_data_array_t *array)
+{
+	r->pos++;
+	json_skip_whitespace(r);
+
+	if (*r->pos == ']') {
+		r->pos++;
+		return true;
+	}
+
+	for (;;) {
+		bool success;
+
+		if (array && *r->pos == '{') {
+			obs_data_t *item = obs_data_create();
+
+			if (++r->depth > JSON_MAX_DEPTH)
+				success = json_error(r,
+						"maximum parsing depth reached");
+			else
+				success = json_read_object(r, item);
+			r->depth--;
+
+			if (success)
+				obs_data_array_push_back(array, item);
+			obs_data_release(item);
+		} else {
+			success = json_read_value(r, NULL, NULL);
+		}
+
+		if (!success)
+			return false;
+
+		json_skip_whitespace(r);
+		if (*r->pos == ']') {
+			r->pos++;
+			return true;
+		} else if (*r->pos != ',') {
+			return json_error(r, "']' expected");
+		}
+
+		r->pos++;
+		json_skip_whitespace(r);
+	}
+}
+
+static bool json_read_value(struct json_reader *r, obs_data_t *data,
+		const char *key)
 {
-	const char *val = obs_data_item_get_string(item);
-	json_object_set_new(json, name, json_string(val));
+	bool success = false;
+
+	if (++r->depth > JSON_MAX_DEPTH) {
+		r->depth--;
+		return json_error(r, "maximum parsing depth reached");
+	}
+
+	switch (*r->pos) {
+	case '{': {
+		obs_data_t *obj = data ? obs_data_create() : NULL;
+
+		success = json_read_object(r, obj);
+		if (success && data)
+			obs_data_set_obj(data, key, obj);
+		obs_data_release(obj);
+		break;
+	}
+	case '[': {
+		obs_data_array_t *array = data ? obs_data_array_create() : NULL;
+
+		success = json_read_array(r, array);
+		if (success && data)
+			obs_data_set_array(data, key, array);
+		obs_data_array_release(array);
+		break;
+	}
+	case '"':
+		success = json_read_string(r, &r->str);
+		if (success && data)
+			obs_data_set_string(data, key,
+					r->str.array ? r->str.array : "");
+		break;
+	case 't':
+		success = json_read_literal(r, "true");
+		if (success && data)
+			obs_data_set_bool(data, key, true);
+		break;
+	case 'f':
+		success = json_read_literal(r, "false");
+		if (success && data)
+			obs_data_set_bool(data, key, false);
+		break;
+	case 'n':
+		success = json_read_literal(r, "null");
+		break;
+	case '\0':
+		success = json_error(r, "premature end of input");
+		break;
+	default:
+		if (*r->pos == '-' || json_is_digit(*r->pos))
+			success = json_read_number(r, data, key);
+		else
+			success = json_error(r, "invalid token");
+	}
+
+	r->depth--;
+	return success;
 }
 
-static inline void set_json_number(json_t *json, const char *name,
-		obs_data_item_t *item)
+/* a top-level array is accepted but its contents are discarded */
+static bool json_read(obs_data_t *data, const char *json, int *line,
+		char *error, size_t error_size)
 {
-	enum obs_data_number_type type = obs_data_item_numtype(item);
+	struct json_reader r = {0};
+	bool success;
 
-	if (type == OBS_DATA_NUM_INT) {
-		long long val = obs_data_item_get_int(item);
-		json_object_set_new(json, name, json_integer(val));
+	r.pos  = json;
+	r.line = 1;
+
+	json_skip_whitespace(&r);
+
+	if (*r.pos == '{' || *r.pos == '[') {
+		r.depth = 1;
+		success = *r.pos == '{' ?
+			json_read_object(&r, data) :
+			json_read_array(&r, NULL);
 	} else {
-		double val = obs_data_item_get_double(item);
-		json_object_set_new(json, name, json_real(val));
+		success = json_error(&r, "'[' or '{' expected");
+	}
+
+	if (success) {
+		json_skip_whitespace(&r);
+		if (*r.pos)
+			success = json_error(&r, "end of file expected");
+	}
+
+	if (!success) {
+		*line = r.line;
+		strncpy(error, r.error, error_size - 1);
+		error[error_size - 1] = 0;
+	}
+
+	for (size_t i = 0; i < r.keys.num; i++) {
+		dstr_free(&r.keys.array[i].key);
+		dstr_free(&r.keys.array[i].seen);
 	}
+	da_free(r.keys);
+	dstr_free(&r.str);
+	return success;
 }
 
-static inline void set_json_bool(json_t *json, const char *name,
-		obs_data_item_t *item)
+/* ------------------------------------------------------------------------- */
+/* JSON writer.  Writes obs_data directly as text, with the same output as
+ * jansson's json_dumps with JSON_PRESERVE_ORDER | JSON_INDENT(4). */
+
+#define JSON_INDENT 4
+
+static inline void json_write_indent(struct dstr *json, int depth)
 {
-	bool val = obs_data_item_get_bool(item);
-	json_object_set_new(json, name, val ? json_true() : json_false());
+	static const char spaces[] = "                                ";
+	size_t count = (size_t)depth * JSON_INDENT;
+
+	dstr_cat_ch(json, '\n');
+
+	while (count) {
+		size_t size = count < sizeof(spaces) - 1 ?
+			count : sizeof(spaces) - 1;
+		dstr_ncat(json, spaces, size);
+		count -= size;
+	}
 }
 
-static json_t *obs_data_to_json(obs_data_t *data);
+static void json_write_string(struct dstr *json, const char *str)
+{
+	const char *start = str;
+	const char *pos = str;
+
+	dstr_cat_ch(json, '"');
+
+	for (; *pos; pos++) {
+		uint8_t c = (uint8_t)*pos;
+		char seq[8];
+		const char *esc;
+
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		switch (c) {
+		case '"':  esc = "\\\""; break;
+		case '\\': esc = "\\\\"; break;
+		case '\b': esc = "\\b";  break;
+		case '\f': esc = "\\f";  break;
+		case '\n': esc = "\\n";  break;
+		case '\r': esc = "\\r";  break;
+		case '\t': esc = "\\t";  break;
+		default:
+			snprintf(seq, sizeof(seq), "\\u%04X", c);
+			esc = seq;
+		}
 
-static inline void set_json_obj(json_t *json, const char *name,
-		obs_data_item_t *item)
+		dstr_ncat(json, start, pos - start);
+		dstr_cat(json, esc);
+		start = pos + 1;
+	}
+
+	dstr_ncat(json, start, pos - start);
+	dstr_cat_ch(json, '"');
+}
+
+/* items jansson can't represent (invalid UTF-8 and non-finite numbers) are
+ * left out, like they were when the data was converted to a json_t tree */
+static bool json_item_writable(struct obs_data_item *item)
 {
-	obs_data_t *obj = obs_data_item_get_obj(item);
-	json_object_set_new(json, name, obs_data_to_json(obj));
-	obs_data_release(obj);
+	if (!obs_data_item_has_user_value(item))
+		return false;
+	if (!json_utf8_valid(get_item_name(item)))
+		return false;
+
+	if (item->type == OBS_DATA_STRING) {
+		return json_utf8_valid(get_item_data(item));
+
+	} else if (item->type == OBS_DATA_NUMBER) {
+		struct obs_data_number *num = get_item_data(item);
+		return num->type == OBS_DATA_NUM_INT ||
+			isfinite(num->double_val);
+	}
+
+	return item->type == OBS_DATA_BOOLEAN ||
+		item->type == OBS_DATA_OBJECT ||
+		item->type == OBS_DATA_ARRAY;
 }
 
-static inline void set_json_array(json_t *json, const char *name,
-		obs_data_item_t *item)
+static void json_write_obj(struct dstr *json, obs_data_t *data, int depth);
+
+static void json_write_array(struct dstr *json, obs_data_array_t *array,
+		int depth)
 {
-	json_t           *jarray = json_array();
-	obs_data_array_t *array   = obs_data_item_get_array(item);
-	size_t           count   = obs_data_array_count(array);
+	size_t count = array ? array->objects.num : 0;
+
+	dstr_cat_ch(json, '[');
 
-	for (size_t idx = 0; idx < count; idx++) {
-		obs_data_t *sub_item = obs_data_array_item(array, idx);
-		json_t     *jitem   = obs_data_to_json(sub_item);
-		json_array_append_new(jarray, jitem);
-		obs_data_release(sub_item);
+	for (size_t i = 0; i < count; i++) {
+		if (i)
+			dstr_cat_ch(json, ',');
+		json_write_indent(json, depth + 1);
+		json_write_obj(json, array->objects.array[i], depth + 1);
 	}
 
-	json_object_set_new(json, name, jarray);
-	obs_data_array_release(array);
+	if (count)
+		json_write_indent(json, depth);
+	dstr_cat_ch(json, ']');
 }
 
-static json_t *obs_data_to_json(obs_data_t *data)
+static void json_write_item(struct dstr *json, struct obs_data_item *item,
+		int depth)
 {
-	json_t *json = json_object();
-	obs_data_item_t *item = NULL;
+	struct obs_data_number *num;
+	char buf[100];
+	int len;
+
+	switch (item->type) {
+	case OBS_DATA_STRING:
+		json_write_string(json, get_item_data(item));
+		break;
+	case OBS_DATA_NUMBER:
+		num = get_item_data(item);
+		if (num->type == OBS_DATA_NUM_INT)
+			len = snprintf(buf, sizeof(buf), "%lld", num->int_val);
+		else
+			len = os_dtostr(num->double_val, buf, sizeof(buf));
+		if (len > 0)
+			dstr_ncat(json, buf, len);
+		break;
+	case OBS_DATA_BOOLEAN:
+		dstr_cat(json, *(bool*)get_item_data(item) ? "true" : "false");
+		break;
+	case OBS_DATA_OBJECT:
+		json_write_obj(json, get_item_obj(item), depth);
+		break;
+	case OBS_DATA_ARRAY:
+		json_write_array(json, get_item_array(item), depth);
+		break;
+	case OBS_DATA_NULL:
+		break;
+	}
+}
+
+static void json_write_obj(struct dstr *json, obs_data_t *data, int depth)
+{
+	struct obs_data_item *item = data ? data->first_item : NULL;
+	bool empty = true;
 
-	for (item = obs_data_first(data); item; obs_data_item_next(&item)) {
-		enum obs_data_type type = obs_data_item_gettype(item);
-		const char *name        = get_item_name(item);
+	dstr_cat_ch(json, '{');
 
-		if (!obs_data_item_has_user_value(item))
+	for (; item; item = item->next) {
+		if (!json_item_writable(item))
 			continue;
 
-		if (type == OBS_DATA_STRING)
-			set_json_string(json, name, item);
-		else if (type == OBS_DATA_NUMBER)
-			set_json_number(json, name, item);
-		else if (type == OBS_DATA_BOOLEAN)
-			set_json_bool(json, name, item);
-		else if (type == OBS_DATA_OBJECT)
-			set_json_obj(json, name, item);
-		else if (type == OBS_DATA_ARRAY)
-			set_json_array(json, name, item);
+		if (!empty)
+			dstr_cat_ch(json, ',');
+		json_write_indent(json, depth + 1);
+		json_write_string(json, get_item_name(item));
+		dstr_ncat(json, ": ", 2);
+		json_write_item(json, item, depth + 1);
+		empty = false;
 	}
 
-	return json;
+	if (!empty)
+		json_write_indent(json, depth);
+	dstr_cat_ch(json, '}');
+}
+
+/* ------------------------------------------------------------------------- */
+/* Binary format.  A compact alternative to JSON for data that's loaded and
+ * saved often:
+ *
+ *   file     "OBSD", u32 version, u32 key count, the key table (one string
+ *            per key) and then the root object
+ *   object   u32 byte size of the rest of the object, varint item count, and
+ *            per item a varint key index, a u8 type and the value
+ *   array    u32 byte size of the rest of the array, varint object count and
+ *            the objects
+ *   string   varint length, the text and a null terminator
+ *   int      zigzag encoded varint
+ *   double   64-bit IEEE 754
+ *
+ * Fixed size values are little endian.  Strings keep their null terminator
+ * so keys and values can be used straight from a memory mapped file, and the
+ * sizes let a reader skip over objects and arrays it isn't interested in.
+ * Like JSON, only values that have been set by the user are stored. */
+
+#define BINARY_MAGIC   "OBSD"
+#define BINARY_VERSION 1
+
+enum binary_type {
+	BINARY_STRING = 1,
+	BINARY_INT,
+	BINARY_DOUBLE,
+	BINARY_TRUE,
+	BINARY_FALSE,
+	BINARY_OBJECT,
+	BINARY_ARRAY
+};
+
+struct binary_key {
+	const char *name;
+	uint32_t   index;
+};
+
+struct binary_writer {
+	DARRAY(uint8_t)           bytes;
+
+	/* open addressed hash table of the keys written so far */
+	DARRAY(struct binary_key) key_table;
+	DARRAY(const char*)       keys;
+};
+
+static inline void binary_write(struct binary_writer *w, const void *data,
+		size_t size)
+{
+	da_push_back_array(w->bytes, data, size);
+}
+
+static inline void binary_write_varint(struct binary_writer *w, uint64_t val)
+{
+	uint8_t buf[10];
+	size_t size = 0;
+
+	while (val >= 0x80) {
+		buf[size++] = (uint8_t)(val | 0x80);
+		val >>= 7;
+	}
+	buf[size++] = (uint8_t)val;
+
+	binary_write(w, buf, size);
+}
+
+static inline void binary_write_u32(struct binary_writer *w, uint32_t val)
+{
+	uint8_t buf[4] = {
+		(uint8_t)val,         (uint8_t)(val >> 8),
+		(uint8_t)(val >> 16), (uint8_t)(val >> 24)
+	};
+
+	binary_write(w, buf, sizeof(buf));
+}
+
+static inline void binary_write_string(struct binary_writer *w,
+		const char *str)
+{
+	size_t len = strlen(str);
+
+	binary_write_varint(w, len);
+	binary_write(w, str, len + 1);
+}
+
+/* writes a placeholder for the size of what follows */
+static inline size_t binary_begin_size(struct binary_writer *w)
+{
+	binary_write_u32(w, 0);
+	return w->bytes.num;
+}
+
+static inline void binary_end_size(struct binary_writer *w, size_t start)
+{
+	uint32_t size = (uint32_t)(w->bytes.num - start);
+	uint8_t *dst = w->bytes.array + start - 4;
+
+	dst[0] = (uint8_t)size;
+	dst[1] = (uint8_t)(size >> 8);
+	dst[2] = (uint8_t)(size >> 16);
+	dst[3] = (uint8_t)(size >> 24);
+}
+
+static inline uint32_t binary_hash(const char *str)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*str)
+		hash = (hash ^ (uint8_t)*str++) * 16777619U;
+
+	return hash;
+}
+
+static void binary_key_table_insert(struct binary_writer *w, const char *name,
+		uint32_t index)
+{
+	size_t mask = w->key_table.num - 1;
+	size_t slot = binary_hash(name) & mask;
+
+	while (w->key_table.array[slot].name)
+		slot = (slot + 1) & mask;
+
+	w->key_table.array[slot].name  = name;
+	w->key_table.array[slot].index = index;
+}
+
+static uint32_t binary_key_index(struct binary_writer *w, const char *name)
+{
+	size_t mask;
+	size_t slot;
+
+	if ((w->keys.num + 1) * 2 > w->key_table.num) {
+		da_free(w->key_table);
+		da_resize(w->key_table, w->keys.num ? w->keys.num * 4 : 64);
+
+		for (size_t i = 0; i < w->keys.num; i++)
+			binary_key_table_insert(w, w->keys.array[i],
+					(uint32_t)i);
+	}
+
+	mask = w->key_table.num - 1;
+	slot = binary_hash(name) & mask;
+
+	while (w->key_table.array[slot].name) {
+		struct binary_key *key = &w->key_table.array[slot];
+		if (strcmp(key->name, name) == 0)
+			return key->index;
+
+		slot = (slot + 1) & mask;
+	}
+
+	w->key_table.array[slot].name  = name;
+	w->key_table.array[slot].index = (uint32_t)w->keys.num;
+	da_push_back(w->keys, &name);
+	return (uint32_t)w->keys.num - 1;
+}
+
+static void binary_write_obj(struct binary_writer *w, obs_data_t *data);
+
+static void binary_write_array(struct binary_writer *w,
+		obs_data_array_t *array)
+{
+	size_t count = array ? array->objects.num : 0;
+	size_t start = binary_begin_size(w);
+
+	binary_write_varint(w, count);
+	for (size_t i = 0; i < count; i++)
+		binary_write_obj(w, array->objects.array[i]);
+
+	binary_end_size(w, start);
+}
+
+static void binary_write_item(struct binary_writer *w,
+		struct obs_data_item *item)
+{
+	struct obs_data_number *num;
+	uint8_t type;
+
+	binary_write_varint(w, binary_key_index(w, get_item_name(item)));
+
+	switch (item->type) {
+	case OBS_DATA_STRING:
+		type = BINARY_STRING;
+		binary_write(w, &type, 1);
+		binary_write_string(w, get_item_data(item));
+		break;
+
+	case OBS_DATA_NUMBER:
+		num = get_item_data(item);
+		if (num->type == OBS_DATA_NUM_INT) {
+			uint64_t val = (uint64_t)num->int_val;
+
+			type = BINARY_INT;
+			binary_write(w, &type, 1);
+			binary_write_varint(w, (val << 1) ^
+					(num->int_val < 0 ? ~0ULL : 0));
+		} else {
+			uint64_t val;
+
+			memcpy(&val, &num->double_val, sizeof(val));
+			type = BINARY_DOUBLE;
+			binary_write(w, &type, 1);
+			binary_write_u32(w, (uint32_t)val);
+			binary_write_u32(w, (uint32_t)(val >> 32));
+		}
+		break;
+
+	case OBS_DATA_BOOLEAN:
+		type = *(bool*)get_item_data(item) ? BINARY_TRUE : BINARY_FALSE;
+		binary_write(w, &type, 1);
+		break;
+
+	case OBS_DATA_OBJECT:
+		type = BINARY_OBJECT;
+		binary_write(w, &type, 1);
+		binary_write_obj(w, get_item_obj(item));
+		break;
+
+	case OBS_DATA_ARRAY:
+		type = BINARY_ARRAY;
+		binary_write(w, &type, 1);
+		binary_write_array(w, get_item_array(item));
+		break;
+
+	case OBS_DATA_NULL:
+		break;
+	}
+}
+
+static inline bool binary_item_writable(struct obs_data_item *item)
+{
+	return item->type != OBS_DATA_NULL &&
+		obs_data_item_has_user_value(item);
+}
+
+static void binary_write_obj(struct binary_writer *w, obs_data_t *data)
+{
+	struct obs_data_item *first = data ? data->first_item : NULL;
+	size_t start = binary_begin_size(w);
+	size_t count = 0;
+
+	for (struct obs_data_item *item = first; item; item = item->next) {
+		if (binary_item_writable(item))
+			count++;
+	}
+
+	binary_write_varint(w, count);
+
+	for (struct obs_data_item *item = first; item; item = item->next) {
+		if (binary_item_writable(item))
+			binary_write_item(w, item);
+	}
+
+	binary_end_size(w, start);
+}
+
+/* the key table is only known once everything else has been written, so the
+ * header is written separately and put in front of it */
+static uint8_t *binary_write_data(obs_data_t *data, size_t *size)
+{
+	struct binary_writer body   = {0};
+	struct binary_writer header = {0};
+	uint8_t *bytes;
+
+	binary_write_obj(&body, data);
+
+	binary_write(&header, BINARY_MAGIC, 4);
+	binary_write_u32(&header, BINARY_VERSION);
+	binary_write_u32(&header, (uint32_t)body.keys.num);
+	for (size_t i = 0; i < body.keys.num; i++)
+		binary_write_string(&header, body.keys.array[i]);
+
+	*size = header.bytes.num + body.bytes.num;
+	bytes = bmalloc(*size);
+	memcpy(bytes, header.bytes.array, header.bytes.num);
+	memcpy(bytes + header.bytes.num, body.bytes.array, body.bytes.num);
+
+	da_free(header.bytes);
+	da_free(body.bytes);
+	da_free(body.key_table);
+	da_free(body.keys);
+	return bytes;
+}
+
+struct binary_reader {
+	const uint8_t *pos;
+	const uint8_t *end;
+	const char    **keys;
+	size_t        key_count;
+	int           depth;
+	const char    *error;
+};
+
+static bool binary_error(struct binary_reader *r, const char *error)
+{
+	r->error = error;
+	return false;
+}
+
+static inline bool binary_read_u8(struct binary_reader *r, uint8_t *val)
+{
+	if (r->pos == r->end)
+		return binary_error(r, "unexpected end of data");
+
+	*val = *r->pos++;
+	return true;
+}
+
+static inline bool binary_read_u32(struct binary_reader *r, uint32_t *val)
+{
+	const uint8_t *p = r->pos;
+
+	if (r->end - r->pos < 4)
+		return binary_error(r, "unexpected end of data");
+
+	*val = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	r->pos += 4;
+	return true;
+}
+
+static inline bool binary_read_varint(struct binary_reader *r, uint64_t *val)
+{
+	*val = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		uint8_t byte;
+
+		if (!binary_read_u8(r, &byte))
+			return false;
+
+		*val |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+
+	return binary_error(r, "invalid varint");
+}
+
+/* returns a pointer into the data, which includes the null terminator */
+static inline bool binary_read_string(struct binary_reader *r,
+		const char **str)
+{
+	uint64_t len;
+
+	if (!binary_read_varint(r, &len))
+		return false;
+	if (len >= (uint64_t)(r->end - r->pos) || r->pos[len] != 0)
+		return binary_error(r, "invalid string");
+
+	*str = (const char*)r->pos;
+	r->pos += len + 1;
+	return true;
+}
+
+static bool binary_read_obj(struct binary_reader *r, obs_data_t *data);
+
+/* sizes are checked so that a corrupted size can't go past its parent */
+static inline bool binary_read_size(struct binary_reader *r,
+		const uint8_t **end)
+{
+	uint32_t size;
+
+	if (!binary_read_u32(r, &size))
+		return false;
+	if (size > (uint64_t)(r->end - r->pos))
+		return binary_error(r, "invalid size");
+
+	*end = r->pos + size;
+	return true;
+}
+
+static bool binary_read_array(struct binary_reader *r,
+		obs_data_array_t *array)
+{
+	const uint8_t *parent_end = r->end;
+	const uint8_t *end;
+	uint64_t count;
+
+	if (!binary_read_size(r, &end))
+		return false;
+
+	r->end = end;
+	if (!binary_read_varint(r, &count))
+		return false;
+
+	for (uint64_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_create();
+		bool success = binary_read_obj(r, item);
+
+		if (success)
+			obs_data_array_push_back(array, item);
+		obs_data_release(item);
+
+		if (!success)
+			return false;
+	}
+
+	if (r->pos != end)
+		return binary_error(r, "invalid array size");
+
+	r->end = parent_end;
+	return true;
+}
+
+static bool binary_read_item(struct binary_reader *r, obs_data_t *data)
+{
+	uint64_t key_index;
+	const char *key;
+	const char *str;
+	uint64_t val;
+	uint32_t low, high;
+	double dval;
+	uint8_t type;
+	bool success;
+
+	if (!binary_read_varint(r, &key_index))
+		return false;
+	if (key_index >= r->key_count)
+		return binary_error(r, "invalid key");
+	if (!binary_read_u8(r, &type))
+		return false;
+
+	key = r->keys[key_index];
+
+	switch (type) {
+	case BINARY_STRING:
+		if (!binary_read_string(r, &str))
+			return false;
+		obs_data_set_string(data, key, str);
+		return true;
+
+	case BINARY_INT:
+		if (!binary_read_varint(r, &val))
+			return false;
+		obs_data_set_int(data, key, (long long)(val >> 1) ^
+				-(long long)(val & 1));
+		return true;
+
+	case BINARY_DOUBLE:
+		if (!binary_read_u32(r, &low) || !binary_read_u32(r, &high))
+			return false;
+		val = ((uint64_t)high << 32) | low;
+		memcpy(&dval, &val, sizeof(dval));
+		obs_data_set_double(data, key, dval);
+		return true;
+
+	case BINARY_TRUE:
+	case BINARY_FALSE:
+		obs_data_set_bool(data, key, type == BINARY_TRUE);
+		return true;
+
+	case BINARY_OBJECT: {
+		obs_data_t *obj = obs_data_create();
+
+		success = binary_read_obj(r, obj);
+		if (success)
+			obs_data_set_obj(data, key, obj);
+		obs_data_release(obj);
+		return success;
+	}
+	case BINARY_ARRAY: {
+		obs_data_array_t *array = obs_data_array_create();
+
+		success = binary_read_array(r, array);
+		if (success)
+			obs_data_set_array(data, key, array);
+		obs_data_array_release(array);
+		return success;
+	}
+	}
+
+	return binary_error(r, "invalid type");
+}
+
+static bool binary_read_obj(struct binary_reader *r, obs_data_t *data)
+{
+	const uint8_t *parent_end = r->end;
+	const uint8_t *end;
+	uint64_t count;
+	bool success = true;
+
+	if (!binary_read_size(r, &end))
+		return false;
+
+	/* same limit as JSON */
+	if (++r->depth > JSON_MAX_DEPTH)
+		return binary_error(r, "maximum depth reached");
+
+	r->end = end;
+	if (!binary_read_varint(r, &count))
+		return false;
+
+	for (uint64_t i = 0; success && i < count; i++)
+		success = binary_read_item(r, data);
+
+	if (!success)
+		return false;
+	if (r->pos != end)
+		return binary_error(r, "invalid object size");
+
+	r->end = parent_end;
+	r->depth--;
+	return true;
+}
+
+static bool binary_read(obs_data_t *data, const uint8_t *bytes, size_t size,
+		const char **error)
+{
+	struct binary_reader r = {0};
+	uint32_t version;
+	uint32_t key_count;
+	bool success = false;
+
+	r.pos = bytes;
+	r.end = bytes + size;
+
+	if (size < 4 || memcmp(bytes, BINARY_MAGIC, 4) != 0) {
+		*error = "not obs_data binary data";
+		return false;
+	}
+
+	r.pos += 4;
+	if (!binary_read_u32(&r, &version) || !binary_read_u32(&r, &key_count))
+		goto fail;
+
+	if (version != BINARY_VERSION) {
+		binary_error(&r, "unsupported version");
+		goto fail;
+	}
+
+	/* every key takes at least two bytes */
+	if (key_count > (size_t)(r.end - r.pos) / 2) {
+		binary_error(&r, "invalid key count");
+		goto fail;
+	}
+
+	r.keys = bmalloc(sizeof(const char*) * (key_count ? key_count : 1));
+	for (; r.key_count < key_count; r.key_count++) {
+		if (!binary_read_string(&r, &r.keys[r.key_count]))
+			goto fail;
+	}
+
+	if (!binary_read_obj(&r, data))
+		goto fail;
+
+	if (r.pos != r.end)
+		binary_error(&r, "unexpected data after root object");
+	else
+		success = true;
+
+fail:
+	*error = r.error;
+	bfree(r.keys);
+	return success;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -632,17 +1790,16 @@ obs_data_t *obs_data_create()
 obs_data_t *obs_data_create_from_json(const char *json_string)
 {
 	obs_data_t *data = obs_data_create();
+	char error[128];
+	int line;
 
-	json_error_t error;
-	json_t *root = json_loads(json_string, JSON_REJECT_DUPLICATES, &error);
+	if (!json_string)
+		json_string = "";
 
-	if (root) {
-		obs_data_add_json_object_data(data, root);
-		json_decref(root);
-	} else {
+	if (!json_read(data, json_string, &line, error, sizeof(error))) {
 		blog(LOG_ERROR, "obs-data.c: [obs_data_create_from_json] "
 		                "Failed reading json string (%d): %s",
-		                error.line, error.text);
+		                line, error);
 		obs_data_release(data);
 		data = NULL;
 	}
@@ -663,28 +1820,30 @@ obs_data_t *obs_data_create_from_json_file(const char *json_file)
 	return data;
 }
 
-obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
-		const char *backup_ext)
+typedef obs_data_t *(*create_from_file_t)(const char *file);
+
+static obs_data_t *create_from_file_safe(const char *file,
+		const char *backup_ext, create_from_file_t create,
+		const char *func)
 {
-	obs_data_t *file_data = obs_data_create_from_json_file(json_file);
+	obs_data_t *file_data = create(file);
 	if (!file_data && backup_ext && *backup_ext) {
 		struct dstr backup_file = {0};
 
-		dstr_copy(&backup_file, json_file);
+		dstr_copy(&backup_file, file);
 		if (*backup_ext != '.')
 			dstr_cat(&backup_file, ".");
 		dstr_cat(&backup_file, backup_ext);
 
 		if (os_file_exists(backup_file.array)) {
-			blog(LOG_WARNING, "obs-data.c: "
-					"[obs_data_create_from_json_file_safe] "
-					"attempting backup file");
+			blog(LOG_WARNING, "obs-data.c: [%s] "
+					"attempting backup file", func);
 
 			/* delete current file if corrupt to prevent it from
 			 * being backed up again */
-			os_rename(backup_file.array, json_file);
+			os_rename(backup_file.array, file);
 
-			file_data = obs_data_create_from_json_file(json_file);
+			file_data = create(file);
 		}
 
 		dstr_free(&backup_file);
@@ -693,6 +1852,51 @@ obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
 	return file_data;
 }
 
+obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
+		const char *backup_ext)
+{
+	return create_from_file_safe(json_file, backup_ext,
+			obs_data_create_from_json_file,
+			"obs_data_create_from_json_file_safe");
+}
+
+obs_data_t *obs_data_create_from_binary(const void *bytes, size_t size)
+{
+	obs_data_t *data = obs_data_create();
+	const char *error;
+
+	if (!binary_read(data, bytes, bytes ? size : 0, &error)) {
+		blog(LOG_ERROR, "obs-data.c: [obs_data_create_from_binary] "
+		                "Failed reading binary data: %s", error);
+		obs_data_release(data);
+		data = NULL;
+	}
+
+	return data;
+}
+
+obs_data_t *obs_data_create_from_binary_file(const char *file)
+{
+	size_t size;
+	void *bytes = os_map_file(file, &size);
+	obs_data_t *data = NULL;
+
+	if (bytes) {
+		data = obs_data_create_from_binary(bytes, size);
+		os_unmap_file(bytes, size);
+	}
+
+	return data;
+}
+
+obs_data_t *obs_data_create_from_binary_file_safe(const char *file,
+		const char *backup_ext)
+{
+	return create_from_file_safe(file, backup_ext,
+			obs_data_create_from_binary_file,
+			"obs_data_create_from_binary_file_safe");
+}
+
 void obs_data_addref(obs_data_t *data)
 {
 	if (data)
@@ -709,8 +1913,7 @@ static inline void obs_data_destroy(struct obs_data *data)
 		item = next;
 	}
 
-	/* NOTE: don't use bfree for json text, allocated by json */
-	free(data->json);
+	bfree(data->json);
 	bfree(data);
 }
 
@@ -726,13 +1929,12 @@ const char *obs_data_get_json(obs_data_t *data)
 {
 	if (!data) return NULL;
 
-	/* NOTE: don't use libobs bfree for json text */
-	free(data->json);
-	data->json = NULL;
+	struct dstr json = {0};
 
-	json_t *root = obs_data_to_json(data);
-	data->json = json_dumps(root, JSON_PRESERVE_ORDER | JSON_INDENT(4));
-	json_decref(root);
+	bfree(data->json);
+
+	json_write_obj(&json, data, 0);
+	data->json = json.array;
 
 	return data->json;
 }
@@ -762,6 +1964,43 @@ bool obs_data_save_json_safe(obs_data_t *data, const char *file,
 	return false;
 }
 
+void *obs_data_get_binary(obs_data_t *data, size_t *size)
+{
+	if (!data) return NULL;
+
+	return binary_write_data(data, size);
+}
+
+bool obs_data_save_binary(obs_data_t *data, const char *file)
+{
+	size_t size;
+	void *bytes = obs_data_get_binary(data, &size);
+	bool success;
+
+	if (!bytes)
+		return false;
+
+	success = os_quick_write_utf8_file(file, bytes, size, false);
+	bfree(bytes);
+	return success;
+}
+
+bool obs_data_save_binary_safe(obs_data_t *data, const char *file,
+		const char *temp_ext, const char *backup_ext)
+{
+	size_t size;
+	void *bytes = obs_data_get_binary(data, &size);
+	bool success;
+
+	if (!bytes)
+		return false;
+
+	success = os_quick_write_utf8_file_safe(file, bytes, size, false,
+			temp_ext, backup_ext);
+	bfree(bytes);
+	return success;
+}
+
 static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 {
 	if (!data) return NULL;
@@ -25,14 +25,8 @@
 
 struct obs_encoder_info *find_encoder(const char *id)
 {
-	for (size_t i = 0; i < obs->encoder_types.num; i++) {
-		struct obs_encoder_info *info = obs->encoder_types.array+i;
-
-		if (strcmp(info->id, id) == 0)
-			return info;
-	}
-
-	return NULL;
+	return obs_type_index_find_da(&obs->encoder_types_index,
+			obs->encoder_types, struct obs_encoder_info, id);
 }
 
 const char *obs_encoder_get_display_name(const char *id)
@@ -719,6 +713,7 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 		struct encoder_callback *cb, struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
+	struct encoder_packet sei_packet;
 	DARRAY(uint8_t)       data;
 	uint8_t               *sei;
 	size_t                size;
@@ -738,14 +733,18 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	da_push_back_array(data, sei, size);
 	da_push_back_array(data, packet->data, packet->size);
 
-	first_packet      = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	sei_packet      = *packet;
+	sei_packet.data = data.array;
+	sei_packet.size = data.num;
+
+	/* outputs expect reference counted packets */
+	obs_encoder_packet_create_instance(&first_packet, &sei_packet);
+	da_free(data);
 
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static inline void send_packet(struct obs_encoder *encoder,
@@ -811,10 +810,20 @@ static inline void do_encode(struct obs_encoder *encoder,
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
-		for (size_t i = encoder->callbacks.num; i > 0; i--) {
-			struct encoder_callback *cb;
-			cb = encoder->callbacks.array+(i-1);
-			send_packet(encoder, cb, &pkt);
+		/* every output gets a reference to the same copy of the
+		 * packet, so anything cached in its header (such as the AVCC
+		 * conversion) is only created once */
+		if (encoder->callbacks.num) {
+			struct encoder_packet shared;
+			obs_encoder_packet_create_instance(&shared, &pkt);
+
+			for (size_t i = encoder->callbacks.num; i > 0; i--) {
+				struct encoder_callback *cb;
+				cb = encoder->callbacks.array+(i-1);
+				send_packet(encoder, cb, &shared);
+			}
+
+			obs_encoder_packet_release(&shared);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
@@ -1034,12 +1043,12 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 		const struct encoder_packet *src)
 {
-	long *p_refs;
+	uint8_t *header;
 
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void*)(p_refs + 1);
-	*p_refs = 1;
+	header = bmalloc(src->size + ENCODER_PACKET_HEADER_SIZE);
+	dst->data = header + ENCODER_PACKET_HEADER_SIZE;
+	init_encoder_packet_header(dst->data);
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1061,8 +1070,9 @@ void obs_encoder_packet_ref(struct encoder_packet *dst,
 		return;
 
 	if (src->data) {
-		long *p_refs = ((long*)src->data) - 1;
-		os_atomic_inc_long(p_refs);
+		struct encoder_packet_header *header =
+			get_encoder_packet_header(src->data);
+		os_atomic_inc_long(&header->refs);
 	}
 
 	*dst = *src;
@@ -1074,9 +1084,16 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 		return;
 
 	if (pkt->data) {
-		long *p_refs = ((long*)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
-			bfree(p_refs);
+		struct encoder_packet_header *header =
+			get_encoder_packet_header(pkt->data);
+
+		if (os_atomic_dec_long(&header->refs) == 0) {
+			if (header->avc) {
+				obs_encoder_packet_release(header->avc);
+				bfree(header->avc);
+			}
+			bfree(header);
+		}
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
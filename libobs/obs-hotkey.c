@@ -80,6 +80,7 @@ obs_hotkey_t *obs_hotkey_binding_get_hotkey(obs_hotkey_binding_t *binding)
 }
 
 static inline bool find_id(obs_hotkey_id id, size_t *idx);
+static void hotkey_save_changed(obs_hotkey_t *hotkey);
 void obs_hotkey_set_name(obs_hotkey_id id, const char *name)
 {
 	size_t idx;
@@ -90,6 +91,7 @@ void obs_hotkey_set_name(obs_hotkey_id id, const char *name)
 	obs_hotkey_t *hotkey = &obs->hotkeys.hotkeys.array[idx];
 	bfree(hotkey->name);
 	hotkey->name = bstrdup(name);
+	hotkey_save_changed(hotkey);
 }
 
 void obs_hotkey_set_description(obs_hotkey_id id, const char *desc)
@@ -146,6 +148,21 @@ static void hotkey_signal(const char *signal, obs_hotkey_t *hotkey)
 	calldata_free(&data);
 }
 
+/* bindings are saved as part of the source that registered the hotkey */
+static void hotkey_save_changed(obs_hotkey_t *hotkey)
+{
+	struct obs_weak_source *weak = hotkey->registerer;
+
+	if (hotkey->registerer_type == OBS_HOTKEY_REGISTERER_SOURCE && weak)
+		obs_source_bump_save_stamp(weak->source);
+}
+
+static void bindings_changed(obs_hotkey_t *hotkey)
+{
+	hotkey_save_changed(hotkey);
+	hotkey_signal("hotkey_bindings_changed", hotkey);
+}
+
 static inline void fixup_pointers(void);
 static inline void load_bindings(obs_hotkey_t *hotkey, obs_data_array_t *data);
 
@@ -676,7 +693,7 @@ static inline void load_bindings(obs_hotkey_t *hotkey, obs_data_array_t *data)
 		obs_data_release(item);
 	}
 
-	hotkey_signal("hotkey_bindings_changed", hotkey);
+	bindings_changed(hotkey);
 }
 
 static inline void remove_bindings(obs_hotkey_id id);
@@ -695,7 +712,7 @@ void obs_hotkey_load_bindings(obs_hotkey_id id,
 		for (size_t i = 0; i < num; i++)
 			create_binding(hotkey, combinations[i]);
 
-		hotkey_signal("hotkey_bindings_changed", hotkey);
+		bindings_changed(hotkey);
 	}
 	unlock();
 }
@@ -1012,6 +1029,7 @@ static inline bool unregister_hotkey(obs_hotkey_id id)
 	obs_hotkey_t *hotkey = &obs->hotkeys.hotkeys.array[idx];
 
 	hotkey_signal("hotkey_unregister", hotkey);
+	hotkey_save_changed(hotkey);
 
 	release_registerer(hotkey);
 
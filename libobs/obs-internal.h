@@ -37,6 +37,8 @@
 #include "obs.h"
 
 #define NUM_TEXTURES 2
+#define MIN_STAGING_DEPTH 2
+#define MAX_STAGING_DEPTH 4
 #define MICROSECOND_DEN 1000000
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
@@ -227,13 +229,12 @@ struct obs_vframe_info {
 
 struct obs_core_video {
 	graphics_t                      *graphics;
-	gs_stagesurf_t                  *copy_surfaces[NUM_TEXTURES];
+	gs_stagesurf_t                  *copy_surfaces[MAX_STAGING_DEPTH];
 	gs_texture_t                    *render_textures[NUM_TEXTURES];
 	gs_texture_t                    *output_textures[NUM_TEXTURES];
 	gs_texture_t                    *convert_textures[NUM_TEXTURES];
 	bool                            textures_rendered[NUM_TEXTURES];
 	bool                            textures_output[NUM_TEXTURES];
-	bool                            textures_copied[NUM_TEXTURES];
 	bool                            textures_converted[NUM_TEXTURES];
 	struct circlebuf                vframe_info_buffer;
 	gs_effect_t                     *default_effect;
@@ -248,6 +249,9 @@ struct obs_core_video {
 	gs_samplerstate_t               *point_sampler;
 	gs_stagesurf_t                  *mapped_surface;
 	int                             cur_texture;
+	uint32_t                        staging_depth;
+	uint32_t                        cur_copy_surface;
+	uint32_t                        copies_queued;
 	long                            raw_active;
 
 	uint64_t                        video_time;
@@ -308,6 +312,33 @@ struct obs_core_audio {
 	char                            *monitoring_device_id;
 };
 
+/* name lookup index for a context list, protected by the list's mutex */
+struct obs_context_index {
+	struct obs_context_data         **buckets;
+	size_t                          num_buckets;
+	size_t                          num;
+};
+
+/* id lookup index for a registered type array (source_types, etc) */
+struct obs_type_index {
+	size_t                          *slots;
+	size_t                          capacity;
+};
+
+extern void obs_type_index_add(struct obs_type_index *index,
+		const void *types, size_t stride, size_t id_offset, size_t num);
+extern void *obs_type_index_find(const struct obs_type_index *index,
+		const void *types, size_t stride, size_t id_offset,
+		const char *id);
+extern void obs_type_index_free(struct obs_type_index *index);
+
+#define obs_type_index_add_da(index, da, type) \
+	obs_type_index_add(index, (da).array, sizeof(type), \
+			offsetof(type, id), (da).num)
+#define obs_type_index_find_da(index, da, type, id) \
+	((type*)obs_type_index_find(index, (da).array, sizeof(type), \
+			offsetof(type, id), id))
+
 /* user sources, output channels, and displays */
 struct obs_core_data {
 	struct obs_source               *first_source;
@@ -323,6 +354,21 @@ struct obs_core_data {
 	pthread_mutex_t                 encoders_mutex;
 	pthread_mutex_t                 services_mutex;
 	pthread_mutex_t                 audio_sources_mutex;
+
+	struct obs_context_index        sources_index;
+	struct obs_context_index        outputs_index;
+	struct obs_context_index        encoders_index;
+	struct obs_context_index        services_index;
+
+	bool                            defer_source_creation;
+	/* only protects the queue, never held while a source is created */
+	pthread_mutex_t                 deferred_create_mutex;
+	DARRAY(obs_weak_source_t*)      deferred_create_queue;
+	os_sem_t                        *deferred_create_sem;
+	pthread_t                       deferred_create_thread;
+	bool                            deferred_create_thread_active;
+	volatile bool                   deferred_create_stop;
+
 	pthread_mutex_t                 draw_callbacks_mutex;
 	DARRAY(struct draw_callback)    draw_callbacks;
 	DARRAY(struct tick_callback)    tick_callbacks;
@@ -331,6 +377,14 @@ struct obs_core_data {
 
 	long long                       unnamed_index;
 
+	/* last stamp handed out by obs_source_invalidate_cache */
+	volatile long                   content_stamp;
+
+	/* last stamp handed out for changes to saved source data, and the stamp
+	 * of the last rename (which changes the saved data of scenes) */
+	volatile long                   save_stamp;
+	volatile long                   name_stamp;
+
 	volatile bool                   valid;
 };
 
@@ -383,6 +437,11 @@ struct obs_core {
 	DARRAY(struct obs_modal_ui)     modal_ui_callbacks;
 	DARRAY(struct obs_modeless_ui)  modeless_ui_callbacks;
 
+	struct obs_type_index           source_types_index;
+	struct obs_type_index           output_types_index;
+	struct obs_type_index           encoder_types_index;
+	struct obs_type_index           service_types_index;
+
 	signal_handler_t                *signals;
 	proc_handler_t                  *procs;
 
@@ -439,6 +498,11 @@ struct obs_context_data {
 	struct obs_context_data         *next;
 	struct obs_context_data         **prev_next;
 
+	struct obs_context_index        *index;
+	struct obs_context_data         *hash_next;
+	struct obs_context_data         **hash_prev_next;
+	uint32_t                        name_hash;
+
 	bool                            private;
 };
 
@@ -551,6 +615,15 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	bool                            defer_update;
 
+	/* creation deferred until the source is first shown or referenced,
+	 * see obs_set_deferred_source_creation */
+	volatile bool                   create_deferred;
+	volatile bool                   create_queued;
+	volatile bool                   deferred_created;
+	pthread_mutex_t                 deferred_mutex;
+	bool                            load_deferred;
+	void                            *deferred_data;
+
 	/* ensures show/hide are only called once */
 	volatile long                   show_refs;
 
@@ -568,6 +641,13 @@ struct obs_source {
 	/* used to temporarily disable sources if needed */
 	bool                            enabled;
 
+	/* changes whenever the rendered content of the source changes, used to
+	 * reuse the cached textures of static scene items */
+	volatile long                   content_stamp;
+
+	/* changes whenever something written by obs_save_source changes */
+	volatile long                   save_stamp;
+
 	/* timing (if video is present, is based upon video) */
 	volatile bool                   timing_set;
 	volatile uint64_t               timing_adjust;
@@ -599,6 +679,12 @@ struct obs_source {
 	pthread_mutex_t                 audio_mutex;
 	pthread_mutex_t                 audio_cb_mutex;
 	DARRAY(struct audio_cb_info)    audio_cb_list;
+
+	/* level analysis shared by all volume meters attached to the source,
+	 * created on first use and processed under audio_cb_mutex */
+	struct audio_levels             *audio_levels;
+	volatile long                   audio_levels_refs;
+	volatile long                   audio_levels_true_peak_refs;
 	struct obs_audio_data           audio_data;
 	size_t                          audio_storage_size;
 	uint32_t                        audio_mixers;
@@ -704,6 +790,12 @@ extern bool obs_source_init_context(struct obs_source *source,
 		obs_data_t *settings, const char *name,
 		obs_data_t *hotkey_data, bool private);
 
+extern obs_source_t *obs_source_create_deferred(const char *id,
+		const char *name, obs_data_t *settings,
+		obs_data_t *hotkey_data);
+extern bool obs_source_init_deferred_create(void);
+extern void obs_source_free_deferred_create(void);
+
 extern bool obs_transition_init(obs_source_t *transition);
 extern void obs_transition_free(obs_source_t *transition);
 extern void obs_transition_tick(obs_source_t *transition);
@@ -763,6 +855,12 @@ static inline enum gs_color_format convert_video_format(
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+extern bool obs_source_get_content_stamp(obs_source_t *source, long *stamp);
+extern bool obs_scene_get_content_stamp(obs_source_t *scene, long *stamp);
+extern void obs_source_bump_save_stamp(const obs_source_t *source);
+extern bool obs_scene_get_save_stamp(obs_source_t *scene, long *stamp);
+extern bool obs_source_is_opaque(obs_source_t *source);
+extern void obs_source_video_render_culled(obs_source_t *source);
 extern float obs_source_get_target_volume(obs_source_t *source,
 		obs_source_t *target);
 
@@ -787,6 +885,21 @@ extern void deinterlace_process_last_frame(obs_source_t *source,
 extern void deinterlace_update_async_video(obs_source_t *source);
 extern void deinterlace_render(obs_source_t *s);
 
+struct audio_levels;
+struct obs_audio_levels;
+
+extern struct audio_levels *audio_levels_create(obs_source_t *source);
+extern void audio_levels_destroy(struct audio_levels *levels);
+extern void audio_levels_process(struct audio_levels *levels,
+		const struct audio_data *data, bool true_peak, bool muted);
+extern void audio_levels_get(struct audio_levels *levels,
+		struct obs_audio_levels *out);
+
+extern void obs_source_audio_levels_addref(obs_source_t *source);
+extern void obs_source_audio_levels_release(obs_source_t *source);
+extern void obs_source_audio_levels_set_true_peak(obs_source_t *source,
+		bool enable);
+
 
 /* ------------------------------------------------------------------------- */
 /* outputs  */
@@ -915,6 +1028,34 @@ extern void obs_output_remove_encoder(struct obs_output *output,
 
 extern void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 		const struct encoder_packet *src);
+
+/* Every reference counted packet's data is preceded by this header.  The
+ * reference count must be directly before the data, so the header size is
+ * measured up to the end of the reference count rather than with sizeof.
+ * 'avc' is the AVCC conversion of the packet, created the first time an
+ * output asks for it and shared by all outputs afterward. */
+struct encoder_packet_header {
+	struct encoder_packet *avc;
+	long                  refs;
+};
+
+#define ENCODER_PACKET_HEADER_SIZE \
+	(offsetof(struct encoder_packet_header, refs) + sizeof(long))
+
+static inline struct encoder_packet_header *get_encoder_packet_header(
+		const uint8_t *data)
+{
+	return (struct encoder_packet_header*)
+		(data - ENCODER_PACKET_HEADER_SIZE);
+}
+
+static inline void init_encoder_packet_header(uint8_t *data)
+{
+	struct encoder_packet_header *header = get_encoder_packet_header(data);
+	header->avc  = NULL;
+	header->refs = 1;
+}
+
 void obs_output_destroy(obs_output_t *output);
 
 
@@ -76,45 +76,69 @@ static inline char *get_module_name(const char *file)
 extern void reset_win32_symbol_paths(void);
 #endif
 
-int obs_open_module(obs_module_t **module, const char *path,
+static int open_module_binary(struct obs_module *mod, const char *path,
 		const char *data_path)
 {
-	struct obs_module mod = {0};
 	int errorcode;
 
-	if (!module || !path || !obs)
-		return MODULE_ERROR;
-
-	blog(LOG_DEBUG, "---------------------------------");
-
-	mod.module = os_dlopen(path);
-	if (!mod.module) {
+	mod->module = os_dlopen(path);
+	if (!mod->module) {
 		blog(LOG_WARNING, "Module '%s' not loaded", path);
 		return MODULE_FILE_NOT_FOUND;
 	}
 
-	errorcode = load_module_exports(&mod, path);
+	errorcode = load_module_exports(mod, path);
 	if (errorcode != MODULE_SUCCESS)
 		return errorcode;
 
-	mod.bin_path  = bstrdup(path);
-	mod.file      = strrchr(mod.bin_path, '/');
-	mod.file      = (!mod.file) ? mod.bin_path : (mod.file + 1);
-	mod.mod_name  = get_module_name(mod.file);
-	mod.data_path = bstrdup(data_path);
-	mod.next      = obs->first_module;
+	mod->bin_path  = bstrdup(path);
+	mod->file      = strrchr(mod->bin_path, '/');
+	mod->file      = (!mod->file) ? mod->bin_path : (mod->file + 1);
+	mod->mod_name  = get_module_name(mod->file);
+	mod->data_path = bstrdup(data_path);
+	return MODULE_SUCCESS;
+}
+
+/* the module's pointer has to be set before its locale is loaded, as the
+ * default locale handler looks up its data path through the module */
+static inline obs_module_t *prepare_module(const struct obs_module *mod)
+{
+	obs_module_t *module = bmemdup(mod, sizeof(*mod));
 
-	if (mod.file) {
-		blog(LOG_DEBUG, "Loading module: %s", mod.file);
+	module->set_pointer(module);
+	if (module->set_locale)
+		module->set_locale(obs->locale);
+
+	return module;
+}
+
+static inline void link_module(obs_module_t *module)
+{
+	if (module->file) {
+		blog(LOG_DEBUG, "Loading module: %s", module->file);
 	}
 
-	*module = bmemdup(&mod, sizeof(mod));
-	obs->first_module = (*module);
-	mod.set_pointer(*module);
+	module->next = obs->first_module;
+	obs->first_module = module;
+}
 
-	if (mod.set_locale)
-		mod.set_locale(obs->locale);
+int obs_open_module(obs_module_t **module, const char *path,
+		const char *data_path)
+{
+	struct obs_module mod = {0};
+	int errorcode;
 
+	if (!module || !path || !obs)
+		return MODULE_ERROR;
+
+	blog(LOG_DEBUG, "---------------------------------");
+
+	errorcode = open_module_binary(&mod, path, data_path);
+	if (errorcode != MODULE_SUCCESS)
+		return errorcode;
+
+	*module = prepare_module(&mod);
+	link_module(*module);
 	return MODULE_SUCCESS;
 }
 
@@ -222,37 +246,193 @@ void obs_add_module_path(const char *bin, const char *data)
 	da_push_back(obs->module_paths, &omp);
 }
 
-static void load_all_callback(void *param, const struct obs_module_info *info)
-{
+struct module_load_job {
+	char         *bin_path;
+	char         *data_path;
 	obs_module_t *module;
+	int          code;
+	uint64_t     open_time;
+	uint64_t     init_time;
+};
 
-	int code = obs_open_module(&module, info->bin_path, info->data_path);
-	if (code != MODULE_SUCCESS) {
-		blog(LOG_DEBUG, "Failed to load module file '%s': %d",
-				info->bin_path, code);
-		return;
+struct module_loader {
+	DARRAY(struct module_load_job) jobs;
+	volatile long                  next_job;
+};
+
+static void find_module_callback(void *param,
+		const struct obs_module_info *info)
+{
+	struct module_loader *loader = param;
+	struct module_load_job *job = da_push_back_new(loader->jobs);
+
+	job->bin_path  = bstrdup(info->bin_path);
+	job->data_path = bstrdup(info->data_path);
+}
+
+#ifdef _WIN32
+/* os_dlopen changes the process-wide DLL search directory while loading, so
+ * the library loads themselves cannot overlap on windows */
+static pthread_mutex_t dlopen_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void open_module_job(struct module_load_job *job)
+{
+	struct obs_module mod = {0};
+	uint64_t start = os_gettime_ns();
+
+#ifdef _WIN32
+	pthread_mutex_lock(&dlopen_mutex);
+#endif
+	job->code = open_module_binary(&mod, job->bin_path, job->data_path);
+#ifdef _WIN32
+	pthread_mutex_unlock(&dlopen_mutex);
+#endif
+
+	if (job->code == MODULE_SUCCESS)
+		job->module = prepare_module(&mod);
+
+	job->open_time = os_gettime_ns() - start;
+}
+
+static void *module_loader_thread(void *param)
+{
+	struct module_loader *loader = param;
+
+	os_set_thread_name("libobs: module loader");
+
+	for (;;) {
+		long idx = os_atomic_inc_long(&loader->next_job) - 1;
+		if (idx >= (long)loader->jobs.num)
+			break;
+
+		open_module_job(loader->jobs.array + idx);
 	}
 
-	obs_init_module(module);
+	return NULL;
+}
+
+#define MAX_MODULE_LOADER_THREADS 8
+
+static void open_modules_concurrently(struct module_loader *loader)
+{
+	pthread_t threads[MAX_MODULE_LOADER_THREADS];
+	size_t num_threads = 0;
+	int cores = os_get_logical_cores();
+
+	if (cores > 1 && loader->jobs.num > 1) {
+		num_threads = (size_t)cores - 1;
+		if (num_threads > MAX_MODULE_LOADER_THREADS)
+			num_threads = MAX_MODULE_LOADER_THREADS;
+		if (num_threads > loader->jobs.num - 1)
+			num_threads = loader->jobs.num - 1;
+	}
 
-	UNUSED_PARAMETER(param);
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&threads[i], NULL, module_loader_thread,
+					loader) != 0) {
+			num_threads = i;
+			break;
+		}
+	}
+
+	/* the calling thread works through the queue too */
+	module_loader_thread(loader);
+
+	for (size_t i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+}
+
+static void log_module_load_times(const struct module_loader *loader,
+		uint64_t open_time, uint64_t total_time)
+{
+	uint64_t init_time = 0;
+	size_t num_loaded = 0;
+
+	blog(LOG_INFO, "  Module load times:");
+
+	for (size_t i = 0; i < loader->jobs.num; i++) {
+		const struct module_load_job *job = loader->jobs.array + i;
+		if (!job->module)
+			continue;
+
+		blog(LOG_INFO, "    %s: open %.3f ms, init %.3f ms",
+				job->module->file,
+				(double)job->open_time / 1000000.0,
+				(double)job->init_time / 1000000.0);
+
+		init_time += job->init_time;
+		if (job->module->loaded)
+			num_loaded++;
+	}
+
+	blog(LOG_INFO, "  Loaded %llu of %llu module(s) in %.3f ms "
+			"(open %.3f ms, init %.3f ms)",
+			(unsigned long long)num_loaded,
+			(unsigned long long)loader->jobs.num,
+			(double)total_time / 1000000.0,
+			(double)open_time / 1000000.0,
+			(double)init_time / 1000000.0);
 }
 
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
+static const char *open_modules_name = "open_modules_concurrently";
 #ifdef _WIN32
 static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 #endif
 
 void obs_load_all_modules(void)
 {
+	struct module_loader loader = {0};
+	uint64_t start_time = os_gettime_ns();
+	uint64_t open_time;
+
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules(load_all_callback, NULL);
+	obs_find_modules(find_module_callback, &loader);
+
+	/* opening the binaries and parsing their locale files does not depend
+	 * on other modules, so that is spread across threads.  the modules
+	 * are still linked and initialized in discovery order so module load
+	 * order stays deterministic */
+	profile_start(open_modules_name);
+	open_modules_concurrently(&loader);
+	profile_end(open_modules_name);
+	open_time = os_gettime_ns() - start_time;
+
+	for (size_t i = 0; i < loader.jobs.num; i++) {
+		struct module_load_job *job = loader.jobs.array + i;
+		uint64_t start;
+
+		blog(LOG_DEBUG, "---------------------------------");
+
+		if (job->code != MODULE_SUCCESS) {
+			blog(LOG_DEBUG, "Failed to load module file '%s': %d",
+					job->bin_path, job->code);
+			continue;
+		}
+
+		link_module(job->module);
+
+		start = os_gettime_ns();
+		obs_init_module(job->module);
+		job->init_time = os_gettime_ns() - start;
+	}
+
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
 	profile_end(reset_win32_symbol_paths_name);
 #endif
 	profile_end(obs_load_all_modules_name);
+
+	log_module_load_times(&loader, open_time,
+			os_gettime_ns() - start_time);
+
+	for (size_t i = 0; i < loader.jobs.num; i++) {
+		bfree(loader.jobs.array[i].bin_path);
+		bfree(loader.jobs.array[i].data_path);
+	}
+	da_free(loader.jobs);
 }
 
 void obs_post_load_modules(void)
@@ -635,6 +815,8 @@ void obs_register_source_s(const struct obs_source_info *info, size_t size)
 	if (array)
 		darray_push_back(sizeof(struct obs_source_info), array, &data);
 	da_push_back(obs->source_types, &data);
+	obs_type_index_add_da(&obs->source_types_index, obs->source_types,
+			struct obs_source_info);
 	return;
 
 error:
@@ -671,6 +853,8 @@ void obs_register_output_s(const struct obs_output_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_output_info, obs->output_types, info);
+	obs_type_index_add_da(&obs->output_types_index, obs->output_types,
+			struct obs_output_info);
 	return;
 
 error:
@@ -697,6 +881,8 @@ void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_encoder_info, obs->encoder_types, info);
+	obs_type_index_add_da(&obs->encoder_types_index, obs->encoder_types,
+			struct obs_encoder_info);
 	return;
 
 error:
@@ -719,6 +905,8 @@ void obs_register_service_s(const struct obs_service_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_service_info, obs->service_types, info);
+	obs_type_index_add_da(&obs->service_types_index, obs->service_types,
+			struct obs_service_info);
 	return;
 
 error:
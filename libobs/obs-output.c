@@ -57,12 +57,8 @@ static inline bool data_capture_ending(const struct obs_output *output)
 
 const struct obs_output_info *find_output(const char *id)
 {
-	size_t i;
-	for (i = 0; i < obs->output_types.num; i++)
-		if (strcmp(obs->output_types.array[i].id, id) == 0)
-			return obs->output_types.array+i;
-
-	return NULL;
+	return obs_type_index_find_da(&obs->output_types_index,
+			obs->output_types, struct obs_output_info, id);
 }
 
 const char *obs_output_get_display_name(const char *id)
@@ -982,7 +978,6 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	sei_t sei;
 	uint8_t *data;
 	size_t size;
-	long ref = 1;
 
 	DARRAY(uint8_t) out_data;
 
@@ -992,7 +987,7 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	sei_init(&sei);
 
 	da_init(out_data);
-	da_push_back_array(out_data, &ref, sizeof(ref));
+	da_resize(out_data, ENCODER_PACKET_HEADER_SIZE);
 	da_push_back_array(out_data, out->data, out->size);
 
 	caption_frame_init(&cf);
@@ -1010,8 +1005,9 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	obs_encoder_packet_release(out);
 
 	*out = backup;
-	out->data = (uint8_t*)out_data.array + sizeof(ref);
-	out->size = out_data.num - sizeof(ref);
+	out->data = (uint8_t*)out_data.array + ENCODER_PACKET_HEADER_SIZE;
+	out->size = out_data.num - ENCODER_PACKET_HEADER_SIZE;
+	init_encoder_packet_header(out->data);
 
 	sei_free(&sei);
 
@@ -1422,7 +1418,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (was_started)
 		apply_interleaved_packet_offset(output, &out);
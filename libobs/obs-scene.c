@@ -21,6 +21,8 @@
 #include "obs-scene.h"
 
 static void resize_group(obs_sceneitem_t *group);
+static uint32_t scene_getwidth(void *data);
+static uint32_t scene_getheight(void *data);
 static void signal_parent(obs_scene_t *parent, const char *name,
 		calldata_t *params);
 static void get_ungrouped_transform(obs_sceneitem_t *group,
@@ -204,8 +206,30 @@ static void scene_enum_all_sources(void *data,
 	scene_enum_sources(data, enum_callback, param, false);
 }
 
+static inline void invalidate_scene_cache(struct obs_scene *scene)
+{
+	if (scene && scene->source)
+		obs_source_invalidate_cache(scene->source);
+}
+
+static inline void scene_save_changed(struct obs_scene *scene)
+{
+	if (scene && scene->source)
+		obs_source_bump_save_stamp(scene->source);
+}
+
+/* item changes made by the user, applied on the next tick */
+static inline void item_transform_changed(struct obs_scene_item *item)
+{
+	os_atomic_set_bool(&item->update_transform, true);
+	scene_save_changed(item->parent);
+}
+
 static inline void detach_sceneitem(struct obs_scene_item *item)
 {
+	invalidate_scene_cache(item->parent);
+	scene_save_changed(item->parent);
+
 	if (item->prev)
 		item->prev->next = item->next;
 	else
@@ -234,6 +258,9 @@ static inline void attach_sceneitem(struct obs_scene *parent,
 			parent->first_item->prev = item;
 		parent->first_item = item;
 	}
+
+	invalidate_scene_cache(parent);
+	scene_save_changed(parent);
 }
 
 void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy)
@@ -388,6 +415,9 @@ static void update_item_transform(struct obs_scene_item *item)
 	calldata_set_ptr(&params, "item", item);
 	signal_parent(item->parent, "item_transform", &params);
 
+	item->cache_valid = false;
+	invalidate_scene_cache(item->parent);
+	scene_save_changed(item->parent);
 	os_atomic_set_bool(&item->update_transform, false);
 }
 
@@ -414,10 +444,17 @@ static inline bool item_is_scene(const struct obs_scene_item *item)
 	return item->source && item->source->info.type == OBS_SOURCE_TYPE_SCENE;
 }
 
+static inline bool item_is_static(const struct obs_scene_item *item)
+{
+	return item->source && (item->source->info.output_flags &
+			OBS_SOURCE_STATIC_CONTENT) != 0;
+}
+
 static inline bool item_texture_enabled(const struct obs_scene_item *item)
 {
 	return crop_enabled(&item->crop) || scale_filter_enabled(item) ||
-		(item_is_scene(item) && !item->is_group);
+		(item_is_scene(item) && !item->is_group) ||
+		item_is_static(item);
 }
 
 static void render_item_texture(struct obs_scene_item *item)
@@ -465,39 +502,86 @@ static void render_item_texture(struct obs_scene_item *item)
 		obs_source_draw(tex, 0, 0, 0, 0, 0);
 }
 
+static const char *render_item_cached_name = "render_item(cached)";
+static const char *render_item_cache_miss_name = "render_item(cache miss)";
+
+static inline bool item_cache_hit(const struct obs_scene_item *item,
+		long stamp, uint32_t width, uint32_t height, uint32_t rebuilds)
+{
+	return item->cache_valid && item->cache_stamp == stamp &&
+		item->cache_width == width && item->cache_height == height &&
+		item->cache_rebuilds == rebuilds;
+}
+
+static bool render_item_to_texture(struct obs_scene_item *item,
+		uint32_t width, uint32_t height)
+{
+	uint32_t cx = calc_cx(item, width);
+	uint32_t cy = calc_cy(item, height);
+
+	if (cx && cy && gs_texrender_begin(item->item_render, cx, cy)) {
+		float cx_scale = (float)width  / (float)cx;
+		float cy_scale = (float)height / (float)cy;
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)width, 0.0f, (float)height,
+				-100.0f, 100.0f);
+
+		gs_matrix_scale3f(cx_scale, cy_scale, 1.0f);
+		gs_matrix_translate3f(
+				-(float)item->crop.left,
+				-(float)item->crop.top,
+				0.0f);
+
+		gs_blend_state_push();
+		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+		obs_source_video_render(item->source);
+		gs_blend_state_pop();
+		gs_texrender_end(item->item_render);
+		return true;
+	}
+
+	return false;
+}
+
 static inline void render_item(struct obs_scene_item *item)
 {
+	const char *profile_name = NULL;
+
 	if (item->item_render) {
 		uint32_t width  = obs_source_get_width(item->source);
 		uint32_t height = obs_source_get_height(item->source);
+		uint32_t rebuilds;
+		bool cacheable;
+		bool cached;
+		long stamp = 0;
 
 		if (!width || !height)
 			return;
 
-		uint32_t cx = calc_cx(item, width);
-		uint32_t cy = calc_cy(item, height);
-
-		if (cx && cy && gs_texrender_begin(item->item_render, cx, cy)) {
-			float cx_scale = (float)width  / (float)cx;
-			float cy_scale = (float)height / (float)cy;
-			struct vec4 clear_color;
-
-			vec4_zero(&clear_color);
-			gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
-			gs_ortho(0.0f, (float)width, 0.0f, (float)height,
-					-100.0f, 100.0f);
-
-			gs_matrix_scale3f(cx_scale, cy_scale, 1.0f);
-			gs_matrix_translate3f(
-					-(float)item->crop.left,
-					-(float)item->crop.top,
-					0.0f);
-
-			gs_blend_state_push();
-			gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-			obs_source_video_render(item->source);
-			gs_blend_state_pop();
-			gs_texrender_end(item->item_render);
+		/* items of static sources keep their texture across frames
+		 * until the content stamp or size of the source changes, or
+		 * the device is rebuilt and the texture contents are lost */
+		cacheable = obs_source_get_content_stamp(item->source, &stamp);
+		rebuilds = gs_get_device_rebuild_count();
+		cached = cacheable &&
+			item_cache_hit(item, stamp, width, height, rebuilds);
+
+		if (cacheable) {
+			profile_name = cached ? render_item_cached_name :
+				render_item_cache_miss_name;
+			profile_start(profile_name);
+		}
+
+		if (!cached) {
+			item->cache_valid = cacheable &&
+				render_item_to_texture(item, width, height);
+			item->cache_stamp    = stamp;
+			item->cache_width    = width;
+			item->cache_height   = height;
+			item->cache_rebuilds = rebuilds;
 		}
 	}
 
@@ -509,6 +593,143 @@ static inline void render_item(struct obs_scene_item *item)
 		obs_source_video_render(item->source);
 	}
 	gs_matrix_pop();
+
+	if (profile_name)
+		profile_end(profile_name);
+}
+
+static const char *render_item_offscreen_name =
+	"render_item(culled offscreen)";
+static const char *render_item_occluded_name =
+	"render_item(culled occluded)";
+
+static inline void render_culled_item(struct obs_scene_item *item)
+{
+	const char *name = item->culled == ITEM_CULLED_OFFSCREEN ?
+		render_item_offscreen_name : render_item_occluded_name;
+
+	profile_start(name);
+	obs_source_video_render_culled(item->source);
+	profile_end(name);
+}
+
+/* ------------------------------------------------------------------------- */
+/* culling                                                                   */
+
+#define MAX_OCCLUDERS 8
+
+struct item_rect {
+	float left;
+	float top;
+	float right;
+	float bottom;
+};
+
+static inline bool rects_intersect(const struct item_rect *a,
+		const struct item_rect *b)
+{
+	return a->left < b->right && a->right > b->left &&
+		a->top < b->bottom && a->bottom > b->top;
+}
+
+static inline bool rect_contains(const struct item_rect *outer,
+		const struct item_rect *inner)
+{
+	return inner->left >= outer->left && inner->right <= outer->right &&
+		inner->top >= outer->top && inner->bottom <= outer->bottom;
+}
+
+/* gets the canvas space bounding box of what the item draws */
+static bool get_item_rect(const struct obs_scene_item *item,
+		struct item_rect *rect, bool *axis_aligned)
+{
+	const struct matrix4 *m = &item->draw_transform;
+	float cx = (float)calc_cx(item, item->last_width);
+	float cy = (float)calc_cy(item, item->last_height);
+	struct vec3 corners[4];
+
+	if (!item->last_width || !item->last_height)
+		return false;
+
+	vec3_set(&corners[0], 0.0f, 0.0f, 0.0f);
+	vec3_set(&corners[1], cx,   0.0f, 0.0f);
+	vec3_set(&corners[2], 0.0f, cy,   0.0f);
+	vec3_set(&corners[3], cx,   cy,   0.0f);
+
+	for (size_t i = 0; i < 4; i++) {
+		struct vec3 *v = &corners[i];
+		vec3_transform(v, v, m);
+
+		if (i == 0 || v->x < rect->left)   rect->left   = v->x;
+		if (i == 0 || v->x > rect->right)  rect->right  = v->x;
+		if (i == 0 || v->y < rect->top)    rect->top    = v->y;
+		if (i == 0 || v->y > rect->bottom) rect->bottom = v->y;
+	}
+
+	/* only unrotated or right angle rotated items fill their bounds */
+	*axis_aligned =
+		(close_float(m->x.y, 0.0f, EPSILON) &&
+		 close_float(m->y.x, 0.0f, EPSILON)) ||
+		(close_float(m->x.x, 0.0f, EPSILON) &&
+		 close_float(m->y.y, 0.0f, EPSILON));
+	return true;
+}
+
+/* Walks the items from top to bottom, culling items that are outside of the
+ * canvas or fully covered by a single opaque item above them.  Groups aren't
+ * culled, their items are positioned relative to the group. */
+static void cull_items(struct obs_scene *scene)
+{
+	struct item_rect occluders[MAX_OCCLUDERS];
+	size_t num_occluders = 0;
+	struct obs_scene_item *item = scene->first_item;
+	struct item_rect canvas = {
+		0.0f, 0.0f,
+		(float)scene_getwidth(scene),
+		(float)scene_getheight(scene)
+	};
+
+	if (!item)
+		return;
+	while (item->next)
+		item = item->next;
+
+	for (; item; item = item->prev) {
+		struct item_rect rect;
+		bool axis_aligned;
+
+		item->culled = ITEM_NOT_CULLED;
+
+		if (!item->user_visible)
+			continue;
+		if (!get_item_rect(item, &rect, &axis_aligned))
+			continue;
+
+		if (!rects_intersect(&rect, &canvas)) {
+			item->culled = ITEM_CULLED_OFFSCREEN;
+			continue;
+		}
+
+		for (size_t i = 0; i < num_occluders; i++) {
+			if (rect_contains(&occluders[i], &rect)) {
+				item->culled = ITEM_CULLED_OCCLUDED;
+				break;
+			}
+		}
+
+		if (item->culled != ITEM_NOT_CULLED)
+			continue;
+
+		if (axis_aligned && num_occluders < MAX_OCCLUDERS &&
+		    obs_source_is_opaque(item->source)) {
+			struct item_rect *occluder = &occluders[num_occluders++];
+
+			occluder->left   = fmaxf(rect.left,   canvas.left);
+			occluder->top    = fmaxf(rect.top,    canvas.top);
+			occluder->right  = fminf(rect.right,  canvas.right);
+			occluder->bottom = fminf(rect.bottom, canvas.bottom);
+		}
+	}
 }
 
 static void scene_video_tick(void *data, float seconds)
@@ -586,12 +807,22 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 		update_transforms_and_prune_sources(scene, &remove_items.da);
 	}
 
+	if (!scene->group_sceneitem)
+		cull_items(scene);
+
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
 	item = scene->first_item;
 	while (item) {
-		if (item->user_visible)
+		if (!item->user_visible) {
+			item = item->next;
+			continue;
+		}
+
+		if (!scene->group_sceneitem && item->culled != ITEM_NOT_CULLED)
+			render_culled_item(item);
+		else
 			render_item(item);
 
 		item = item->next;
@@ -608,6 +839,91 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 	UNUSED_PARAMETER(effect);
 }
 
+/* A scene is only static if all of its visible items are, and the stamp of the
+ * scene is the newest stamp of its own and of those items.  Pending transform
+ * updates and removals count as changes, they are applied on the next render. */
+bool obs_scene_get_content_stamp(obs_source_t *source, long *stamp)
+{
+	struct obs_scene *scene = source->context.data;
+	struct obs_scene_item *item;
+	bool is_static = true;
+
+	if (!scene)
+		return false;
+
+	video_lock(scene);
+
+	if (scene->group_sceneitem && os_atomic_load_bool(
+				&scene->group_sceneitem->update_group_resize))
+		is_static = false;
+
+	item = scene->first_item;
+	while (item && is_static) {
+		long item_stamp;
+
+		if (!item->user_visible) {
+			item = item->next;
+			continue;
+		}
+
+		if (os_atomic_load_bool(&item->update_transform) ||
+		    obs_source_removed(item->source) ||
+		    source_size_changed(item) ||
+		    !obs_source_get_content_stamp(item->source, &item_stamp)) {
+			is_static = false;
+			break;
+		}
+
+		if (item_stamp > *stamp)
+			*stamp = item_stamp;
+
+		item = item->next;
+	}
+
+	video_unlock(scene);
+	return is_static;
+}
+
+/* Groups are saved as part of the scenes that contain them, so the save stamp
+ * of a scene is the newest stamp of its own, of the groups it contains, and of
+ * the last rename of any source (items are saved by source name). */
+bool obs_scene_get_save_stamp(obs_source_t *source, long *stamp)
+{
+	struct obs_scene *scene = source->context.data;
+	struct obs_scene_item *item;
+	long name_stamp = os_atomic_load_long(&obs->data.name_stamp);
+	bool tracked = true;
+
+	if (!scene)
+		return false;
+
+	if (name_stamp > *stamp)
+		*stamp = name_stamp;
+
+	full_lock(scene);
+
+	item = scene->first_item;
+	while (item) {
+		if (item->is_group) {
+			long group_stamp = os_atomic_load_long(
+					&item->source->save_stamp);
+
+			if (os_atomic_load_bool(&item->update_group_resize)) {
+				tracked = false;
+				break;
+			}
+
+			if (group_stamp > *stamp)
+				*stamp = group_stamp;
+		}
+
+		item = item->next;
+	}
+
+	full_unlock(scene);
+	return tracked;
+}
+
 static void set_visibility(struct obs_scene_item *item, bool vis)
 {
 	pthread_mutex_lock(&item->actions_mutex);
@@ -1580,6 +1896,9 @@ static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene,
 
 	full_unlock(scene);
 
+	invalidate_scene_cache(scene);
+	scene_save_changed(scene);
+
 	if (!scene->source->context.private)
 		init_hotkeys(scene, item, obs_source_get_name(source));
 
@@ -1725,7 +2044,7 @@ void obs_sceneitem_set_pos(obs_sceneitem_t *item, const struct vec2 *pos)
 {
 	if (item) {
 		vec2_copy(&item->pos, pos);
-		os_atomic_set_bool(&item->update_transform, true);
+		item_transform_changed(item);
 	}
 }
 
@@ -1733,7 +2052,7 @@ void obs_sceneitem_set_rot(obs_sceneitem_t *item, float rot)
 {
 	if (item) {
 		item->rot = rot;
-		os_atomic_set_bool(&item->update_transform, true);
+		item_transform_changed(item);
 	}
 }
 
@@ -1741,7 +2060,7 @@ void obs_sceneitem_set_scale(obs_sceneitem_t *item, const struct vec2 *scale)
 {
 	if (item) {
 		vec2_copy(&item->scale, scale);
-		os_atomic_set_bool(&item->update_transform, true);
+		item_transform_changed(item);
 	}
 }
 
@@ -1749,7 +2068,7 @@ void obs_sceneitem_set_alignment(obs_sceneitem_t *item, uint32_t alignment)
 {
 	if (item) {
 		item->align = alignment;
-		os_atomic_set_bool(&item->update_transform, true);
+		item_transform_changed(item);
 	}
 }
 
@@ -1761,6 +2080,9 @@ static inline void signal_reorder(struct obs_scene_item *item)
 
 	command = "reorder";
 
+	invalidate_scene_cache(item->parent);
+	scene_save_changed(item->parent);
+
 	calldata_init_fixed(&params, stack, sizeof(stack));
 	signal_parent(item->parent, command, &params);
 }
@@ -1845,7 +2167,7 @@ void obs_sceneitem_set_bounds_type(obs_sceneitem_t *item,
 {
 	if (item) {
 		item->bounds_type = type;
-		os_atomic_set_bool(&item->update_transform, true);
+		item_transform_changed(item);
 	}
 }
 
@@ -1854,7 +2176,7 @@ void obs_sceneitem_set_bounds_alignment(obs_sceneitem_t *item,
 {
 	if (item) {
 		item->bounds_align = alignment;
-		os_atomic_set_bool(&item->update_transform, true);
+		item_transform_changed(item);
 	}
 }
 
@@ -1862,7 +2184,7 @@ void obs_sceneitem_set_bounds(obs_sceneitem_t *item, const struct vec2 *bounds)
 {
 	if (item) {
 		item->bounds = *bounds;
-		os_atomic_set_bool(&item->update_transform, true);
+		item_transform_changed(item);
 	}
 }
 
@@ -1929,7 +2251,7 @@ void obs_sceneitem_set_info(obs_sceneitem_t *item,
 		item->bounds_type  = info->bounds_type;
 		item->bounds_align = info->bounds_alignment;
 		item->bounds       = info->bounds;
-		os_atomic_set_bool(&item->update_transform, true);
+		item_transform_changed(item);
 	}
 }
 
@@ -1981,6 +2303,8 @@ bool obs_sceneitem_set_visible(obs_sceneitem_t *item, bool visible)
 	}
 
 	item->user_visible = visible;
+	invalidate_scene_cache(item->parent);
+	scene_save_changed(item->parent);
 
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "item", item);
@@ -2015,6 +2339,7 @@ bool obs_sceneitem_set_locked(obs_sceneitem_t *item, bool lock)
 		return false;
 
 	item->locked = lock;
+	scene_save_changed(item->parent);
 
 	return true;
 }
@@ -2120,7 +2445,8 @@ void obs_sceneitem_set_crop(obs_sceneitem_t *item,
 		return;
 
 	item_tex_now_enabled = crop_enabled(crop) ||
-		scale_filter_enabled(item) || item_is_scene(item);
+		scale_filter_enabled(item) || item_is_scene(item) ||
+		item_is_static(item);
 
 	obs_enter_graphics();
 
@@ -2140,7 +2466,7 @@ void obs_sceneitem_set_crop(obs_sceneitem_t *item,
 	if (item->crop.bottom < 0) item->crop.bottom = 0;
 	obs_leave_graphics();
 
-	os_atomic_set_bool(&item->update_transform, true);
+	item_transform_changed(item);
 }
 
 void obs_sceneitem_get_crop(const obs_sceneitem_t *item,
@@ -2174,7 +2500,7 @@ void obs_sceneitem_set_scale_filter(obs_sceneitem_t *item,
 
 	obs_leave_graphics();
 
-	os_atomic_set_bool(&item->update_transform, true);
+	item_transform_changed(item);
 }
 
 enum obs_scale_type obs_sceneitem_get_scale_filter(
@@ -2231,6 +2557,9 @@ obs_data_t *obs_sceneitem_get_private_settings(obs_sceneitem_t *item)
 	if (!obs_ptr_valid(item, "obs_sceneitem_get_private_settings"))
 		return NULL;
 
+	/* the caller may change the settings at any time */
+	scene_save_changed(item->parent);
+
 	obs_data_addref(item->private_settings);
 	return item->private_settings;
 }
@@ -28,6 +28,12 @@ struct item_action {
 	uint64_t timestamp;
 };
 
+enum item_cull {
+	ITEM_NOT_CULLED,
+	ITEM_CULLED_OFFSCREEN,
+	ITEM_CULLED_OCCLUDED
+};
+
 struct obs_scene_item {
 	volatile long         ref;
 	volatile bool         removed;
@@ -48,9 +54,21 @@ struct obs_scene_item {
 	bool                  selected;
 	bool                  locked;
 
+	/* set each frame by the scene before rendering its items */
+	enum item_cull        culled;
+
 	gs_texrender_t        *item_render;
 	struct obs_sceneitem_crop crop;
 
+	/* content stamp and size the item texture was last rendered with,
+	 * used to skip re-rendering items with static content.  the device
+	 * rebuild count invalidates the texture when the device is lost */
+	bool                  cache_valid;
+	long                  cache_stamp;
+	uint32_t              cache_width;
+	uint32_t              cache_height;
+	uint32_t              cache_rebuilds;
+
 	struct vec2           pos;
 	struct vec2           scale;
 	float                 rot;
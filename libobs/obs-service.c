@@ -19,12 +19,8 @@
 
 const struct obs_service_info *find_service(const char *id)
 {
-	size_t i;
-	for (i = 0; i < obs->service_types.num; i++)
-		if (strcmp(obs->service_types.array[i].id, id) == 0)
-			return obs->service_types.array+i;
-
-	return NULL;
+	return obs_type_index_find_da(&obs->service_types_index,
+			obs->service_types, struct obs_service_info, id);
 }
 
 const char *obs_service_get_display_name(const char *id)
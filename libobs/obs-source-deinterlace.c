@@ -414,6 +414,8 @@ void obs_source_set_deinterlace_mode(obs_source_t *source,
 		source->deinterlace_effect = get_effect(mode);
 		obs_leave_graphics();
 	}
+
+	obs_source_bump_save_stamp(source);
 }
 
 enum obs_deinterlace_mode obs_source_get_deinterlace_mode(
@@ -431,6 +433,7 @@ void obs_source_set_deinterlace_field_order(obs_source_t *source,
 
 	source->deinterlace_top_first =
 		field_order == OBS_DEINTERLACE_FIELD_ORDER_TOP;
+	obs_source_bump_save_stamp(source);
 }
 
 enum obs_deinterlace_field_order obs_source_get_deinterlace_field_order(
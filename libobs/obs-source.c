@@ -41,13 +41,8 @@ static inline bool deinterlacing_enabled(const struct obs_source *source)
 
 struct obs_source_info *get_source_info(const char *id)
 {
-	for (size_t i = 0; i < obs->source_types.num; i++) {
-		struct obs_source_info *info = &obs->source_types.array[i];
-		if (strcmp(info->id, id) == 0)
-			return info;
-	}
-
-	return NULL;
+	return obs_type_index_find_da(&obs->source_types_index,
+			obs->source_types, struct obs_source_info, id);
 }
 
 static const char *source_signals[] = {
@@ -145,6 +140,7 @@ bool obs_source_init(struct obs_source *source)
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
+	pthread_mutex_init_value(&source->deferred_mutex);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		return false;
@@ -162,6 +158,8 @@ bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init(&source->async_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->deferred_mutex, NULL) != 0)
+		return false;
 
 	if (is_audio_source(source) || is_composite_source(source))
 		allocate_audio_output_buffer(source);
@@ -294,7 +292,7 @@ static void obs_source_init_audio_hotkeys(struct obs_source *source)
 
 static obs_source_t *obs_source_create_internal(const char *id,
 		const char *name, obs_data_t *settings,
-		obs_data_t *hotkey_data, bool private)
+		obs_data_t *hotkey_data, bool private, bool deferred)
 {
 	struct obs_source *source = bzalloc(sizeof(struct obs_source));
 
@@ -339,17 +337,23 @@ static obs_source_t *obs_source_create_internal(const char *id,
 
 	/* allow the source to be created even if creation fails so that the
 	 * user's data doesn't become lost */
-	if (info)
-		source->context.data = info->create(source->context.settings,
-				source);
-	if (!source->context.data)
-		blog(LOG_ERROR, "Failed to create source '%s'!", name);
+	if (info && deferred) {
+		source->create_deferred = true;
+	} else {
+		if (info)
+			source->context.data = info->create(
+					source->context.settings, source);
+		if (!source->context.data)
+			blog(LOG_ERROR, "Failed to create source '%s'!", name);
+	}
 
-	blog(LOG_DEBUG, "%ssource '%s' (%s) created",
-			private ? "private " : "", name, id);
+	blog(LOG_DEBUG, "%ssource '%s' (%s) created%s",
+			private ? "private " : "", name, id,
+			source->create_deferred ? " (deferred)" : "");
 
 	source->flags = source->default_flags;
 	source->enabled = true;
+	obs_source_bump_save_stamp(source);
 
 	if (!private) {
 		obs_source_dosignal(source, "source_create", NULL);
@@ -367,13 +371,205 @@ obs_source_t *obs_source_create(const char *id, const char *name,
 		obs_data_t *settings, obs_data_t *hotkey_data)
 {
 	return obs_source_create_internal(id, name, settings, hotkey_data,
-			false);
+			false, false);
 }
 
 obs_source_t *obs_source_create_private(const char *id, const char *name,
 		obs_data_t *settings)
 {
-	return obs_source_create_internal(id, name, settings, NULL, true);
+	return obs_source_create_internal(id, name, settings, NULL, true,
+			false);
+}
+
+obs_source_t *obs_source_create_deferred(const char *id, const char *name,
+		obs_data_t *settings, obs_data_t *hotkey_data)
+{
+	return obs_source_create_internal(id, name, settings, hotkey_data,
+			false, true);
+}
+
+/* runs the deferred create callback on whichever thread instantiates the
+ * source.  the result is only published to context.data on the graphics
+ * thread (see publish_deferred_source) so that show/activate/update are
+ * never delivered twice or lost.
+ *
+ * only the source's own deferred_mutex is held while the plugin callbacks
+ * run, the graphics thread never waits on it.  deferred_data is never
+ * changed again once deferred_created is set. */
+static void create_deferred_source(obs_source_t *source)
+{
+	uint64_t start;
+
+	pthread_mutex_lock(&source->deferred_mutex);
+
+	if (!source->create_deferred ||
+	    os_atomic_load_bool(&source->deferred_created)) {
+		pthread_mutex_unlock(&source->deferred_mutex);
+		return;
+	}
+
+	start = os_gettime_ns();
+	source->deferred_data = source->info.create(source->context.settings,
+			source);
+
+	if (!source->deferred_data) {
+		blog(LOG_ERROR, "Failed to create source '%s'!",
+				source->context.name);
+	} else if (source->load_deferred && source->info.load) {
+		source->info.load(source->deferred_data,
+				source->context.settings);
+	}
+
+	source->load_deferred = false;
+	obs_source_bump_save_stamp(source);
+
+	blog(LOG_DEBUG, "source '%s' (%s) instantiated in %.3f ms",
+			source->context.name, source->info.id,
+			(double)(os_gettime_ns() - start) / 1000000.0);
+
+	os_atomic_set_bool(&source->deferred_created, true);
+
+	pthread_mutex_unlock(&source->deferred_mutex);
+}
+
+/* graphics thread only.  deferred_data keeps pointing to the same data so
+ * that threads which saw create_deferred just before this can still use
+ * it */
+static void publish_deferred_source(obs_source_t *source)
+{
+	source->context.data = source->deferred_data;
+	os_atomic_set_bool(&source->create_deferred, false);
+
+	/* replay show/activate that happened before the source existed */
+	if (source->context.data) {
+		if (source->showing && source->info.show)
+			source->info.show(source->context.data);
+		if (source->active && source->info.activate)
+			source->info.activate(source->context.data);
+	}
+}
+
+static void *deferred_create_thread(void *param)
+{
+	struct obs_core_data *data = &obs->data;
+
+	os_set_thread_name("libobs: deferred source creation");
+
+	while (os_sem_wait(data->deferred_create_sem) == 0) {
+		obs_weak_source_t *weak = NULL;
+		obs_source_t *source;
+
+		if (os_atomic_load_bool(&data->deferred_create_stop))
+			break;
+
+		pthread_mutex_lock(&data->deferred_create_mutex);
+		if (data->deferred_create_queue.num) {
+			weak = data->deferred_create_queue.array[0];
+			da_erase(data->deferred_create_queue, 0);
+		}
+		pthread_mutex_unlock(&data->deferred_create_mutex);
+
+		source = obs_weak_source_get_source(weak);
+		obs_weak_source_release(weak);
+
+		if (source) {
+			create_deferred_source(source);
+			obs_source_release(source);
+		}
+	}
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
+
+static void queue_deferred_create(obs_source_t *source)
+{
+	struct obs_core_data *data = &obs->data;
+	obs_weak_source_t *weak;
+
+	if (!source->create_deferred)
+		return;
+	if (os_atomic_set_bool(&source->create_queued, true))
+		return;
+
+	weak = obs_source_get_weak_source(source);
+
+	pthread_mutex_lock(&data->deferred_create_mutex);
+
+	if (!data->deferred_create_thread_active) {
+		if (pthread_create(&data->deferred_create_thread, NULL,
+					deferred_create_thread, NULL) != 0) {
+			pthread_mutex_unlock(&data->deferred_create_mutex);
+			obs_weak_source_release(weak);
+
+			blog(LOG_WARNING, "Failed to start deferred source "
+					"creation thread, creating '%s' "
+					"immediately", source->context.name);
+			create_deferred_source(source);
+			return;
+		}
+
+		data->deferred_create_thread_active = true;
+	}
+
+	da_push_back(data->deferred_create_queue, &weak);
+	pthread_mutex_unlock(&data->deferred_create_mutex);
+
+	os_sem_post(data->deferred_create_sem);
+}
+
+bool obs_source_init_deferred_create(void)
+{
+	struct obs_core_data *data = &obs->data;
+
+	pthread_mutex_init_value(&data->deferred_create_mutex);
+	if (pthread_mutex_init(&data->deferred_create_mutex, NULL) != 0)
+		return false;
+	return os_sem_init(&data->deferred_create_sem, 0) == 0;
+}
+
+void obs_source_free_deferred_create(void)
+{
+	struct obs_core_data *data = &obs->data;
+
+	if (data->deferred_create_thread_active) {
+		os_atomic_set_bool(&data->deferred_create_stop, true);
+		os_sem_post(data->deferred_create_sem);
+		pthread_join(data->deferred_create_thread, NULL);
+		data->deferred_create_thread_active = false;
+	}
+
+	for (size_t i = 0; i < data->deferred_create_queue.num; i++)
+		obs_weak_source_release(data->deferred_create_queue.array[i]);
+	da_free(data->deferred_create_queue);
+
+	os_sem_destroy(data->deferred_create_sem);
+	pthread_mutex_destroy(&data->deferred_create_mutex);
+	data->deferred_create_sem = NULL;
+}
+
+bool obs_source_creation_deferred(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_creation_deferred") ?
+		os_atomic_load_bool(&source->create_deferred) : false;
+}
+
+static void prewarm_tree(obs_source_t *parent, obs_source_t *child,
+		void *param)
+{
+	queue_deferred_create(child);
+
+	UNUSED_PARAMETER(parent);
+	UNUSED_PARAMETER(param);
+}
+
+void obs_source_prewarm(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_prewarm"))
+		return;
+
+	queue_deferred_create(source);
+	obs_source_enum_active_tree(source, prewarm_tree, NULL);
 }
 
 static char *get_new_filter_name(obs_source_t *dst, const char *name)
@@ -550,7 +746,10 @@ void obs_source_destroy(struct obs_source *source)
 	if (source->context.data) {
 		source->info.destroy(source->context.data);
 		source->context.data = NULL;
+	} else if (source->deferred_data) {
+		source->info.destroy(source->deferred_data);
 	}
+	source->deferred_data = NULL;
 
 	audio_monitor_destroy(source->monitor);
 
@@ -588,6 +787,7 @@ void obs_source_destroy(struct obs_source *source)
 
 	da_free(source->audio_actions);
 	da_free(source->audio_cb_list);
+	audio_levels_destroy(source->audio_levels);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
 	da_free(source->filters);
@@ -597,6 +797,7 @@ void obs_source_destroy(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_cb_mutex);
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
+	pthread_mutex_destroy(&source->deferred_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
 
@@ -756,19 +957,34 @@ bool obs_source_configurable(const obs_source_t *source)
 
 obs_properties_t *obs_source_properties(const obs_source_t *source)
 {
-	if (!data_valid(source, "obs_source_properties"))
+	void *data;
+
+	if (!obs_source_valid(source, "obs_source_properties"))
+		return NULL;
+
+	/* the UI referencing a deferred source instantiates it right away.
+	 * deferred_data stays valid even if the graphics thread publishes the
+	 * source in the meantime */
+	if (os_atomic_load_bool(&source->create_deferred)) {
+		create_deferred_source((obs_source_t*)source);
+		data = source->deferred_data;
+	} else {
+		data = source->context.data;
+	}
+
+	if (!data)
 		return NULL;
 
 	if (source->info.get_properties2) {
 		obs_properties_t *props;
-		props = source->info.get_properties2(source->context.data,
+		props = source->info.get_properties2(data,
 				source->info.type_data);
 		obs_properties_apply_settings(props, source->context.settings);
 		return props;
 
 	} else if (source->info.get_properties) {
 		obs_properties_t *props;
-		props = source->info.get_properties(source->context.data);
+		props = source->info.get_properties(data);
 		obs_properties_apply_settings(props, source->context.settings);
 		return props;
 	}
@@ -788,13 +1004,24 @@ uint32_t obs_get_source_output_flags(const char *id)
 	return info ? info->output_flags : 0;
 }
 
+static inline void bump_content_stamp(obs_source_t *source)
+{
+	long stamp = os_atomic_inc_long(&obs->data.content_stamp);
+	os_atomic_set_long(&source->content_stamp, stamp);
+}
+
 static void obs_source_deferred_update(obs_source_t *source)
 {
+	/* keep the update pending until a deferred source is published */
+	if (source->create_deferred)
+		return;
+
 	if (source->context.data && source->info.update)
 		source->info.update(source->context.data,
 				source->context.settings);
 
 	source->defer_update = false;
+	bump_content_stamp(source);
 }
 
 void obs_source_update(obs_source_t *source, obs_data_t *settings)
@@ -805,14 +1032,120 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 	if (settings)
 		obs_data_apply(source->context.settings, settings);
 
-	if (source->info.output_flags & OBS_SOURCE_VIDEO) {
+	obs_source_bump_save_stamp(source);
+
+	if ((source->info.output_flags & OBS_SOURCE_VIDEO) != 0 ||
+	    source->create_deferred) {
 		source->defer_update = true;
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data,
 				source->context.settings);
+		bump_content_stamp(source);
 	}
 }
 
+void obs_source_invalidate_cache(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_invalidate_cache"))
+		return;
+
+	bump_content_stamp(source);
+}
+
+/* Returns true if the source renders the same image until its stamp changes.
+ * The stamp includes the filters of the source, and for scenes, the stamps of
+ * all of their visible items. */
+bool obs_source_get_content_stamp(obs_source_t *source, long *stamp)
+{
+	bool is_static;
+
+	if (!source || source->create_deferred || source->defer_update)
+		return false;
+
+	*stamp = os_atomic_load_long(&source->content_stamp);
+
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE)
+		is_static = obs_scene_get_content_stamp(source, stamp);
+	else
+		is_static = (source->info.output_flags &
+				OBS_SOURCE_STATIC_CONTENT) != 0;
+
+	if (!is_static)
+		return false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		long filter_stamp = os_atomic_load_long(&filter->content_stamp);
+
+		/* disabled filters still count towards the stamp so that
+		 * toggling one invalidates the cache */
+		if (filter->enabled && (filter->info.output_flags &
+					OBS_SOURCE_STATIC_CONTENT) == 0) {
+			is_static = false;
+			break;
+		}
+
+		if (filter_stamp > *stamp)
+			*stamp = filter_stamp;
+	}
+
+	pthread_mutex_unlock(&source->filter_mutex);
+	return is_static;
+}
+
+/* the source argument is const so that getters which hand out mutable data
+ * (such as the settings) can mark the source as changed */
+void obs_source_bump_save_stamp(const obs_source_t *source)
+{
+	struct obs_source *mutable_source = (struct obs_source *)source;
+	long stamp = os_atomic_inc_long(&obs->data.save_stamp);
+	os_atomic_set_long(&mutable_source->save_stamp, stamp);
+}
+
+bool obs_source_get_save_stamp(obs_source_t *source, long *stamp)
+{
+	bool tracked = true;
+
+	if (!obs_source_valid(source, "obs_source_get_save_stamp"))
+		return false;
+	if (!obs_ptr_valid(stamp, "obs_source_get_save_stamp"))
+		return false;
+
+	*stamp = os_atomic_load_long(&source->save_stamp);
+
+	/* sources that write their own data when saved can't be tracked,
+	 * except for scenes which track their items themselves */
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE)
+		tracked = obs_scene_get_save_stamp(source, stamp);
+	else if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+		tracked = false;
+	else if (source->info.save)
+		tracked = false;
+
+	if (!tracked)
+		return false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		long filter_stamp = os_atomic_load_long(&filter->save_stamp);
+
+		if (filter->info.save) {
+			tracked = false;
+			break;
+		}
+
+		if (filter_stamp > *stamp)
+			*stamp = filter_stamp;
+	}
+
+	pthread_mutex_unlock(&source->filter_mutex);
+	return tracked;
+}
+
 void obs_source_update_properties(obs_source_t *source)
 {
 	if (!obs_source_valid(source, "obs_source_update_properties"))
@@ -1031,6 +1364,13 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 	if ((source->info.output_flags & OBS_SOURCE_ASYNC) != 0)
 		async_tick(source);
 
+	if (source->create_deferred) {
+		if (os_atomic_load_bool(&source->deferred_created))
+			publish_deferred_source(source);
+		else if (source->show_refs || source->activate_refs)
+			queue_deferred_create(source);
+	}
+
 	if (source->defer_update)
 		obs_source_deferred_update(source);
 
@@ -1040,6 +1380,7 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 
 	/* call show/hide if the reference changed */
 	now_showing = !!source->show_refs;
+
 	if (now_showing != source->showing) {
 		if (now_showing) {
 			show_source(source);
@@ -1129,6 +1470,13 @@ static void source_signal_audio_data(obs_source_t *source,
 {
 	pthread_mutex_lock(&source->audio_cb_mutex);
 
+	if (os_atomic_load_long(&source->audio_levels_refs)) {
+		bool true_peak = os_atomic_load_long(
+				&source->audio_levels_true_peak_refs) > 0;
+		audio_levels_process(source->audio_levels, in, true_peak,
+				muted);
+	}
+
 	for (size_t i = source->audio_cb_list.num; i > 0; i--) {
 		struct audio_cb_info info = source->audio_cb_list.array[i - 1];
 		info.callback(info.param, source, in, muted);
@@ -1825,6 +2173,52 @@ void obs_source_video_render(obs_source_t *source)
 	obs_source_release(source);
 }
 
+/* Called instead of obs_source_video_render for sources a scene doesn't need
+ * to draw.  Asynchronous frames are still consumed so the source doesn't fall
+ * behind and shows the current frame once it's drawn again. */
+void obs_source_video_render_culled(obs_source_t *source)
+{
+	if (source->info.type == OBS_SOURCE_TYPE_INPUT &&
+	    (source->info.output_flags & OBS_SOURCE_ASYNC) != 0) {
+		if (deinterlacing_enabled(source))
+			deinterlace_update_async_video(source);
+		obs_source_update_async_video(source);
+	}
+}
+
+static inline bool format_has_alpha(enum video_format format)
+{
+	return format == VIDEO_FORMAT_RGBA || format == VIDEO_FORMAT_BGRA;
+}
+
+bool obs_source_is_opaque(obs_source_t *source)
+{
+	bool opaque = true;
+
+	if ((source->info.output_flags & OBS_SOURCE_OPAQUE) == 0)
+		return false;
+	if (!source->context.data || !source->enabled)
+		return false;
+
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC) != 0) {
+		if (!source->async_active || format_has_alpha(
+					source->async_format))
+			return false;
+	}
+
+	/* filters are free to change the alpha of the source */
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		if (source->filters.array[i]->enabled) {
+			opaque = false;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return opaque;
+}
+
 static uint32_t get_base_width(const obs_source_t *source)
 {
 	bool is_filter = !!source->filter_parent;
@@ -1983,6 +2377,9 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	bump_content_stamp(source);
+	obs_source_bump_save_stamp(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -2018,6 +2415,9 @@ static bool obs_source_filter_remove_refless(obs_source_t *source,
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	bump_content_stamp(source);
+	obs_source_bump_save_stamp(source);
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -2144,8 +2544,11 @@ void obs_source_filter_set_order(obs_source_t *source, obs_source_t *filter,
 	success = move_filter_dir(source, filter, movement);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		bump_content_stamp(source);
+		obs_source_bump_save_stamp(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 obs_data_t *obs_source_get_settings(const obs_source_t *source)
@@ -2153,6 +2556,9 @@ obs_data_t *obs_source_get_settings(const obs_source_t *source)
 	if (!obs_source_valid(source, "obs_source_get_settings"))
 		return NULL;
 
+	/* the caller may change the settings without updating the source */
+	obs_source_bump_save_stamp(source);
+
 	obs_data_addref(source->context.settings);
 	return source->context.settings;
 }
@@ -2840,6 +3246,11 @@ void obs_source_set_name(obs_source_t *source, const char *name)
 		char *prev_name = bstrdup(source->context.name);
 		obs_context_data_setname(&source->context, name);
 
+		/* scenes save their items by name */
+		obs_source_bump_save_stamp(source);
+		os_atomic_set_long(&obs->data.name_stamp,
+				os_atomic_load_long(&source->save_stamp));
+
 		calldata_init(&data);
 		calldata_set_ptr(&data, "source", source);
 		calldata_set_string(&data, "new_name", source->context.name);
@@ -3102,6 +3513,7 @@ void obs_source_set_volume(obs_source_t *source, float volume)
 		pthread_mutex_unlock(&source->audio_actions_mutex);
 
 		source->user_volume = volume;
+		obs_source_bump_save_stamp(source);
 	}
 }
 
@@ -3125,6 +3537,7 @@ void obs_source_set_sync_offset(obs_source_t *source, int64_t offset)
 				&data);
 
 		source->sync_offset = calldata_int(&data, "offset");
+		obs_source_bump_save_stamp(source);
 	}
 }
 
@@ -3331,12 +3744,29 @@ void obs_source_save(obs_source_t *source)
 
 void obs_source_load(obs_source_t *source)
 {
-	if (!data_valid(source, "obs_source_load"))
+	if (!obs_source_valid(source, "obs_source_load"))
 		return;
-	if (source->info.load)
-		source->info.load(source->context.data,
-				source->context.settings);
 
+	if (source->create_deferred) {
+		/* info.load is called once the source is instantiated */
+		pthread_mutex_lock(&source->deferred_mutex);
+		if (!os_atomic_load_bool(&source->deferred_created)) {
+			source->load_deferred = true;
+		} else if (source->deferred_data && source->info.load) {
+			source->info.load(source->deferred_data,
+					source->context.settings);
+		}
+		pthread_mutex_unlock(&source->deferred_mutex);
+
+	} else if (source->context.data) {
+		if (source->info.load)
+			source->info.load(source->context.data,
+					source->context.settings);
+	} else {
+		return;
+	}
+
+	obs_source_bump_save_stamp(source);
 	obs_source_dosignal(source, "source_load", "load");
 }
 
@@ -3371,6 +3801,7 @@ void obs_source_set_flags(obs_source_t *source, uint32_t flags)
 
 	if (flags != source->flags) {
 		source->flags = flags;
+		obs_source_bump_save_stamp(source);
 		signal_flags_updated(source);
 	}
 }
@@ -3411,6 +3842,7 @@ void obs_source_set_audio_mixers(obs_source_t *source, uint32_t mixers)
 	mixers = (uint32_t)calldata_int(&data, "mixers");
 
 	source->audio_mixers = mixers;
+	obs_source_bump_save_stamp(source);
 }
 
 uint32_t obs_source_get_audio_mixers(const obs_source_t *source)
@@ -3561,6 +3993,8 @@ void obs_source_set_enabled(obs_source_t *source, bool enabled)
 		return;
 
 	source->enabled = enabled;
+	bump_content_stamp(source);
+	obs_source_bump_save_stamp(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -3589,6 +4023,7 @@ void obs_source_set_muted(obs_source_t *source, bool muted)
 		return;
 
 	source->user_muted = muted;
+	obs_source_bump_save_stamp(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -3653,6 +4088,7 @@ void obs_source_enable_push_to_mute(obs_source_t *source, bool enabled)
 				enabled ? "enabled" : "disabled");
 
 	source->push_to_mute_enabled = enabled;
+	obs_source_bump_save_stamp(source);
 
 	if (changed)
 		source_signal_push_to_changed(source, "push_to_mute_changed",
@@ -3680,6 +4116,7 @@ void obs_source_set_push_to_mute_delay(obs_source_t *source, uint64_t delay)
 
 	pthread_mutex_lock(&source->audio_mutex);
 	source->push_to_mute_delay = delay;
+	obs_source_bump_save_stamp(source);
 
 	source_signal_push_to_delay(source, "push_to_mute_delay", delay);
 	pthread_mutex_unlock(&source->audio_mutex);
@@ -3711,6 +4148,7 @@ void obs_source_enable_push_to_talk(obs_source_t *source, bool enabled)
 				enabled ? "enabled" : "disabled");
 
 	source->push_to_talk_enabled = enabled;
+	obs_source_bump_save_stamp(source);
 
 	if (changed)
 		source_signal_push_to_changed(source, "push_to_talk_changed",
@@ -3738,6 +4176,7 @@ void obs_source_set_push_to_talk_delay(obs_source_t *source, uint64_t delay)
 
 	pthread_mutex_lock(&source->audio_mutex);
 	source->push_to_talk_delay = delay;
+	obs_source_bump_save_stamp(source);
 
 	source_signal_push_to_delay(source, "push_to_talk_delay", delay);
 	pthread_mutex_unlock(&source->audio_mutex);
@@ -4094,6 +4533,7 @@ void obs_source_set_monitoring_type(obs_source_t *source,
 	}
 
 	source->monitoring_type = type;
+	obs_source_bump_save_stamp(source);
 }
 
 enum obs_monitoring_type obs_source_get_monitoring_type(
@@ -4122,6 +4562,8 @@ obs_data_t *obs_source_get_private_settings(obs_source_t *source)
 	if (!obs_ptr_valid(source, "obs_source_get_private_settings"))
 		return NULL;
 
+	obs_source_bump_save_stamp(source);
+
 	obs_data_addref(source->private_settings);
 	return source->private_settings;
 }
@@ -135,6 +135,41 @@ enum obs_source_type {
  */
 #define OBS_SOURCE_CAP_DISABLED (1<<10)
 
+/**
+ * Source can be created from any thread
+ *
+ * Specifies that the create callback of this source type does not rely on
+ * being called from the thread loading the scene collection, and may run
+ * concurrently with the creation of other sources.  When loading sources via
+ * obs_load_sources, inputs of such types are created on a pool of worker
+ * threads, and only inputs of such types can have their creation deferred.
+ */
+#define OBS_SOURCE_THREADSAFE_CREATE (1<<11)
+
+/**
+ * Source video only changes when it is updated
+ *
+ * Specifies that the source renders the same image every frame unless its
+ * settings are updated, its filters change, or it calls
+ * obs_source_invalidate_cache.  Scene items of such sources (and of scenes
+ * made up solely of such sources) are rendered to a texture once and that
+ * texture is reused until the content changes.
+ *
+ * Filters may also set this flag, otherwise any enabled filter on a source
+ * disables caching for it.
+ */
+#define OBS_SOURCE_STATIC_CONTENT (1<<12)
+
+/**
+ * Source video is fully opaque
+ *
+ * Specifies that the source covers its whole area with opaque pixels, so
+ * scenes can skip rendering the items it fully covers.  It is ignored while
+ * the source has enabled filters, and for asynchronous sources while the
+ * current frame format has an alpha channel.
+ */
+#define OBS_SOURCE_OPAQUE (1<<13)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -305,13 +305,13 @@ end:
 
 static const char *stage_output_texture_name = "stage_output_texture";
 static inline void stage_output_texture(struct obs_core_video *video,
-		int cur_texture, int prev_texture)
+		int prev_texture)
 {
 	profile_start(stage_output_texture_name);
 
 	gs_texture_t   *texture;
 	bool        texture_ready;
-	gs_stagesurf_t *copy = video->copy_surfaces[cur_texture];
+	gs_stagesurf_t *copy;
 
 	if (video->gpu_conversion) {
 		texture = video->convert_textures[prev_texture];
@@ -326,9 +326,13 @@ static inline void stage_output_texture(struct obs_core_video *video,
 	if (!texture_ready)
 		goto end;
 
+	/* download_frame always leaves a surface free for the next stage */
+	copy = video->copy_surfaces[video->cur_copy_surface];
 	gs_stage_texture(copy, texture);
 
-	video->textures_copied[cur_texture] = true;
+	if (++video->cur_copy_surface == video->staging_depth)
+		video->cur_copy_surface = 0;
+	video->copies_queued++;
 
 end:
 	profile_end(stage_output_texture_name);
@@ -349,7 +353,7 @@ static inline void render_video(struct obs_core_video *video, bool raw_active,
 		if (video->gpu_conversion)
 			render_convert_texture(video, cur_texture, prev_texture);
 
-		stage_output_texture(video, cur_texture, prev_texture);
+		stage_output_texture(video, prev_texture);
 	}
 
 	gs_set_render_target(NULL, NULL);
@@ -358,15 +362,45 @@ static inline void render_video(struct obs_core_video *video, bool raw_active,
 	gs_end_scene();
 }
 
+static const char *map_staged_frame_name = "map_staged_frame";
+static const char *map_staged_frame_wait_name = "map_staged_frame(wait)";
 static inline bool download_frame(struct obs_core_video *video,
-		int prev_texture, struct video_data *frame)
+		struct video_data *frame)
 {
-	gs_stagesurf_t *surface = video->copy_surfaces[prev_texture];
+	uint32_t oldest;
+	gs_stagesurf_t *surface;
+	bool full;
+	bool ready;
+	bool success;
+	const char *name;
+
+	if (!video->copies_queued)
+		return false;
 
-	if (!video->textures_copied[prev_texture])
+	oldest = (video->cur_copy_surface + video->staging_depth -
+			video->copies_queued) % video->staging_depth;
+	surface = video->copy_surfaces[oldest];
+
+	/* only wait on the GPU once every surface is in use, otherwise the
+	 * frame is picked up on a later tick.  a full ring is the normal
+	 * state (one frame is staged and one mapped per tick), so a map is
+	 * only counted as a wait if the copy really hasn't finished yet */
+	full = video->copies_queued == video->staging_depth;
+	ready = gs_stagesurface_is_ready(surface);
+	if (!full && !ready)
 		return false;
 
-	if (!gs_stagesurface_map(surface, &frame->data[0], &frame->linesize[0]))
+	name = ready ? map_staged_frame_name : map_staged_frame_wait_name;
+
+	profile_start(name);
+	success = gs_stagesurface_map(surface, &frame->data[0],
+			&frame->linesize[0]);
+	profile_end(name);
+
+	/* a surface that fails to map is dropped, so it can't block the
+	 * ring */
+	video->copies_queued--;
+	if (!success)
 		return false;
 
 	video->mapped_surface = surface;
@@ -525,6 +559,7 @@ static inline void output_video_data(struct obs_core_video *video,
 	}
 }
 
+static const char *lagged_frame_name = "lagged_frame";
 static inline void video_sleep(struct obs_core_video *video, bool active,
 		uint64_t *p_time, uint64_t interval_ns)
 {
@@ -544,6 +579,9 @@ static inline void video_sleep(struct obs_core_video *video, bool active,
 	video->total_frames += count;
 	video->lagged_frames += count - 1;
 
+	if (count > 1)
+		profile_trace_trigger(lagged_frame_name);
+
 	vframe_info.timestamp = cur_time;
 	vframe_info.count = count;
 	if (active)
@@ -575,7 +613,7 @@ static inline void output_frame(bool raw_active)
 
 	if (raw_active) {
 		profile_start(output_frame_download_frame_name);
-		frame_ready = download_frame(video, prev_texture, &frame);
+		frame_ready = download_frame(video, &frame);
 		profile_end(output_frame_download_frame_name);
 	}
 
@@ -608,10 +646,11 @@ static void clear_frame_data(void)
 	struct obs_core_video *video = &obs->video;
 	memset(video->textures_rendered, 0, sizeof(video->textures_rendered));
 	memset(video->textures_output, 0, sizeof(video->textures_output));
-	memset(video->textures_copied, 0, sizeof(video->textures_copied));
 	memset(video->textures_converted, 0, sizeof(video->textures_converted));
 	circlebuf_free(&video->vframe_info_buffer);
 	video->cur_texture = 0;
+	video->cur_copy_surface = 0;
+	video->copies_queued = 0;
 }
 
 static const char *tick_sources_name = "tick_sources";
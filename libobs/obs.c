@@ -190,13 +190,15 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 		video->conversion_height : ovi->output_height;
 	size_t i;
 
-	for (i = 0; i < NUM_TEXTURES; i++) {
+	for (i = 0; i < video->staging_depth; i++) {
 		video->copy_surfaces[i] = gs_stagesurface_create(
 				ovi->output_width, output_height, GS_RGBA);
 
 		if (!video->copy_surfaces[i])
 			return false;
+	}
 
+	for (i = 0; i < NUM_TEXTURES; i++) {
 		video->render_textures[i] = gs_texture_create(
 				ovi->base_width, ovi->base_height,
 				GS_RGBA, 1, NULL, GS_RENDER_TARGET);
@@ -360,6 +362,7 @@ static int obs_init_video(struct obs_video_info *ovi)
 	video->output_height  = ovi->output_height;
 	video->gpu_conversion = ovi->gpu_conversion;
 	video->scale_type     = ovi->scale_type;
+	video->staging_depth  = ovi->staging_depth;
 
 	set_video_matrix(video, ovi);
 
@@ -427,13 +430,16 @@ static void obs_free_video(void)
 			video->mapped_surface = NULL;
 		}
 
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < MAX_STAGING_DEPTH; i++) {
 			gs_stagesurface_destroy(video->copy_surfaces[i]);
+			video->copy_surfaces[i] = NULL;
+		}
+
+		for (size_t i = 0; i < NUM_TEXTURES; i++) {
 			gs_texture_destroy(video->render_textures[i]);
 			gs_texture_destroy(video->convert_textures[i]);
 			gs_texture_destroy(video->output_textures[i]);
 
-			video->copy_surfaces[i]    = NULL;
 			video->render_textures[i]  = NULL;
 			video->convert_textures[i] = NULL;
 			video->output_textures[i]  = NULL;
@@ -447,12 +453,12 @@ static void obs_free_video(void)
 				sizeof(video->textures_rendered));
 		memset(&video->textures_output, 0,
 				sizeof(video->textures_output));
-		memset(&video->textures_copied, 0,
-				sizeof(video->textures_copied));
 		memset(&video->textures_converted, 0,
 				sizeof(video->textures_converted));
 
-		video->cur_texture = 0;
+		video->cur_texture      = 0;
+		video->cur_copy_surface = 0;
+		video->copies_queued    = 0;
 	}
 }
 
@@ -534,6 +540,224 @@ static void obs_free_audio(void)
 	memset(audio, 0, sizeof(struct obs_core_audio));
 }
 
+#define CONTEXT_INDEX_MIN_BUCKETS 64
+#define TYPE_INDEX_MIN_CAPACITY   32
+
+/* FNV-1a */
+static inline uint32_t hash_string(const char *str)
+{
+	uint32_t hash = 2166136261U;
+	while (*str) {
+		hash ^= (uint8_t)*(str++);
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static inline bool context_indexable(const struct obs_context_data *context)
+{
+	return !context->private && context->name;
+}
+
+static inline struct obs_context_data **get_bucket(
+		const struct obs_context_index *index, uint32_t hash)
+{
+	return index->buckets + (hash & (index->num_buckets - 1));
+}
+
+static void context_index_link(struct obs_context_data **prev_next,
+		struct obs_context_data *context)
+{
+	context->hash_prev_next = prev_next;
+	context->hash_next      = *prev_next;
+	*prev_next              = context;
+	if (context->hash_next)
+		context->hash_next->hash_prev_next = &context->hash_next;
+}
+
+static void context_index_resize(struct obs_context_index *index,
+		size_t num_buckets)
+{
+	struct obs_context_data **old_buckets = index->buckets;
+	size_t old_num_buckets = index->num_buckets;
+
+	index->buckets     = bzalloc(num_buckets * sizeof(*index->buckets));
+	index->num_buckets = num_buckets;
+
+	/* append to the end of the new chains so that contexts sharing a
+	 * name keep their newest-first order */
+	for (size_t i = 0; i < old_num_buckets; i++) {
+		struct obs_context_data *context = old_buckets[i];
+
+		while (context) {
+			struct obs_context_data *next = context->hash_next;
+			struct obs_context_data **tail =
+				get_bucket(index, context->name_hash);
+
+			while (*tail)
+				tail = &(*tail)->hash_next;
+
+			context_index_link(tail, context);
+			context = next;
+		}
+	}
+
+	bfree(old_buckets);
+}
+
+/* must be called with the list mutex held */
+static void context_index_insert(struct obs_context_index *index,
+		struct obs_context_data *context)
+{
+	if (!context_indexable(context))
+		return;
+
+	if (!index->num_buckets)
+		context_index_resize(index, CONTEXT_INDEX_MIN_BUCKETS);
+	else if (index->num >= index->num_buckets)
+		context_index_resize(index, index->num_buckets * 2);
+
+	context->name_hash = hash_string(context->name);
+	context_index_link(get_bucket(index, context->name_hash), context);
+	index->num++;
+}
+
+/* must be called with the list mutex held */
+static void context_index_remove(struct obs_context_index *index,
+		struct obs_context_data *context)
+{
+	if (!context->hash_prev_next)
+		return;
+
+	*context->hash_prev_next = context->hash_next;
+	if (context->hash_next)
+		context->hash_next->hash_prev_next = context->hash_prev_next;
+
+	context->hash_next      = NULL;
+	context->hash_prev_next = NULL;
+	index->num--;
+}
+
+/* must be called with the list mutex held */
+static struct obs_context_data *context_index_find(
+		const struct obs_context_index *index, const char *name)
+{
+	struct obs_context_data *context;
+	uint32_t hash;
+
+	if (!index->num || !name)
+		return NULL;
+
+	hash = hash_string(name);
+	context = *get_bucket(index, hash);
+
+	while (context) {
+		if (context->name_hash == hash &&
+		    strcmp(context->name, name) == 0)
+			return context;
+		context = context->hash_next;
+	}
+
+	return NULL;
+}
+
+static void context_index_free(struct obs_context_index *index)
+{
+	bfree(index->buckets);
+	memset(index, 0, sizeof(*index));
+}
+
+static inline struct obs_context_index *get_context_index(
+		enum obs_obj_type type)
+{
+	switch (type) {
+	case OBS_OBJ_TYPE_SOURCE:  return &obs->data.sources_index;
+	case OBS_OBJ_TYPE_OUTPUT:  return &obs->data.outputs_index;
+	case OBS_OBJ_TYPE_ENCODER: return &obs->data.encoders_index;
+	case OBS_OBJ_TYPE_SERVICE: return &obs->data.services_index;
+	case OBS_OBJ_TYPE_INVALID: break;
+	}
+
+	return NULL;
+}
+
+static inline const char *type_id_at(const void *types, size_t stride,
+		size_t id_offset, size_t idx)
+{
+	return *(const char**)((const uint8_t*)types + idx * stride +
+			id_offset);
+}
+
+static void type_index_place(struct obs_type_index *index, const char *id,
+		size_t idx)
+{
+	size_t mask = index->capacity - 1;
+	size_t slot = hash_string(id) & mask;
+
+	while (index->slots[slot])
+		slot = (slot + 1) & mask;
+
+	/* slots store the array index plus one so that zero means empty */
+	index->slots[slot] = idx + 1;
+}
+
+void obs_type_index_add(struct obs_type_index *index,
+		const void *types, size_t stride, size_t id_offset, size_t num)
+{
+	if (!num)
+		return;
+
+	/* keep the load factor at or below one half */
+	if (num * 2 > index->capacity) {
+		size_t capacity = index->capacity ?
+			index->capacity : TYPE_INDEX_MIN_CAPACITY;
+		while (num * 2 > capacity)
+			capacity *= 2;
+
+		bfree(index->slots);
+		index->slots    = bzalloc(capacity * sizeof(size_t));
+		index->capacity = capacity;
+
+		for (size_t i = 0; i < num - 1; i++)
+			type_index_place(index,
+					type_id_at(types, stride, id_offset, i),
+					i);
+	}
+
+	type_index_place(index, type_id_at(types, stride, id_offset, num - 1),
+			num - 1);
+}
+
+void *obs_type_index_find(const struct obs_type_index *index,
+		const void *types, size_t stride, size_t id_offset,
+		const char *id)
+{
+	size_t mask;
+	size_t slot;
+
+	if (!index->capacity || !id)
+		return NULL;
+
+	mask = index->capacity - 1;
+	slot = hash_string(id) & mask;
+
+	while (index->slots[slot]) {
+		size_t idx = index->slots[slot] - 1;
+		if (strcmp(type_id_at(types, stride, id_offset, idx), id) == 0)
+			return (uint8_t*)types + idx * stride;
+
+		slot = (slot + 1) & mask;
+	}
+
+	return NULL;
+}
+
+void obs_type_index_free(struct obs_type_index *index)
+{
+	bfree(index->slots);
+	memset(index, 0, sizeof(*index));
+}
+
 static bool obs_init_data(void)
 {
 	struct obs_core_data *data = &obs->data;
@@ -564,6 +788,8 @@ static bool obs_init_data(void)
 		goto fail;
 	if (!obs_view_init(&data->main_view))
 		goto fail;
+	if (!obs_source_init_deferred_create())
+		goto fail;
 
 	data->valid = true;
 
@@ -605,12 +831,19 @@ static void obs_free_data(void)
 
 	blog(LOG_INFO, "Freeing OBS context data");
 
+	obs_source_free_deferred_create();
+
 	FREE_OBS_LINKED_LIST(source);
 	FREE_OBS_LINKED_LIST(output);
 	FREE_OBS_LINKED_LIST(encoder);
 	FREE_OBS_LINKED_LIST(display);
 	FREE_OBS_LINKED_LIST(service);
 
+	context_index_free(&data->sources_index);
+	context_index_free(&data->outputs_index);
+	context_index_free(&data->encoders_index);
+	context_index_free(&data->services_index);
+
 	pthread_mutex_destroy(&data->sources_mutex);
 	pthread_mutex_destroy(&data->audio_sources_mutex);
 	pthread_mutex_destroy(&data->displays_mutex);
@@ -876,6 +1109,11 @@ void obs_shutdown(void)
 
 #undef FREE_REGISTERED_TYPES
 
+	obs_type_index_free(&obs->source_types_index);
+	obs_type_index_free(&obs->output_types_index);
+	obs_type_index_free(&obs->encoder_types_index);
+	obs_type_index_free(&obs->service_types_index);
+
 	da_free(obs->input_types);
 	da_free(obs->filter_types);
 	da_free(obs->transition_types);
@@ -989,6 +1227,14 @@ int obs_reset_video(struct obs_video_info *ovi)
 	ovi->output_width  &= 0xFFFFFFFC;
 	ovi->output_height &= 0xFFFFFFFE;
 
+	if (ovi->staging_depth < MIN_STAGING_DEPTH ||
+	    ovi->staging_depth > MAX_STAGING_DEPTH) {
+		if (ovi->staging_depth)
+			blog(LOG_WARNING, "Invalid staging depth %u, using %u",
+					ovi->staging_depth, MIN_STAGING_DEPTH);
+		ovi->staging_depth = MIN_STAGING_DEPTH;
+	}
+
 	if (!video->graphics) {
 		int errorcode = obs_init_graphics(ovi);
 		if (errorcode != OBS_VIDEO_SUCCESS) {
@@ -1027,7 +1273,8 @@ int obs_reset_video(struct obs_video_info *ovi)
 	               "\tdownscale filter:  %s\n"
 	               "\tfps:               %d/%d\n"
 	               "\tformat:            %s\n"
-	               "\tYUV mode:          %s%s%s",
+	               "\tYUV mode:          %s%s%s\n"
+	               "\tstaging depth:     %u",
 	               ovi->base_width, ovi->base_height,
 	               ovi->output_width, ovi->output_height,
 	               scale_type_name,
@@ -1035,7 +1282,8 @@ int obs_reset_video(struct obs_video_info *ovi)
 	               get_video_format_name(ovi->output_format),
 	               yuv ? yuv_format : "None",
 		       yuv ? "/" : "",
-	               yuv ? yuv_range : "");
+	               yuv ? yuv_range : "",
+	               ovi->staging_depth);
 
 	return obs_init_video(ovi);
 }
@@ -1359,22 +1607,17 @@ void obs_enum_services(bool (*enum_proc)(void*, obs_service_t*), void *param)
 			enum_proc, param);
 }
 
-static inline void *get_context_by_name(void *vfirst, const char *name,
-		pthread_mutex_t *mutex, void *(*addref)(void*))
+static inline void *get_context_by_name(struct obs_context_index *index,
+		const char *name, pthread_mutex_t *mutex,
+		void *(*addref)(void*))
 {
-	struct obs_context_data **first = vfirst;
 	struct obs_context_data *context;
 
 	pthread_mutex_lock(mutex);
 
-	context = *first;
-	while (context) {
-		if (!context->private && strcmp(context->name, name) == 0) {
-			context = addref(context);
-			break;
-		}
-		context = context->next;
-	}
+	context = context_index_find(index, name);
+	if (context)
+		context = addref(context);
 
 	pthread_mutex_unlock(mutex);
 	return context;
@@ -1408,28 +1651,28 @@ static inline void *obs_id_(void *data)
 obs_source_t *obs_get_source_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_source, name,
+	return get_context_by_name(&obs->data.sources_index, name,
 			&obs->data.sources_mutex, obs_source_addref_safe_);
 }
 
 obs_output_t *obs_get_output_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_output, name,
+	return get_context_by_name(&obs->data.outputs_index, name,
 			&obs->data.outputs_mutex, obs_output_addref_safe_);
 }
 
 obs_encoder_t *obs_get_encoder_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_encoder, name,
+	return get_context_by_name(&obs->data.encoders_index, name,
 			&obs->data.encoders_mutex, obs_encoder_addref_safe_);
 }
 
 obs_service_t *obs_get_service_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_service, name,
+	return get_context_by_name(&obs->data.services_index, name,
 			&obs->data.services_mutex, obs_service_addref_safe_);
 }
 
@@ -1546,14 +1789,45 @@ float obs_get_master_volume(void)
 	return obs ? obs->audio.user_volume : 0.0f;
 }
 
-static obs_source_t *obs_load_source_type(obs_data_t *source_data)
+static obs_source_t *obs_load_source_type(obs_data_t *source_data);
+
+/* deferred sources are created on a background thread, so only inputs that
+ * declare thread-safe creation can be deferred */
+static inline bool can_defer_creation(const char *id)
+{
+	const struct obs_source_info *info;
+
+	if (!obs->data.defer_source_creation)
+		return false;
+
+	info = get_source_info(id);
+	return info && info->type == OBS_SOURCE_TYPE_INPUT &&
+		(info->output_flags & OBS_SOURCE_THREADSAFE_CREATE) != 0;
+}
+
+static obs_source_t *create_source_from_data(obs_data_t *source_data,
+		bool allow_defer)
 {
-	obs_data_array_t *filters = obs_data_get_array(source_data, "filters");
 	obs_source_t *source;
 	const char   *name    = obs_data_get_string(source_data, "name");
 	const char   *id      = obs_data_get_string(source_data, "id");
 	obs_data_t   *settings = obs_data_get_obj(source_data, "settings");
 	obs_data_t   *hotkeys  = obs_data_get_obj(source_data, "hotkeys");
+
+	if (allow_defer && can_defer_creation(id))
+		source = obs_source_create_deferred(id, name, settings,
+				hotkeys);
+	else
+		source = obs_source_create(id, name, settings, hotkeys);
+
+	obs_data_release(hotkeys);
+	obs_data_release(settings);
+	return source;
+}
+
+static void load_source_data(obs_source_t *source, obs_data_t *source_data)
+{
+	obs_data_array_t *filters = obs_data_get_array(source_data, "filters");
 	double       volume;
 	int64_t      sync;
 	uint32_t     flags;
@@ -1562,10 +1836,6 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 	int          di_mode;
 	int          monitoring_type;
 
-	source = obs_source_create(id, name, settings, hotkeys);
-
-	obs_data_release(hotkeys);
-
 	obs_data_set_default_double(source_data, "volume", 1.0);
 	volume = obs_data_get_double(source_data, "volume");
 	obs_source_set_volume(source, (float)volume);
@@ -1641,9 +1911,13 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 
 		obs_data_array_release(filters);
 	}
+}
 
-	obs_data_release(settings);
-
+static obs_source_t *obs_load_source_type(obs_data_t *source_data)
+{
+	obs_source_t *source = create_source_from_data(source_data, false);
+	if (source)
+		load_source_data(source, source_data);
 	return source;
 }
 
@@ -1652,59 +1926,229 @@ obs_source_t *obs_load_source(obs_data_t *source_data)
 	return obs_load_source_type(source_data);
 }
 
+struct source_load_job {
+	obs_data_t                      *source_data;
+	obs_source_t                    *source;
+	bool                            concurrent;
+	uint64_t                        create_time;
+	uint64_t                        load_time;
+};
+
+struct source_loader {
+	struct source_load_job          *jobs;
+	size_t                          num_jobs;
+	volatile long                   next_job;
+};
+
+/* leaf inputs whose type declares thread-safe creation do not depend on any
+ * other source at creation time (scene items, transitions and filters are
+ * only resolved afterward in obs_source_load), so they can be created in any
+ * order on any thread */
+static bool can_create_concurrently(obs_data_t *source_data)
+{
+	const char *id = obs_data_get_string(source_data, "id");
+	const struct obs_source_info *info = get_source_info(id);
+
+	/* deferred sources are cheap to create, nothing to gain */
+	if (can_defer_creation(id))
+		return false;
+
+	return info && info->type == OBS_SOURCE_TYPE_INPUT &&
+		(info->output_flags & OBS_SOURCE_THREADSAFE_CREATE) != 0;
+}
+
+static void *source_loader_thread(void *param)
+{
+	struct source_loader *loader = param;
+
+	os_set_thread_name("libobs: source loader");
+
+	for (;;) {
+		long idx = os_atomic_inc_long(&loader->next_job) - 1;
+		struct source_load_job *job;
+		uint64_t start;
+
+		if (idx >= (long)loader->num_jobs)
+			break;
+
+		job = &loader->jobs[idx];
+		if (!job->concurrent)
+			continue;
+
+		start = os_gettime_ns();
+		job->source = create_source_from_data(job->source_data, false);
+		job->create_time = os_gettime_ns() - start;
+	}
+
+	return NULL;
+}
+
+#define MAX_SOURCE_LOADER_THREADS 8
+
+static size_t create_sources_concurrently(struct source_loader *loader)
+{
+	pthread_t threads[MAX_SOURCE_LOADER_THREADS];
+	size_t num_concurrent = 0;
+	size_t num_threads = 0;
+	int cores;
+
+	for (size_t i = 0; i < loader->num_jobs; i++) {
+		struct source_load_job *job = &loader->jobs[i];
+		job->concurrent = can_create_concurrently(job->source_data);
+		if (job->concurrent)
+			num_concurrent++;
+	}
+
+	if (num_concurrent < 2)
+		return 0;
+
+	cores = os_get_logical_cores();
+	if (cores > 1) {
+		num_threads = (size_t)cores - 1;
+		if (num_threads > MAX_SOURCE_LOADER_THREADS)
+			num_threads = MAX_SOURCE_LOADER_THREADS;
+		if (num_threads > num_concurrent - 1)
+			num_threads = num_concurrent - 1;
+	}
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&threads[i], NULL, source_loader_thread,
+					loader) != 0) {
+			num_threads = i;
+			break;
+		}
+	}
+
+	/* the calling thread works through the queue too */
+	source_loader_thread(loader);
+
+	for (size_t i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	return num_concurrent;
+}
+
+/* workers insert sources into the source list in the order they finish, so
+ * each is moved back to the head of the list at its position in the array.
+ * this keeps the list, and so the order sources are saved in, the same as
+ * when every source is created in order.  sources_mutex must be held. */
+static void relink_source_first(obs_source_t *source)
+{
+	struct obs_context_data *context = &source->context;
+	struct obs_context_data **first =
+		(struct obs_context_data**)&obs->data.first_source;
+
+	if (!context->mutex || *first == context)
+		return;
+
+	*context->prev_next = context->next;
+	if (context->next)
+		context->next->prev_next = context->prev_next;
+
+	context->prev_next = first;
+	context->next      = *first;
+	*first             = context;
+	if (context->next)
+		context->next->prev_next = &context->next;
+}
+
+static void log_source_load_times(const struct source_loader *loader,
+		size_t num_concurrent, uint64_t total_time)
+{
+	for (size_t i = 0; i < loader->num_jobs; i++) {
+		const struct source_load_job *job = &loader->jobs[i];
+		if (!job->source)
+			continue;
+
+		blog(LOG_DEBUG, "Loaded source '%s' (%s): "
+				"create %.3f ms%s, load %.3f ms",
+				obs_source_get_name(job->source),
+				obs_source_get_id(job->source),
+				(double)job->create_time / 1000000.0,
+				job->concurrent ? " (concurrent)" : "",
+				(double)job->load_time / 1000000.0);
+	}
+
+	blog(LOG_INFO, "Loaded %llu source(s) in %.3f ms "
+			"(%llu created concurrently)",
+			(unsigned long long)loader->num_jobs,
+			(double)total_time / 1000000.0,
+			(unsigned long long)num_concurrent);
+}
+
 void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 		void *private_data)
 {
 	if (!obs) return;
 
 	struct obs_core_data *data = &obs->data;
-	DARRAY(obs_source_t*) sources;
-	size_t count;
+	struct source_loader loader = {0};
+	size_t num_concurrent;
+	uint64_t start_time = os_gettime_ns();
 	size_t i;
 
-	da_init(sources);
+	loader.num_jobs = obs_data_array_count(array);
+	loader.jobs = bzalloc(loader.num_jobs * sizeof(*loader.jobs));
 
-	count = obs_data_array_count(array);
-	da_reserve(sources, count);
+	for (i = 0; i < loader.num_jobs; i++)
+		loader.jobs[i].source_data = obs_data_array_item(array, i);
+
+	/* sources_mutex must not be held here, creation takes it to insert
+	 * each source into the source list */
+	num_concurrent = create_sources_concurrently(&loader);
 
 	pthread_mutex_lock(&data->sources_mutex);
 
-	for (i = 0; i < count; i++) {
-		obs_data_t   *source_data = obs_data_array_item(array, i);
-		obs_source_t *source      = obs_load_source(source_data);
+	for (i = 0; i < loader.num_jobs; i++) {
+		struct source_load_job *job = &loader.jobs[i];
+		uint64_t start = os_gettime_ns();
 
-		da_push_back(sources, &source);
+		if (!job->concurrent)
+			job->source = create_source_from_data(job->source_data,
+					true);
+		else if (job->source)
+			relink_source_first(job->source);
+		if (job->source)
+			load_source_data(job->source, job->source_data);
 
-		obs_data_release(source_data);
+		job->create_time += os_gettime_ns() - start;
 	}
 
 	/* tell sources that we want to load */
-	for (i = 0; i < sources.num; i++) {
-		obs_source_t *source = sources.array[i];
-		obs_data_t *source_data = obs_data_array_item(array, i);
+	for (i = 0; i < loader.num_jobs; i++) {
+		struct source_load_job *job = &loader.jobs[i];
+		obs_source_t *source = job->source;
+		uint64_t start = os_gettime_ns();
+
 		if (source) {
 			if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
-				obs_transition_load(source, source_data);
+				obs_transition_load(source, job->source_data);
 			obs_source_load(source);
 			if (cb)
 				cb(private_data, source);
 		}
-		obs_data_release(source_data);
+
+		job->load_time = os_gettime_ns() - start;
 	}
 
-	for (i = 0; i < sources.num; i++)
-		obs_source_release(sources.array[i]);
+	log_source_load_times(&loader, num_concurrent,
+			os_gettime_ns() - start_time);
+
+	for (i = 0; i < loader.num_jobs; i++) {
+		obs_source_release(loader.jobs[i].source);
+		obs_data_release(loader.jobs[i].source_data);
+	}
 
 	pthread_mutex_unlock(&data->sources_mutex);
 
-	da_free(sources);
+	bfree(loader.jobs);
 }
 
 obs_data_t *obs_save_source(obs_source_t *source)
 {
 	obs_data_array_t *filters = obs_data_array_create();
 	obs_data_t *source_data = obs_data_create();
-	obs_data_t *settings    = obs_source_get_settings(source);
+	obs_data_t *settings    = source->context.settings;
 	obs_data_t *hotkey_data = source->context.hotkey_data;
 	obs_data_t *hotkeys;
 	float      volume      = obs_source_get_volume(source);
@@ -1724,6 +2168,9 @@ obs_data_t *obs_save_source(obs_source_t *source)
 	int        di_order    =
 		(int)obs_source_get_deinterlace_field_order(source);
 
+	/* not obs_source_get_settings, saving doesn't change the source */
+	obs_data_addref(settings);
+
 	obs_source_save(source);
 	hotkeys = obs_hotkeys_save_source(source);
 
@@ -1822,6 +2269,17 @@ obs_data_array_t *obs_save_sources(void)
 	return obs_save_sources_filtered(save_source_filter, NULL);
 }
 
+void obs_set_deferred_source_creation(bool enable)
+{
+	if (!obs) return;
+	obs->data.defer_source_creation = enable;
+}
+
+bool obs_deferred_source_creation_enabled(void)
+{
+	return obs ? obs->data.defer_source_creation : false;
+}
+
 /* ensures that names are never blank */
 static inline char *dup_name(const char *name, bool private)
 {
@@ -1914,6 +2372,7 @@ void obs_context_data_insert(struct obs_context_data *context,
 	assert(first);
 
 	context->mutex = mutex;
+	context->index = get_context_index(context->type);
 
 	pthread_mutex_lock(mutex);
 	context->prev_next  = first;
@@ -1921,6 +2380,8 @@ void obs_context_data_insert(struct obs_context_data *context,
 	*first              = context;
 	if (context->next)
 		context->next->prev_next = &context->next;
+	if (context->index)
+		context_index_insert(context->index, context);
 	pthread_mutex_unlock(mutex);
 }
 
@@ -1932,15 +2393,26 @@ void obs_context_data_remove(struct obs_context_data *context)
 			*context->prev_next = context->next;
 		if (context->next)
 			context->next->prev_next = context->prev_next;
+		if (context->index)
+			context_index_remove(context->index, context);
 		pthread_mutex_unlock(context->mutex);
 
 		context->mutex = NULL;
+		context->index = NULL;
 	}
 }
 
 void obs_context_data_setname(struct obs_context_data *context,
 		const char *name)
 {
+	pthread_mutex_t *list_mutex = context->mutex;
+
+	if (list_mutex) {
+		pthread_mutex_lock(list_mutex);
+		if (context->index)
+			context_index_remove(context->index, context);
+	}
+
 	pthread_mutex_lock(&context->rename_cache_mutex);
 
 	if (context->name)
@@ -1948,6 +2420,12 @@ void obs_context_data_setname(struct obs_context_data *context,
 	context->name = dup_name(name, context->private);
 
 	pthread_mutex_unlock(&context->rename_cache_mutex);
+
+	if (list_mutex) {
+		if (context->index)
+			context_index_insert(context->index, context);
+		pthread_mutex_unlock(list_mutex);
+	}
 }
 
 profiler_name_store_t *obs_get_profiler_name_store(void)
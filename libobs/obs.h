@@ -176,6 +176,13 @@ struct obs_video_info {
 	enum video_range_type range;       /**< YUV range (if YUV) */
 
 	enum obs_scale_type scale_type;    /**< How to scale if scaling */
+
+	/**
+	 * Number of output frames that can be waiting on GPU readback at
+	 * once (2-4, 0 for the default of 2).  More frames add latency, but
+	 * give slow drivers more time before mapping has to wait on them.
+	 */
+	uint32_t            staging_depth;
 };
 
 /**
@@ -609,6 +616,14 @@ EXPORT float obs_get_master_volume(void);
 /** Saves a source to settings data */
 EXPORT obs_data_t *obs_save_source(obs_source_t *source);
 
+/**
+ * Gets a stamp that changes whenever the data obs_save_source writes for the
+ * source changes, so previously saved data can be reused while it stays the
+ * same.  Returns false if the source can't be tracked (for example if it
+ * writes its own data in its save callback) and always needs to be saved.
+ */
+EXPORT bool obs_source_get_save_stamp(obs_source_t *source, long *stamp);
+
 /** Loads a source from settings data */
 EXPORT obs_source_t *obs_load_source(obs_data_t *data);
 
@@ -627,6 +642,15 @@ EXPORT void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 /** Saves sources to a data array */
 EXPORT obs_data_array_t *obs_save_sources(void);
 
+/**
+ * Enables or disables deferred creation of inputs loaded with
+ * obs_load_sources.  When enabled, inputs only keep their settings until they
+ * are first shown, prewarmed, or have their properties queried, at which
+ * point they are created on a background thread.
+ */
+EXPORT void obs_set_deferred_source_creation(bool enable);
+EXPORT bool obs_deferred_source_creation_enabled(void);
+
 typedef bool (*obs_save_source_filter_cb)(void *data, obs_source_t *source);
 EXPORT obs_data_array_t *obs_save_sources_filtered(obs_save_source_filter_cb cb,
 		void *data);
@@ -913,6 +937,15 @@ EXPORT bool obs_source_active(const obs_source_t *source);
  */
 EXPORT bool obs_source_showing(const obs_source_t *source);
 
+/**
+ * Queues the background creation of a deferred source and any of its deferred
+ * visible children, e.g. to prepare a scene before switching to it.
+ */
+EXPORT void obs_source_prewarm(obs_source_t *source);
+
+/** Returns true if the source has not been instantiated yet */
+EXPORT bool obs_source_creation_deferred(const obs_source_t *source);
+
 /** Unused flag */
 #define OBS_SOURCE_FLAG_UNUSED_1               (1<<0)
 /** Specifies to force audio to mono */
@@ -1084,6 +1117,13 @@ EXPORT void obs_source_output_audio(obs_source_t *source,
 /** Signal an update to any currently used properties via 'update_properties' */
 EXPORT void obs_source_update_properties(obs_source_t *source);
 
+/**
+ * Marks the video of a source as changed.  Sources with the
+ * OBS_SOURCE_STATIC_CONTENT flag must call this whenever their image changes
+ * outside of an update, otherwise scenes may keep drawing the old image.
+ */
+EXPORT void obs_source_invalidate_cache(obs_source_t *source);
+
 /** Gets the current async video frame */
 EXPORT struct obs_source_frame *obs_source_get_frame(obs_source_t *source);
 
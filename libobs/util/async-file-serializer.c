@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2017 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "async-file-serializer.h"
+#include "threading.h"
+#include "platform.h"
+#include "profiler.h"
+#include "bmem.h"
+#include "base.h"
+
+#define DEFAULT_BUFFER_SIZE (4 * 1024 * 1024)
+#define DEFAULT_NUM_BUFFERS 4
+
+/* buffers, buffer sizes and file offsets must all be a multiple of this for
+ * unbuffered writes */
+#define DIRECT_IO_ALIGN 4096
+
+#ifdef _WIN32
+#define file_write(fd, data, size) _write(fd, data, (unsigned int)(size))
+#define file_seek                  _lseeki64
+#define file_sync                  _commit
+#define file_close                 _close
+#else
+#define file_write                 write
+#define file_seek                  lseek
+#define file_sync                  fsync
+#define file_close                 close
+#endif
+
+struct async_buffer {
+	uint8_t *data;
+	size_t  size;
+};
+
+struct async_file {
+	int                  fd;
+	bool                 direct_io;
+	enum async_file_sync sync;
+
+	uint8_t              *mem;
+	struct async_buffer  *buffers;
+	size_t               num_buffers;
+	size_t               buffer_size;
+
+	/* buffer currently being filled by the caller */
+	size_t               cur;
+	/* logical position as seen by the caller */
+	int64_t              pos;
+
+	/* writer thread only (or the caller while all buffers are free) */
+	size_t               next_write;
+	int64_t              file_pos;
+
+	os_sem_t             *free_sem;
+	os_sem_t             *full_sem;
+	volatile long        free_count;
+	pthread_t            thread;
+	volatile bool        stop;
+	volatile bool        error;
+
+	pthread_mutex_t      stats_mutex;
+	struct async_file_stats stats;
+};
+
+static int open_file(const char *path, bool direct_io)
+{
+	int fd = -1;
+
+#ifdef _WIN32
+	wchar_t *wpath;
+
+	if (os_utf8_to_wcs_ptr(path, 0, &wpath)) {
+		_wsopen_s(&fd, wpath, _O_WRONLY | _O_CREAT | _O_TRUNC |
+				_O_BINARY, _SH_DENYWR, _S_IREAD | _S_IWRITE);
+		bfree(wpath);
+	}
+
+	UNUSED_PARAMETER(direct_io);
+#else
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+#ifdef O_DIRECT
+	if (direct_io) {
+		fd = open(path, flags | O_DIRECT, 0644);
+		if (fd != -1)
+			return fd;
+	}
+#else
+	UNUSED_PARAMETER(direct_io);
+#endif
+
+	fd = open(path, flags, 0644);
+#endif
+
+	return fd;
+}
+
+static bool direct_io_enabled(int fd)
+{
+#if defined(O_DIRECT) && !defined(_WIN32)
+	int flags = fcntl(fd, F_GETFL);
+	return flags != -1 && (flags & O_DIRECT) != 0;
+#else
+	UNUSED_PARAMETER(fd);
+	return false;
+#endif
+}
+
+static void disable_direct_io(struct async_file *file)
+{
+#if defined(O_DIRECT) && !defined(_WIN32)
+	int flags = fcntl(file->fd, F_GETFL);
+	if (flags != -1)
+		fcntl(file->fd, F_SETFL, flags & ~O_DIRECT);
+#endif
+	file->direct_io = false;
+}
+
+static void preallocate_file(int fd, int64_t size)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+	/* keep the reported size unchanged so a file cut short by a crash
+	 * does not end in a block of zeroes */
+	if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)size) != 0)
+		blog(LOG_DEBUG, "async_file_serializer: preallocating %lld "
+				"bytes failed: %d", (long long)size, errno);
+#else
+	UNUSED_PARAMETER(fd);
+	UNUSED_PARAMETER(size);
+#endif
+}
+
+static bool write_data(struct async_file *file, const uint8_t *data,
+		size_t size)
+{
+	if (file->direct_io && (size % DIRECT_IO_ALIGN != 0 ||
+	                        file->file_pos % DIRECT_IO_ALIGN != 0))
+		disable_direct_io(file);
+
+	while (size) {
+		int64_t ret = (int64_t)file_write(file->fd, data, size);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			blog(LOG_ERROR, "async_file_serializer: write failed: "
+					"%d", errno);
+			return false;
+		}
+
+		data           += ret;
+		size           -= (size_t)ret;
+		file->file_pos += ret;
+	}
+
+	return true;
+}
+
+static const char *async_file_thread_name = "async_file_thread";
+static void *async_file_thread(void *param)
+{
+	struct async_file *file = param;
+
+	os_set_thread_name("async file writer");
+	profile_register_root(async_file_thread_name, 0);
+
+	for (;;) {
+		struct async_buffer *buf;
+		uint64_t start;
+		uint64_t elapsed;
+		bool success;
+
+		os_sem_wait(file->full_sem);
+		if (os_atomic_load_bool(&file->stop))
+			break;
+
+		buf = &file->buffers[file->next_write];
+		file->next_write = (file->next_write + 1) % file->num_buffers;
+
+		profile_start(async_file_thread_name);
+		start = os_gettime_ns();
+		success = !file->error && write_data(file, buf->data, buf->size);
+		if (success && file->sync == ASYNC_FILE_SYNC_EVERY_BUFFER)
+			file_sync(file->fd);
+		elapsed = os_gettime_ns() - start;
+		profile_end(async_file_thread_name);
+
+		if (!success)
+			os_atomic_set_bool(&file->error, true);
+
+		pthread_mutex_lock(&file->stats_mutex);
+		if (success) {
+			file->stats.bytes_written += buf->size;
+			file->stats.buffers_written++;
+		}
+		if (elapsed > file->stats.max_write_time_ns)
+			file->stats.max_write_time_ns = elapsed;
+		pthread_mutex_unlock(&file->stats_mutex);
+
+		buf->size = 0;
+		os_atomic_inc_long(&file->free_count);
+		os_sem_post(file->free_sem);
+
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static void wait_free_buffer(struct async_file *file)
+{
+	uint64_t start = 0;
+	bool stall = os_atomic_load_long(&file->free_count) == 0;
+
+	if (stall)
+		start = os_gettime_ns();
+
+	os_sem_wait(file->free_sem);
+	os_atomic_dec_long(&file->free_count);
+
+	if (stall) {
+		uint64_t elapsed = os_gettime_ns() - start;
+
+		pthread_mutex_lock(&file->stats_mutex);
+		file->stats.stalls++;
+		file->stats.stall_time_ns += elapsed;
+		pthread_mutex_unlock(&file->stats_mutex);
+	}
+}
+
+static void submit_buffer(struct async_file *file)
+{
+	os_sem_post(file->full_sem);
+	file->cur = (file->cur + 1) % file->num_buffers;
+	wait_free_buffer(file);
+}
+
+/* returns once everything written so far has reached the file */
+static void flush_buffers(struct async_file *file)
+{
+	if (file->buffers[file->cur].size)
+		submit_buffer(file);
+
+	for (size_t i = 1; i < file->num_buffers; i++)
+		os_sem_wait(file->free_sem);
+	for (size_t i = 1; i < file->num_buffers; i++)
+		os_sem_post(file->free_sem);
+}
+
+static size_t async_file_write(void *sdata, const void *data, size_t size)
+{
+	struct async_file *file = sdata;
+	const uint8_t *src = data;
+	size_t remaining = size;
+
+	if (os_atomic_load_bool(&file->error))
+		return 0;
+
+	while (remaining) {
+		struct async_buffer *buf = &file->buffers[file->cur];
+		size_t space = file->buffer_size - buf->size;
+		size_t copy = remaining < space ? remaining : space;
+
+		memcpy(buf->data + buf->size, src, copy);
+		buf->size += copy;
+		src       += copy;
+		remaining -= copy;
+
+		if (buf->size == file->buffer_size)
+			submit_buffer(file);
+	}
+
+	file->pos += (int64_t)size;
+	return size;
+}
+
+static int64_t async_file_seek(void *sdata, int64_t offset,
+		enum serialize_seek_type seek_type)
+{
+	struct async_file *file = sdata;
+	int origin = SEEK_SET;
+	int64_t new_pos;
+
+	switch (seek_type) {
+	case SERIALIZE_SEEK_START:   origin = SEEK_SET; break;
+	case SERIALIZE_SEEK_CURRENT: origin = SEEK_CUR; break;
+	case SERIALIZE_SEEK_END:     origin = SEEK_END; break;
+	}
+
+	/* the writer thread is idle after this, so the file can be used
+	 * directly */
+	flush_buffers(file);
+
+	new_pos = (int64_t)file_seek(file->fd, offset, origin);
+	if (new_pos < 0)
+		return -1;
+
+	file->pos      = new_pos;
+	file->file_pos = new_pos;
+	return new_pos;
+}
+
+static int64_t async_file_get_pos(void *sdata)
+{
+	struct async_file *file = sdata;
+	return file->pos;
+}
+
+static inline size_t align_size(size_t size)
+{
+	return (size + DIRECT_IO_ALIGN - 1) & ~(size_t)(DIRECT_IO_ALIGN - 1);
+}
+
+static bool init_buffers(struct async_file *file)
+{
+	uint8_t *data;
+
+	file->buffers = bzalloc(sizeof(struct async_buffer) *
+			file->num_buffers);
+	file->mem = bmalloc(file->buffer_size * file->num_buffers +
+			DIRECT_IO_ALIGN);
+
+	data = (uint8_t*)align_size((size_t)file->mem);
+
+	for (size_t i = 0; i < file->num_buffers; i++)
+		file->buffers[i].data = data + file->buffer_size * i;
+
+	if (os_sem_init(&file->free_sem, (int)file->num_buffers - 1) != 0)
+		return false;
+	if (os_sem_init(&file->full_sem, 0) != 0)
+		return false;
+
+	file->free_count = (long)file->num_buffers - 1;
+	return true;
+}
+
+static void async_file_destroy(struct async_file *file)
+{
+	if (file->fd != -1)
+		file_close(file->fd);
+
+	os_sem_destroy(file->free_sem);
+	os_sem_destroy(file->full_sem);
+	pthread_mutex_destroy(&file->stats_mutex);
+	bfree(file->buffers);
+	bfree(file->mem);
+	bfree(file);
+}
+
+bool async_file_serializer_init(struct serializer *s, const char *path,
+		const struct async_file_options *options)
+{
+	struct async_file_options defaults = {0};
+	struct async_file *file;
+
+	if (!options)
+		options = &defaults;
+
+	file = bzalloc(sizeof(struct async_file));
+	file->sync        = options->sync;
+	file->buffer_size = options->buffer_size ?
+		align_size(options->buffer_size) : DEFAULT_BUFFER_SIZE;
+	file->num_buffers = options->num_buffers > 1 ?
+		options->num_buffers : DEFAULT_NUM_BUFFERS;
+
+	if (pthread_mutex_init(&file->stats_mutex, NULL) != 0) {
+		bfree(file);
+		return false;
+	}
+
+	file->fd = open_file(path, options->direct_io);
+	if (file->fd == -1) {
+		async_file_destroy(file);
+		return false;
+	}
+
+	file->direct_io = direct_io_enabled(file->fd);
+
+	if (options->preallocate > 0)
+		preallocate_file(file->fd, options->preallocate);
+
+	if (!init_buffers(file)) {
+		async_file_destroy(file);
+		return false;
+	}
+
+	if (pthread_create(&file->thread, NULL, async_file_thread,
+				file) != 0) {
+		async_file_destroy(file);
+		return false;
+	}
+
+	s->data    = file;
+	s->read    = NULL;
+	s->write   = async_file_write;
+	s->seek    = async_file_seek;
+	s->get_pos = async_file_get_pos;
+	return true;
+}
+
+void async_file_serializer_free(struct serializer *s,
+		struct async_file_stats *stats)
+{
+	struct async_file *file = s->data;
+	if (!file) {
+		if (stats)
+			memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	flush_buffers(file);
+
+	os_atomic_set_bool(&file->stop, true);
+	os_sem_post(file->full_sem);
+	pthread_join(file->thread, NULL);
+
+	if (file->sync != ASYNC_FILE_SYNC_NONE && !file->error &&
+	    file_sync(file->fd) != 0) {
+		blog(LOG_ERROR, "async_file_serializer: sync failed: %d",
+				errno);
+		os_atomic_set_bool(&file->error, true);
+	}
+
+	if (stats)
+		async_file_serializer_get_stats(s, stats);
+
+	async_file_destroy(file);
+	s->data = NULL;
+}
+
+void async_file_serializer_get_stats(struct serializer *s,
+		struct async_file_stats *stats)
+{
+	struct async_file *file = s->data;
+	if (!file) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	pthread_mutex_lock(&file->stats_mutex);
+	*stats = file->stats;
+	pthread_mutex_unlock(&file->stats_mutex);
+
+	stats->error = os_atomic_load_bool(&file->error);
+}
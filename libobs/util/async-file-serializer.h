@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2017 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "serializer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *   Output file serializer that copies data into large buffers and writes
+ * them to disk on a separate thread, so a slow disk only blocks the caller
+ * once every buffer is waiting to be written.
+ *
+ *   Seeking waits for all buffered data to be written first.
+ */
+
+enum async_file_sync {
+	ASYNC_FILE_SYNC_NONE,
+	ASYNC_FILE_SYNC_ON_CLOSE,
+	ASYNC_FILE_SYNC_EVERY_BUFFER
+};
+
+struct async_file_options {
+	/** Size of each buffer, 0 for the default (4 MiB) */
+	size_t               buffer_size;
+	/** Number of buffers, 0 for the default (4) */
+	size_t               num_buffers;
+	/** Bytes of disk space to reserve up front, if supported */
+	int64_t              preallocate;
+	/** Bypass the OS page cache, if supported */
+	bool                 direct_io;
+	enum async_file_sync sync;
+};
+
+struct async_file_stats {
+	uint64_t bytes_written;
+	uint64_t buffers_written;
+	/** Number of times the caller had to wait for a free buffer */
+	uint64_t stalls;
+	uint64_t stall_time_ns;
+	uint64_t max_write_time_ns;
+	bool     error;
+};
+
+EXPORT bool async_file_serializer_init(struct serializer *s, const char *path,
+		const struct async_file_options *options);
+/* stats receives the final statistics, including any error writing the
+ * last of the data, and may be NULL */
+EXPORT void async_file_serializer_free(struct serializer *s,
+		struct async_file_stats *stats);
+
+EXPORT void async_file_serializer_get_stats(struct serializer *s,
+		struct async_file_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2017 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "log-sink.h"
+#include "threading.h"
+#include "platform.h"
+#include "bmem.h"
+#include "dstr.h"
+
+#define DEFAULT_BUFFER_SIZE (1024 * 1024)
+#define MIN_BUFFER_SIZE     (4 * 1024)
+#define MAX_BUFFER_SIZE     (256 * 1024 * 1024)
+
+/* record sizes (and therefore the padding at the end of the buffer) are a
+ * multiple of this, so there's always room for a padding record header */
+#define RECORD_ALIGN 16
+
+enum record_state {
+	RECORD_EMPTY,
+	RECORD_COMMITTED,
+	RECORD_PADDING
+};
+
+/* the buffer is all zero (RECORD_EMPTY) except for records that have been
+ * reserved but not read yet.  a record only becomes visible to the reader
+ * once its writer sets the state, after everything else has been written */
+struct log_record {
+	volatile long state;
+	uint32_t      size;
+	uint32_t      len;
+};
+
+struct log_sink {
+	uint8_t           *buffer;
+	size_t            size;
+	unsigned long     mask;
+
+	/* positions only ever grow, wrapping around with unsigned math */
+	volatile long     reserve_pos;
+	volatile long     read_pos;
+	volatile long     dropped;
+	long              reported_dropped;
+
+	log_sink_write_cb write;
+	void              *param;
+
+	/* recursive so a crash handler on the sink's own thread can flush */
+	pthread_mutex_t   read_mutex;
+	struct dstr       batch;
+
+	os_sem_t          *sem;
+	pthread_t         thread;
+	bool              thread_active;
+	volatile bool     stop;
+};
+
+static inline size_t align_record(size_t size)
+{
+	return (size + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+}
+
+static inline struct log_record *record_at(log_sink_t *sink,
+		unsigned long pos)
+{
+	return (struct log_record *)(sink->buffer + (pos & sink->mask));
+}
+
+/* collects all records that are ready and writes them out in one go */
+static void read_records(log_sink_t *sink)
+{
+	long dropped;
+
+	pthread_mutex_lock(&sink->read_mutex);
+
+	for (;;) {
+		unsigned long pos = (unsigned long)sink->read_pos;
+		struct log_record *record = record_at(sink, pos);
+		long state = os_atomic_load_long(&record->state);
+		uint32_t size;
+
+		if (state == RECORD_EMPTY)
+			break;
+
+		size = record->size;
+		if (state == RECORD_COMMITTED)
+			dstr_ncat(&sink->batch, (const char *)(record + 1),
+					record->len);
+
+		memset(record, 0, size);
+		os_atomic_set_long(&sink->read_pos, (long)(pos + size));
+	}
+
+	dropped = os_atomic_load_long(&sink->dropped);
+	if (dropped != sink->reported_dropped) {
+		dstr_catf(&sink->batch, "%ld log messages were dropped\n",
+				dropped - sink->reported_dropped);
+		sink->reported_dropped = dropped;
+	}
+
+	if (sink->batch.len) {
+		sink->write(sink->param, sink->batch.array, sink->batch.len);
+		dstr_resize(&sink->batch, 0);
+	}
+
+	pthread_mutex_unlock(&sink->read_mutex);
+}
+
+static void *log_sink_thread(void *param)
+{
+	log_sink_t *sink = param;
+
+	os_set_thread_name("log sink");
+
+	while (os_sem_wait(sink->sem) == 0) {
+		if (os_atomic_load_bool(&sink->stop))
+			break;
+
+		read_records(sink);
+	}
+
+	return NULL;
+}
+
+log_sink_t *log_sink_create(size_t buffer_size, log_sink_write_cb write,
+		void *param)
+{
+	pthread_mutexattr_t attr;
+	log_sink_t *sink;
+	size_t size = MIN_BUFFER_SIZE;
+
+	if (!write)
+		return NULL;
+
+	if (!buffer_size)
+		buffer_size = DEFAULT_BUFFER_SIZE;
+	if (buffer_size > MAX_BUFFER_SIZE)
+		buffer_size = MAX_BUFFER_SIZE;
+	while (size < buffer_size)
+		size *= 2;
+
+	sink = bzalloc(sizeof(log_sink_t));
+	sink->buffer = bzalloc(size);
+	sink->size   = size;
+	sink->mask   = (unsigned long)(size - 1);
+	sink->write  = write;
+	sink->param  = param;
+
+	if (pthread_mutexattr_init(&attr) != 0)
+		goto fail1;
+	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
+		goto fail1;
+	if (pthread_mutex_init(&sink->read_mutex, &attr) != 0)
+		goto fail1;
+	if (os_sem_init(&sink->sem, 0) != 0)
+		goto fail2;
+	if (pthread_create(&sink->thread, NULL, log_sink_thread, sink) != 0)
+		goto fail3;
+
+	sink->thread_active = true;
+	return sink;
+
+fail3:
+	os_sem_destroy(sink->sem);
+fail2:
+	pthread_mutex_destroy(&sink->read_mutex);
+fail1:
+	bfree(sink->buffer);
+	bfree(sink);
+	return NULL;
+}
+
+void log_sink_destroy(log_sink_t *sink)
+{
+	if (!sink)
+		return;
+
+	if (sink->thread_active) {
+		os_atomic_set_bool(&sink->stop, true);
+		os_sem_post(sink->sem);
+		pthread_join(sink->thread, NULL);
+	}
+
+	read_records(sink);
+
+	os_sem_destroy(sink->sem);
+	pthread_mutex_destroy(&sink->read_mutex);
+	dstr_free(&sink->batch);
+	bfree(sink->buffer);
+	bfree(sink);
+}
+
+bool log_sink_write(log_sink_t *sink, const char *str, size_t len)
+{
+	struct log_record *record;
+	unsigned long reserve;
+	unsigned long offset;
+	size_t max_len;
+	size_t needed;
+	size_t pad;
+
+	if (!sink || !str)
+		return false;
+
+	/* very long messages are cut rather than dropped */
+	max_len = sink->size / 4 - sizeof(struct log_record);
+	if (len > max_len)
+		len = max_len;
+
+	needed = align_record(sizeof(struct log_record) + len);
+
+	for (;;) {
+		unsigned long read;
+
+		reserve = (unsigned long)os_atomic_load_long(
+				&sink->reserve_pos);
+		read    = (unsigned long)os_atomic_load_long(&sink->read_pos);
+		offset  = reserve & sink->mask;
+
+		/* records never wrap, the rest of the buffer is skipped */
+		pad = offset + needed > sink->size ? sink->size - offset : 0;
+
+		if (reserve - read + pad + needed > sink->size) {
+			os_atomic_inc_long(&sink->dropped);
+			return false;
+		}
+
+		if (os_atomic_compare_swap_long(&sink->reserve_pos,
+					(long)reserve,
+					(long)(reserve + pad + needed)))
+			break;
+	}
+
+	if (pad) {
+		record = record_at(sink, reserve);
+		record->size = (uint32_t)pad;
+		os_atomic_set_long(&record->state, RECORD_PADDING);
+		reserve += (unsigned long)pad;
+	}
+
+	record = record_at(sink, reserve);
+	record->size = (uint32_t)needed;
+	record->len  = (uint32_t)len;
+	memcpy(record + 1, str, len);
+	os_atomic_set_long(&record->state, RECORD_COMMITTED);
+
+	os_sem_post(sink->sem);
+	return true;
+}
+
+void log_sink_flush(log_sink_t *sink)
+{
+	if (sink)
+		read_records(sink);
+}
+
+long log_sink_dropped(log_sink_t *sink)
+{
+	return sink ? os_atomic_load_long(&sink->dropped) : 0;
+}
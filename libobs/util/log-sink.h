@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2017 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ *   Asynchronous log sink.  Any number of threads can write log text into a
+ * lock-free ring buffer without blocking, a background thread collects
+ * everything that has been written and passes it on to the write callback in
+ * large batches.
+ *
+ *   If the ring buffer is full, messages are dropped rather than making the
+ * caller wait, and the number of dropped messages is written out once there is
+ * room again.
+ */
+
+typedef struct log_sink log_sink_t;
+
+/* called on the sink's thread (or the thread calling log_sink_flush) with
+ * one or more complete messages */
+typedef void (*log_sink_write_cb)(void *param, const char *data, size_t size);
+
+/* buffer_size is rounded up to a power of two, 0 for the default (1 MiB) */
+EXPORT log_sink_t *log_sink_create(size_t buffer_size,
+		log_sink_write_cb write, void *param);
+
+/* writes out everything still buffered before returning */
+EXPORT void log_sink_destroy(log_sink_t *sink);
+
+/* never blocks.  returns false if the message was dropped */
+EXPORT bool log_sink_write(log_sink_t *sink, const char *str, size_t len);
+
+/* synchronously writes out everything buffered so far on the calling thread,
+ * can be used from crash handlers */
+EXPORT void log_sink_flush(log_sink_t *sink);
+
+EXPORT long log_sink_dropped(log_sink_t *sink);
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,6 +18,8 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <sys/statvfs.h>
 #include <dirent.h>
 #include <stdlib.h>
@@ -272,6 +274,38 @@ bool os_file_exists(const char *path)
 	return access(path, F_OK) == 0;
 }
 
+void *os_map_file(const char *path, size_t *size)
+{
+	struct stat st;
+	void *data;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+	    (uint64_t)st.st_size > SIZE_MAX) {
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return NULL;
+
+	*size = (size_t)st.st_size;
+	return data;
+}
+
+void os_unmap_file(void *data, size_t size)
+{
+	if (data)
+		munmap(data, size);
+}
+
 size_t os_get_abs_path(const char *path, char *abspath, size_t size)
 {
 	size_t min_size = size < PATH_MAX ? size : PATH_MAX;
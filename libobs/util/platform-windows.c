@@ -306,6 +306,51 @@ bool os_file_exists(const char *path)
 	return hFind != INVALID_HANDLE_VALUE;
 }
 
+void *os_map_file(const char *path, size_t *size)
+{
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+	LARGE_INTEGER file_size;
+	wchar_t *path_utf16;
+	void *data = NULL;
+
+	if (!os_utf8_to_wcs_ptr(path, 0, &path_utf16))
+		return NULL;
+
+	file = CreateFileW(path_utf16, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	bfree(path_utf16);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 ||
+	    (uint64_t)file_size.QuadPart > SIZE_MAX)
+		goto cleanup;
+
+	mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+		goto cleanup;
+
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data)
+		*size = (size_t)file_size.QuadPart;
+
+cleanup:
+	if (mapping)
+		CloseHandle(mapping);
+	CloseHandle(file);
+	return data;
+}
+
+void os_unmap_file(void *data, size_t size)
+{
+	if (data)
+		UnmapViewOfFile(data);
+
+	UNUSED_PARAMETER(size);
+}
+
 size_t os_get_abs_path(const char *path, char *abspath, size_t size)
 {
 	wchar_t wpath[512];
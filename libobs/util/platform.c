@@ -587,8 +587,9 @@ int os_dtostr(double value, char *dst, size_t size)
 		while(*end == '0')
 			end++;
 
+		/* includes the null terminator */
 		if(end != start) {
-			memmove(start, end, length - (size_t)(end - dst));
+			memmove(start, end, length + 1 - (size_t)(end - dst));
 			length -= (size_t)(end - start);
 		}
 	}
@@ -60,6 +60,12 @@ EXPORT bool os_quick_write_mbs_file(const char *path, const char *str,
 EXPORT int64_t os_get_file_size(const char *path);
 EXPORT int64_t os_get_free_space(const char *path);
 
+/* maps a whole file into memory read-only, returns NULL if the file can't be
+ * opened or is empty.  on windows the file can't be replaced or deleted while
+ * it's mapped */
+EXPORT void *os_map_file(const char *path, size_t *size);
+EXPORT void os_unmap_file(void *data, size_t size);
+
 EXPORT size_t os_mbs_to_wcs(const char *str, size_t str_len, wchar_t *dst,
 		size_t dst_size);
 EXPORT size_t os_utf8_to_wcs(const char *str, size_t len, wchar_t *dst,
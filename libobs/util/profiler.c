@@ -32,6 +32,10 @@ struct profiler_snapshot_entry {
 
 typedef struct profiler_time_entry profiler_time_entry;
 
+#define PROFILE_CALL_NONE ((size_t)-1)
+
+/* calls refer to each other by index, the arena they live in may grow while
+ * a root call is active */
 typedef struct profile_call profile_call;
 struct profile_call {
 	const char *name;
@@ -43,9 +47,20 @@ struct profile_call {
 #ifdef TRACK_OVERHEAD
 	uint64_t overhead_end;
 #endif
-	uint64_t expected_time_between_calls;
-	DARRAY(profile_call) children;
-	profile_call *parent;
+	size_t parent;
+	size_t first_child;
+	size_t last_child;
+	size_t next_sibling;
+};
+
+/* holds all calls of a single root call.  finished arenas are merged by the
+ * aggregator thread and then reused, so once warmed up, profiling a thread
+ * doesn't allocate */
+typedef struct profile_call_arena profile_call_arena;
+struct profile_call_arena {
+	profile_call_arena *next;
+	DARRAY(profile_call) calls;
+	size_t current;
 };
 
 typedef struct profile_times_table_entry profile_times_table_entry;
@@ -83,7 +98,7 @@ struct profile_root_entry {
 	pthread_mutex_t *mutex;
 	const char *name;
 	profile_entry *entry;
-	profile_call *prev_call;
+	uint64_t prev_call_start;
 };
 
 static inline uint64_t diff_ns_to_usec(uint64_t prev, uint64_t next)
@@ -228,18 +243,18 @@ static profile_entry *get_child(profile_entry *parent, const char *name)
 	return init_entry(da_push_back_new(parent->children), name);
 }
 
-static void merge_call(profile_entry *entry, profile_call *call,
-		profile_call *prev_call)
+static void merge_call(profile_entry *entry, const profile_call *calls,
+		size_t idx, uint64_t prev_call_start)
 {
-	const size_t num = call->children.num;
-	for (size_t i = 0; i < num; i++) {
-		profile_call *child = &call->children.array[i];
-		merge_call(get_child(entry, child->name), child, NULL);
-	}
+	const profile_call *call = &calls[idx];
 
-	if (entry->expected_time_between_calls != 0 && prev_call) {
+	for (size_t child = call->first_child; child != PROFILE_CALL_NONE;
+			child = calls[child].next_sibling)
+		merge_call(get_child(entry, calls[child].name), calls, child, 0);
+
+	if (entry->expected_time_between_calls != 0 && prev_call_start) {
 		migrate_old_entries(&entry->times_between_calls, true);
-		uint64_t usec = diff_ns_to_usec(prev_call->start_time,
+		uint64_t usec = diff_ns_to_usec(prev_call_start,
 				call->start_time);
 		add_hashmap_entry(&entry->times_between_calls, usec, 1);
 	}
@@ -249,23 +264,28 @@ static void merge_call(profile_entry *entry, profile_call *call,
 	add_hashmap_entry(&entry->times, usec, 1);
 
 #ifdef TRACK_OVERHEAD
+	/* kept in nanoseconds, the overhead of a call is well below a
+	 * microsecond */
+	uint64_t ns = (call->start_time - call->overhead_start) +
+		(call->overhead_end - call->end_time);
 	migrate_old_entries(&entry->overhead, true);
-	usec  = diff_ns_to_usec(call->overhead_start, call->start_time);
-	usec += diff_ns_to_usec(call->end_time, call->overhead_end);
-	add_hashmap_entry(&entry->overhead, usec, 1);
+	add_hashmap_entry(&entry->overhead, ns, 1);
 #endif
 }
 
-static bool enabled = false;
+static volatile bool enabled = false;
 static pthread_mutex_t root_mutex = PTHREAD_MUTEX_INITIALIZER;
 static DARRAY(profile_root_entry) root_entries;
 
-static THREAD_LOCAL profile_call *thread_context = NULL;
+static THREAD_LOCAL profile_call_arena *thread_arena = NULL;
 static THREAD_LOCAL bool thread_enabled = true;
 
+static bool start_aggregator(void);
+
 void profiler_start(void)
 {
 	pthread_mutex_lock(&root_mutex);
+	start_aggregator();
 	enabled = true;
 	pthread_mutex_unlock(&root_mutex);
 }
@@ -334,76 +354,337 @@ void profile_register_root(const char *name,
 	pthread_mutex_unlock(&root_mutex);
 }
 
-static void free_call_context(profile_call *context);
+/* ------------------------------------------------------------------------- */
+/* Aggregation */
+
+static pthread_mutex_t arena_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t merge_mutex = PTHREAD_MUTEX_INITIALIZER;
+static profile_call_arena *pending_arenas = NULL;
+static profile_call_arena **pending_arenas_tail = &pending_arenas;
+static profile_call_arena *free_arenas = NULL;
 
-static void merge_context(profile_call *context)
+static os_sem_t *aggregator_sem = NULL;
+static pthread_t aggregator_thread;
+static volatile bool aggregator_exit = false;
+
+static profile_call_arena *get_free_arena(void)
 {
+	profile_call_arena *arena;
+
+	pthread_mutex_lock(&arena_mutex);
+	arena = free_arenas;
+	if (arena)
+		free_arenas = arena->next;
+	pthread_mutex_unlock(&arena_mutex);
+
+	if (!arena)
+		arena = bzalloc(sizeof(profile_call_arena));
+
+	arena->next = NULL;
+	arena->current = PROFILE_CALL_NONE;
+	da_resize(arena->calls, 0);
+	return arena;
+}
+
+static void recycle_arena(profile_call_arena *arena)
+{
+	pthread_mutex_lock(&arena_mutex);
+	arena->next = free_arenas;
+	free_arenas = arena;
+	pthread_mutex_unlock(&arena_mutex);
+}
+
+static void free_arena_list(profile_call_arena *arena)
+{
+	while (arena) {
+		profile_call_arena *next = arena->next;
+		da_free(arena->calls);
+		bfree(arena);
+		arena = next;
+	}
+}
+
+static void merge_arena(profile_call_arena *arena)
+{
+	profile_call *root = &arena->calls.array[0];
 	pthread_mutex_t *mutex = NULL;
 	profile_entry *entry = NULL;
-	profile_call *prev_call = NULL;
+	uint64_t prev_call_start = 0;
 
 	if (!lock_root()) {
-		free_call_context(context);
+		recycle_arena(arena);
 		return;
 	}
 
-	profile_root_entry *r_entry = get_root_entry(context->name);
+	profile_root_entry *r_entry = get_root_entry(root->name);
 
-	mutex     = r_entry->mutex;
-	entry     = r_entry->entry;
-	prev_call = r_entry->prev_call;
+	mutex           = r_entry->mutex;
+	entry           = r_entry->entry;
+	prev_call_start = r_entry->prev_call_start;
 
-	r_entry->prev_call = context;
+	r_entry->prev_call_start = root->start_time;
 
 	pthread_mutex_lock(mutex);
 	pthread_mutex_unlock(&root_mutex);
 
-	merge_call(entry, context, prev_call);
+	merge_call(entry, arena->calls.array, 0, prev_call_start);
 
 	pthread_mutex_unlock(mutex);
 
-	free_call_context(prev_call);
+	recycle_arena(arena);
+}
+
+/* merge_mutex keeps the calls of each root merged in the order they were
+ * submitted, which the time between calls depends on */
+static void merge_pending_arenas(void)
+{
+	pthread_mutex_lock(&merge_mutex);
+
+	for (;;) {
+		profile_call_arena *arena;
+
+		pthread_mutex_lock(&arena_mutex);
+		arena = pending_arenas;
+		if (arena) {
+			pending_arenas = arena->next;
+			if (!pending_arenas)
+				pending_arenas_tail = &pending_arenas;
+		}
+		pthread_mutex_unlock(&arena_mutex);
+
+		if (!arena)
+			break;
+
+		merge_arena(arena);
+	}
+
+	pthread_mutex_unlock(&merge_mutex);
+}
+
+static void *aggregator_thread_func(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	os_set_thread_name("profiler: aggregator");
+
+	while (os_sem_wait(aggregator_sem) == 0) {
+		if (os_atomic_load_bool(&aggregator_exit))
+			break;
+
+		merge_pending_arenas();
+	}
+
+	return NULL;
+}
+
+/* called with root_mutex held */
+static bool start_aggregator(void)
+{
+	if (aggregator_sem)
+		return true;
+
+	os_atomic_set_bool(&aggregator_exit, false);
+
+	if (os_sem_init(&aggregator_sem, 0) != 0)
+		goto fail;
+	if (pthread_create(&aggregator_thread, NULL, aggregator_thread_func,
+				NULL) != 0)
+		goto fail;
+
+	return true;
+
+fail:
+	blog(LOG_WARNING, "Failed to start the profiler aggregator thread, "
+			"merging on the profiled threads instead");
+	os_sem_destroy(aggregator_sem);
+	aggregator_sem = NULL;
+	return false;
+}
+
+static void stop_aggregator(void)
+{
+	if (!aggregator_sem)
+		return;
+
+	os_atomic_set_bool(&aggregator_exit, true);
+	os_sem_post(aggregator_sem);
+	pthread_join(aggregator_thread, NULL);
+
+	os_sem_destroy(aggregator_sem);
+	aggregator_sem = NULL;
 }
 
+static void submit_arena(profile_call_arena *arena)
+{
+	if (!os_atomic_load_bool(&enabled)) {
+		thread_enabled = false;
+		recycle_arena(arena);
+		return;
+	}
+
+	arena->next = NULL;
+
+	pthread_mutex_lock(&arena_mutex);
+	*pending_arenas_tail = arena;
+	pending_arenas_tail = &arena->next;
+	pthread_mutex_unlock(&arena_mutex);
+
+	if (aggregator_sem)
+		os_sem_post(aggregator_sem);
+	else
+		merge_pending_arenas();
+}
+
+/* ------------------------------------------------------------------------- */
+/* Trace recording */
+
+#define TRACE_RING_SIZE (1 << 15)
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+
+enum trace_event_type {
+	TRACE_BEGIN,
+	TRACE_END,
+	TRACE_INSTANT,
+};
+
+/* names are already interned by the profiler (calls are matched by pointer),
+ * so the name pointer doubles as the name id */
+struct trace_event {
+	uint64_t time;
+	const char *name;
+	enum trace_event_type type;
+};
+
+/* written by a single thread, head is only advanced after the event has been
+ * written so readers can detect which events may have been overwritten */
+struct trace_ring {
+	struct trace_ring *next;
+	long tid;
+	const char *thread_name;
+	volatile long head;
+	struct trace_event events[TRACE_RING_SIZE];
+};
+
+static volatile bool trace_enabled = false;
+static volatile long trace_generation = 0;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_ring *first_trace_ring = NULL;
+static long trace_thread_count = 0;
+
+static THREAD_LOCAL struct trace_ring *thread_trace = NULL;
+static THREAD_LOCAL long thread_trace_generation = -1;
+
+static struct trace_ring *get_trace_ring(const char *name)
+{
+	long generation = os_atomic_load_long(&trace_generation);
+	struct trace_ring *ring;
+
+	if (thread_trace && thread_trace_generation == generation)
+		return thread_trace;
+
+	ring = bzalloc(sizeof(struct trace_ring));
+
+	pthread_mutex_lock(&trace_mutex);
+	ring->tid = ++trace_thread_count;
+	ring->next = first_trace_ring;
+	first_trace_ring = ring;
+	pthread_mutex_unlock(&trace_mutex);
+
+	ring->thread_name = name;
+	thread_trace = ring;
+	thread_trace_generation = generation;
+	return ring;
+}
+
+static inline void trace_record(const char *name, enum trace_event_type type,
+		uint64_t time)
+{
+	if (!os_atomic_load_bool(&trace_enabled))
+		return;
+
+	/* threads are named after the first root they profile */
+	struct trace_ring *ring = get_trace_ring(name);
+	long head = ring->head;
+	struct trace_event *event =
+		&ring->events[(unsigned long)head & TRACE_RING_MASK];
+
+	event->time = time;
+	event->name = name;
+	event->type = type;
+
+	os_atomic_set_long(&ring->head, head + 1);
+}
+
+void profile_trace_mark(const char *name)
+{
+	trace_record(name, TRACE_INSTANT, os_gettime_ns());
+}
+
+/* ------------------------------------------------------------------------- */
+
 void profile_start(const char *name)
 {
+#ifdef TRACK_OVERHEAD
+	uint64_t overhead_start = os_gettime_ns();
+#endif
+	if (os_atomic_load_bool(&trace_enabled))
+		trace_record(name, TRACE_BEGIN, os_gettime_ns());
+
 	if (!thread_enabled)
 		return;
 
-	profile_call new_call = {
-		.name = name,
+	profile_call_arena *arena = thread_arena;
+	if (!arena) {
+		arena = get_free_arena();
+		thread_arena = arena;
+	}
+
+	size_t parent = arena->current;
+	size_t idx = arena->calls.num;
+	profile_call *call = da_push_back_new(arena->calls);
+
+	call->name = name;
 #ifdef TRACK_OVERHEAD
-		.overhead_start = os_gettime_ns(),
+	call->overhead_start = overhead_start;
 #endif
-		.parent = thread_context,
-	};
+	call->parent = parent;
+	call->first_child = PROFILE_CALL_NONE;
+	call->last_child = PROFILE_CALL_NONE;
+	call->next_sibling = PROFILE_CALL_NONE;
 
-	profile_call *call = NULL;
+	if (parent != PROFILE_CALL_NONE) {
+		profile_call *parent_call = &arena->calls.array[parent];
 
-	if (new_call.parent) {
-		size_t idx = da_push_back(new_call.parent->children, &new_call);
-		call = &new_call.parent->children.array[idx];
-	} else {
-		call = bmalloc(sizeof(profile_call));
-		memcpy(call, &new_call, sizeof(profile_call));
+		if (parent_call->last_child != PROFILE_CALL_NONE)
+			arena->calls.array[parent_call->last_child]
+				.next_sibling = idx;
+		else
+			parent_call->first_child = idx;
+
+		parent_call->last_child = idx;
 	}
 
-	thread_context = call;
+	arena->current = idx;
 	call->start_time = os_gettime_ns();
 }
 
 void profile_end(const char *name)
 {
 	uint64_t end = os_gettime_ns();
+	trace_record(name, TRACE_END, end);
+
 	if (!thread_enabled)
 		return;
 
-	profile_call *call = thread_context;
-	if (!call) {
+	profile_call_arena *arena = thread_arena;
+	if (!arena || arena->current == PROFILE_CALL_NONE) {
 		blog(LOG_ERROR, "Called profile end with no active profile");
 		return;
 	}
 
+	profile_call *calls = arena->calls.array;
+	profile_call *call = &calls[arena->current];
+
 	if (!call->name)
 		call->name = name;
 
@@ -412,30 +693,33 @@ void profile_end(const char *name)
 				"start(\"%s\"[%p]) <-> end(\"%s\"[%p])",
 				call->name, call->name, name, name);
 
-		profile_call *parent = call->parent;
-		while (parent && parent->parent &&  parent->name != name)
-			parent = parent->parent;
+		size_t parent = call->parent;
+		while (parent != PROFILE_CALL_NONE &&
+		       calls[parent].parent != PROFILE_CALL_NONE &&
+		       calls[parent].name != name)
+			parent = calls[parent].parent;
 
-		if (!parent || parent->name != name)
+		if (parent == PROFILE_CALL_NONE || calls[parent].name != name)
 			return;
 
 		while (call->name != name) {
 			profile_end(call->name);
-			call = call->parent;
+			call = &calls[arena->current];
 		}
 	}
 
-	thread_context = call->parent;
+	arena->current = call->parent;
 
 	call->end_time = end;
 #ifdef TRACK_OVERHEAD
 	call->overhead_end = os_gettime_ns();
 #endif
 
-	if (call->parent)
+	if (call->parent != PROFILE_CALL_NONE)
 		return;
 
-	merge_context(call);
+	thread_arena = NULL;
+	submit_arena(arena);
 }
 
 static int profiler_time_entry_compare(const void *first, const void *second)
@@ -745,34 +1029,65 @@ void profile_print_func(const char *intro, profile_entry_print_func print,
 	dstr_free(&indent_buffer);
 }
 
-void profiler_print(profiler_snapshot_t *snap)
+#ifdef TRACK_OVERHEAD
+static void sum_overhead(profile_entry *entry, uint64_t *ns, uint64_t *calls)
 {
-	profile_print_func("== Profiler Results =============================",
-			profile_print_entry, snap);
+	profile_times_table *map = &entry->overhead;
+
+	migrate_old_entries(map, false);
+
+	for (size_t i = 0; i < map->size; i++) {
+		if (!map->entries[i].probes)
+			continue;
+
+		profiler_time_entry *time = &map->entries[i].entry;
+		*ns    += time->time_delta * time->count;
+		*calls += time->count;
+	}
+
+	for (size_t i = 0; i < entry->children.num; i++)
+		sum_overhead(&entry->children.array[i], ns, calls);
 }
 
-void profiler_print_time_between_calls(profiler_snapshot_t *snap)
+static void print_overhead(void)
 {
-	profile_print_func("== Profiler Time Between Calls ==================",
-			profile_print_entry_expected, snap);
+	blog(LOG_INFO, "== Profiler Overhead ============================");
+
+	pthread_mutex_lock(&root_mutex);
+	for (size_t i = 0; i < root_entries.num; i++) {
+		profile_root_entry *r_entry = &root_entries.array[i];
+		uint64_t ns = 0;
+		uint64_t calls = 0;
+
+		pthread_mutex_lock(r_entry->mutex);
+		sum_overhead(r_entry->entry, &ns, &calls);
+		pthread_mutex_unlock(r_entry->mutex);
+
+		if (calls)
+			blog(LOG_INFO, "%s: %g ns per call (%"PRIu64" calls)",
+					r_entry->name, (double)ns / calls,
+					calls);
+	}
+	pthread_mutex_unlock(&root_mutex);
+
+	blog(LOG_INFO, "=================================================");
 }
+#endif
 
-static void free_call_children(profile_call *call)
+void profiler_print(profiler_snapshot_t *snap)
 {
-	if (!call)
-		return;
-
-	const size_t num = call->children.num;
-	for (size_t i = 0; i < num; i++)
-		free_call_children(&call->children.array[i]);
+	profile_print_func("== Profiler Results =============================",
+			profile_print_entry, snap);
 
-	da_free(call->children);
+#ifdef TRACK_OVERHEAD
+	print_overhead();
+#endif
 }
 
-static void free_call_context(profile_call *context)
+void profiler_print_time_between_calls(profiler_snapshot_t *snap)
 {
-	free_call_children(context);
-	bfree(context);
+	profile_print_func("== Profiler Time Between Calls ==================",
+			profile_print_entry_expected, snap);
 }
 
 static void free_hashmap(profile_times_table *map)
@@ -797,12 +1112,29 @@ static void free_profile_entry(profile_entry *entry)
 	da_free(entry->children);
 }
 
+static void free_trace_rings(void);
+
 void profiler_free(void)
 {
 	DARRAY(profile_root_entry) old_root_entries = {0};
 
+	free_trace_rings();
+
 	pthread_mutex_lock(&root_mutex);
 	enabled = false;
+	pthread_mutex_unlock(&root_mutex);
+
+	stop_aggregator();
+
+	pthread_mutex_lock(&arena_mutex);
+	free_arena_list(pending_arenas);
+	free_arena_list(free_arenas);
+	pending_arenas = NULL;
+	pending_arenas_tail = &pending_arenas;
+	free_arenas = NULL;
+	pthread_mutex_unlock(&arena_mutex);
+
+	pthread_mutex_lock(&root_mutex);
 	da_move(old_root_entries, root_entries);
 	pthread_mutex_unlock(&root_mutex);
 
@@ -816,8 +1148,6 @@ void profiler_free(void)
 		bfree(entry->mutex);
 		entry->mutex = NULL;
 
-		free_call_context(entry->prev_call);
-
 		free_profile_entry(entry->entry);
 		bfree(entry->entry);
 	}
@@ -928,6 +1258,8 @@ profiler_snapshot_t *profile_snapshot_create(void)
 {
 	profiler_snapshot_t *snap = bzalloc(sizeof(profiler_snapshot_t));
 
+	merge_pending_arenas();
+
 	pthread_mutex_lock(&root_mutex);
 	da_reserve(snap->roots, root_entries.num);
 	for (size_t i = 0; i < root_entries.num; i++) {
@@ -1170,3 +1502,211 @@ uint64_t profiler_snapshot_entry_overall_between_calls_count(
 {
 	return entry ? entry->overall_between_calls_count : 0;
 }
+
+
+/* ------------------------------------------------------------------------- */
+/* Profiler tracing */
+
+#define TRACE_DUMP_INTERVAL_NS 10000000000ULL
+
+static char *trace_dump_dir = NULL;
+static uint64_t trace_last_dump = 0;
+static volatile long trace_dumps_active = 0;
+
+void profiler_trace_enable(bool enable)
+{
+	os_atomic_set_bool(&trace_enabled, enable);
+}
+
+bool profiler_trace_enabled(void)
+{
+	return os_atomic_load_bool(&trace_enabled);
+}
+
+static void free_trace_rings(void)
+{
+	struct trace_ring *ring;
+
+	os_atomic_set_bool(&trace_enabled, false);
+
+	while (os_atomic_load_long(&trace_dumps_active))
+		os_sleep_ms(10);
+
+	pthread_mutex_lock(&trace_mutex);
+	os_atomic_inc_long(&trace_generation);
+	ring = first_trace_ring;
+	first_trace_ring = NULL;
+	trace_thread_count = 0;
+
+	bfree(trace_dump_dir);
+	trace_dump_dir = NULL;
+	pthread_mutex_unlock(&trace_mutex);
+
+	while (ring) {
+		struct trace_ring *next = ring->next;
+		bfree(ring);
+		ring = next;
+	}
+}
+
+static void trace_cat_json_string(struct dstr *buffer, const char *str)
+{
+	if (!str)
+		str = "";
+
+	dstr_cat_ch(buffer, '"');
+	for (; *str; str++) {
+		unsigned char ch = (unsigned char)*str;
+
+		if (ch == '"' || ch == '\\') {
+			dstr_cat_ch(buffer, '\\');
+			dstr_cat_ch(buffer, (char)ch);
+		} else if (ch < 0x20) {
+			dstr_catf(buffer, "\\u%04x", ch);
+		} else {
+			dstr_cat_ch(buffer, (char)ch);
+		}
+	}
+	dstr_cat_ch(buffer, '"');
+}
+
+static void trace_dump_ring(FILE *f, struct dstr *buffer,
+		struct trace_ring *ring, struct trace_event *events,
+		bool *first)
+{
+	static const char *phases[] = {"B", "E", "i"};
+	unsigned long end = (unsigned long)os_atomic_load_long(&ring->head);
+	unsigned long copied = end > TRACE_RING_SIZE ?
+		end - TRACE_RING_SIZE : 0;
+	unsigned long start = copied;
+
+	for (unsigned long i = copied; i < end; i++)
+		events[i - copied] = ring->events[i & TRACE_RING_MASK];
+
+	/* anything the thread may have overwritten while copying is dropped */
+	unsigned long new_end = (unsigned long)os_atomic_load_long(&ring->head);
+	unsigned long valid = new_end >= TRACE_RING_SIZE ?
+		new_end - TRACE_RING_SIZE + 1 : 0;
+	if (valid > start)
+		start = valid;
+
+	if (ring->thread_name) {
+		dstr_printf(buffer, "%s{\"name\":\"thread_name\",\"ph\":\"M\","
+				"\"pid\":1,\"tid\":%ld,\"args\":{\"name\":",
+				*first ? "" : ",\n", ring->tid);
+		trace_cat_json_string(buffer, ring->thread_name);
+		dstr_cat(buffer, "}}");
+		fwrite(buffer->array, 1, buffer->len, f);
+		*first = false;
+	}
+
+	for (unsigned long i = start; i < end; i++) {
+		struct trace_event *event = &events[i - copied];
+
+		dstr_printf(buffer, "%s{\"name\":", *first ? "" : ",\n");
+		trace_cat_json_string(buffer, event->name);
+		dstr_catf(buffer, ",\"ph\":\"%s\",\"ts\":%.3f,"
+				"\"pid\":1,\"tid\":%ld%s}",
+				phases[event->type],
+				(double)event->time / 1000.0, ring->tid,
+				event->type == TRACE_INSTANT ?
+					",\"s\":\"g\"" : "");
+		fwrite(buffer->array, 1, buffer->len, f);
+		*first = false;
+	}
+}
+
+bool profiler_trace_dump_json(const char *filename)
+{
+	struct trace_event *events;
+	struct dstr buffer = {0};
+	struct trace_ring *ring;
+	bool first = true;
+
+	FILE *f = os_fopen(filename, "wb+");
+	if (!f)
+		return false;
+
+	events = bmalloc(sizeof(struct trace_event) * TRACE_RING_SIZE);
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+
+	/* rings are only ever prepended and are freed in profiler_free, so
+	 * the list can be walked without holding the mutex */
+	pthread_mutex_lock(&trace_mutex);
+	ring = first_trace_ring;
+	pthread_mutex_unlock(&trace_mutex);
+
+	for (; ring; ring = ring->next)
+		trace_dump_ring(f, &buffer, ring, events, &first);
+
+	fputs("\n]}\n", f);
+
+	dstr_free(&buffer);
+	bfree(events);
+	fclose(f);
+	return true;
+}
+
+void profiler_trace_set_dump_dir(const char *dir)
+{
+	pthread_mutex_lock(&trace_mutex);
+	bfree(trace_dump_dir);
+	trace_dump_dir = dir && *dir ? bstrdup(dir) : NULL;
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+static void *trace_dump_thread(void *data)
+{
+	char *path = data;
+
+	os_set_thread_name("profiler: trace dump");
+
+	if (profiler_trace_dump_json(path))
+		blog(LOG_INFO, "Profiler trace written to '%s'", path);
+	else
+		blog(LOG_WARNING, "Failed to write profiler trace to '%s'",
+				path);
+
+	bfree(path);
+	os_atomic_dec_long(&trace_dumps_active);
+	return NULL;
+}
+
+void profile_trace_trigger(const char *name)
+{
+	struct dstr path = {0};
+	uint64_t now = os_gettime_ns();
+	pthread_t thread;
+
+	if (!os_atomic_load_bool(&trace_enabled))
+		return;
+
+	trace_record(name, TRACE_INSTANT, now);
+
+	pthread_mutex_lock(&trace_mutex);
+	if (trace_dump_dir && (!trace_last_dump ||
+	    now - trace_last_dump >= TRACE_DUMP_INTERVAL_NS)) {
+		char *file = os_generate_formatted_filename("json", true,
+				"trace %CCYY-%MM-%DD %hh-%mm-%ss");
+		dstr_printf(&path, "%s/%s", trace_dump_dir, file);
+		bfree(file);
+
+		trace_last_dump = now;
+	}
+	pthread_mutex_unlock(&trace_mutex);
+
+	if (!path.array)
+		return;
+
+	/* the dump runs on its own thread, the trigger is usually hit on a
+	 * time critical thread */
+	os_atomic_inc_long(&trace_dumps_active);
+	if (pthread_create(&thread, NULL, trace_dump_thread, path.array) != 0) {
+		os_atomic_dec_long(&trace_dumps_active);
+		dstr_free(&path);
+		return;
+	}
+
+	pthread_detach(thread);
+}
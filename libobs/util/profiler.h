@@ -33,6 +33,26 @@ EXPORT void profiler_print_time_between_calls(profiler_snapshot_t *snap);
 
 EXPORT void profiler_free(void);
 
+/* ------------------------------------------------------------------------- */
+/* Profiler tracing
+ *
+ * When enabled, every profile_start/profile_end is also recorded as an
+ * individual event in a lock-free per-thread ring buffer, which can be dumped
+ * as a Chrome trace JSON file (loadable in chrome://tracing and Perfetto) */
+
+EXPORT void profiler_trace_enable(bool enable);
+EXPORT bool profiler_trace_enabled(void);
+
+/* records an instant event on the calling thread */
+EXPORT void profile_trace_mark(const char *name);
+
+/* records an instant event and, if a dump directory is set, writes a trace
+ * dump to it in the background (at most once every few seconds) */
+EXPORT void profile_trace_trigger(const char *name);
+EXPORT void profiler_trace_set_dump_dir(const char *dir);
+
+EXPORT bool profiler_trace_dump_json(const char *filename);
+
 /* ------------------------------------------------------------------------- */
 /* Profiler name storage */
 
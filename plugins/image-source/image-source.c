@@ -64,6 +64,8 @@ static void image_source_load(struct image_source *context)
 		if (!context->image.loaded)
 			warn("failed to load texture '%s'", file);
 	}
+
+	obs_source_invalidate_cache(context->source);
 }
 
 static void image_source_unload(struct image_source *context)
@@ -71,6 +73,8 @@ static void image_source_unload(struct image_source *context)
 	obs_enter_graphics();
 	gs_image_file_free(&context->image);
 	obs_leave_graphics();
+
+	obs_source_invalidate_cache(context->source);
 }
 
 static void image_source_update(void *data, obs_data_t *settings)
@@ -190,6 +194,8 @@ static void image_source_tick(void *data, float seconds)
 				obs_enter_graphics();
 				gs_image_file_update_texture(&context->image);
 				obs_leave_graphics();
+
+				obs_source_invalidate_cache(context->source);
 			}
 
 			context->active = false;
@@ -206,6 +212,8 @@ static void image_source_tick(void *data, float seconds)
 			obs_enter_graphics();
 			gs_image_file_update_texture(&context->image);
 			obs_leave_graphics();
+
+			obs_source_invalidate_cache(context->source);
 		}
 	}
 
@@ -251,7 +259,8 @@ static obs_properties_t *image_source_properties(void *data)
 static struct obs_source_info image_source_info = {
 	.id             = "image_source",
 	.type           = OBS_SOURCE_TYPE_INPUT,
-	.output_flags   = OBS_SOURCE_VIDEO,
+	.output_flags   = OBS_SOURCE_VIDEO | OBS_SOURCE_THREADSAFE_CREATE |
+	                  OBS_SOURCE_STATIC_CONTENT,
 	.get_name       = image_source_get_name,
 	.create         = image_source_create,
 	.destroy        = image_source_destroy,
@@ -25,6 +25,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <util/async-file-serializer.h>
 #include "ffmpeg-mux.h"
 
 #include <libavformat/avformat.h>
@@ -104,6 +105,8 @@ struct ffmpeg_mux {
 	struct header          video_header;
 	struct header          *audio_header;
 	int                    num_audio_streams;
+	struct serializer      file;
+	bool                   file_open;
 	bool                   initialized;
 	char error[4096];
 };
@@ -113,11 +116,29 @@ static void header_free(struct header *header)
 	free(header->data);
 }
 
+static void close_output_file(struct ffmpeg_mux *ffm)
+{
+	AVIOContext *pb = ffm->output->pb;
+	struct async_file_stats stats;
+
+	if (pb) {
+		avio_flush(pb);
+		av_freep(&pb->buffer);
+		av_freep(&ffm->output->pb);
+	}
+
+	async_file_serializer_free(&ffm->file, &stats);
+	ffm->file_open = false;
+
+	if (stats.error)
+		printf("Error writing '%s'\n", ffm->params.file);
+}
+
 static void free_avformat(struct ffmpeg_mux *ffm)
 {
 	if (ffm->output) {
-		if ((ffm->output->oformat->flags & AVFMT_NOFILE) == 0)
-			avio_close(ffm->output->pb);
+		if (ffm->file_open)
+			close_output_file(ffm);
 
 		avformat_free_context(ffm->output);
 		ffm->output = NULL;
@@ -460,17 +481,61 @@ static inline bool ffmpeg_mux_get_extra_data(struct ffmpeg_mux *ffm)
 #pragma warning(disable : 4996)
 #endif
 
+#define AVIO_BUFFER_SIZE 65536
+
+/* the file is written on a separate thread so that a slow disk does not
+ * stop packets from being read from the pipe */
+static int write_file_data(void *opaque, uint8_t *buf, int buf_size)
+{
+	struct ffmpeg_mux *ffm = opaque;
+	size_t written = s_write(&ffm->file, buf, (size_t)buf_size);
+
+	return written == (size_t)buf_size ? buf_size : AVERROR(EIO);
+}
+
+static int64_t seek_file(void *opaque, int64_t offset, int whence)
+{
+	struct ffmpeg_mux *ffm = opaque;
+	enum serialize_seek_type seek_type;
+
+	switch (whence & ~AVSEEK_FORCE) {
+	case SEEK_SET: seek_type = SERIALIZE_SEEK_START;   break;
+	case SEEK_CUR: seek_type = SERIALIZE_SEEK_CURRENT; break;
+	case SEEK_END: seek_type = SERIALIZE_SEEK_END;     break;
+	default:       return -1;
+	}
+
+	return serializer_seek(&ffm->file, offset, seek_type);
+}
+
+static inline bool open_async_file(struct ffmpeg_mux *ffm)
+{
+	uint8_t *buf;
+
+	if (!async_file_serializer_init(&ffm->file, ffm->params.file, NULL))
+		return false;
+
+	ffm->file_open = true;
+
+	buf = av_malloc(AVIO_BUFFER_SIZE);
+	ffm->output->pb = avio_alloc_context(buf, AVIO_BUFFER_SIZE, 1, ffm,
+			NULL, write_file_data, seek_file);
+	if (!ffm->output->pb) {
+		av_free(buf);
+		return false;
+	}
+
+	return true;
+}
+
 static inline int open_output_file(struct ffmpeg_mux *ffm)
 {
 	AVOutputFormat *format = ffm->output->oformat;
 	int ret;
 
 	if ((format->flags & AVFMT_NOFILE) == 0) {
-		ret = avio_open(&ffm->output->pb, ffm->params.file,
-				AVIO_FLAG_WRITE);
-		if (ret < 0) {
-			printf("Couldn't open '%s', %s",
-					ffm->params.file, av_err2str(ret));
+		if (!open_async_file(ffm)) {
+			printf("Couldn't open '%s'", ffm->params.file);
 			return FFM_ERROR;
 		}
 	}
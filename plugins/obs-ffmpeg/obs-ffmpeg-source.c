@@ -50,6 +50,7 @@ struct ffmpeg_source {
 	char *input_format;
 	int buffering_mb;
 	int speed_percent;
+	int cache_max_mb;
 	bool is_looping;
 	bool is_local_file;
 	bool is_hw_decoding;
@@ -57,6 +58,7 @@ struct ffmpeg_source {
 	bool restart_on_activate;
 	bool close_when_inactive;
 	bool seekable;
+	bool cache_frames;
 };
 
 static bool is_local_file_modified(obs_properties_t *props,
@@ -74,6 +76,8 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_t *close = obs_properties_get(props, "close_when_inactive");
 	obs_property_t *seekable = obs_properties_get(props, "seekable");
 	obs_property_t *speed = obs_properties_get(props, "speed_percent");
+	obs_property_t *cache = obs_properties_get(props, "cache_frames");
+	obs_property_t *cache_max = obs_properties_get(props, "cache_max_mb");
 	obs_property_set_visible(input, !enabled);
 	obs_property_set_visible(input_format, !enabled);
 	obs_property_set_visible(buffering, !enabled);
@@ -82,6 +86,8 @@ static bool is_local_file_modified(obs_properties_t *props,
 	obs_property_set_visible(looping, enabled);
 	obs_property_set_visible(speed, enabled);
 	obs_property_set_visible(seekable, !enabled);
+	obs_property_set_visible(cache, enabled);
+	obs_property_set_visible(cache_max, enabled);
 
 	return true;
 }
@@ -97,6 +103,8 @@ static void ffmpeg_source_defaults(obs_data_t *settings)
 #endif
 	obs_data_set_default_int(settings, "buffering_mb", 2);
 	obs_data_set_default_int(settings, "speed_percent", 100);
+	obs_data_set_default_bool(settings, "cache_frames", false);
+	obs_data_set_default_int(settings, "cache_max_mb", 256);
 }
 
 static const char *media_filter =
@@ -178,6 +186,15 @@ static obs_properties_t *ffmpeg_source_getproperties(void *data)
 	obs_properties_add_int_slider(props, "speed_percent",
 			obs_module_text("SpeedPercentage"), 1, 200, 1);
 
+	prop = obs_properties_add_bool(props, "cache_frames",
+			obs_module_text("CacheFrames"));
+
+	obs_property_set_long_description(prop,
+			obs_module_text("CacheFrames.ToolTip"));
+
+	obs_properties_add_int(props, "cache_max_mb",
+			obs_module_text("CacheMaxSize"), 1, 4096, 1);
+
 	prop = obs_properties_add_list(props, "color_range",
 			obs_module_text("ColorRange"), OBS_COMBO_TYPE_LIST,
 			OBS_COMBO_FORMAT_INT);
@@ -205,7 +222,8 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 			"\tis_hw_decoding:          %s\n"
 			"\tis_clear_on_media_end:   %s\n"
 			"\trestart_on_activate:     %s\n"
-			"\tclose_when_inactive:     %s",
+			"\tclose_when_inactive:     %s\n"
+			"\tcache_frames:            %s",
 			input ? input : "(null)",
 			input_format ? input_format : "(null)",
 			s->speed_percent,
@@ -213,7 +231,8 @@ static void dump_source_info(struct ffmpeg_source *s, const char *input,
 			s->is_hw_decoding ? "yes" : "no",
 			s->is_clear_on_media_end ? "yes" : "no",
 			s->restart_on_activate ? "yes" : "no",
-			s->close_when_inactive ? "yes" : "no");
+			s->close_when_inactive ? "yes" : "no",
+			s->cache_frames ? "yes" : "no");
 }
 
 static void get_frame(void *opaque, struct obs_source_frame *f)
@@ -263,7 +282,9 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.speed = s->speed_percent,
 			.force_range = s->range,
 			.hardware_decoding = s->is_hw_decoding,
-			.is_local_file = s->is_local_file || s->seekable
+			.is_local_file = s->is_local_file || s->seekable,
+			.cache_max_size = s->cache_frames && s->is_local_file
+				? (size_t)s->cache_max_mb * 1024 * 1024 : 0
 		};
 
 		s->media_valid = mp_media_init(&s->media, &info);
@@ -341,6 +362,8 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	s->speed_percent = (int)obs_data_get_int(settings, "speed_percent");
 	s->is_local_file = is_local_file;
 	s->seekable = obs_data_get_bool(settings, "seekable");
+	s->cache_frames = obs_data_get_bool(settings, "cache_frames");
+	s->cache_max_mb = (int)obs_data_get_int(settings, "cache_max_mb");
 
 	if (s->speed_percent < 1 || s->speed_percent > 200)
 		s->speed_percent = 100;
@@ -430,6 +453,21 @@ static void get_nb_frames(void *data, calldata_t *cd)
 	calldata_set_int(cd, "num_frames", frames);
 }
 
+static void get_playback_stats(void *data, calldata_t *cd)
+{
+	struct ffmpeg_source *s = data;
+	int queue_depth = 0;
+	int64_t late_frames = 0;
+
+	if (s->media_valid)
+		mp_media_get_queue_stats(&s->media, &queue_depth,
+				&late_frames);
+
+	calldata_set_int(cd, "queue_depth", queue_depth);
+	calldata_set_int(cd, "queue_size", MP_QUEUE_SIZE);
+	calldata_set_int(cd, "late_frames", late_frames);
+}
+
 static void *ffmpeg_source_create(obs_data_t *settings, obs_source_t *source)
 {
 	UNUSED_PARAMETER(settings);
@@ -448,6 +486,9 @@ static void *ffmpeg_source_create(obs_data_t *settings, obs_source_t *source)
 			get_duration, s);
 	proc_handler_add(ph, "void get_nb_frames(out int num_frames)",
 			get_nb_frames, s);
+	proc_handler_add(ph, "void get_playback_stats(out int queue_depth, "
+			"out int queue_size, out int late_frames)",
+			get_playback_stats, s);
 
 	ffmpeg_source_update(s, settings);
 	return s;
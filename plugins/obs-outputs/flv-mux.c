@@ -42,18 +42,18 @@ static inline double encoder_bitrate(obs_encoder_t *encoder)
 
 #define FLV_INFO_SIZE_OFFSET 42
 
-void write_file_info(FILE *file, int64_t duration_ms, int64_t size)
+void write_file_info(struct serializer *s, int64_t duration_ms, int64_t size)
 {
 	char buf[64];
 	char *enc = buf;
 	char *end = enc + sizeof(buf);
 
-	fseek(file, FLV_INFO_SIZE_OFFSET, SEEK_SET);
+	serializer_seek(s, FLV_INFO_SIZE_OFFSET, SERIALIZE_SEEK_START);
 
 	enc_num_val(&enc, end, "duration", (double)duration_ms / 1000.0);
 	enc_num_val(&enc, end, "fileSize", (double)size);
 
-	fwrite(buf, 1, enc - buf, file);
+	s_write(s, buf, enc - buf);
 }
 
 static bool build_flv_meta_data(obs_output_t *context,
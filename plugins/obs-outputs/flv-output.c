@@ -21,6 +21,7 @@
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/async-file-serializer.h>
 #include <inttypes.h>
 #include "flv-mux.h"
 
@@ -34,7 +35,8 @@
 struct flv_output {
 	obs_output_t    *output;
 	struct dstr     path;
-	FILE            *file;
+	struct serializer file;
+	bool            file_open;
 	volatile bool   active;
 	volatile bool   stopping;
 	uint64_t        stop_ts;
@@ -95,7 +97,7 @@ static int write_packet(struct flv_output *stream,
 
 	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset,
 			&data, &size, is_header);
-	fwrite(data, 1, size, stream->file);
+	s_write(&stream->file, data, size);
 	bfree(data);
 
 	return ret;
@@ -107,7 +109,7 @@ static void write_meta_data(struct flv_output *stream)
 	size_t  meta_data_size;
 
 	flv_meta_data(stream->output, &meta_data, &meta_data_size, true, 0);
-	fwrite(meta_data, 1, meta_data_size, stream->file);
+	s_write(&stream->file, meta_data, meta_data_size);
 	bfree(meta_data);
 }
 
@@ -172,8 +174,9 @@ static bool flv_output_start(void *data)
 	dstr_copy(&stream->path, path);
 	obs_data_release(settings);
 
-	stream->file = os_fopen(stream->path.array, "wb");
-	if (!stream->file) {
+	stream->file_open = async_file_serializer_init(&stream->file,
+			stream->path.array, NULL);
+	if (!stream->file_open) {
 		warn("Unable to open FLV file '%s'", stream->path.array);
 		return false;
 	}
@@ -197,11 +200,22 @@ static void flv_output_actual_stop(struct flv_output *stream)
 {
 	os_atomic_set_bool(&stream->active, false);
 
-	if (stream->file) {
-		write_file_info(stream->file, stream->last_packet_ts,
-				os_ftelli64(stream->file));
+	if (stream->file_open) {
+		struct async_file_stats stats;
 
-		fclose(stream->file);
+		write_file_info(&stream->file, stream->last_packet_ts,
+				serializer_get_pos(&stream->file));
+
+		async_file_serializer_free(&stream->file, &stats);
+		stream->file_open = false;
+
+		if (stats.error)
+			warn("Error writing FLV file '%s'", stream->path.array);
+		if (stats.stalls)
+			info("Disk writes stalled output %llu time(s) "
+					"(%.3f ms total)",
+					(unsigned long long)stats.stalls,
+					(double)stats.stall_time_ns / 1000000.0);
 	}
 	obs_output_end_data_capture(stream->output);
 
@@ -237,7 +251,7 @@ static void flv_output_data(void *data, struct encoder_packet *packet)
 			stream->got_first_video = true;
 		}
 
-		obs_parse_avc_packet(&parsed_packet, packet);
+		obs_parse_avc_packet_ref(&parsed_packet, packet);
 		write_packet(stream, &parsed_packet, false);
 		obs_encoder_packet_release(&parsed_packet);
 	} else {
@@ -484,8 +484,15 @@ static void *send_thread(void *data)
 
 	os_set_thread_name("ftl-stream: send_thread");
 
+	const char *send_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				"ftl_stream_send_thread(%s)",
+				obs_output_get_name(stream->output));
+	profile_register_root(send_thread_name, 0);
+
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
+		bool sent;
 
 		if (stopping(stream) && stream->stop_ts == 0) {
 			break;
@@ -501,16 +508,18 @@ static void *send_thread(void *data)
 			}
 		}
 
+		profile_start(send_thread_name);
 		/* sends sps/pps on every key frame as this is typically
 		 * required for webrtc */
-		if (packet.keyframe) {
-			if (!send_headers(stream, packet.dts_usec)) {
-				os_atomic_set_bool(&stream->disconnected, true);
-				break;
-			}
-		}
+		if (packet.keyframe && !send_headers(stream, packet.dts_usec))
+			sent = false;
+		else
+			sent = send_packet(stream, &packet, false) >= 0;
+		profile_end(send_thread_name);
+
+		profile_reenable_thread();
 
-		if (send_packet(stream, &packet, false) < 0) {
+		if (!sent) {
 			os_atomic_set_bool(&stream->disconnected, true);
 			break;
 		}
@@ -810,7 +819,7 @@ static void ftl_stream_data(void *data, struct encoder_packet *packet)
 		return;
 
 	if (packet->type == OBS_ENCODER_VIDEO)
-		obs_parse_avc_packet(&new_packet, packet);
+		obs_parse_avc_packet_ref(&new_packet, packet);
 	else
 		obs_encoder_packet_ref(&new_packet, packet);
 
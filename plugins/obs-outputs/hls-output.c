@@ -0,0 +1,757 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stdio.h>
+#include <math.h>
+#include <obs-module.h>
+#include <obs-avc.h>
+#include <util/platform.h>
+#include <util/dstr.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include "mp4-mux.h"
+
+#define do_log(level, format, ...) \
+	blog(level, "[hls output: '%s'] " format, \
+			obs_output_get_name(stream->output), ##__VA_ARGS__)
+
+#define warn(format, ...)  do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...)  do_log(LOG_INFO,    format, ##__VA_ARGS__)
+
+#define INIT_SEGMENT_NAME   "init.mp4"
+#define SEGMENT_NAME_FORMAT "segment_%05u.m4s"
+#define PLAYLIST_NAME       "playlist.m3u8"
+
+/* AAC, used for the duration of the last audio packet of the stream */
+#define AUDIO_FRAME_SIZE    1024
+
+struct hls_track {
+	uint32_t                          timescale;
+
+	/* time of the first video packet in the timescale of the track, all
+	 * track times are relative to it */
+	int64_t                           origin;
+
+	DARRAY(struct encoder_packet)     packets;
+};
+
+struct hls_segment {
+	uint32_t                          index;
+	bool                              is_init;
+	double                            duration;
+
+	/* moof box + mdat header, or the whole init segment */
+	uint8_t                           *header;
+	size_t                            header_size;
+
+	/* packet references, written to disk as-is after the header */
+	DARRAY(struct encoder_packet)     packets;
+};
+
+struct hls_playlist_entry {
+	uint32_t                          index;
+	double                            duration;
+};
+
+struct hls_output {
+	obs_output_t                      *output;
+	struct dstr                       path;
+	int64_t                           segment_duration;
+	uint32_t                          playlist_size;
+
+	volatile bool                     active;
+	volatile bool                     stopping;
+	uint64_t                          stop_ts;
+
+	pthread_mutex_t                   mutex;
+
+	bool                              got_first_video;
+	struct hls_track                  video;
+	struct hls_track                  audio;
+	int64_t                           segment_start;
+	int64_t                           last_video_duration;
+	uint32_t                          next_index;
+
+	/* segments are written on a separate thread so the encoders are never
+	 * blocked by disk writes */
+	pthread_t                         write_thread;
+	bool                              write_thread_active;
+	os_sem_t                          *write_sem;
+	pthread_mutex_t                   write_mutex;
+	DARRAY(struct hls_segment)        write_queue;
+	volatile bool                     write_error;
+
+	/* only accessed from the write thread */
+	DARRAY(struct hls_playlist_entry) playlist;
+	uint32_t                          media_sequence;
+};
+
+static inline bool stopping(struct hls_output *stream)
+{
+	return os_atomic_load_bool(&stream->stopping);
+}
+
+static inline bool active(struct hls_output *stream)
+{
+	return os_atomic_load_bool(&stream->active);
+}
+
+static inline int64_t rescale(int64_t val, int32_t num, int32_t den,
+		uint32_t timescale)
+{
+	return val * num * (int64_t)timescale / den;
+}
+
+static inline int64_t track_time(const struct hls_track *track,
+		const struct encoder_packet *packet, int64_t val)
+{
+	return rescale(val, packet->timebase_num, packet->timebase_den,
+			track->timescale) - track->origin;
+}
+
+static const char *hls_output_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("HLSOutput");
+}
+
+static void free_packets(struct hls_track *track)
+{
+	for (size_t i = 0; i < track->packets.num; i++)
+		obs_encoder_packet_release(track->packets.array + i);
+	da_resize(track->packets, 0);
+}
+
+static void free_segment(struct hls_segment *segment)
+{
+	for (size_t i = 0; i < segment->packets.num; i++)
+		obs_encoder_packet_release(segment->packets.array + i);
+	da_free(segment->packets);
+	bfree(segment->header);
+}
+
+static void hls_output_destroy(void *data)
+{
+	struct hls_output *stream = data;
+
+	if (stream->write_thread_active) {
+		os_sem_post(stream->write_sem);
+		pthread_join(stream->write_thread, NULL);
+	}
+
+	free_packets(&stream->video);
+	free_packets(&stream->audio);
+	da_free(stream->video.packets);
+	da_free(stream->audio.packets);
+
+	for (size_t i = 0; i < stream->write_queue.num; i++)
+		free_segment(stream->write_queue.array + i);
+	da_free(stream->write_queue);
+	da_free(stream->playlist);
+
+	os_sem_destroy(stream->write_sem);
+	pthread_mutex_destroy(&stream->write_mutex);
+	pthread_mutex_destroy(&stream->mutex);
+	dstr_free(&stream->path);
+	bfree(stream);
+}
+
+static void *hls_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct hls_output *stream = bzalloc(sizeof(struct hls_output));
+	stream->output = output;
+	pthread_mutex_init_value(&stream->mutex);
+	pthread_mutex_init_value(&stream->write_mutex);
+
+	if (pthread_mutex_init(&stream->mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&stream->write_mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&stream->write_sem, 0) != 0)
+		goto fail;
+
+	UNUSED_PARAMETER(settings);
+	return stream;
+
+fail:
+	hls_output_destroy(stream);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* write thread                                                              */
+
+static void get_file_path(struct hls_output *stream, struct dstr *file,
+		const struct hls_segment *segment)
+{
+	dstr_copy_dstr(file, &stream->path);
+	dstr_cat_ch(file, '/');
+
+	if (segment->is_init)
+		dstr_cat(file, INIT_SEGMENT_NAME);
+	else
+		dstr_catf(file, SEGMENT_NAME_FORMAT, segment->index);
+}
+
+static bool write_segment_file(struct hls_output *stream, const char *file,
+		const struct hls_segment *segment)
+{
+	FILE *f = os_fopen(file, "wb");
+	bool success;
+
+	if (!f) {
+		warn("Unable to open segment file '%s'", file);
+		return false;
+	}
+
+	success = fwrite(segment->header, 1, segment->header_size, f) ==
+		segment->header_size;
+
+	for (size_t i = 0; success && i < segment->packets.num; i++) {
+		const struct encoder_packet *packet =
+			segment->packets.array + i;
+		success = fwrite(packet->data, 1, packet->size, f) ==
+			packet->size;
+	}
+
+	if (fclose(f) != 0)
+		success = false;
+	if (!success)
+		warn("Error writing segment file '%s'", file);
+
+	return success;
+}
+
+static void write_playlist(struct hls_output *stream, bool ended)
+{
+	struct dstr playlist = {0};
+	struct dstr file = {0};
+	double max_duration = 0.0;
+
+	for (size_t i = 0; i < stream->playlist.num; i++) {
+		double duration = stream->playlist.array[i].duration;
+		if (duration > max_duration)
+			max_duration = duration;
+	}
+
+	dstr_copy(&playlist, "#EXTM3U\n#EXT-X-VERSION:7\n");
+	dstr_catf(&playlist, "#EXT-X-TARGETDURATION:%d\n",
+			(int)ceil(max_duration));
+	dstr_catf(&playlist, "#EXT-X-MEDIA-SEQUENCE:%u\n",
+			stream->media_sequence);
+	if (!stream->playlist_size)
+		dstr_cat(&playlist, ended ?
+				"#EXT-X-PLAYLIST-TYPE:VOD\n" :
+				"#EXT-X-PLAYLIST-TYPE:EVENT\n");
+	dstr_cat(&playlist, "#EXT-X-INDEPENDENT-SEGMENTS\n");
+	dstr_cat(&playlist, "#EXT-X-MAP:URI=\"" INIT_SEGMENT_NAME "\"\n");
+
+	for (size_t i = 0; i < stream->playlist.num; i++) {
+		struct hls_playlist_entry *entry = stream->playlist.array + i;
+
+		dstr_catf(&playlist, "#EXTINF:%.3f,\n" SEGMENT_NAME_FORMAT "\n",
+				entry->duration, entry->index);
+	}
+
+	if (ended)
+		dstr_cat(&playlist, "#EXT-X-ENDLIST\n");
+
+	dstr_copy_dstr(&file, &stream->path);
+	dstr_cat(&file, "/" PLAYLIST_NAME);
+
+	/* players may read the playlist at any time, so replace it atomically */
+	if (!os_quick_write_utf8_file_safe(file.array, playlist.array,
+				playlist.len, false, "tmp", NULL))
+		warn("Unable to write playlist '%s'", file.array);
+
+	dstr_free(&file);
+	dstr_free(&playlist);
+}
+
+static void remove_old_segments(struct hls_output *stream)
+{
+	struct dstr file = {0};
+
+	while (stream->playlist.num > stream->playlist_size) {
+		struct hls_segment segment = {
+			.index = stream->playlist.array[0].index
+		};
+
+		get_file_path(stream, &file, &segment);
+		os_unlink(file.array);
+
+		da_erase(stream->playlist, 0);
+		stream->media_sequence++;
+	}
+
+	dstr_free(&file);
+}
+
+static void write_segment(struct hls_output *stream,
+		const struct hls_segment *segment)
+{
+	struct dstr file = {0};
+	struct hls_playlist_entry entry = {
+		.index    = segment->index,
+		.duration = segment->duration
+	};
+
+	get_file_path(stream, &file, segment);
+
+	if (!write_segment_file(stream, file.array, segment)) {
+		os_atomic_set_bool(&stream->write_error, true);
+		goto free;
+	}
+
+	if (!segment->is_init) {
+		da_push_back(stream->playlist, &entry);
+		if (stream->playlist_size)
+			remove_old_segments(stream);
+
+		write_playlist(stream, false);
+	}
+
+free:
+	dstr_free(&file);
+}
+
+static void *write_thread(void *data)
+{
+	struct hls_output *stream = data;
+
+	os_set_thread_name("hls-output: write_thread");
+
+	const char *write_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				"hls_output_write_thread(%s)",
+				obs_output_get_name(stream->output));
+	profile_register_root(write_thread_name, 0);
+
+	/* every queued segment posts the semaphore once, a post without a
+	 * queued segment stops the thread once everything has been written */
+	while (os_sem_wait(stream->write_sem) == 0) {
+		struct hls_segment segment;
+		bool have_segment;
+
+		pthread_mutex_lock(&stream->write_mutex);
+		have_segment = stream->write_queue.num > 0;
+		if (have_segment) {
+			segment = stream->write_queue.array[0];
+			da_erase(stream->write_queue, 0);
+		}
+		pthread_mutex_unlock(&stream->write_mutex);
+
+		if (!have_segment)
+			break;
+
+		profile_start(write_thread_name);
+		if (!os_atomic_load_bool(&stream->write_error))
+			write_segment(stream, &segment);
+		free_segment(&segment);
+		profile_end(write_thread_name);
+
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static void queue_segment(struct hls_output *stream,
+		struct hls_segment *segment)
+{
+	pthread_mutex_lock(&stream->write_mutex);
+	da_push_back(stream->write_queue, segment);
+	pthread_mutex_unlock(&stream->write_mutex);
+
+	os_sem_post(stream->write_sem);
+}
+
+/* ------------------------------------------------------------------------- */
+/* segmenting                                                                */
+
+static bool queue_init_segment(struct hls_output *stream)
+{
+	struct hls_segment segment = {.is_init = true};
+
+	if (!mp4_init_segment(stream->output, &segment.header,
+				&segment.header_size)) {
+		warn("Failed to create the initialization segment");
+		return false;
+	}
+
+	queue_segment(stream, &segment);
+	return true;
+}
+
+/* audio packets are part of the segment if they start before the end of the
+ * video of the segment */
+static size_t count_segment_audio(struct hls_output *stream, int64_t end_time,
+		bool last)
+{
+	struct hls_track *audio = &stream->audio;
+	size_t num = 0;
+
+	if (last)
+		return audio->packets.num;
+
+	for (; num < audio->packets.num; num++) {
+		struct encoder_packet *packet = audio->packets.array + num;
+		int64_t time = track_time(audio, packet, packet->dts);
+
+		if (time * MP4_VIDEO_TIMESCALE >= end_time * audio->timescale)
+			break;
+	}
+
+	return num;
+}
+
+/* end_time is the time of the first video packet after the segment in the
+ * video timescale */
+static void flush_segment(struct hls_output *stream, int64_t end_time,
+		bool last)
+{
+	struct hls_track *video = &stream->video;
+	struct hls_track *audio = &stream->audio;
+	size_t num_video = video->packets.num;
+	size_t num_audio = count_segment_audio(stream, end_time, last);
+	struct mp4_fragment_track tracks[2];
+	struct hls_segment segment = {0};
+	size_t num_tracks = 0;
+	uint32_t *durations;
+	int32_t *cts_offsets;
+
+	if (!num_video)
+		return;
+
+	durations = bmalloc((num_video + num_audio) * sizeof(uint32_t));
+	cts_offsets = bmalloc(num_video * sizeof(int32_t));
+
+	for (size_t i = 0; i < num_video; i++) {
+		struct encoder_packet *packet = video->packets.array + i;
+		int64_t dts  = track_time(video, packet, packet->dts);
+		int64_t pts  = track_time(video, packet, packet->pts);
+		int64_t next = (i + 1 < num_video) ?
+			track_time(video, packet + 1, packet[1].dts) :
+			end_time;
+
+		durations[i] = (uint32_t)(next - dts);
+		cts_offsets[i] = (int32_t)(pts - dts);
+	}
+
+	for (size_t i = 0; i < num_audio; i++) {
+		struct encoder_packet *packet = audio->packets.array + i;
+		int64_t dts = track_time(audio, packet, packet->dts);
+		uint32_t duration = i ? durations[num_video + i - 1] :
+			AUDIO_FRAME_SIZE;
+
+		if (i + 1 < audio->packets.num)
+			duration = (uint32_t)(track_time(audio, packet + 1,
+						packet[1].dts) - dts);
+
+		durations[num_video + i] = duration;
+	}
+
+	tracks[num_tracks++] = (struct mp4_fragment_track){
+		.track_id    = MP4_VIDEO_TRACK_ID,
+		.base_time   = (uint64_t)track_time(video,
+				video->packets.array, video->packets.array->dts),
+		.packets     = video->packets.array,
+		.durations   = durations,
+		.cts_offsets = cts_offsets,
+		.num         = num_video
+	};
+
+	if (num_audio) {
+		tracks[num_tracks++] = (struct mp4_fragment_track){
+			.track_id    = MP4_AUDIO_TRACK_ID,
+			.base_time   = (uint64_t)track_time(audio,
+					audio->packets.array,
+					audio->packets.array->dts),
+			.packets     = audio->packets.array,
+			.durations   = durations + num_video,
+			.num         = num_audio
+		};
+	}
+
+	segment.index = stream->next_index++;
+	segment.duration = (double)(end_time - stream->segment_start) /
+		(double)MP4_VIDEO_TIMESCALE;
+
+	mp4_fragment_header(segment.index + 1, tracks, num_tracks,
+			&segment.header, &segment.header_size);
+
+	/* the packet references are handed over to the write thread */
+	da_push_back_array(segment.packets, video->packets.array, num_video);
+	da_push_back_array(segment.packets, audio->packets.array, num_audio);
+	da_resize(video->packets, 0);
+	da_erase_range(audio->packets, 0, num_audio);
+
+	queue_segment(stream, &segment);
+
+	stream->last_video_duration = durations[num_video - 1];
+	stream->segment_start = end_time;
+
+	bfree(cts_offsets);
+	bfree(durations);
+}
+
+static void flush_last_segment(struct hls_output *stream)
+{
+	struct hls_track *video = &stream->video;
+	struct encoder_packet *last;
+	int64_t duration = stream->last_video_duration;
+
+	if (!video->packets.num)
+		return;
+
+	last = video->packets.array + video->packets.num - 1;
+
+	if (video->packets.num > 1)
+		duration = track_time(video, last, last->dts) -
+			track_time(video, last - 1, last[-1].dts);
+	if (!duration)
+		duration = rescale(1, last->timebase_num, last->timebase_den,
+				video->timescale);
+
+	flush_segment(stream, track_time(video, last, last->dts) + duration,
+			true);
+}
+
+static bool start_tracks(struct hls_output *stream,
+		struct encoder_packet *packet)
+{
+	obs_encoder_t *aencoder =
+		obs_output_get_audio_encoder(stream->output, 0);
+
+	stream->video.timescale = MP4_VIDEO_TIMESCALE;
+	stream->audio.timescale = obs_encoder_get_sample_rate(aencoder);
+
+	stream->video.origin = rescale(packet->dts, packet->timebase_num,
+			packet->timebase_den, stream->video.timescale);
+	stream->audio.origin = rescale(packet->dts, packet->timebase_num,
+			packet->timebase_den, stream->audio.timescale);
+
+	stream->segment_start = 0;
+	stream->got_first_video = true;
+
+	return queue_init_segment(stream);
+}
+
+static void add_video_packet(struct hls_output *stream,
+		struct encoder_packet *packet)
+{
+	struct hls_track *video = &stream->video;
+	struct encoder_packet parsed_packet;
+	int64_t time = track_time(video, packet, packet->dts);
+
+	/* segments always start on a keyframe */
+	if (packet->keyframe && video->packets.num &&
+	    time - stream->segment_start >= stream->segment_duration)
+		flush_segment(stream, time, false);
+
+	/* converts to length prefixed NALs once for all outputs that use the
+	 * packet, the reference is kept until the segment is written */
+	obs_parse_avc_packet_ref(&parsed_packet, packet);
+	da_push_back(video->packets, &parsed_packet);
+}
+
+static void add_audio_packet(struct hls_output *stream,
+		struct encoder_packet *packet)
+{
+	struct encoder_packet ref;
+
+	/* drop audio from before the start of the video */
+	if (track_time(&stream->audio, packet, packet->dts) < 0)
+		return;
+
+	obs_encoder_packet_ref(&ref, packet);
+	da_push_back(stream->audio.packets, &ref);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool hls_output_start(void *data)
+{
+	struct hls_output *stream = data;
+	obs_data_t *settings;
+	const char *path;
+	int segment_duration;
+
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
+		return false;
+
+	settings = obs_output_get_settings(stream->output);
+	path = obs_data_get_string(settings, "path");
+	dstr_copy(&stream->path, path);
+	dstr_replace(&stream->path, "\\", "/");
+	if (dstr_end(&stream->path) == '/')
+		dstr_resize(&stream->path, stream->path.len - 1);
+
+	segment_duration = (int)obs_data_get_int(settings, "segment_duration");
+	if (segment_duration <= 0)
+		segment_duration = 2;
+	stream->segment_duration = (int64_t)segment_duration *
+		MP4_VIDEO_TIMESCALE;
+	stream->playlist_size = (uint32_t)obs_data_get_int(settings,
+			"playlist_size");
+	obs_data_release(settings);
+
+	if (dstr_is_empty(&stream->path)) {
+		warn("No output directory specified");
+		return false;
+	}
+
+	if (os_mkdirs(stream->path.array) == MKDIR_ERROR) {
+		warn("Unable to create output directory '%s'",
+				stream->path.array);
+		return false;
+	}
+
+	stream->got_first_video = false;
+	stream->next_index = 0;
+	stream->last_video_duration = 0;
+	stream->media_sequence = 0;
+	da_resize(stream->playlist, 0);
+	os_atomic_set_bool(&stream->write_error, false);
+	os_atomic_set_bool(&stream->stopping, false);
+
+	if (pthread_create(&stream->write_thread, NULL, write_thread,
+				stream) != 0) {
+		warn("Failed to create write thread");
+		return false;
+	}
+	stream->write_thread_active = true;
+
+	os_atomic_set_bool(&stream->active, true);
+	obs_output_begin_data_capture(stream->output, 0);
+
+	info("Writing HLS segments to '%s'...", stream->path.array);
+	return true;
+}
+
+static void hls_output_stop(void *data, uint64_t ts)
+{
+	struct hls_output *stream = data;
+	stream->stop_ts = ts / 1000;
+	os_atomic_set_bool(&stream->stopping, true);
+}
+
+static void hls_output_actual_stop(struct hls_output *stream, int code)
+{
+	os_atomic_set_bool(&stream->active, false);
+
+	if (code == OBS_OUTPUT_SUCCESS)
+		flush_last_segment(stream);
+
+	free_packets(&stream->video);
+	free_packets(&stream->audio);
+
+	if (stream->write_thread_active) {
+		os_sem_post(stream->write_sem);
+		pthread_join(stream->write_thread, NULL);
+		stream->write_thread_active = false;
+
+		if (stream->playlist.num)
+			write_playlist(stream, true);
+	}
+
+	if (code == OBS_OUTPUT_SUCCESS) {
+		obs_output_end_data_capture(stream->output);
+		info("HLS output complete");
+	} else {
+		obs_output_signal_stop(stream->output, code);
+	}
+}
+
+static void hls_output_data(void *data, struct encoder_packet *packet)
+{
+	struct hls_output *stream = data;
+
+	pthread_mutex_lock(&stream->mutex);
+
+	if (!active(stream))
+		goto unlock;
+
+	if (os_atomic_load_bool(&stream->write_error)) {
+		hls_output_actual_stop(stream, OBS_OUTPUT_ERROR);
+		goto unlock;
+	}
+
+	if (stopping(stream)) {
+		if (packet->sys_dts_usec >= (int64_t)stream->stop_ts) {
+			hls_output_actual_stop(stream, OBS_OUTPUT_SUCCESS);
+			goto unlock;
+		}
+	}
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		if (!stream->got_first_video &&
+		    !start_tracks(stream, packet)) {
+			hls_output_actual_stop(stream, OBS_OUTPUT_ERROR);
+			goto unlock;
+		}
+
+		add_video_packet(stream, packet);
+
+	} else if (stream->got_first_video) {
+		add_audio_packet(stream, packet);
+	}
+
+unlock:
+	pthread_mutex_unlock(&stream->mutex);
+}
+
+static void hls_output_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "segment_duration", 2);
+	obs_data_set_default_int(settings, "playlist_size", 0);
+}
+
+static obs_properties_t *hls_output_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_path(props, "path",
+			obs_module_text("HLSOutput.Directory"),
+			OBS_PATH_DIRECTORY, NULL, NULL);
+	obs_properties_add_int(props, "segment_duration",
+			obs_module_text("HLSOutput.SegmentDuration"),
+			1, 60, 1);
+	obs_properties_add_int(props, "playlist_size",
+			obs_module_text("HLSOutput.PlaylistSize"),
+			0, 1000, 1);
+	return props;
+}
+
+struct obs_output_info hls_output_info = {
+	.id                   = "hls_output",
+	.flags                = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
+	.encoded_video_codecs = "h264",
+	.encoded_audio_codecs = "aac",
+	.get_name             = hls_output_getname,
+	.create               = hls_output_create,
+	.destroy              = hls_output_destroy,
+	.start                = hls_output_start,
+	.stop                 = hls_output_stop,
+	.encoded_packet       = hls_output_data,
+	.get_defaults         = hls_output_defaults,
+	.get_properties       = hls_output_properties
+};
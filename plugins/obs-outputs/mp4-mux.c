@@ -0,0 +1,492 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <obs.h>
+#include <obs-avc.h>
+#include <util/array-serializer.h>
+#include "mp4-mux.h"
+
+#define SAMPLE_FLAGS_SYNC     0x02000000
+#define SAMPLE_FLAGS_NON_SYNC 0x01010000
+
+#define TRUN_DATA_OFFSET      0x000001
+#define TRUN_DURATION         0x000100
+#define TRUN_SIZE             0x000200
+#define TRUN_FLAGS            0x000400
+#define TRUN_CTS_OFFSET       0x000800
+
+#define TFHD_DEFAULT_BASE_IS_MOOF 0x020000
+
+/* ------------------------------------------------------------------------- */
+
+static inline size_t box_start(struct serializer *s, const char *type)
+{
+	size_t pos = (size_t)serializer_get_pos(s);
+	s_wb32(s, 0);
+	s_write(s, type, 4);
+	return pos;
+}
+
+static inline size_t full_box_start(struct serializer *s, const char *type,
+		uint8_t version, uint32_t flags)
+{
+	size_t pos = box_start(s, type);
+	s_w8(s, version);
+	s_wb24(s, flags);
+	return pos;
+}
+
+static inline void write_be32_at(struct serializer *s, size_t pos,
+		uint32_t val)
+{
+	struct array_output_data *data = s->data;
+	uint8_t *p = data->bytes.array + pos;
+
+	p[0] = (uint8_t)(val >> 24);
+	p[1] = (uint8_t)(val >> 16);
+	p[2] = (uint8_t)(val >> 8);
+	p[3] = (uint8_t)val;
+}
+
+static inline void box_end(struct serializer *s, size_t pos)
+{
+	size_t size = (size_t)serializer_get_pos(s) - pos;
+	write_be32_at(s, pos, (uint32_t)size);
+}
+
+static inline void s_zero(struct serializer *s, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		s_w8(s, 0);
+}
+
+static void write_matrix(struct serializer *s)
+{
+	static const uint32_t unity[9] = {
+		0x00010000, 0, 0,
+		0, 0x00010000, 0,
+		0, 0, 0x40000000
+	};
+
+	for (size_t i = 0; i < 9; i++)
+		s_wb32(s, unity[i]);
+}
+
+/* MPEG-4 descriptors, the size is always written in the 4 byte form */
+static inline void write_descriptor_header(struct serializer *s, uint8_t tag,
+		uint32_t size)
+{
+	s_w8(s, tag);
+	s_w8(s, (uint8_t)(0x80 | ((size >> 21) & 0x7F)));
+	s_w8(s, (uint8_t)(0x80 | ((size >> 14) & 0x7F)));
+	s_w8(s, (uint8_t)(0x80 | ((size >> 7) & 0x7F)));
+	s_w8(s, (uint8_t)(size & 0x7F));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline uint32_t encoder_bitrate(obs_encoder_t *encoder)
+{
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	uint32_t bitrate = (uint32_t)obs_data_get_int(settings, "bitrate");
+
+	obs_data_release(settings);
+	return bitrate * 1000;
+}
+
+static void write_ftyp(struct serializer *s)
+{
+	size_t pos = box_start(s, "ftyp");
+	s_write(s, "iso6", 4);
+	s_wb32(s, 0);
+	s_write(s, "iso6", 4);
+	s_write(s, "cmfc", 4);
+	s_write(s, "mp41", 4);
+	box_end(s, pos);
+}
+
+static void write_mvhd(struct serializer *s)
+{
+	size_t pos = full_box_start(s, "mvhd", 0, 0);
+	s_wb32(s, 0);              /* creation time */
+	s_wb32(s, 0);              /* modification time */
+	s_wb32(s, 1000);           /* timescale */
+	s_wb32(s, 0);              /* duration */
+	s_wb32(s, 0x00010000);     /* rate */
+	s_wb16(s, 0x0100);         /* volume */
+	s_zero(s, 10);
+	write_matrix(s);
+	s_zero(s, 24);
+	s_wb32(s, MP4_AUDIO_TRACK_ID + 1);
+	box_end(s, pos);
+}
+
+static void write_tkhd(struct serializer *s, uint32_t track_id, bool audio,
+		uint32_t width, uint32_t height)
+{
+	/* track enabled | track in movie */
+	size_t pos = full_box_start(s, "tkhd", 0, 0x3);
+	s_wb32(s, 0);
+	s_wb32(s, 0);
+	s_wb32(s, track_id);
+	s_wb32(s, 0);
+	s_wb32(s, 0);              /* duration */
+	s_zero(s, 8);
+	s_wb16(s, 0);              /* layer */
+	s_wb16(s, 0);              /* alternate group */
+	s_wb16(s, audio ? 0x0100 : 0);
+	s_wb16(s, 0);
+	write_matrix(s);
+	s_wb32(s, width << 16);
+	s_wb32(s, height << 16);
+	box_end(s, pos);
+}
+
+static void write_mdhd(struct serializer *s, uint32_t timescale)
+{
+	size_t pos = full_box_start(s, "mdhd", 0, 0);
+	s_wb32(s, 0);
+	s_wb32(s, 0);
+	s_wb32(s, timescale);
+	s_wb32(s, 0);
+	s_wb16(s, 0x55C4);         /* 'und' */
+	s_wb16(s, 0);
+	box_end(s, pos);
+}
+
+static void write_hdlr(struct serializer *s, const char *type,
+		const char *name)
+{
+	size_t pos = full_box_start(s, "hdlr", 0, 0);
+	s_wb32(s, 0);
+	s_write(s, type, 4);
+	s_zero(s, 12);
+	s_write(s, name, strlen(name) + 1);
+	box_end(s, pos);
+}
+
+static void write_dinf(struct serializer *s)
+{
+	size_t dinf = box_start(s, "dinf");
+	size_t dref = full_box_start(s, "dref", 0, 0);
+	s_wb32(s, 1);
+
+	/* self contained */
+	size_t url = full_box_start(s, "url ", 0, 1);
+	box_end(s, url);
+
+	box_end(s, dref);
+	box_end(s, dinf);
+}
+
+static void write_empty_sample_tables(struct serializer *s)
+{
+	size_t pos;
+
+	pos = full_box_start(s, "stts", 0, 0);
+	s_wb32(s, 0);
+	box_end(s, pos);
+
+	pos = full_box_start(s, "stsc", 0, 0);
+	s_wb32(s, 0);
+	box_end(s, pos);
+
+	pos = full_box_start(s, "stsz", 0, 0);
+	s_wb32(s, 0);
+	s_wb32(s, 0);
+	box_end(s, pos);
+
+	pos = full_box_start(s, "stco", 0, 0);
+	s_wb32(s, 0);
+	box_end(s, pos);
+}
+
+static bool write_avc1(struct serializer *s, obs_encoder_t *vencoder)
+{
+	uint32_t width  = obs_encoder_get_width(vencoder);
+	uint32_t height = obs_encoder_get_height(vencoder);
+	uint8_t  *extra_data;
+	size_t   extra_size;
+	uint8_t  *avcc;
+	size_t   avcc_size;
+	size_t   pos;
+
+	if (!obs_encoder_get_extra_data(vencoder, &extra_data, &extra_size))
+		return false;
+
+	avcc_size = obs_parse_avc_header(&avcc, extra_data, extra_size);
+	if (!avcc_size)
+		return false;
+
+	pos = box_start(s, "avc1");
+	s_zero(s, 6);
+	s_wb16(s, 1);              /* data reference index */
+	s_zero(s, 16);
+	s_wb16(s, (uint16_t)width);
+	s_wb16(s, (uint16_t)height);
+	s_wb32(s, 0x00480000);     /* 72 dpi */
+	s_wb32(s, 0x00480000);
+	s_wb32(s, 0);
+	s_wb16(s, 1);              /* frame count */
+	s_zero(s, 32);             /* compressor name */
+	s_wb16(s, 0x0018);         /* depth */
+	s_wb16(s, 0xFFFF);
+
+	size_t avcc_pos = box_start(s, "avcC");
+	s_write(s, avcc, avcc_size);
+	box_end(s, avcc_pos);
+
+	box_end(s, pos);
+	bfree(avcc);
+	return true;
+}
+
+static bool write_mp4a(struct serializer *s, obs_encoder_t *aencoder)
+{
+	audio_t  *audio       = obs_encoder_audio(aencoder);
+	uint32_t sample_rate  = obs_encoder_get_sample_rate(aencoder);
+	uint32_t channels     = (uint32_t)audio_output_get_channels(audio);
+	uint32_t bitrate      = encoder_bitrate(aencoder);
+	uint8_t  *asc;
+	size_t   asc_size;
+	size_t   pos;
+
+	if (!obs_encoder_get_extra_data(aencoder, &asc, &asc_size))
+		return false;
+
+	pos = box_start(s, "mp4a");
+	s_zero(s, 6);
+	s_wb16(s, 1);              /* data reference index */
+	s_zero(s, 8);
+	s_wb16(s, (uint16_t)channels);
+	s_wb16(s, 16);             /* sample size */
+	s_wb16(s, 0);
+	s_wb16(s, 0);
+	s_wb32(s, sample_rate << 16);
+
+	size_t esds = full_box_start(s, "esds", 0, 0);
+
+	/* ES descriptor: ES_ID, flags, then the decoder config and the SL
+	 * config descriptors */
+	write_descriptor_header(s, 0x03, 3 + (5 + 13 + 5 + (uint32_t)asc_size) +
+			(5 + 1));
+	s_wb16(s, 0);
+	s_w8(s, 0);
+
+	/* decoder config: MPEG-4 audio, audio stream */
+	write_descriptor_header(s, 0x04, 13 + 5 + (uint32_t)asc_size);
+	s_w8(s, 0x40);
+	s_w8(s, 0x15);
+	s_wb24(s, 0);              /* buffer size */
+	s_wb32(s, bitrate);        /* max bitrate */
+	s_wb32(s, bitrate);        /* average bitrate */
+
+	write_descriptor_header(s, 0x05, (uint32_t)asc_size);
+	s_write(s, asc, asc_size);
+
+	write_descriptor_header(s, 0x06, 1);
+	s_w8(s, 0x02);
+
+	box_end(s, esds);
+	box_end(s, pos);
+	return true;
+}
+
+static bool write_trak(struct serializer *s, obs_encoder_t *encoder,
+		bool audio)
+{
+	uint32_t track_id  = audio ? MP4_AUDIO_TRACK_ID : MP4_VIDEO_TRACK_ID;
+	uint32_t timescale = audio ? obs_encoder_get_sample_rate(encoder) :
+		MP4_VIDEO_TIMESCALE;
+	bool     success;
+	size_t   trak, mdia, minf, stbl, stsd, pos;
+
+	trak = box_start(s, "trak");
+	write_tkhd(s, track_id, audio,
+			audio ? 0 : obs_encoder_get_width(encoder),
+			audio ? 0 : obs_encoder_get_height(encoder));
+
+	mdia = box_start(s, "mdia");
+	write_mdhd(s, timescale);
+	write_hdlr(s, audio ? "soun" : "vide",
+			audio ? "SoundHandler" : "VideoHandler");
+
+	minf = box_start(s, "minf");
+	if (audio) {
+		pos = full_box_start(s, "smhd", 0, 0);
+		s_wb16(s, 0);
+		s_wb16(s, 0);
+		box_end(s, pos);
+	} else {
+		pos = full_box_start(s, "vmhd", 0, 1);
+		s_zero(s, 8);
+		box_end(s, pos);
+	}
+	write_dinf(s);
+
+	stbl = box_start(s, "stbl");
+	stsd = full_box_start(s, "stsd", 0, 0);
+	s_wb32(s, 1);
+	success = audio ? write_mp4a(s, encoder) : write_avc1(s, encoder);
+	box_end(s, stsd);
+	write_empty_sample_tables(s);
+	box_end(s, stbl);
+
+	box_end(s, minf);
+	box_end(s, mdia);
+	box_end(s, trak);
+	return success;
+}
+
+static void write_trex(struct serializer *s, uint32_t track_id)
+{
+	size_t pos = full_box_start(s, "trex", 0, 0);
+	s_wb32(s, track_id);
+	s_wb32(s, 1);              /* sample description index */
+	s_wb32(s, 0);              /* default duration */
+	s_wb32(s, 0);              /* default size */
+	s_wb32(s, 0);              /* default flags */
+	box_end(s, pos);
+}
+
+bool mp4_init_segment(obs_output_t *context, uint8_t **output, size_t *size)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(context);
+	obs_encoder_t *aencoder = obs_output_get_audio_encoder(context, 0);
+	struct array_output_data data;
+	struct serializer s;
+	bool success = true;
+	size_t moov, mvex;
+
+	if (!vencoder || !aencoder)
+		return false;
+
+	array_output_serializer_init(&s, &data);
+
+	write_ftyp(&s);
+
+	moov = box_start(&s, "moov");
+	write_mvhd(&s);
+	success &= write_trak(&s, vencoder, false);
+	success &= write_trak(&s, aencoder, true);
+
+	mvex = box_start(&s, "mvex");
+	write_trex(&s, MP4_VIDEO_TRACK_ID);
+	write_trex(&s, MP4_AUDIO_TRACK_ID);
+	box_end(&s, mvex);
+
+	box_end(&s, moov);
+
+	if (!success) {
+		array_output_serializer_free(&data);
+		return false;
+	}
+
+	*output = data.bytes.array;
+	*size   = data.bytes.num;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static size_t write_traf(struct serializer *s,
+		const struct mp4_fragment_track *track)
+{
+	bool     video = track->cts_offsets != NULL;
+	uint32_t flags = TRUN_DATA_OFFSET | TRUN_DURATION | TRUN_SIZE;
+	size_t   traf, pos, data_offset_pos;
+
+	if (video)
+		flags |= TRUN_FLAGS | TRUN_CTS_OFFSET;
+
+	traf = box_start(s, "traf");
+
+	pos = full_box_start(s, "tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF);
+	s_wb32(s, track->track_id);
+	box_end(s, pos);
+
+	pos = full_box_start(s, "tfdt", 1, 0);
+	s_wb64(s, track->base_time);
+	box_end(s, pos);
+
+	/* version 1 for signed composition time offsets */
+	pos = full_box_start(s, "trun", 1, flags);
+	s_wb32(s, (uint32_t)track->num);
+	data_offset_pos = (size_t)serializer_get_pos(s);
+	s_wb32(s, 0);
+
+	for (size_t i = 0; i < track->num; i++) {
+		const struct encoder_packet *packet = &track->packets[i];
+
+		s_wb32(s, track->durations[i]);
+		s_wb32(s, (uint32_t)packet->size);
+
+		if (video) {
+			s_wb32(s, packet->keyframe ?
+					SAMPLE_FLAGS_SYNC :
+					SAMPLE_FLAGS_NON_SYNC);
+			s_wb32(s, (uint32_t)track->cts_offsets[i]);
+		}
+	}
+
+	box_end(s, pos);
+	box_end(s, traf);
+	return data_offset_pos;
+}
+
+void mp4_fragment_header(uint32_t sequence,
+		const struct mp4_fragment_track *tracks, size_t num_tracks,
+		uint8_t **output, size_t *size)
+{
+	struct array_output_data data;
+	struct serializer s;
+	size_t data_offset_pos[2];
+	size_t moof, pos, moof_size;
+	size_t mdat_size = 8;
+
+	assert(num_tracks <= 2);
+
+	array_output_serializer_init(&s, &data);
+
+	moof = box_start(&s, "moof");
+
+	pos = full_box_start(&s, "mfhd", 0, 0);
+	s_wb32(&s, sequence);
+	box_end(&s, pos);
+
+	for (size_t i = 0; i < num_tracks; i++)
+		data_offset_pos[i] = write_traf(&s, &tracks[i]);
+
+	box_end(&s, moof);
+	moof_size = data.bytes.num - moof;
+
+	/* sample data offsets are relative to the start of the moof box */
+	for (size_t i = 0; i < num_tracks; i++) {
+		write_be32_at(&s, data_offset_pos[i],
+				(uint32_t)(moof_size + mdat_size));
+
+		for (size_t j = 0; j < tracks[i].num; j++)
+			mdat_size += tracks[i].packets[j].size;
+	}
+
+	s_wb32(&s, (uint32_t)mdat_size);
+	s_write(&s, "mdat", 4);
+
+	*output = data.bytes.array;
+	*size   = data.bytes.num;
+}
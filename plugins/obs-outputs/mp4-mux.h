@@ -0,0 +1,49 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+
+/* fragmented MP4 (CMAF) muxing, currently hard-coded to h264 and aac just like
+ * the FLV muxer */
+
+#define MP4_VIDEO_TRACK_ID  1
+#define MP4_AUDIO_TRACK_ID  2
+#define MP4_VIDEO_TIMESCALE 90000
+
+struct mp4_fragment_track {
+	uint32_t              track_id;
+	uint64_t              base_time;
+
+	/* video packets must already be converted to length prefixed NALs */
+	struct encoder_packet *packets;
+	const uint32_t        *durations;
+	const int32_t         *cts_offsets;
+	size_t                num;
+};
+
+/* builds the initialization segment (ftyp + moov) from the encoders of the
+ * output */
+extern bool mp4_init_segment(obs_output_t *context, uint8_t **output,
+		size_t *size);
+
+/* builds the moof box and mdat header of a fragment.  the packet data of each
+ * track must be written right after it, in the order of the tracks given */
+extern void mp4_fragment_header(uint32_t sequence,
+		const struct mp4_fragment_track *tracks, size_t num_tracks,
+		uint8_t **output, size_t *size);
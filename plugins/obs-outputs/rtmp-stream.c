@@ -447,8 +447,15 @@ static void *send_thread(void *data)
 
 	os_set_thread_name("rtmp-stream: send_thread");
 
+	const char *send_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				"rtmp_stream_send_thread(%s)",
+				obs_output_get_name(stream->output));
+	profile_register_root(send_thread_name, 0);
+
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
+		bool sent;
 
 		if (stopping(stream) && stream->stop_ts == 0) {
 			break;
@@ -464,14 +471,17 @@ static void *send_thread(void *data)
 			}
 		}
 
-		if (!stream->sent_headers) {
-			if (!send_headers(stream)) {
-				os_atomic_set_bool(&stream->disconnected, true);
-				break;
-			}
-		}
+		profile_start(send_thread_name);
+		if (!stream->sent_headers && !send_headers(stream))
+			sent = false;
+		else
+			sent = send_packet(stream, &packet, false,
+					packet.track_idx) >= 0;
+		profile_end(send_thread_name);
+
+		profile_reenable_thread();
 
-		if (send_packet(stream, &packet, false, packet.track_idx) < 0) {
+		if (!sent) {
 			os_atomic_set_bool(&stream->disconnected, true);
 			break;
 		}
@@ -1100,7 +1110,7 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 			stream->got_first_video = true;
 		}
 
-		obs_parse_avc_packet(&new_packet, packet);
+		obs_parse_avc_packet_ref(&new_packet, packet);
 	} else {
 		obs_encoder_packet_ref(&new_packet, packet);
 	}
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <util/platform.h>
+#include <media-io/audio-loudness.h>
+
+/*
+ * Checks the loudness meter against the stereo test cases 1-5 of EBU Tech
+ * 3341, then measures how long metering takes for 8 tracks of 5.1 audio.
+ */
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#define SAMPLE_RATE  48000
+#define PACKET_SIZE  1024
+#define MAX_CHANNELS 6
+#define TRACKS       8
+#define BENCH_SECS   60
+#define BENCH_RUNS   5
+
+static float planes[MAX_CHANNELS][PACKET_SIZE];
+
+static void get_planes(const float *ptrs[MAX_CHANNELS])
+{
+	for (size_t i = 0; i < MAX_CHANNELS; i++)
+		ptrs[i] = planes[i];
+}
+
+/* feeds a 1 kHz sine to every channel */
+static void process_sine(audio_loudness_t *meter, double *phase, double dbfs,
+		double secs)
+{
+	double amp = pow(10.0, dbfs / 20.0);
+	size_t frames = (size_t)(secs * SAMPLE_RATE + 0.5);
+	const float *ptrs[MAX_CHANNELS];
+
+	get_planes(ptrs);
+
+	while (frames) {
+		size_t count = frames < PACKET_SIZE ? frames : PACKET_SIZE;
+
+		for (size_t i = 0; i < count; i++) {
+			float val = (float)(amp * sin(*phase));
+			*phase += 2.0 * M_PI * 1000.0 / SAMPLE_RATE;
+
+			for (size_t ch = 0; ch < MAX_CHANNELS; ch++)
+				planes[ch][i] = val;
+		}
+
+		audio_loudness_process(meter, ptrs, count);
+		frames -= count;
+	}
+}
+
+struct test_segment {
+	double dbfs;
+	double secs;
+};
+
+struct test_case {
+	const char *name;
+	double expected;
+	size_t num_segments;
+	struct test_segment segments[5];
+};
+
+static const struct test_case test_cases[] = {
+	{"Tech 3341 case 1", -23.0, 1, {{-23.0, 20.0}}},
+	{"Tech 3341 case 2", -33.0, 1, {{-33.0, 20.0}}},
+	{"Tech 3341 case 3", -23.0, 3,
+		{{-36.0, 10.0}, {-23.0, 60.0}, {-36.0, 10.0}}},
+	{"Tech 3341 case 4", -23.0, 5,
+		{{-72.0, 10.0}, {-36.0, 10.0}, {-23.0, 60.0}, {-36.0, 10.0},
+		 {-72.0, 10.0}}},
+	{"Tech 3341 case 5", -23.0, 3,
+		{{-26.0, 20.0}, {-20.0, 20.1}, {-26.0, 20.0}}},
+};
+
+#define NUM_TEST_CASES (sizeof(test_cases) / sizeof(test_cases[0]))
+
+/* Tech 3341 allows +/- 0.1 LU for the integrated loudness */
+#define TOLERANCE 0.1
+
+static bool run_test_cases(void)
+{
+	audio_loudness_t *meter =
+		audio_loudness_create(SAMPLE_RATE, SPEAKERS_STEREO);
+	bool success = true;
+
+	for (size_t i = 0; i < NUM_TEST_CASES; i++) {
+		const struct test_case *test = &test_cases[i];
+		double phase = 0.0;
+		double integrated;
+		bool pass;
+
+		audio_loudness_reset(meter);
+
+		for (size_t j = 0; j < test->num_segments; j++)
+			process_sine(meter, &phase, test->segments[j].dbfs,
+					test->segments[j].secs);
+
+		integrated = audio_loudness_integrated(meter);
+		pass = fabs(integrated - test->expected) <= TOLERANCE;
+		if (!pass)
+			success = false;
+
+		printf("%s: %.2f LUFS, expected %.1f LUFS (%s)\n",
+				test->name, integrated, test->expected,
+				pass ? "pass" : "FAIL");
+	}
+
+	audio_loudness_destroy(meter);
+	return success;
+}
+
+static void run_benchmark(void)
+{
+	audio_loudness_t *meters[TRACKS];
+	const float *ptrs[MAX_CHANNELS];
+	size_t packets = BENCH_SECS * SAMPLE_RATE / PACKET_SIZE;
+	double best_ms = 0.0;
+
+	get_planes(ptrs);
+
+	for (size_t ch = 0; ch < MAX_CHANNELS; ch++) {
+		for (size_t i = 0; i < PACKET_SIZE; i++)
+			planes[ch][i] = (float)sin(i * 0.01 * (ch + 1)) * 0.3f;
+	}
+
+	for (size_t i = 0; i < TRACKS; i++)
+		meters[i] = audio_loudness_create(SAMPLE_RATE,
+				SPEAKERS_5POINT1);
+
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		uint64_t start = os_gettime_ns();
+		double ms;
+
+		for (size_t i = 0; i < packets; i++) {
+			for (size_t track = 0; track < TRACKS; track++)
+				audio_loudness_process(meters[track], ptrs,
+						PACKET_SIZE);
+		}
+
+		ms = (double)(os_gettime_ns() - start) / 1000000.0;
+		if (run == 0 || ms < best_ms)
+			best_ms = ms;
+	}
+
+	for (size_t i = 0; i < TRACKS; i++)
+		audio_loudness_destroy(meters[i]);
+
+	printf("%d tracks x %d channels, %d s of audio: %.1f ms, best of %d "
+	       "(%.2f%% of one core)\n",
+			TRACKS, MAX_CHANNELS, BENCH_SECS, best_ms, BENCH_RUNS,
+			best_ms / (BENCH_SECS * 10.0));
+}
+
+int main(void)
+{
+	bool success = run_test_cases();
+	run_benchmark();
+	return success ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/platform.h>
+#include <util/dstr.h>
+#include <util/bmem.h>
+#include <graphics/graphics.h>
+
+/*
+ * Measures how long loading effects takes with an empty effect cache (cold
+ * start) and again once the cache has been filled by that load (warm start).
+ * Any graphics module can be used; libobs-software works without a display:
+ *
+ *   effect-cache-bench libobs-software /tmp/effect-cache default.effect
+ */
+
+#define RUNS 5
+
+static void clear_cache_dir(const char *dir)
+{
+	struct os_dirent *ent;
+	struct dstr path = {0};
+	os_dir_t *d = os_opendir(dir);
+
+	if (!d)
+		return;
+
+	while ((ent = os_readdir(d)) != NULL) {
+		if (ent->directory)
+			continue;
+
+		dstr_printf(&path, "%s/%s", dir, ent->d_name);
+		os_unlink(path.array);
+	}
+
+	os_closedir(d);
+	dstr_free(&path);
+}
+
+/* loaded effects stay in memory until the graphics context is destroyed, so
+ * every load gets a new context, like a fresh start would.  returns the time
+ * taken to load all effects, or 0 on failure */
+static uint64_t load_effects(const char *module, char *files[], int num_files)
+{
+	graphics_t *graphics = NULL;
+	uint64_t start;
+	uint64_t elapsed;
+	bool success = true;
+
+	if (gs_create(&graphics, module, 0) != GS_SUCCESS) {
+		fprintf(stderr, "Failed to create graphics with '%s'\n",
+				module);
+		return 0;
+	}
+
+	gs_enter_context(graphics);
+	start = os_gettime_ns();
+
+	for (int i = 0; i < num_files; i++) {
+		char *errors = NULL;
+
+		if (!gs_effect_create_from_file(files[i], &errors)) {
+			fprintf(stderr, "Failed to load '%s': %s\n", files[i],
+					errors ? errors : "unknown error");
+			success = false;
+		}
+
+		bfree(errors);
+	}
+
+	elapsed = os_gettime_ns() - start;
+	gs_leave_context();
+	gs_destroy(graphics);
+
+	return success ? elapsed : 0;
+}
+
+static inline double to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *module;
+	const char *cache_dir;
+	uint64_t best_cold = 0;
+	uint64_t best_warm = 0;
+	char **files;
+	int num_files;
+	int ret = 1;
+
+	if (argc < 4) {
+		printf("usage: effect-cache-bench <graphics module> "
+		       "<cache directory> <effect file> [effect file...]\n\n"
+		       "Loads the effects with an empty and with a filled "
+		       "effect cache.  Files in the\ncache directory are "
+		       "deleted.\n");
+		return 1;
+	}
+
+	module = argv[1];
+	cache_dir = argv[2];
+	files = argv + 3;
+	num_files = argc - 3;
+
+	gs_effect_cache_set_dir(cache_dir);
+
+	for (int run = 0; run < RUNS; run++) {
+		uint64_t cold;
+		uint64_t warm;
+
+		clear_cache_dir(cache_dir);
+		cold = load_effects(module, files, num_files);
+		warm = load_effects(module, files, num_files);
+
+		if (!cold || !warm)
+			goto fail;
+
+		if (run == 0 || cold < best_cold)
+			best_cold = cold;
+		if (run == 0 || warm < best_warm)
+			best_warm = warm;
+	}
+
+	printf("%d effect(s) with %s, best of %d:\n", num_files, module,
+			RUNS);
+	printf("  cold (empty cache):  %8.2f ms\n", to_ms(best_cold));
+	printf("  warm (filled cache): %8.2f ms\n", to_ms(best_warm));
+	ret = 0;
+
+fail:
+	clear_cache_dir(cache_dir);
+	gs_effect_cache_set_dir(NULL);
+	return ret;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <util/platform.h>
+#include <util/bmem.h>
+#include <obs-data.h>
+
+/*
+ * Converts obs_data files between JSON and the binary format, e.g. to turn a
+ * scene collection into binary and back.  The input format is detected from
+ * the file contents, the output is always the other format.  Load and save
+ * times are printed so the tool can also be used to compare the formats.
+ */
+
+static bool is_binary_file(const char *file)
+{
+	FILE *f = os_fopen(file, "rb");
+	char magic[4] = {0};
+
+	if (!f)
+		return false;
+
+	fread(magic, 1, sizeof(magic), f);
+	fclose(f);
+	return memcmp(magic, "OBSD", 4) == 0;
+}
+
+static inline double ms_since(uint64_t start)
+{
+	return (double)(os_gettime_ns() - start) / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+	obs_data_t *data;
+	uint64_t start;
+	bool binary;
+	bool success;
+
+	if (argc != 3) {
+		printf("usage: obs-data-convert <input file> <output file>\n\n"
+		       "Converts JSON to binary, or binary to JSON\n");
+		return 1;
+	}
+
+	binary = is_binary_file(argv[1]);
+
+	start = os_gettime_ns();
+	data = binary ?
+		obs_data_create_from_binary_file(argv[1]) :
+		obs_data_create_from_json_file(argv[1]);
+	if (!data) {
+		fprintf(stderr, "Failed to load '%s'\n", argv[1]);
+		return 1;
+	}
+
+	printf("Loaded %s in %.2f ms\n", binary ? "binary" : "JSON",
+			ms_since(start));
+
+	start = os_gettime_ns();
+	success = binary ?
+		obs_data_save_json(data, argv[2]) :
+		obs_data_save_binary(data, argv[2]);
+	obs_data_release(data);
+
+	if (!success) {
+		fprintf(stderr, "Failed to save '%s'\n", argv[2]);
+		return 1;
+	}
+
+	printf("Saved %s in %.2f ms\n", binary ? "JSON" : "binary",
+			ms_since(start));
+	return 0;
+}
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/platform.h>
+#include <util/bmem.h>
+#include <obs-data.h>
+
+/*
+ * Generates scene collection-like JSON files of a given size, and measures
+ * how long obs_data takes to parse and write them, along with the peak heap
+ * used by each step.  Collections of 1, 10 and 50 MB are the usual sizes
+ * to compare:
+ *
+ *   obs-data-json-bench generate c1.json 1
+ *   obs-data-json-bench c1.json
+ */
+
+/* ------------------------------------------------------------------------- */
+/* heap tracking, every bmem allocation is prefixed with its size */
+
+#define HEADER_SIZE 16
+
+static size_t heap_cur = 0;
+static size_t heap_peak = 0;
+
+static inline void heap_add(size_t size)
+{
+	heap_cur += size;
+	if (heap_cur > heap_peak)
+		heap_peak = heap_cur;
+}
+
+static void *tracking_malloc(size_t size)
+{
+	char *ptr = malloc(size + HEADER_SIZE);
+	if (!ptr)
+		return NULL;
+
+	*(size_t*)ptr = size;
+	heap_add(size);
+	return ptr + HEADER_SIZE;
+}
+
+static void *tracking_realloc(void *ptr, size_t size)
+{
+	char *new_ptr;
+	size_t old_size;
+
+	if (!ptr)
+		return tracking_malloc(size);
+
+	new_ptr = (char*)ptr - HEADER_SIZE;
+	old_size = *(size_t*)new_ptr;
+
+	new_ptr = realloc(new_ptr, size + HEADER_SIZE);
+	if (!new_ptr)
+		return NULL;
+
+	*(size_t*)new_ptr = size;
+	heap_cur -= old_size;
+	heap_add(size);
+	return new_ptr + HEADER_SIZE;
+}
+
+static void tracking_free(void *ptr)
+{
+	char *base;
+
+	if (!ptr)
+		return;
+
+	base = (char*)ptr - HEADER_SIZE;
+	heap_cur -= *(size_t*)base;
+	free(base);
+}
+
+static struct base_allocator tracking_allocator = {
+	tracking_malloc, tracking_realloc, tracking_free
+};
+
+/* returns the peak heap since the last call, relative to the heap in use at
+ * the time of that call */
+static size_t reset_heap_peak(size_t *base)
+{
+	size_t peak = heap_peak - *base;
+
+	*base = heap_cur;
+	heap_peak = heap_cur;
+	return peak;
+}
+
+/* ------------------------------------------------------------------------- */
+/* generator */
+
+/* approximate size of one generated source once written */
+#define SOURCE_JSON_SIZE 1366
+
+static void add_filters(obs_data_t *source)
+{
+	obs_data_array_t *filters = obs_data_array_create();
+
+	for (int i = 0; i < 3; i++) {
+		obs_data_t *filter = obs_data_create();
+		obs_data_t *settings = obs_data_create();
+
+		obs_data_set_string(filter, "name", "Color Correction");
+		obs_data_set_string(filter, "id", "color_filter");
+		obs_data_set_double(settings, "gamma", 0.25 * i);
+		obs_data_set_int(settings, "color", 0xFFFFFFFFLL - i);
+		obs_data_set_obj(filter, "settings", settings);
+		obs_data_array_push_back(filters, filter);
+
+		obs_data_release(settings);
+		obs_data_release(filter);
+	}
+
+	obs_data_set_array(source, "filters", filters);
+	obs_data_array_release(filters);
+}
+
+static obs_data_t *create_source(int idx)
+{
+	obs_data_t *source = obs_data_create();
+	obs_data_t *settings = obs_data_create();
+	obs_data_t *hotkeys = obs_data_create();
+	obs_data_array_t *sync = obs_data_array_create();
+	char name[64];
+
+	/* names with escapes and multi-byte characters, as users do */
+	snprintf(name, sizeof(name), "Source \"%d\" \xc3\xa9\xe2\x82\xac\t/",
+			idx);
+
+	obs_data_set_string(source, "name", name);
+	obs_data_set_string(source, "id", "ffmpeg_source");
+	obs_data_set_int(source, "flags", idx * 7919LL);
+	obs_data_set_double(source, "volume", 1.0 / (idx + 3));
+	obs_data_set_double(source, "balance", 0.5);
+	obs_data_set_bool(source, "muted", (idx & 1) != 0);
+
+	obs_data_set_string(settings, "local_file",
+			"C:\\Users\\user\\Videos\\clip.mp4");
+	obs_data_set_int(settings, "width", 1920);
+	obs_data_set_int(settings, "height", 1080);
+	obs_data_set_double(settings, "speed", 1e-7 * idx);
+	obs_data_set_bool(settings, "looping", true);
+	obs_data_set_obj(source, "settings", settings);
+
+	obs_data_set_obj(source, "hotkeys", hotkeys);
+	obs_data_set_array(source, "sync", sync);
+	add_filters(source);
+
+	obs_data_array_release(sync);
+	obs_data_release(hotkeys);
+	obs_data_release(settings);
+	return source;
+}
+
+static bool generate(const char *file, int mb)
+{
+	obs_data_t *collection = obs_data_create();
+	obs_data_array_t *sources = obs_data_array_create();
+	size_t count = (size_t)mb * 1024 * 1024 / SOURCE_JSON_SIZE;
+	bool success;
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *source = create_source((int)i);
+		obs_data_array_push_back(sources, source);
+		obs_data_release(source);
+	}
+
+	obs_data_set_string(collection, "name", "Benchmark");
+	obs_data_set_string(collection, "current_scene", "Scene");
+	obs_data_set_array(collection, "sources", sources);
+
+	success = obs_data_save_json(collection, file);
+
+	obs_data_array_release(sources);
+	obs_data_release(collection);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+/* benchmark */
+
+static inline double ms_since(uint64_t start)
+{
+	return (double)(os_gettime_ns() - start) / 1000000.0;
+}
+
+static inline double to_mb(size_t size)
+{
+	return (double)size / (1024.0 * 1024.0);
+}
+
+static bool benchmark(const char *file)
+{
+	char *json = os_quick_read_utf8_file(file);
+	obs_data_t *data;
+	uint64_t start;
+	size_t base = 0;
+	size_t peak;
+	double parse_ms;
+	double write_ms;
+
+	if (!json) {
+		fprintf(stderr, "Failed to read '%s'\n", file);
+		return false;
+	}
+
+	reset_heap_peak(&base);
+
+	start = os_gettime_ns();
+	data = obs_data_create_from_json(json);
+	parse_ms = ms_since(start);
+	peak = reset_heap_peak(&base);
+
+	if (!data) {
+		fprintf(stderr, "Failed to parse '%s'\n", file);
+		bfree(json);
+		return false;
+	}
+
+	printf("%s (%.1f MB)\n", file, to_mb(strlen(json)));
+	printf("  parse: %8.1f ms, peak heap +%.1f MB\n", parse_ms,
+			to_mb(peak));
+
+	start = os_gettime_ns();
+	obs_data_get_json(data);
+	write_ms = ms_since(start);
+	peak = reset_heap_peak(&base);
+
+	printf("  write: %8.1f ms, peak heap +%.1f MB\n", write_ms,
+			to_mb(peak));
+
+	obs_data_release(data);
+	bfree(json);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	bool success = true;
+
+	if (argc >= 4 && strcmp(argv[1], "generate") == 0) {
+		int mb = atoi(argv[3]);
+
+		if (mb <= 0 || !generate(argv[2], mb)) {
+			fprintf(stderr, "Failed to generate '%s'\n", argv[2]);
+			return 1;
+		}
+		return 0;
+	}
+
+	if (argc < 2) {
+		printf("usage: obs-data-json-bench generate <file> <size in MB>\n"
+		       "       obs-data-json-bench <file> [file...]\n\n"
+		       "Generates a scene collection-like JSON file, or "
+		       "measures parsing and writing\nJSON files\n");
+		return 1;
+	}
+
+	/* must be set before anything is allocated with bmem */
+	base_set_allocator(&tracking_allocator);
+
+	for (int i = 1; i < argc; i++) {
+		if (!benchmark(argv[i]))
+			success = false;
+	}
+
+	return success ? 0 : 1;
+}
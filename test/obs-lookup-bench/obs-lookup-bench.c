@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/platform.h>
+#include <obs.h>
+
+/*
+ * Compares looking up sources by name, and source types by id, through the
+ * hash indices of libobs against a linear walk of the same lists, which is
+ * how the lookups used to work.  The default of 2000 sources is the size of
+ * a large scene collection.
+ */
+
+#define NUM_TYPES 100
+#define MAX_NAME  32
+#define RUNS      5
+
+static char type_ids[NUM_TYPES][MAX_NAME];
+static int source_data = 0;
+
+static const char *bench_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Lookup Benchmark";
+}
+
+static void *bench_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return &source_data;
+}
+
+static void bench_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static void register_types(void)
+{
+	struct obs_source_info info = {
+		.type     = OBS_SOURCE_TYPE_INPUT,
+		.get_name = bench_get_name,
+		.create   = bench_create,
+		.destroy  = bench_destroy
+	};
+
+	for (int i = 0; i < NUM_TYPES; i++) {
+		snprintf(type_ids[i], MAX_NAME, "lookup_bench_source_%d", i);
+		info.id = type_ids[i];
+		obs_register_source(&info);
+	}
+}
+
+static inline void source_name(char *name, int idx)
+{
+	snprintf(name, MAX_NAME, "Source %d", idx);
+}
+
+/* ------------------------------------------------------------------------- */
+/* linear lookups, as before the indices */
+
+struct linear_find {
+	const char   *name;
+	obs_source_t *source;
+};
+
+static bool linear_find_source(void *param, obs_source_t *source)
+{
+	struct linear_find *find = param;
+
+	if (strcmp(obs_source_get_name(source), find->name) == 0) {
+		find->source = obs_source_get_ref(source);
+		return false;
+	}
+
+	return true;
+}
+
+static obs_source_t *linear_get_source_by_name(const char *name)
+{
+	struct linear_find find = {name, NULL};
+	obs_enum_sources(linear_find_source, &find);
+	return find.source;
+}
+
+static bool linear_find_type(const char *id)
+{
+	const char *type_id;
+
+	for (size_t i = 0; obs_enum_input_types(i, &type_id); i++) {
+		if (strcmp(type_id, id) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline double ns_per_op(uint64_t ns, uint64_t ops)
+{
+	return (double)ns / (double)ops;
+}
+
+static void bench_names(int num_sources)
+{
+	uint64_t best_hashed = 0;
+	uint64_t best_linear = 0;
+	char name[MAX_NAME];
+
+	for (int run = 0; run < RUNS; run++) {
+		uint64_t start = os_gettime_ns();
+		uint64_t hashed;
+		uint64_t linear;
+
+		for (int i = 0; i < num_sources; i++) {
+			source_name(name, i);
+			obs_source_release(obs_get_source_by_name(name));
+		}
+
+		hashed = os_gettime_ns() - start;
+		start = os_gettime_ns();
+
+		for (int i = 0; i < num_sources; i++) {
+			source_name(name, i);
+			obs_source_release(linear_get_source_by_name(name));
+		}
+
+		linear = os_gettime_ns() - start;
+
+		if (run == 0 || hashed < best_hashed)
+			best_hashed = hashed;
+		if (run == 0 || linear < best_linear)
+			best_linear = linear;
+	}
+
+	printf("source by name, %d sources:\n", num_sources);
+	printf("  hashed: %10.1f ns per lookup\n",
+			ns_per_op(best_hashed, num_sources));
+	printf("  linear: %10.1f ns per lookup\n",
+			ns_per_op(best_linear, num_sources));
+}
+
+static void bench_types(void)
+{
+	uint64_t best_hashed = 0;
+	uint64_t best_linear = 0;
+
+	for (int run = 0; run < RUNS; run++) {
+		uint64_t start = os_gettime_ns();
+		uint64_t hashed;
+		uint64_t linear;
+
+		for (int i = 0; i < NUM_TYPES; i++)
+			obs_source_get_display_name(type_ids[i]);
+
+		hashed = os_gettime_ns() - start;
+		start = os_gettime_ns();
+
+		for (int i = 0; i < NUM_TYPES; i++)
+			linear_find_type(type_ids[i]);
+
+		linear = os_gettime_ns() - start;
+
+		if (run == 0 || hashed < best_hashed)
+			best_hashed = hashed;
+		if (run == 0 || linear < best_linear)
+			best_linear = linear;
+	}
+
+	printf("source type by id, %d types:\n", NUM_TYPES);
+	printf("  hashed: %10.1f ns per lookup\n",
+			ns_per_op(best_hashed, NUM_TYPES));
+	printf("  linear: %10.1f ns per lookup\n",
+			ns_per_op(best_linear, NUM_TYPES));
+}
+
+int main(int argc, char *argv[])
+{
+	int num_sources = argc > 1 ? atoi(argv[1]) : 2000;
+	obs_source_t **sources;
+	char name[MAX_NAME];
+
+	if (num_sources <= 0) {
+		printf("usage: obs-lookup-bench [sources]\n");
+		return 1;
+	}
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Failed to start libobs\n");
+		return 1;
+	}
+
+	register_types();
+
+	sources = bzalloc(sizeof(obs_source_t*) * num_sources);
+	for (int i = 0; i < num_sources; i++) {
+		source_name(name, i);
+		sources[i] = obs_source_create(type_ids[i % NUM_TYPES], name,
+				NULL, NULL);
+	}
+
+	bench_names(num_sources);
+	bench_types();
+
+	for (int i = 0; i < num_sources; i++)
+		obs_source_release(sources[i]);
+	bfree(sources);
+
+	obs_shutdown();
+	return 0;
+}
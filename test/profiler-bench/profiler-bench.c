@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+#include <util/bmem.h>
+
+/*
+ * Measures the cost of profile_start/profile_end.  Each root contains a
+ * number of items with two nested regions, roughly the shape of a frame of
+ * the graphics thread.  The profiler is built with TRACK_OVERHEAD, so the
+ * results end with the overhead measured inside the profiler itself, next to
+ * the wall clock time and heap allocations per root measured here.
+ */
+
+/* counts every malloc and realloc made through bmem, on any thread, which
+ * includes the merging done by the aggregator thread */
+static volatile long heap_allocs = 0;
+
+static void *counting_malloc(size_t size)
+{
+	os_atomic_inc_long(&heap_allocs);
+	return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size)
+{
+	os_atomic_inc_long(&heap_allocs);
+	return realloc(ptr, size);
+}
+
+static struct base_allocator counting_allocator = {
+	counting_malloc, counting_realloc, free
+};
+
+static const char *root_name = "profiler_bench_root";
+static const char *item_name = "item";
+static const char *nested_a_name = "nested_a";
+static const char *nested_b_name = "nested_b";
+
+#define PAIRS_PER_ITEM 3
+
+static void profile_root(int items)
+{
+	profile_start(root_name);
+
+	for (int i = 0; i < items; i++) {
+		profile_start(item_name);
+
+		profile_start(nested_a_name);
+		profile_end(nested_a_name);
+
+		profile_start(nested_b_name);
+		profile_end(nested_b_name);
+
+		profile_end(item_name);
+	}
+
+	profile_end(root_name);
+}
+
+int main(int argc, char *argv[])
+{
+	int roots = argc > 1 ? atoi(argv[1]) : 5000;
+	int items = argc > 2 ? atoi(argv[2]) : 100;
+	uint64_t pairs;
+	uint64_t start;
+	uint64_t elapsed;
+	long allocs;
+
+	if (roots <= 0 || items <= 0) {
+		printf("usage: profiler-bench [roots] [items per root]\n");
+		return 1;
+	}
+
+	base_set_allocator(&counting_allocator);
+
+	profiler_start();
+	profile_register_root(root_name, 0);
+
+	/* the first root fills the arena pool, leave it out of the results */
+	profile_root(items);
+
+	allocs = os_atomic_load_long(&heap_allocs);
+	start = os_gettime_ns();
+
+	for (int i = 0; i < roots; i++)
+		profile_root(items);
+
+	elapsed = os_gettime_ns() - start;
+	allocs = os_atomic_load_long(&heap_allocs) - allocs;
+
+	pairs = (uint64_t)roots * (items * PAIRS_PER_ITEM + 1);
+
+	printf("%d roots of %d items, %"PRIu64" start/end pairs\n",
+			roots, items, pairs);
+	printf("%.1f ns per start/end pair\n", (double)elapsed / pairs);
+	printf("%.2f allocations per root\n", (double)allocs / roots);
+
+	profiler_stop();
+	profiler_print(NULL);
+	profiler_free();
+	return 0;
+}